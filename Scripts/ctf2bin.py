@@ -0,0 +1,282 @@
+#!/usr/bin/env python
+
+# This script converts a file in CNTK text format into the chunked CNTK binary format,
+# which is read by the CNTKBinaryFormatDeserializer (module CNTKBinaryReader) without parsing.
+#
+# Each stream of the input is given by its name, its alias in the input file, its format (dense or sparse)
+# and its sample dimension, like in the "input" section of the CNTKTextFormatDeserializer configuration.
+# The streams are stored under their names. Sequences with the same id on consecutive lines form one
+# sequence; a line without a sequence id is a sequence of its own. Comments (|# ...) are skipped.
+#
+# Sequences are grouped into chunks of about --chunkSize bytes, the unit the randomizer loads and
+# the deserializer memory-maps. The format is described in Source/Readers/CNTKBinaryReader/BinaryDataDeserializer.h.
+
+# Example usage:
+#    ctf2bin.py --input train.ctf --output train.bin --stream features F dense 784 --stream labels L sparse 10
+#
+
+import sys
+import struct
+import argparse
+import tempfile
+import shutil
+
+MAGIC = b"CNTKBinF"
+VERSION = 1
+ALIGNMENT = 8
+
+class Stream:
+    def __init__(self, name, alias, format, dim):
+        if format not in ("dense", "sparse"):
+            raise Exception("Format of stream '{0}' must be 'dense' or 'sparse', not '{1}'".format(name, format))
+        self.name = name
+        self.alias = alias
+        self.sparse = format == "sparse"
+        self.dim = int(dim)
+
+def _padding(size):
+    return (ALIGNMENT - size % ALIGNMENT) % ALIGNMENT
+
+def _parseLine(line, streams, aliasToIndex, sequence):
+    # returns the sequence id of the line (None if not given), appends the samples of the line to 'sequence'
+    parts = line.rstrip('\r\n').split('|')
+    head = parts[0].strip()
+    sequenceId = int(head) if head != "" else None
+    for part in parts[1:]:
+        if part.startswith('#'):
+            continue
+        tokens = part.split()
+        if len(tokens) == 0:
+            continue
+        alias = tokens[0]
+        if alias not in aliasToIndex:
+            raise Exception("Unknown input alias '{0}' in line '{1}'".format(alias, line.rstrip('\r\n')))
+        index = aliasToIndex[alias]
+        stream = streams[index]
+        if stream.sparse:
+            sample = []
+            for token in tokens[1:]:
+                i, v = token.split(':')
+                if int(i) >= stream.dim:
+                    raise Exception("Index {0} exceeds the dimension {1} of input '{2}'".format(i, stream.dim, stream.name))
+                sample.append((int(i), float(v)))
+        else:
+            sample = [float(v) for v in tokens[1:]]
+            if len(sample) != stream.dim:
+                raise Exception("Sample of input '{0}' has {1} values, expected {2}".format(stream.name, len(sample), stream.dim))
+        sequence[index].append(sample)
+    return sequenceId
+
+def _sequenceSize(streams, sequence, valueSize):
+    size = 0
+    for stream, samples in zip(streams, sequence):
+        if stream.sparse:
+            nnz = sum(len(s) for s in samples)
+            size += nnz * (valueSize + 4) + len(samples) * 4
+        else:
+            size += len(samples) * stream.dim * valueSize
+        size += _padding(size)
+    return size
+
+def _writeChunk(output, streams, sequences, valueFormat):
+    # sequence table
+    numSamples = 0
+    for key, sequence in sequences:
+        output.write(struct.pack("<Q", key))
+        for stream, samples in zip(streams, sequence):
+            nnz = sum(len(s) for s in samples) if stream.sparse else 0
+            output.write(struct.pack("<II", len(samples), nnz))
+        numSamples += max(len(samples) for samples in sequence)
+    size = len(sequences) * (8 + 8 * len(streams))
+    output.write(b"\0" * _padding(size))
+    size += _padding(size)
+
+    # data
+    for key, sequence in sequences:
+        for stream, samples in zip(streams, sequence):
+            if stream.sparse:
+                values = [v for s in samples for (i, v) in s]
+                indices = [i for s in samples for (i, v) in s]
+                data = struct.pack("<" + valueFormat * len(values), *values)
+                data += struct.pack("<%di" % len(indices), *indices)
+                data += struct.pack("<%di" % len(samples), *[len(s) for s in samples])
+            else:
+                values = [v for s in samples for v in s]
+                data = struct.pack("<" + valueFormat * len(values), *values)
+            data += b"\0" * _padding(len(data))
+            output.write(data)
+            size += len(data)
+    return (size, len(sequences), numSamples)
+
+def convert(inputs, output, streams, chunkSize=32 * 1024 * 1024, precision="float"):
+    aliasToIndex = dict((s.alias, i) for i, s in enumerate(streams))
+    if len(aliasToIndex) != len(streams):
+        raise Exception("Stream aliases must be unique")
+    valueFormat, valueSize = ("f", 4) if precision == "float" else ("d", 8)
+
+    # the chunks are written to a temporary file first, because the chunk table precedes them
+    chunks = []
+    data = tempfile.TemporaryFile()
+    pending = []
+    pendingSize = 0
+
+    def flush():
+        if len(pending) > 0:
+            chunks.append(_writeChunk(data, streams, pending, valueFormat))
+            del pending[:]
+
+    def addSequence(key, sequence):
+        if not any(len(samples) > 0 for samples in sequence):
+            return 0
+        pending.append((key, sequence))
+        return _sequenceSize(streams, sequence, valueSize)
+
+    for input in inputs:
+        key = None
+        sequence = None
+        nextKey = 0
+        for line in input:
+            if line.strip() == "":
+                continue
+            samples = [[] for s in streams]
+            lineKey = _parseLine(line, streams, aliasToIndex, samples)
+            if lineKey is None or lineKey != key or sequence is None:
+                if sequence is not None:
+                    pendingSize += addSequence(key, sequence)
+                    if pendingSize >= chunkSize:
+                        flush()
+                        pendingSize = 0
+                key = lineKey if lineKey is not None else nextKey
+                nextKey = key + 1
+                sequence = samples
+            else:
+                for index in range(len(streams)):
+                    sequence[index].extend(samples[index])
+        if sequence is not None:
+            pendingSize += addSequence(key, sequence)
+    flush()
+
+    # header
+    header = MAGIC + struct.pack("<IIII", VERSION, 0 if precision == "float" else 1, len(streams), len(chunks))
+    for stream in streams:
+        name = stream.name.encode("ascii")
+        header += struct.pack("<III", 1 if stream.sparse else 0, stream.dim, len(name))
+        header += name + b"\0" * ((4 - len(name) % 4) % 4)
+    header += b"\0" * _padding(len(header))
+
+    # chunk table
+    offset = len(header) + len(chunks) * 24
+    for (size, numSequences, numSamples) in chunks:
+        header += struct.pack("<QQII", offset, size, numSequences, numSamples)
+        offset += size
+
+    output.write(header)
+    data.seek(0)
+    shutil.copyfileobj(data, output)
+    data.close()
+
+if __name__ == "__main__":
+    parser = argparse.ArgumentParser(description="Converts a file in CNTK text format into the CNTK binary format.")
+    parser.add_argument('--input', help='Name of the input files, stdin if not given', default="", nargs="*", required=False)
+    parser.add_argument('--output', help='Name of the output file', required=True)
+    parser.add_argument('--stream', help='Stream description: name alias format (dense or sparse) dimension',
+        nargs=4, action="append", metavar=("NAME", "ALIAS", "FORMAT", "DIM"), required=True)
+    parser.add_argument('--chunkSize', help='Approximate size of the chunks in bytes, default 32MB',
+        type=int, default=32 * 1024 * 1024, required=False)
+    parser.add_argument('--precision', help='Precision of the values, default float',
+        choices=["float", "double"], default="float", required=False)
+    args = parser.parse_args()
+
+    # creating inputs
+    inputs = [sys.stdin]
+    if len(args.input) != 0:
+        inputs = [open(i) for i in args.input]
+
+    with open(args.output, "wb") as output:
+        convert(inputs, output, [Stream(*s) for s in args.stream], args.chunkSize, args.precision)
+
+
+#####################################################################################################
+# Tests
+#####################################################################################################
+
+import io
+import pytest
+
+def _readChunks(binary):
+    # minimal reader of the binary format, returns the stream headers and per chunk the list of (key, [samples per stream])
+    assert binary[0:8] == MAGIC
+    version, elementType, numStreams, numChunks = struct.unpack_from("<IIII", binary, 8)
+    offset = 24
+    streams = []
+    for s in range(numStreams):
+        storage, dim, nameLength = struct.unpack_from("<III", binary, offset)
+        offset += 12
+        streams.append((binary[offset:offset + nameLength].decode("ascii"), storage, dim))
+        offset += nameLength + (4 - nameLength % 4) % 4
+    offset += _padding(offset)
+    chunks = []
+    for c in range(numChunks):
+        chunkOffset, size, numSequences, numSamples = struct.unpack_from("<QQII", binary, offset + 24 * c)
+        assert chunkOffset % ALIGNMENT == 0
+        sequences = []
+        dataOffset = chunkOffset + numSequences * (8 + 8 * numStreams)
+        dataOffset += _padding(dataOffset)
+        for i in range(numSequences):
+            entry = chunkOffset + i * (8 + 8 * numStreams)
+            key = struct.unpack_from("<Q", binary, entry)[0]
+            sequence = []
+            for s, (name, storage, dim) in enumerate(streams):
+                length, nnz = struct.unpack_from("<II", binary, entry + 8 + 8 * s)
+                if storage == 0:
+                    values = struct.unpack_from("<%df" % (length * dim), binary, dataOffset)
+                    sequence.append([list(values[j * dim:(j + 1) * dim]) for j in range(length)])
+                    dataOffset += 4 * length * dim
+                else:
+                    values = struct.unpack_from("<%df" % nnz, binary, dataOffset)
+                    indices = struct.unpack_from("<%di" % nnz, binary, dataOffset + 4 * nnz)
+                    counts = struct.unpack_from("<%di" % length, binary, dataOffset + 8 * nnz)
+                    samples = []
+                    position = 0
+                    for count in counts:
+                        samples.append(list(zip(indices[position:position + count], values[position:position + count])))
+                        position += count
+                    sequence.append(samples)
+                    dataOffset += 8 * nnz + 4 * length
+                dataOffset += _padding(dataOffset)
+            sequences.append((key, sequence))
+        assert dataOffset == chunkOffset + size
+        chunks.append(sequences)
+    return streams, chunks
+
+def test_simpleSanityCheck():
+    input = io.StringIO(u"0 |F 1 2 |L 1:1\n0 |F 3 4 |# comment\n5 |F 5 6 |L 0:1 2:0.5\n|F 7 8\n")
+    output = io.BytesIO()
+
+    convert([input], output, [Stream("features", "F", "dense", 2), Stream("labels", "L", "sparse", 3)])
+
+    streams, chunks = _readChunks(output.getvalue())
+    assert streams == [("features", 0, 2), ("labels", 1, 3)]
+    assert len(chunks) == 1
+    assert chunks[0] == [
+        (0, [[[1, 2], [3, 4]], [[(1, 1)]]]),
+        (5, [[[5, 6]], [[(0, 1), (2, 0.5)]]]),
+        (6, [[[7, 8]], []])]
+
+def test_chunking():
+    input = io.StringIO(u"".join(u"%d |F %d\n" % (i, i) for i in range(10)))
+    output = io.BytesIO()
+
+    convert([input], output, [Stream("features", "F", "dense", 1)], chunkSize=32)
+
+    streams, chunks = _readChunks(output.getvalue())
+    assert [len(c) for c in chunks] == [4, 4, 2]
+    assert [key for c in chunks for (key, sequence) in c] == list(range(10))
+
+def test_wrongDimension():
+    input = io.StringIO(u"0 |F 1 2 3\n")
+    output = io.BytesIO()
+
+    with pytest.raises(Exception) as info:
+        convert([input], output, [Stream("features", "F", "dense", 2)])
+    assert str(info.value) == "Sample of input 'features' has 3 values, expected 2"
@@ -64,6 +64,21 @@ static void DoEvalBase(const ConfigParameters& config, IDataReader& reader)
 
     bool enableDistributedMBReading = config(L"distributedMBReading", false);
 
+    // with half-precision parameters, optionally evaluate the full-precision model first to report the accuracy drift
+    bool halfPrecisionDriftReport = config(L"halfPrecisionParameters", false) && config(L"halfPrecisionDriftReport", false);
+    vector<EpochCriterion> fullPrecisionCriteria;
+    if (halfPrecisionDriftReport)
+    {
+        ConfigParameters fullPrecisionConfig(config);
+        fullPrecisionConfig.Insert("halfPrecisionParameters", "false");
+        vector<wstring> fullPrecisionEvalNodeNames;
+        let fullPrecisionNet = GetModelFromConfig<ConfigParameters, ElemType>(fullPrecisionConfig, L"evalNodeNames", fullPrecisionEvalNodeNames);
+        SimpleEvaluator<ElemType> fullPrecisionEval(fullPrecisionNet, MPIWrapper::GetInstance(), enableDistributedMBReading, numMBsToShowResult,
+                                                    firstMBsToShowResult, traceLevel, maxSamplesInRAM, numSubminiBatches);
+        fprintf(stderr, "Evaluating the full-precision model for the half-precision drift report.\n");
+        fullPrecisionCriteria = fullPrecisionEval.Evaluate(&reader, fullPrecisionEvalNodeNames, mbSize[0], epochSize);
+    }
+
     vector<wstring> evalNodeNamesVector;
 
     let net = GetModelFromConfig<ConfigParameters, ElemType>(config, L"evalNodeNames", evalNodeNamesVector);
@@ -75,7 +90,19 @@ static void DoEvalBase(const ConfigParameters& config, IDataReader& reader)
 
     SimpleEvaluator<ElemType> eval(net, MPIWrapper::GetInstance(), enableDistributedMBReading, numMBsToShowResult, 
                                    firstMBsToShowResult, traceLevel, maxSamplesInRAM, numSubminiBatches);
-    eval.Evaluate(&reader, evalNodeNamesVector, mbSize[0], epochSize);
+    auto criteria = eval.Evaluate(&reader, evalNodeNamesVector, mbSize[0], epochSize);
+
+    if (halfPrecisionDriftReport)
+    {
+        for (size_t i = 0; i < criteria.size() && i < fullPrecisionCriteria.size(); i++)
+        {
+            double fullPrecision = fullPrecisionCriteria[i].Average();
+            double halfPrecision = criteria[i].Average();
+            fprintf(stderr, "Half-precision drift: criterion %d: full precision %.8g, half precision %.8g, difference %.4g (%.4g%% relative)\n",
+                    (int)i, fullPrecision, halfPrecision, halfPrecision - fullPrecision,
+                    fullPrecision != 0 ? 100 * (halfPrecision - fullPrecision) / fabs(fullPrecision) : 0.0);
+        }
+    }
 }
 
 template <typename ElemType>
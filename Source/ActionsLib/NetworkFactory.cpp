@@ -178,6 +178,22 @@ ComputationNetworkPtr GetModelFromConfig(const ConfigRecordType& config, const w
         net->CompileNetwork();
     }
 
+    // for inference, optionally remove Dropout, precompute constants, and fold BatchNormalization, and save the result
+    if (config(L"optimizeForInference", false))
+    {
+        net->OptimizeForInference<ElemType>(config(L"latencyTestSamples", (size_t) 0));
+        wstring optimizedModelPath = config(L"optimizedModelPath", L"");
+        if (!optimizedModelPath.empty())
+        {
+            net->Save(optimizedModelPath);
+            fprintf(stderr, "Optimized model saved to '%ls'.\n", optimizedModelPath.c_str());
+        }
+    }
+
+    // for CPU inference, optionally store the weight matrices in half precision
+    if (config(L"halfPrecisionParameters", false))
+        net->StoreParametersInHalfPrecision<ElemType>();
+
     return net;
 }
 
@@ -186,6 +186,8 @@ void DoEdit(const ConfigParameters& config)
     {
         ndlScript.LoadConfigFile(ndlMacros);
     }
+    // MEL refers to nodes by name, so by default keep the element-wise nodes that CompileNetwork() would otherwise fuse
+    ComputationNetwork::SetElementwiseFusion(config(L"fuseElementwiseNodes", false));
     MELScript<ElemType> melScript;
     melScript.LoadConfigFileAndResolveVariables(editPath, config);
 }
@@ -535,6 +535,8 @@ int wmainWithBS(int argc, wchar_t* argv[]) // called from wmain which is a wrapp
         mpi = MPIWrapper::GetInstance(true /*create*/);
 
     g_shareNodeValueMatrices = config(L"shareNodeValueMatrices", false);
+    ComputationNetwork::SetElementwiseFusion(config(L"fuseElementwiseNodes", false));
+    ComputationNetwork::SetConcurrentNodeExecution(config(L"concurrentNodeThreads", (size_t) 0));
 
     TracingGPUMemoryAllocator::SetTraceLevel(config(L"traceGPUMemoryAllocations", 0));
 
@@ -648,6 +650,8 @@ int wmainOldCNTKConfig(int argc, wchar_t* argv[])
         mpi = MPIWrapper::GetInstance(true /*create*/);
 
     g_shareNodeValueMatrices = config(L"shareNodeValueMatrices", false);
+    ComputationNetwork::SetElementwiseFusion(config(L"fuseElementwiseNodes", false));
+    ComputationNetwork::SetConcurrentNodeExecution(config(L"concurrentNodeThreads", (size_t) 0));
 
     TracingGPUMemoryAllocator::SetTraceLevel(config(L"traceGPUMemoryAllocations", 0));
 
@@ -582,6 +582,26 @@ void MELScript<ElemType>::CallFunction(const std::string& p_name, const ConfigPa
             netNdlFrom->cn->RenameNode(node, nodeName.second);
         }
     }
+    else if (EqualInsensitive(name, "OptimizeForInference"))
+    {
+        size_t numFixedParams = 1, numOptionalParams = 1;
+        if (params.size() > numFixedParams + numOptionalParams || params.size() < numFixedParams)
+            RuntimeError("Invalid number of parameters. Valid parameters: OptimizeForInference(modelName, [latencyTestSamples=0]).");
+
+        size_t latencyTestSamples = GetOptionalLatencyTestSamples(params, numFixedParams);
+
+        std::string modelName = params[0];
+        auto found = m_mapNameToNetNdl.find(modelName);
+        if (found == m_mapNameToNetNdl.end() || found->second.cn == NULL)
+            RuntimeError("OptimizeForInference can only be called after a network has been setup, no active model named %s.", modelName.c_str());
+
+        // validate and finish the second pass through NDL if any in-line NDL was defined
+        NetNdl<ElemType>* netNdl = &found->second;
+        ProcessNDLScript(netNdl, ndlPassAll, true);
+        netNdl->cn->InvalidateCompiledNetwork();
+        netNdl->cn->CompileNetwork();
+        netNdl->cn->template OptimizeForInference<ElemType>(latencyTestSamples);
+    }
     else if (EqualInsensitive(name, "ReviseParameter"))
     {
         typedef LearnableParameter<ElemType> LearnableParameterNode;
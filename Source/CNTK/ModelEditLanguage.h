@@ -471,6 +471,29 @@ public:
         return modelFormat;
     }
 
+    size_t GetOptionalLatencyTestSamples(const ConfigParamList& params, const size_t numFixedParams)
+    {
+        size_t latencyTestSamples = 0;
+        for (size_t paramNumber = params.size(); paramNumber > numFixedParams; paramNumber--)
+        {
+            // process optional parameter if it exists
+            std::string propName, value;
+            if (OptionalParameter(params[paramNumber - 1], propName, value))
+            {
+                if (EqualInsensitive(propName, "latencyTestSamples"))
+                {
+                    latencyTestSamples = ConfigValue(value);
+                }
+                else
+                {
+                    RuntimeError("Invalid optional parameter %s, valid optional parameters: latencyTestSamples=numSamples", propName.c_str());
+                }
+            }
+        }
+
+        return latencyTestSamples;
+    }
+
     std::string GetOptionalSnippetSection(const ConfigParamList& params, const size_t numFixedParams)
     {
         // process optional parameter if it exists
@@ -1396,4 +1396,21 @@ namespace CNTK
     /// of the computation graph which can be "Combine"d to create a single Function with 2 outputs; viz. CrossEntropy loss and ClassificationError output.
     ///
     CNTK_API FunctionPtr Combine(const std::initializer_list<FunctionPtr>& operands, const std::wstring& name = L"");
+
+    ///
+    /// Counters of the caches used by Forward and Backward for converting between the padded sequences of Value objects and
+    /// CNTK's internal packed minibatch layout. Calls with the same sequence lengths as an earlier call reuse its packed layout
+    /// and gather/scatter indices; 'm_secondsSaved' is the time it originally took to create what was reused.
+    ///
+    struct PackingCacheStatistics
+    {
+        size_t m_numHits;
+        size_t m_numMisses;
+        double m_secondsSaved;
+    };
+
+    ///
+    /// Returns the counters of the packing caches, accumulated over all Functions since the library was loaded.
+    ///
+    CNTK_API PackingCacheStatistics GetPackingCacheStatistics();
 }
@@ -10,6 +10,7 @@
 #include "Utils.h"
 #include "ComputationNode.h"
 #include "ReshapingNodes.h"
+#include <mutex>
 
 using namespace Microsoft::MSR::CNTK;
 
@@ -288,6 +289,8 @@ namespace CNTK
         if (m_computationNetwork == nullptr)
         {
             m_computationNetwork = std::make_shared<ComputationNetwork>(AsCNTKImplDeviceId(device));
+            // m_variableToNodeMap refers to the nodes of the network, which must therefore not be replaced by fused nodes
+            m_computationNetwork->DisallowElementwiseFusion();
 
             ComputationNetworkBuilder<ElementType> builder(*m_computationNetwork);
 
@@ -364,6 +367,67 @@ namespace CNTK
         return m_computationNetwork;
     }
 
+    // Converting between the padded sequences of a Value object and the packed MBLayout of the network
+    // requires the packed layout and a vector of gather (or scatter) column indices. Both only depend on
+    // the sequence lengths, which usually repeat across calls (e.g. in evaluation or bucketed training),
+    // so they are cached by that signature. All of this state is guarded by s_packingCacheMutex.
+    static std::mutex s_packingCacheMutex;
+    static PackedMBLayoutCache s_packedLayoutCache;
+    static PackedMBLayoutCache::Statistics s_columnIndexCacheStatistics;
+
+    template <typename ElementType>
+    struct ColumnIndexCache
+    {
+        // (device, signature) -> (index row vector, seconds it took to create it)
+        typedef std::map<std::pair<DEVICEID_TYPE, std::vector<size_t>>, std::pair<std::shared_ptr<const Matrix<ElementType>>, double>> IndexMap;
+
+        static IndexMap s_gatherIndices;
+        static IndexMap s_scatterIndices;
+
+        static const size_t s_maxEntries = 1024;
+
+        // returns the cached indices for 'signature', calling 'computeIndices' to fill the index vector on a miss
+        template <typename ComputeIndicesFunction>
+        static std::shared_ptr<const Matrix<ElementType>> Get(IndexMap& indexMap, DEVICEID_TYPE deviceId, const std::vector<size_t>& signature, size_t numCols, const ComputeIndicesFunction& computeIndices)
+        {
+            auto key = std::make_pair(deviceId, signature);
+            auto found = indexMap.find(key);
+            if (found != indexMap.end())
+            {
+                s_columnIndexCacheStatistics.OnHit(found->second.second);
+                return found->second.first;
+            }
+
+            s_columnIndexCacheStatistics.OnMiss();
+            if (indexMap.size() >= s_maxEntries)
+                indexMap.clear();
+
+            Timer timer;
+            timer.Start();
+            std::vector<ElementType> indices(numCols);
+            computeIndices(indices);
+            auto indexMatrix = std::make_shared<const Matrix<ElementType>>(1, numCols, indices.data(), deviceId);
+            timer.Stop();
+
+            indexMap[key] = std::make_pair(indexMatrix, timer.ElapsedSeconds());
+            return indexMatrix;
+        }
+    };
+
+    template <typename ElementType>
+    typename ColumnIndexCache<ElementType>::IndexMap ColumnIndexCache<ElementType>::s_gatherIndices;
+
+    template <typename ElementType>
+    typename ColumnIndexCache<ElementType>::IndexMap ColumnIndexCache<ElementType>::s_scatterIndices;
+
+    PackingCacheStatistics GetPackingCacheStatistics()
+    {
+        std::lock_guard<std::mutex> lock(s_packingCacheMutex);
+        PackedMBLayoutCache::Statistics statistics = s_packedLayoutCache.GetStatistics();
+        statistics += s_columnIndexCacheStatistics;
+        return{ statistics.m_numHits, statistics.m_numMisses, statistics.m_secondsSaved };
+    }
+
     template <typename ElementType>
     /*static*/ std::pair<std::shared_ptr<const Matrix<ElementType>>, MBLayoutPtr> CompositeFunction::GetCNTKImplMatrixAndMBLayoutFromValueObject(Variable var, const ValuePtr& value)
     {
@@ -442,44 +506,48 @@ namespace CNTK
             }
 
             // The data needs to be rearranged since CNTK requires sequences to be interleaved across timesteps
-            std::vector<MBLayout::SequenceInfo> sequences;
-            for (size_t i = 0; i < numSequences; ++i)
-                sequences.push_back({ i, SIZE_MAX, 0, sequenceLengths[i]});
+            // The packed layout is shared with other calls for the same sequence lengths; our callers only copy from it
+            MBLayoutPtr layout;
+            std::shared_ptr<const Matrix<ElementType>> gatherIdxMatrix;
+            {
+                std::lock_guard<std::mutex> lock(s_packingCacheMutex);
+                const auto& packing = s_packedLayoutCache.Get(sequenceLengths);
+                layout = packing.m_layout;
+
+                // Now generate the gather indices
+                gatherIdxMatrix = ColumnIndexCache<ElementType>::Get(ColumnIndexCache<ElementType>::s_gatherIndices, AsCNTKImplDeviceId(value->Data()->Device()), sequenceLengths, layout->GetNumCols(),
+                    [&](std::vector<ElementType>& gatherIndicesVector)
+                    {
+                        std::vector<size_t> sequencesShorterThanLongestSequence;
+                        for (size_t i = 0; i < numSequences; ++i)
+                            if (sequenceLengths[i] != maxNumTimeSteps)
+                                sequencesShorterThanLongestSequence.push_back(i);
+
+                        // Set the source location for all gaps to be the last step of the first sequence that is shorter than the longest sequence in the batch
+                        size_t sourceColIdxForInvalidColumns = sequencesShorterThanLongestSequence.empty() ? 0 : (((sequencesShorterThanLongestSequence[0] + 1) * maxNumTimeSteps) - 1);
+                        std::fill(gatherIndicesVector.begin(), gatherIndicesVector.end(), (ElementType)sourceColIdxForInvalidColumns);
+                        for (size_t i = 0; i < numSequences; ++i)
+                        {
+                            size_t targetParallelStreamIdx = packing.m_placement[i].first;
+                            size_t targetStartIdxInParallelStream = packing.m_placement[i].second;
+                            for (size_t j = 0; j < sequenceLengths[i]; ++j)
+                                gatherIndicesVector[((targetStartIdxInParallelStream + j) * layout->GetNumParallelSequences()) + targetParallelStreamIdx] = (ElementType)((i * maxNumTimeSteps) + j);
+                        }
+                    });
+            }
 
-            auto layout = std::make_shared<MBLayout>();
-            std::vector<std::pair<size_t, size_t>> placement;
-            std::vector<size_t> rowAllocations;
-            layout->InitAsPackedSequences(sequences, placement, rowAllocations);
             if (maxNumTimeSteps != layout->GetNumTimeSteps())
                 LogicError("The number of time steps in the packed MBLayout does not match the longest sequence's length in the Value object");
 
             if (numSequences != layout->GetNumSequences())
                 LogicError("The number of sequences in the packed MBLayout does not match the sequence count in the Value object");
 
-            // Now generate the gather indices
             auto matrixData = std::make_shared<Matrix<ElementType>>(var.Shape().TotalSize(),
                                                                     layout->GetNumCols(),
                                                                     AsCNTKImplDeviceId(value->Data()->Device()),
                                                                     value->Data()->IsSparse() ? MatrixType::SPARSE : MatrixType::DENSE,
                                                                     AsCNTKImplMatrixFormat(value->Data()->GetStorageFormat()));
 
-            std::vector<size_t> sequencesShorterThanLongestSequence;
-            for (size_t i = 0; i < numSequences; ++i)
-                if (sequenceLengths[i] != maxNumTimeSteps)
-                    sequencesShorterThanLongestSequence.push_back(i);
-
-            // Set the source location for all gaps to be the last step of the first sequence that is shorter than the longest sequence in the batch
-            size_t sourceColIdxForInvalidColumns = sequencesShorterThanLongestSequence.empty() ? 0 : (((sequencesShorterThanLongestSequence[0] + 1) * maxNumTimeSteps) - 1);
-            std::vector<ElementType> gatherIndicesVector(layout->GetNumCols(), (ElementType)sourceColIdxForInvalidColumns);
-            for (size_t i = 0; i < numSequences; ++i)
-            {
-                size_t targetParallelStreamIdx = placement[i].first;
-                size_t targetStartIdxInParallelStream = placement[i].second;
-                for (size_t j = 0; j < sequenceLengths[i]; ++j)
-                    gatherIndicesVector[((targetStartIdxInParallelStream + j) * layout->GetNumParallelSequences()) + targetParallelStreamIdx] = (ElementType)((i * maxNumTimeSteps) + j);
-            }
-
-            auto gatherIdxMatrix = std::make_shared<Matrix<ElementType>>(1, layout->GetNumCols(), gatherIndicesVector.data(), AsCNTKImplDeviceId(value->Data()->Device()));
             matrixData->DoGatherColumnsOf(0, *gatherIdxMatrix, *(value->Data()->GetMatrix<ElementType>(var.Shape().NumAxes())), 1);
             return{ matrixData, layout };
         }
@@ -533,24 +601,43 @@ namespace CNTK
             if (sequenceLengths[i] != maxNumTimeSteps)
                 sequencesShorterThanLongestSequence.push_back(i);
 
-        // Set the target location of all gaps to be the last step of the first sequence that is shorter than the longest sequence in the batch
-        size_t targetColIdxForInvalidColumns = sequencesShorterThanLongestSequence.empty() ? 0 : (((sequencesShorterThanLongestSequence[0] + 1) * maxNumTimeSteps) - 1);
-        std::vector<ElementType> scatterIndicesVector(layout->GetNumCols(), (ElementType)targetColIdxForInvalidColumns);
-        size_t i = 0;
+        // The scatter indices are determined by where the layout places each sequence
+        std::vector<size_t> layoutSignature = { layout->GetNumParallelSequences(), maxNumTimeSteps };
         for (auto sequenceInfo : layoutSequences)
         {
             if (sequenceInfo.seqId != GAP_SEQUENCE_ID)
             {
-                size_t targetParallelStreamIdx = sequenceInfo.s;
-                size_t targetStartIdxInParallelStream = sequenceInfo.tBegin;
-                for (size_t j = 0; j < sequenceInfo.GetNumTimeSteps(); ++j)
-                    scatterIndicesVector[((targetStartIdxInParallelStream + j) * layout->GetNumParallelSequences()) + targetParallelStreamIdx] = (ElementType)((i * maxNumTimeSteps) + j);
-
-                i++;
+                layoutSignature.push_back(sequenceInfo.s);
+                layoutSignature.push_back((size_t)sequenceInfo.tBegin);
+                layoutSignature.push_back(sequenceInfo.GetNumTimeSteps());
             }
         }
 
-        auto scatterIdxMatrix = std::make_shared<Matrix<ElementType>>(1, layout->GetNumCols(), scatterIndicesVector.data(), matrix.GetDeviceId());
+        std::shared_ptr<const Matrix<ElementType>> scatterIdxMatrix;
+        {
+            std::lock_guard<std::mutex> lock(s_packingCacheMutex);
+            scatterIdxMatrix = ColumnIndexCache<ElementType>::Get(ColumnIndexCache<ElementType>::s_scatterIndices, matrix.GetDeviceId(), layoutSignature, layout->GetNumCols(),
+                [&](std::vector<ElementType>& scatterIndicesVector)
+                {
+                    // Set the target location of all gaps to be the last step of the first sequence that is shorter than the longest sequence in the batch
+                    size_t targetColIdxForInvalidColumns = sequencesShorterThanLongestSequence.empty() ? 0 : (((sequencesShorterThanLongestSequence[0] + 1) * maxNumTimeSteps) - 1);
+                    std::fill(scatterIndicesVector.begin(), scatterIndicesVector.end(), (ElementType)targetColIdxForInvalidColumns);
+                    size_t i = 0;
+                    for (auto sequenceInfo : layoutSequences)
+                    {
+                        if (sequenceInfo.seqId != GAP_SEQUENCE_ID)
+                        {
+                            size_t targetParallelStreamIdx = sequenceInfo.s;
+                            size_t targetStartIdxInParallelStream = sequenceInfo.tBegin;
+                            for (size_t j = 0; j < sequenceInfo.GetNumTimeSteps(); ++j)
+                                scatterIndicesVector[((targetStartIdxInParallelStream + j) * layout->GetNumParallelSequences()) + targetParallelStreamIdx] = (ElementType)((i * maxNumTimeSteps) + j);
+
+                            i++;
+                        }
+                    }
+                });
+        }
+
         shuffledMatrixData->DoScatterColumnsOf(0, *scatterIdxMatrix, matrix, 1);
 
         // Create the mask if needed
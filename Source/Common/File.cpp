@@ -14,6 +14,8 @@
 #include <string>
 #include <stdint.h>
 #include <locale>
+#include <climits>
+#include <algorithm>
 #ifdef _WIN32
 #define NOMINMAX
 #include "Windows.h"
@@ -273,6 +275,13 @@ void File::Flush()
     fflushOrDie(m_file);
 }
 
+void File::SetBuffer(char* buffer, size_t size)
+{
+    size = std::min(size, (size_t) INT_MAX); // limit of the MSVC runtime
+    if (setvbuf(m_file, buffer, _IOFBF, size) != 0)
+        RuntimeError("File: failed to set a buffer of %d bytes for %S", (int) size, m_filename.c_str());
+}
+
 // read a line
 // End of line is denoted by one of these, i.e. we don't support the old Mac OS convention of CR
 //  - LF
@@ -340,6 +340,42 @@ public:
     // (e.g. when vectors are manages by .net)
     // 
     virtual void ForwardPass(const ValueRefs<ElemType>& inputs, ValueRefs<ElemType>& output) = 0;
+
+    //
+    // Streaming evaluation of recurrent models. A session carries the state of the recurrent (PastValue) nodes
+    // from one ForwardPass() call to the next, so that a sequence can be passed in pieces as its samples arrive,
+    // and each call only computes the outputs of its new samples. Sessions are independent of each other.
+    // Models that look into the future (FutureValue) cannot be evaluated in a session.
+    // Sessions are reset by StartForwardEvaluation().
+    //
+
+    //
+    // CreateSession - create a session and return its handle. The first call on the session starts a new sequence.
+    //
+    virtual size_t CreateSession() = 0;
+
+    //
+    // ResetSession - end the sequence of the session; the next call on the session starts a new sequence.
+    //
+    virtual void ResetSession(size_t session) = 0;
+
+    //
+    // DestroySession - release the state held by the session.
+    //
+    virtual void DestroySession(size_t session) = 0;
+
+    //
+    // ForwardPass - same as above, but the inputs continue the sequence of the given session.
+    //
+    virtual void ForwardPass(size_t session, const Values<ElemType>& inputs, Values<ElemType>& output) = 0;
+    virtual void ForwardPass(size_t session, const ValueRefs<ElemType>& inputs, ValueRefs<ElemType>& output) = 0;
+
+    //
+    // ForwardPass - same as above for several sessions at once, in a single forward pass over a minibatch with one
+    // sequence per session. inputs[k] and outputs[k] are the inputs and outputs of sessions[k].
+    //
+    virtual void ForwardPass(const std::vector<size_t>& sessions, const std::vector<Values<ElemType>>& inputs, std::vector<Values<ElemType>>& outputs) = 0;
+    virtual void ForwardPass(const std::vector<size_t>& sessions, const std::vector<ValueRefs<ElemType>>& inputs, std::vector<ValueRefs<ElemType>>& outputs) = 0;
 };
 
 template <typename ElemType>
@@ -109,6 +109,11 @@ public:
 
     void Flush();
 
+    // Makes the stream fully buffered in the given memory (setvbuf()), which must stay valid until the file is closed.
+    // Must be called before the first read or write. With a buffer larger than the content, writes only copy into
+    // memory, and the data is written to disk by Flush() or when the file is closed.
+    void SetBuffer(char* buffer, size_t size);
+
     bool CanSeek() const { return m_seekable; }
     size_t Size();
     uint64_t GetPosition();
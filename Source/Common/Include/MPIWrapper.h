@@ -19,6 +19,7 @@
 #include <array>
 #include <vector>
 #include <memory>
+#include <algorithm>
 
 namespace Microsoft { namespace MSR { namespace CNTK {
 
@@ -70,6 +71,15 @@ class MPIWrapper : public std::enable_shared_from_this<MPIWrapper>
     // MPI communicator that reflects the current subset selection
     MPI_Comm m_currentComm;
 
+    // Host hierarchy of MPI_COMM_WORLD: the ranks of each host, and the leaders (lowest rank) of all hosts.
+    // m_interHostComm is MPI_COMM_NULL on ranks that are not the leader of their host.
+    MPI_Comm m_intraHostComm;
+    MPI_Comm m_interHostComm;
+    size_t m_ranksPerHost;           // as requested by SetRanksPerHost(), 0: ranks that share memory
+    size_t m_numHosts;
+    std::vector<int> m_hostOfRank;   // host index (= rank in m_interHostComm of its leader) of every rank
+    std::vector<int> m_hostRankOfRank; // rank in m_intraHostComm of every rank
+
     static MPIWrapperPtr s_mpi;
 
     // MPI_Init() with delay-loading the msmpi.dll (possibly causing a failure if missing; we want to catch that)
@@ -119,7 +129,7 @@ class MPIWrapper : public std::enable_shared_from_this<MPIWrapper>
 
 public:
     MPIWrapper()
-        : m_currentComm(MPI_COMM_WORLD)
+        : m_currentComm(MPI_COMM_WORLD), m_intraHostComm(MPI_COMM_NULL), m_interHostComm(MPI_COMM_NULL), m_ranksPerHost(0), m_numHosts(1)
     {
         static bool initialized = false;
         if (initialized)
@@ -153,6 +163,8 @@ public:
         // do an initial handshake
         Ping("mpihelper");
 
+        CreateHostCommunicators();
+
         // stagger the jobs just a little to get a sort-of deterministic order e.g. in GPU allocation when running on one machine
         // continue 0.5 seconds apart
         ::Sleep((DWORD)(500 * CurrentNodeRank()));
@@ -236,6 +248,95 @@ private:
         Ping("requestnodes (after change)");
     }
 
+    // Splits MPI_COMM_WORLD into one communicator per host and one across the host leaders.
+    // The hosts are the groups of ranks that can share memory (MPI_COMM_TYPE_SHARED), or consecutive groups of m_ranksPerHost ranks.
+    void CreateHostCommunicators()
+    {
+        if (m_intraHostComm != MPI_COMM_NULL)
+            MPI_Comm_free(&m_intraHostComm) || MpiFail("CreateHostCommunicators: MPI_Comm_free");
+        if (m_interHostComm != MPI_COMM_NULL)
+            MPI_Comm_free(&m_interHostComm) || MpiFail("CreateHostCommunicators: MPI_Comm_free");
+
+        if (m_ranksPerHost == 0)
+            MPI_Comm_split_type(MPI_COMM_WORLD, MPI_COMM_TYPE_SHARED, m_myRank, MPI_INFO_NULL, &m_intraHostComm) || MpiFail("CreateHostCommunicators: MPI_Comm_split_type");
+        else
+            MPI_Comm_split(MPI_COMM_WORLD, (int) (m_myRank / m_ranksPerHost), m_myRank, &m_intraHostComm) || MpiFail("CreateHostCommunicators: MPI_Comm_split");
+
+        // ranks are ordered by their world rank in both communicators, so the leader of a host is its lowest rank
+        int hostRank;
+        MPI_Comm_rank(m_intraHostComm, &hostRank);
+        MPI_Comm_split(MPI_COMM_WORLD, (hostRank == 0) ? 0 : MPI_UNDEFINED, m_myRank, &m_interHostComm) || MpiFail("CreateHostCommunicators: MPI_Comm_split");
+
+        int host = 0;
+        if (m_interHostComm != MPI_COMM_NULL)
+            MPI_Comm_rank(m_interHostComm, &host);
+        MPI_Bcast(&host, 1, MPI_INT, 0, m_intraHostComm) || MpiFail("CreateHostCommunicators: MPI_Bcast");
+
+        int hostAndRank[2] = {host, hostRank};
+        std::vector<int> allHostsAndRanks(2 * m_numMPINodes);
+        MPI_Allgather(hostAndRank, 2, MPI_INT, allHostsAndRanks.data(), 2, MPI_INT, MPI_COMM_WORLD) || MpiFail("CreateHostCommunicators: MPI_Allgather");
+        m_hostOfRank.resize(m_numMPINodes);
+        m_hostRankOfRank.resize(m_numMPINodes);
+        m_numHosts = 0;
+        for (int rank = 0; rank < m_numMPINodes; rank++)
+        {
+            m_hostOfRank[rank] = allHostsAndRanks[2 * rank];
+            m_hostRankOfRank[rank] = allHostsAndRanks[2 * rank + 1];
+            m_numHosts = std::max(m_numHosts, (size_t) m_hostOfRank[rank] + 1);
+        }
+
+        fprintf(stderr, "mpihelper: %d MPI nodes on %d hosts; we (%d) are rank %d on host %d\n",
+                (int) m_numMPINodes, (int) m_numHosts, (int) m_myRank, hostRank, host);
+        fflush(stderr);
+    }
+
+    // allreduce (sum) of a raw buffer over 'comm' with the ring algorithm, see RingAllReduce()
+    template <class ElemType>
+    static void RingAllReduce(ElemType *pData, size_t nData, MPI_Comm comm)
+    {
+        int rankInComm, numNodesInComm;
+        MPI_Comm_rank(comm, &rankInComm);
+        MPI_Comm_size(comm, &numNodesInComm);
+        const size_t rank = rankInComm;
+        const size_t numNodes = numNodesInComm;
+        if ((numNodes <= 1) || (nData == 0))
+            return;
+
+        // node i initially sends segment i; segment s is [segmentBegin(s), segmentBegin(s + 1))
+        auto segmentBegin = [nData, numNodes](size_t segment)
+        {
+            return (nData / numNodes) * segment + std::min(segment, nData % numNodes);
+        };
+
+        const int next = (int) ((rank + 1) % numNodes);
+        const int prev = (int) ((rank + numNodes - 1) % numNodes);
+        const int tag = 0x5249; // 'RI', MPI only guarantees tags up to 32767 (MPI_TAG_UB)
+        std::vector<ElemType> received((nData + numNodes - 1) / numNodes);
+
+        // reduce-scatter: after step k, segment (rank - k - 1) holds the sum over k + 2 nodes; finally node i owns segment i + 1
+        for (size_t step = 0; step + 1 < numNodes; step++)
+        {
+            const size_t sendSegment = (rank + numNodes - step) % numNodes;
+            const size_t recvSegment = (rank + numNodes - step - 1) % numNodes;
+            const size_t recvBegin = segmentBegin(recvSegment);
+            const size_t recvCount = segmentBegin(recvSegment + 1) - recvBegin;
+            MPI_Sendrecv(pData + segmentBegin(sendSegment), (int) (segmentBegin(sendSegment + 1) - segmentBegin(sendSegment)), GetDataType(pData), next, tag,
+                         received.data(), (int) recvCount, GetDataType(pData), prev, tag, comm, MPI_STATUS_IGNORE) || MpiFail("RingAllReduce: MPI_Sendrecv");
+            for (size_t i = 0; i < recvCount; i++)
+                pData[recvBegin + i] += received[i];
+        }
+
+        // allgather: pass the reduced segments around the ring
+        for (size_t step = 0; step + 1 < numNodes; step++)
+        {
+            const size_t sendSegment = (rank + 1 + numNodes - step) % numNodes;
+            const size_t recvSegment = (rank + numNodes - step) % numNodes;
+            MPI_Sendrecv(pData + segmentBegin(sendSegment), (int) (segmentBegin(sendSegment + 1) - segmentBegin(sendSegment)), GetDataType(pData), next, tag,
+                         pData + segmentBegin(recvSegment), (int) (segmentBegin(recvSegment + 1) - segmentBegin(recvSegment)), GetDataType(pData), prev, tag,
+                         comm, MPI_STATUS_IGNORE) || MpiFail("RingAllReduce: MPI_Sendrecv");
+        }
+    }
+
 public:
 
     static MPIWrapperPtr GetInstance(bool create = false)
@@ -337,6 +438,19 @@ public:
         }
     }
 
+    // allreduce (sum) of a raw buffer with the ring algorithm: a reduce-scatter followed by an allgather,
+    // each passing 1/NumNodesInUse() of the buffer to the next node in NumNodesInUse()-1 steps.
+    // Every node sends and receives 2 (n-1)/n of the buffer independent of the number of nodes (bandwidth-optimal),
+    // while the latency grows linearly with the number of nodes, so this is meant for large (fused) buffers.
+    template <class ElemType>
+    void RingAllReduce(ElemType *pData, size_t nData) const
+    {
+        if ((NumNodesInUse() > 1) && (Communicator() != MPI_COMM_NULL))
+        {
+            RingAllReduce(pData, nData, Communicator());
+        }
+    }
+
     template <class ElemType>
     void Bcast(ElemType *pData, size_t nData, size_t srcRank)
     {
@@ -346,6 +460,97 @@ public:
         }
     }
 
+    // -----------------------------------------------------------------------
+    // hierarchical data exchange: within each host, then across one leader per host
+    // -----------------------------------------------------------------------
+
+    // Groups consecutive ranks into hosts of 'ranksPerHost' ranks (0: the ranks that can share memory, the default).
+    // A collective call; mainly meant to exercise the hierarchical functions with several ranks on a single machine.
+    void SetRanksPerHost(size_t ranksPerHost)
+    {
+        if (ranksPerHost != m_ranksPerHost)
+        {
+            m_ranksPerHost = ranksPerHost;
+            CreateHostCommunicators();
+        }
+    }
+
+    size_t NumHosts() const
+    {
+        return m_numHosts;
+    }
+    MPI_Comm IntraHostCommunicator() const
+    {
+        return m_intraHostComm;
+    }
+    MPI_Comm InterHostCommunicator() const
+    {
+        return m_interHostComm;
+    } // MPI_COMM_NULL unless we are the leader of our host
+
+    // true if some host runs several of the nodes in use, so that the hierarchical functions save network traffic
+    bool HasHostHierarchy() const
+    {
+        return UsingAllNodes() && (m_intraHostComm != MPI_COMM_NULL) && (m_numHosts < (size_t) m_numMPINodes);
+    }
+
+    // Allreduce (sum) in three steps: reduce to the leader of each host (through shared memory),
+    // allreduce across the host leaders (through the network, optionally with the ring algorithm),
+    // and broadcast the result from the leader within each host.
+    // Only 1/(ranks per host) of the flat allreduce's data crosses the network.
+    template <class ElemType>
+    void HierarchicalAllReduce(ElemType *pData, size_t nData, bool useRingAcrossHosts = false)
+    {
+        if (!HasHostHierarchy())
+        {
+            if (useRingAcrossHosts)
+                RingAllReduce(pData, nData);
+            else
+                AllReduce(pData, nData);
+            return;
+        }
+
+        if (nData == 0)
+            return;
+
+        const bool isHostLeader = (m_interHostComm != MPI_COMM_NULL);
+        MPI_Reduce(isHostLeader ? MPI_IN_PLACE : pData, pData, (int) nData, GetDataType(pData), MPI_SUM, 0, m_intraHostComm) || MpiFail("HierarchicalAllReduce: MPI_Reduce");
+        if (isHostLeader && (m_numHosts > 1))
+        {
+            if (useRingAcrossHosts)
+                RingAllReduce(pData, nData, m_interHostComm);
+            else
+                MPI_Allreduce(MPI_IN_PLACE, pData, (int) nData, GetDataType(pData), MPI_SUM, m_interHostComm) || MpiFail("HierarchicalAllReduce: MPI_Allreduce");
+        }
+        MPI_Bcast(pData, (int) nData, GetDataType(pData), 0, m_intraHostComm) || MpiFail("HierarchicalAllReduce: MPI_Bcast");
+    }
+
+    // Broadcast in three steps: from 'srcRank' to the leader of its host, across the host leaders, and within each host.
+    template <class ElemType>
+    void HierarchicalBcast(ElemType *pData, size_t nData, size_t srcRank)
+    {
+        if (!HasHostHierarchy())
+        {
+            Bcast(pData, nData, srcRank);
+            return;
+        }
+
+        const int srcHost = m_hostOfRank[srcRank];
+        const int srcHostRank = m_hostRankOfRank[srcRank];
+        const int tag = 0x4243; // 'BC', MPI only guarantees tags up to 32767 (MPI_TAG_UB)
+        if ((srcHostRank != 0) && (m_hostOfRank[m_myRank] == srcHost))
+        {
+            if (m_myRank == (int) srcRank)
+                MPI_Send(pData, (int) nData, GetDataType(pData), 0, tag, m_intraHostComm) || MpiFail("HierarchicalBcast: MPI_Send");
+            else if (m_hostRankOfRank[m_myRank] == 0)
+                MPI_Recv(pData, (int) nData, GetDataType(pData), srcHostRank, tag, m_intraHostComm, MPI_STATUS_IGNORE) || MpiFail("HierarchicalBcast: MPI_Recv");
+        }
+
+        if ((m_interHostComm != MPI_COMM_NULL) && (m_numHosts > 1))
+            MPI_Bcast(pData, (int) nData, GetDataType(pData), srcHost, m_interHostComm) || MpiFail("HierarchicalBcast: MPI_Bcast");
+        MPI_Bcast(pData, (int) nData, GetDataType(pData), 0, m_intraHostComm) || MpiFail("HierarchicalBcast: MPI_Bcast");
+    }
+
     // wait for all ranks to reach here
     void WaitAll()
     {
@@ -9,7 +9,9 @@
 
 #include "Basics.h"
 #include "Matrix.h"
+#include "TimerUtility.h"
 #include <vector>
+#include <map>
 #include <memory> // for shared_ptr
 
 namespace Microsoft { namespace MSR { namespace CNTK {
@@ -200,7 +202,7 @@ public:
     template<typename SequenceInfoVector>
     void InitAsPackedSequences(const SequenceInfoVector& inputSequences,
         /*temp buffer*/std::vector<std::pair<size_t, size_t>>& placement,
-        /*temp buffer*/std::vector<size_t> rowAllocations)
+        /*temp buffer*/std::vector<size_t>& rowAllocations)
     {
         placement.resize(inputSequences.size()); // [sequence index] result goes here (entries are invalid for gaps)
         // determine width of MBLayout
@@ -584,6 +586,108 @@ public:
 };
 typedef MBLayout::MBLayoutPtr MBLayoutPtr;
 
+// -----------------------------------------------------------------------
+// PackedMBLayoutCache -- results of MBLayout::InitAsPackedSequences() by sequence-length signature
+//
+// Readers and the V2 library pack every minibatch from scratch, although successive
+// minibatches often consist of sequences of identical lengths (evaluation, length-bucketed
+// training). This cache hands out the same packed layout for the same vector of sequence
+// lengths. Sequence i gets seqId i, as in SequencePacker::CreateMBLayout().
+// The layout is shared between all users of an entry and must not be modified;
+// copy it into a layout of your own with MBLayout::CopyFrom() instead.
+// This class is not thread-safe.
+// -----------------------------------------------------------------------
+
+class PackedMBLayoutCache
+{
+public:
+    struct Entry
+    {
+        MBLayoutPtr m_layout;                                // packed layout (read-only)
+        std::vector<std::pair<size_t, size_t>> m_placement; // [sequence index] -> (parallel sequence, begin time)
+        double m_buildSeconds;                               // time it took to pack; counted as saved on every hit
+    };
+
+    // hit/miss counters; also used by caches that derive further data from an entry
+    struct Statistics
+    {
+        size_t m_numHits;
+        size_t m_numMisses;
+        double m_secondsSaved;
+
+        Statistics() : m_numHits(0), m_numMisses(0), m_secondsSaved(0) { }
+
+        void OnHit(double secondsSaved)
+        {
+            m_numHits++;
+            m_secondsSaved += secondsSaved;
+        }
+
+        void OnMiss() { m_numMisses++; }
+
+        double HitRate() const
+        {
+            return m_numHits + m_numMisses == 0 ? 0.0 : (double) m_numHits / (m_numHits + m_numMisses);
+        }
+
+        Statistics& operator+=(const Statistics& other)
+        {
+            m_numHits += other.m_numHits;
+            m_numMisses += other.m_numMisses;
+            m_secondsSaved += other.m_secondsSaved;
+            return *this;
+        }
+    };
+
+    // 'maxEntries' bounds the memory if the lengths hardly ever repeat; the cache starts over once it is exceeded
+    explicit PackedMBLayoutCache(size_t maxEntries = 1024)
+        : m_maxEntries(maxEntries)
+    {
+    }
+
+    // returns the packed layout for sequences of the given lengths
+    // The reference is valid until the next call.
+    const Entry& Get(const std::vector<size_t>& sequenceLengths)
+    {
+        auto found = m_entries.find(sequenceLengths);
+        if (found != m_entries.end())
+        {
+            m_statistics.OnHit(found->second.m_buildSeconds);
+            return found->second;
+        }
+
+        m_statistics.OnMiss();
+        if (m_entries.size() >= m_maxEntries)
+            m_entries.clear();
+
+        Timer timer;
+        timer.Start();
+
+        m_sequenceInfos.resize(sequenceLengths.size());
+        for (size_t i = 0; i < sequenceLengths.size(); i++)
+            m_sequenceInfos[i] = { i, SIZE_MAX, 0, sequenceLengths[i] };
+
+        Entry& entry = m_entries[sequenceLengths];
+        entry.m_layout = std::make_shared<MBLayout>();
+        entry.m_layout->InitAsPackedSequences(m_sequenceInfos, entry.m_placement, m_rowAllocations);
+
+        timer.Stop();
+        entry.m_buildSeconds = timer.ElapsedSeconds();
+        return entry;
+    }
+
+    const Statistics& GetStatistics() const { return m_statistics; }
+
+private:
+    size_t m_maxEntries;
+    std::map<std::vector<size_t>, Entry> m_entries;
+    Statistics m_statistics;
+
+    // temp buffers for packing
+    std::vector<MBLayout::SequenceInfo> m_sequenceInfos;
+    std::vector<size_t> m_rowAllocations;
+};
+
 // -----------------------------------------------------------------------
 // FrameRange -- identifies a frame or a set of frames to apply computation to
 //
@@ -6,6 +6,7 @@
 #pragma once
 
 #include "Basics.h"
+#include "ComputationProfiler.h"
 #include <memory>
 
 namespace Microsoft { namespace MSR { namespace CNTK {
@@ -40,6 +41,12 @@ struct ComputationEnvironment
         m_networkOperationMode = mode;
         return oldMode;
     }
+
+    // profiler that the nodes' ForwardProp() and Backprop() calls are recorded in, null if not profiling
+    ComputationProfilerPtr m_profiler;
+    ComputationProfiler* GetProfiler() const { return m_profiler.get(); }
+    void SetProfiler(const ComputationProfilerPtr& profiler) { m_profiler = profiler; }
+
     // more properties should be added here as needed
 };
 typedef std::shared_ptr<ComputationEnvironment> ComputationEnvironmentPtr;
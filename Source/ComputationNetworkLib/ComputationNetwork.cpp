@@ -34,13 +34,13 @@ namespace Microsoft { namespace MSR { namespace CNTK {
 // -----------------------------------------------------------------------
 
 template <>
-vector<shared_ptr<Matrix<float>>>& MatrixPool::GetReleasedMatrices<float>()
+vector<pair<shared_ptr<Matrix<float>>, const ComputationNodeBase*>>& MatrixPool::GetReleasedMatrices<float>()
 {
     return m_releasedFloatMatrices;
 }
 
 template <>
-vector<shared_ptr<Matrix<double>>>& MatrixPool::GetReleasedMatrices<double>()
+vector<pair<shared_ptr<Matrix<double>>, const ComputationNodeBase*>>& MatrixPool::GetReleasedMatrices<double>()
 {
     return m_releasedDoubleMatrices;
 }
@@ -104,6 +104,31 @@ void ComputationNetwork::Save(const wstring& fileName, const FileOptions fileFor
 void ComputationNetwork::SaveToFileImpl(const wstring& fileName, const FileOptions fileFormat) const
 {
     File fstream(fileName, fileFormat | FileOptions::fileOptionsWrite);
+    Save(fstream);
+    fstream.Flush();
+}
+
+// the nodes that Save() writes: the nodes of the network, with fused nodes replaced by the original nodes they stand in for
+// Since a fused node has the name of the root of the original nodes, the saved graph is the same as without fusion.
+static map<const wstring, ComputationNodeBasePtr, nocase_compare> GetNodesToSave(const map<const wstring, ComputationNodeBasePtr, nocase_compare>& nameToNodeMap)
+{
+    map<const wstring, ComputationNodeBasePtr, nocase_compare> nodesToSave;
+    for (const auto& iter : nameToNodeMap)
+    {
+        auto fusedNode = dynamic_pointer_cast<IFusedNode>(iter.second);
+        if (!fusedNode)
+            nodesToSave.insert(iter);
+        else
+            for (const auto& node : fusedNode->GetFusedNodes())
+                nodesToSave[node->NodeName()] = node;
+    }
+    return nodesToSave;
+}
+
+void ComputationNetwork::Save(File& fstream) const
+{
+    VerifyIsCompiled("Save");
+    let nodesToSave = GetNodesToSave(m_nameToNodeMap);
     fstream.PutMarker(FileMarker::fileMarkerBeginSection, L"BCN");
 
     // model version
@@ -111,11 +136,11 @@ void ComputationNetwork::SaveToFileImpl(const wstring& fileName, const FileOptio
     fstream << (size_t) CURRENT_CNTK_MODEL_VERSION;
     fstream.PutMarker(FileMarker::fileMarkerEndSection, L"EVersion");
 
-    fstream << (size_t) m_nameToNodeMap.size();
+    fstream << (size_t) nodesToSave.size();
 
     // put all node info first
     fstream.PutMarker(FileMarker::fileMarkerBeginSection, L"BNodeList");
-    for (auto nodeIter = m_nameToNodeMap.begin(); nodeIter != m_nameToNodeMap.end(); nodeIter++)
+    for (auto nodeIter = nodesToSave.begin(); nodeIter != nodesToSave.end(); nodeIter++)
     {
         ComputationNodeBasePtr nodePtr = nodeIter->second;
         // type
@@ -139,7 +164,7 @@ void ComputationNetwork::SaveToFileImpl(const wstring& fileName, const FileOptio
 
     // put relationship
     fstream.PutMarker(FileMarker::fileMarkerBeginSection, L"BRelation");
-    for (auto nodeIter = m_nameToNodeMap.begin(); nodeIter != m_nameToNodeMap.end(); nodeIter++)
+    for (auto nodeIter = nodesToSave.begin(); nodeIter != nodesToSave.end(); nodeIter++)
     {
         ComputationNodeBasePtr nodePtr = nodeIter->second;
         fstream << nodePtr->NodeName() << nodePtr->GetNumInputs();
@@ -188,8 +213,6 @@ void ComputationNetwork::SaveToFileImpl(const wstring& fileName, const FileOptio
     fstream.PutMarker(FileMarker::fileMarkerEndSection, L"ERootNodes");
 
     fstream.PutMarker(FileMarker::fileMarkerEndSection, L"ECN");
-
-    fstream.Flush();
 }
 
 // load the section of nodes that contain persistable parameters
@@ -213,6 +236,8 @@ void ComputationNetwork::ReadPersistableParameters(File& fstream, bool create)
     size_t numNodes;
     fstream >> numNodes;
 
+    let savedNodes = GetNodesToSave(m_nameToNodeMap); // for reloading
+
     // get all node info first
     fstream.GetMarker(FileMarker::fileMarkerBeginSection, L"BNodeList");
     for (size_t i = 0; i < numNodes; i++)
@@ -226,7 +251,11 @@ void ComputationNetwork::ReadPersistableParameters(File& fstream, bool create)
 
         ComputationNodeBasePtr node;
         if (!create) // reloading existing
-            node = GetNodeFromName(nodeName);
+        {
+            // the file has the original nodes of fused nodes (see Save())
+            let nodeIter = savedNodes.find(nodeName);
+            node = nodeIter != savedNodes.end() ? nodeIter->second : GetNodeFromName(nodeName);
+        }
         else if (precision == L"float")
             node = ComputationNetworkBuilder<float>::NewNode(opName, m_deviceId, nodeName);
         else if (precision == L"double")
@@ -914,6 +943,71 @@ void ComputationNodeBase::EnumerateArcs(std::unordered_set<ComputationNodeBasePt
 // specialized operations
 // -----------------------------------------------------------------------
 
+// ========================================
+// This function stores learnable parameters in half precision to halve their memory and bandwidth in CPU inference.
+// Only parameters that are exclusively used as the left operand of Times/TransposeTimes against minibatch data
+// are converted, everything else (biases, embeddings used elsewhere, ...) stays in full precision.
+// The network must be compiled; afterwards it can only be evaluated, not trained or saved.
+// ========================================
+template <class ElemType>
+void ComputationNetwork::StoreParametersInHalfPrecision()
+{
+    VerifyIsCompiled("StoreParametersInHalfPrecision");
+    if (GetDeviceId() != CPUDEVICE)
+    {
+        fprintf(stderr, "StoreParametersInHalfPrecision: Half-precision parameters are only supported on the CPU, keeping full precision.\n");
+        return;
+    }
+
+    // whether a consumer can use its input 'inputIndex' in half precision
+    auto canUseHalfPrecisionInput = [](const ComputationNodeBasePtr& node, size_t inputIndex)
+    {
+        if (inputIndex != 0)
+            return false;
+        if (auto times = dynamic_pointer_cast<TimesNode<ElemType>>(node))
+            return times->CanUseHalfPrecisionInput0();
+        if (auto transposeTimes = dynamic_pointer_cast<TransposeTimesNode<ElemType>>(node))
+            return transposeTimes->CanUseHalfPrecisionInput0();
+        return false;
+    };
+
+    // a parameter qualifies if all of its consumers can use it in half precision
+    map<wstring, bool> qualifies; // [parameter name]
+    for (const auto& iter : m_nameToNodeMap)
+    {
+        const auto& node = iter.second;
+        for (size_t i = 0; i < node->GetNumInputs(); i++)
+        {
+            const auto& input = node->Input(i);
+            if (!dynamic_pointer_cast<LearnableParameter<ElemType>>(input))
+                continue;
+            auto result = qualifies.insert(make_pair(input->NodeName(), true));
+            result.first->second = result.first->second && canUseHalfPrecisionInput(node, i);
+        }
+    }
+
+    size_t numParameters = 0, numConverted = 0, fullPrecisionBytes = 0, halfPrecisionBytes = 0;
+    for (const auto& iter : qualifies)
+    {
+        auto parameter = dynamic_pointer_cast<LearnableParameter<ElemType>>(GetNodeFromName(iter.first));
+        const size_t numElements = parameter->Value().GetNumElements();
+        numParameters++;
+        fullPrecisionBytes += numElements * sizeof(ElemType);
+        if (!iter.second)
+        {
+            halfPrecisionBytes += numElements * sizeof(ElemType);
+            continue;
+        }
+
+        parameter->StoreValueInHalfPrecision();
+        numConverted++;
+        halfPrecisionBytes += numElements * sizeof(uint16_t);
+    }
+
+    fprintf(stderr, "StoreParametersInHalfPrecision: %d of %d parameters stored in half precision, parameter memory %.2f MB -> %.2f MB.\n",
+            (int)numConverted, (int)numParameters, fullPrecisionBytes / 1048576.0, halfPrecisionBytes / 1048576.0);
+}
+
 // TODO: Lift this into config language, move underlying code to math lib. This should be a model-editing operation.
 
 // ========================================
@@ -1467,6 +1561,7 @@ template void ComputationNetwork::InitLearnableParameters<float>(const Computati
 template void ComputationNetwork::Read<float>(const wstring& fileName);
 template void ComputationNetwork::ReadPersistableParameters<float>(File& fstream, bool create);
 template void ComputationNetwork::PerformSVDecomposition<float>(const map<wstring, float>& SVDConfig, size_t alignedsize);
+template void ComputationNetwork::StoreParametersInHalfPrecision<float>();
 template /*static*/ void ComputationNetwork::SetDropoutRate<float>(ComputationNetworkPtr net, const ComputationNodeBasePtr& criterionNode, const double dropoutRate, double& prevDropoutRate, size_t randSeedBase);
 template /*static*/ void ComputationNetwork::SetBatchNormalizationTimeConstants<float>(ComputationNetworkPtr net, const ComputationNodeBasePtr& criterionNode, const double normalizationTimeConstant, double& prevNormalizationTimeConstant, double blendTimeConstant, double& prevBlendTimeConstant);
 template void ComputationNetwork::SetSeqParam<float>(ComputationNetworkPtr net, const ComputationNodeBasePtr criterionNode, const double& hsmoothingWeight, const double& frameDropThresh, const bool& doreferencealign,
@@ -1477,6 +1572,7 @@ template void ComputationNetwork::InitLearnableParameters<double>(const Computat
 template void ComputationNetwork::Read<double>(const wstring& fileName);
 template void ComputationNetwork::ReadPersistableParameters<double>(File& fstream, bool create);
 template void ComputationNetwork::PerformSVDecomposition<double>(const map<wstring, float>& SVDConfig, size_t alignedsize);
+template void ComputationNetwork::StoreParametersInHalfPrecision<double>();
 template /*static*/ void ComputationNetwork::SetDropoutRate<double>(ComputationNetworkPtr net, const ComputationNodeBasePtr& criterionNode, const double dropoutRate, double& prevDropoutRate, size_t randSeedBase);
 template /*static*/ void ComputationNetwork::SetBatchNormalizationTimeConstants<double>(ComputationNetworkPtr net, const ComputationNodeBasePtr& criterionNode, const double normalizationTimeConstant, double& prevNormalizationTimeConstant, double blendTimeConstant, double& prevBlendTimeConstant);
 template void ComputationNetwork::SetSeqParam<double>(ComputationNetworkPtr net, const ComputationNodeBasePtr criterionNode, const double& hsmoothingWeight, const double& frameDropThresh, const bool& doreferencealign,
@@ -13,6 +13,7 @@
 #include "ComputationNode.h"
 #include "ScriptableObjects.h"
 #include "ComputationEnvironment.h"
+#include "ComputationScheduler.h"
 
 #include <map>
 #include <string>
@@ -29,6 +30,7 @@
 #include <chrono>
 #include <unordered_map>
 #include <set>
+#include <functional>
 
 namespace Microsoft { namespace MSR { namespace CNTK {
 
@@ -51,6 +53,7 @@ public:
     ComputationNetwork() :
         m_randomSeedOffset(0),
         m_isCompiled(false),
+        m_allowElementwiseFusion(true),
         m_areMatricesAllocated(false),
         m_pMBLayoutOfNetwork(make_shared<MBLayout>(1, 0, L"*")),
         m_environment(make_shared<ComputationEnvironment>())
@@ -118,6 +121,8 @@ public:
     }
 
     void Save(const std::wstring& fileName, const FileOptions fileFormat = FileOptions::fileOptionsBinary) const;
+    // serializes the model into an open file, without flushing it (used for the asynchronous checkpoints of SGD)
+    void Save(File& fstream) const;
     void SaveEdited(const std::wstring& fileName, const FileOptions fileFormat = FileOptions::fileOptionsBinary);
 
 private:
@@ -136,6 +141,11 @@ public:
     // main entry point for backprop
     void Backprop(const ComputationNodeBasePtr rootNode);
 
+    // backprop that calls 'onGradientFinal' for each top-level node as soon as its gradient has its final value,
+    // e.g. to start the aggregation of parameter gradients while the rest of the network is backpropagated
+    typedef std::function<void(const ComputationNodeBasePtr&)> GradientFinalCallback;
+    void Backprop(const ComputationNodeBasePtr rootNode, const GradientFinalCallback& onGradientFinal);
+
     template <class NODESET> // version that takes multiple nodes
     void ForwardProp(const NODESET& nodes)
     {
@@ -171,11 +181,29 @@ public:
 
     void CompileNetwork(); // call this after creation, Load(), and any modification
 
+    // enables or disables the fusion of element-wise nodes by CompileNetwork() (off by default)
+    // Fused nodes exist at runtime only; Save() writes the original nodes, so model files are the same either way.
+    static void SetElementwiseFusion(bool enable) { s_fuseElementwiseNodes = enable; }
+    // keeps this network from being fused even if enabled, for owners that hold on to its nodes (e.g. the V2 library)
+    void DisallowElementwiseFusion() { m_allowElementwiseFusion = false; }
+
+    // enables concurrent execution of independent nodes on the CPU with the given number of threads (0 or 1: sequential, the default)
+    // See ComputationScheduler for how nodes are ordered; nodes that do not declare IsThreadSafe() are executed in sequential order.
+    static void SetConcurrentNodeExecution(size_t numThreads) { s_numConcurrentNodeThreads = numThreads; }
+
 private:
     void ValidateNetwork();
     size_t ValidateNodes(list<ComputationNodeBasePtr> nodes, bool isFirstPass, bool isFinalValidationPass);
     bool ValidateNode(ComputationNodeBasePtr node, bool isFinalValidationPass) const;
     void MarkValueNonSharableNodes();
+    bool FuseElementwiseNodes();
+    size_t RemoveDropoutNodes();
+    template <class ElemType>
+    size_t FoldConstantSubexpressions();
+    template <class ElemType>
+    size_t FoldBatchNormalizationNodes();
+    template <class ElemType>
+    double MeasureForwardPropLatency(size_t numSamples);
     void ChangeNodeInputs(ComputationNodeBasePtr fromNode, ComputationNodeBasePtr toNode);
 
 private:
@@ -679,6 +707,15 @@ public:
     template <class ElemType>
     void PerformSVDecomposition(const map<wstring, float>& SVDConfig, size_t AlignedSize);
 
+    // for CPU inference: store the weight matrices of matrix products in half precision
+    template <class ElemType>
+    void StoreParametersInHalfPrecision();
+
+    // for inference: remove Dropout, precompute constant subexpressions, and fold BatchNormalization into the preceding layer
+    // If 'latencyTestSamples' > 0, the latency of ForwardProp() of the outputs for that many samples is reported before and after.
+    template <class ElemType>
+    void OptimizeForInference(size_t latencyTestSamples = 0);
+
     template <class ElemType>
     void SaveToDbnFile(ComputationNetworkPtr net, const std::wstring& fileName) const;
 
@@ -1027,6 +1064,20 @@ protected:
         // There is currently no other constructor for inner nested PAR-traversed sub-networks, but there will be.
         PARTraversalFlowControlNode(const std::vector<shared_ptr<SEQTraversalFlowControlNode>>& recurrentInfo, const std::list<ComputationNodeBasePtr>& allNodes);
         // Base::m_nestedNodes contains all top-level nodes, in evaluation order
+
+        // if set, called in Backprop() after each node; the gradient of a node is final at that point since all nodes consuming it come later in evaluation order
+        GradientFinalCallback m_onGradientFinal;
+
+        // forget the schedule for concurrent execution, which depends on how matrices are shared
+        void InvalidateScheduler() { m_scheduler.reset(); }
+
+    private:
+        void ForwardPropNode(const ComputationNodeBasePtr& node, const FrameRange& fr, ComputationProfiler* profiler);
+        void BackpropNode(const ComputationNodeBasePtr& node, const FrameRange& fr, ComputationProfiler* profiler);
+        std::shared_ptr<WorkStealingThreadPool> GetThreadPoolForConcurrentExecution();
+
+        std::shared_ptr<ComputationScheduler> m_scheduler; // formed upon first concurrent execution
+        std::mutex m_onGradientFinalMutex;                 // m_onGradientFinal is called from several threads when executing concurrently
     };
 
 public:
@@ -1083,6 +1134,9 @@ private:
 
     // cache for evaluation ordering:
     bool m_isCompiled; // CompileNetwork has been called
+    static bool s_fuseElementwiseNodes; // CompileNetwork() calls FuseElementwiseNodes()
+    bool m_allowElementwiseFusion;      // unless disallowed for this network
+    static size_t s_numConcurrentNodeThreads; // PARTraversalFlowControlNode executes independent nodes concurrently
     bool m_areMatricesAllocated; // AllocateAllMatrices has been called
 
     // cached network iterations
@@ -343,6 +343,7 @@ void ComputationNetwork::DetermineSCCsR(ComputationNodeBasePtr cur,
                 }
                 rInfo.m_steppingDirection = DetermineLoopDirection(rInfo.m_nestedNodes);
                 m_allSEQNodes.push_back(make_shared<SEQTraversalFlowControlNode>(move(rInfo)));
+                m_allSEQNodes.back()->SetEnvironment(m_environment);
                 loopId++; // and count it  TODO: may be removed
             }
         }
@@ -10,6 +10,7 @@
 #include "ComputationNetwork.h"
 #include "RecurrentNodes.h"
 #include "InputAndParamNodes.h"
+#include "ComputationProfiler.h"
 #include <string>
 #include <vector>
 #include <list>
@@ -79,12 +80,47 @@ void ComputationNetwork::Backprop(const ComputationNodeBasePtr rootNode) // trai
     GetNestedNetwork(rootNode)->Backprop(FrameRange(nullptr), true, true);
 }
 
+void ComputationNetwork::Backprop(const ComputationNodeBasePtr rootNode, const GradientFinalCallback& onGradientFinal)
+{
+    auto network = dynamic_pointer_cast<PARTraversalFlowControlNode>(GetNestedNetwork(rootNode));
+    if (!network)
+        LogicError("Backprop: The nested network of %ls %ls operation is not PAR-traversed.", rootNode->NodeName().c_str(), rootNode->OperationName().c_str());
+
+    network->m_onGradientFinal = onGradientFinal;
+    try
+    {
+        Backprop(rootNode);
+    }
+    catch (...)
+    {
+        network->m_onGradientFinal = nullptr;
+        throw;
+    }
+    network->m_onGradientFinal = nullptr;
+}
+
 void ComputationNetwork::FormNestedNetwork(const ComputationNodeBasePtr& rootNode)
 {
     if (m_nestedNetworks.find(rootNode) != m_nestedNetworks.end())
         fprintf(stderr, "FormNestedNetwork: WARNING: Was called twice for %ls %ls operation\n", rootNode->NodeName().c_str(), rootNode->OperationName().c_str());
 
-    m_nestedNetworks[rootNode] = make_shared<PARTraversalFlowControlNode>(m_allSEQNodes, GetEvalOrder(rootNode));
+    auto nestedNetwork = make_shared<PARTraversalFlowControlNode>(m_allSEQNodes, GetEvalOrder(rootNode));
+    nestedNetwork->SetEnvironment(m_environment);
+    m_nestedNetworks[rootNode] = nestedNetwork;
+}
+
+// the profiler attached to the environment of a flow-control node, or null if not profiling
+static ComputationProfiler* GetProfiler(const ComputationNodeBase& flowControlNode)
+{
+    auto environment = flowControlNode.GetEnvironmentPtr();
+    return environment ? environment->GetProfiler() : nullptr;
+}
+
+// the profiler to record a node of a PAR traversal in; leaves (inputs, parameters) compute nothing and are not recorded,
+// and loops are not recorded as a node, they record their nested nodes themselves
+static ComputationProfiler* GetNodeProfiler(ComputationProfiler* profiler, const ComputationNodeBasePtr& node)
+{
+    return profiler && node->GetNumInputs() > 0 && !dynamic_cast<FlowControlNode*>(node.get()) ? profiler : nullptr;
 }
 
 ComputationNodeBasePtr ComputationNetwork::GetNestedNetwork(const ComputationNodeBasePtr& rootNode)
@@ -131,35 +167,91 @@ ComputationNetwork::PARTraversalFlowControlNode::PARTraversalFlowControlNode(con
 }
 /*virtual*/ void ComputationNetwork::PARTraversalFlowControlNode::ForwardProp(const FrameRange& fr) /*override*/
 {
-    for (auto& node : m_nestedNodes)
+    ComputationProfiler* profiler = GetProfiler(*this);
+    auto threadPool = GetThreadPoolForConcurrentExecution();
+    if (threadPool && m_scheduler->IsConcurrentForwardProp())
+    {
+        m_scheduler->ForwardProp(*threadPool, [&](size_t i)
+        {
+            ForwardPropNode(m_nestedNodes[i], fr, profiler);
+        });
+    }
+    else
     {
+        for (auto& node : m_nestedNodes)
+            ForwardPropNode(node, fr, profiler);
+    }
+}
+
+void ComputationNetwork::PARTraversalFlowControlNode::ForwardPropNode(const ComputationNodeBasePtr& node, const FrameRange& fr, ComputationProfiler* profiler)
+{
 #if 0
-        if (dynamic_pointer_cast<LearnableParameter<float>>(node))
-            dynamic_pointer_cast<ComputationNode<float>>(node)->DebugLogMinibatch();
+    if (dynamic_pointer_cast<LearnableParameter<float>>(node))
+        dynamic_pointer_cast<ComputationNode<float>>(node)->DebugLogMinibatch();
 #endif
-        if (node->IsOutOfDateWrtInputs())
-        {
-            node->BeginForwardProp();
-            node->ForwardProp(fr.WithLayout(node->GetMBLayout()));
-            node->EndForwardProp();
+    if (node->IsOutOfDateWrtInputs())
+    {
+        ComputationProfiler::NodeScope profilerScope(GetNodeProfiler(profiler, node), *node, /*backprop=*/false, node->GetSampleMatrixNumCols());
+        node->BeginForwardProp();
+        node->ForwardProp(fr.WithLayout(node->GetMBLayout()));
+        node->EndForwardProp();
 
-            node->BumpEvalTimeStamp();
-        }
+        node->BumpEvalTimeStamp();
     }
 }
 
 /*virtual*/ void ComputationNetwork::PARTraversalFlowControlNode::Backprop(const FrameRange& fr, bool childrenInThisLoop, bool childrenInOuterLoop) /*override*/
 {
     childrenInThisLoop, childrenInOuterLoop; // TODO: think through what these mean when coming from PAR mode
-    // process nodes in pre-determined order
-    for (auto pnode = m_nestedNodes.rbegin(); pnode != m_nestedNodes.rend(); pnode++) // iterate backwards over evaluation order
+    ComputationProfiler* profiler = GetProfiler(*this);
+    auto threadPool = GetThreadPoolForConcurrentExecution();
+    if (threadPool && m_scheduler->IsConcurrentBackprop())
+    {
+        m_scheduler->Backprop(*threadPool, [&](size_t i)
+        {
+            BackpropNode(m_nestedNodes[i], fr, profiler);
+        });
+    }
+    else
     {
-        auto& node = *pnode;
+        // process nodes in pre-determined order
+        for (auto pnode = m_nestedNodes.rbegin(); pnode != m_nestedNodes.rend(); pnode++) // iterate backwards over evaluation order
+            BackpropNode(*pnode, fr, profiler);
+    }
+}
 
+void ComputationNetwork::PARTraversalFlowControlNode::BackpropNode(const ComputationNodeBasePtr& node, const FrameRange& fr, ComputationProfiler* profiler)
+{
+    {
+        ComputationProfiler::NodeScope profilerScope(GetNodeProfiler(profiler, node), *node, /*backprop=*/true, node->GetSampleMatrixNumCols());
         node->BeginBackprop();
         node->Backprop(fr.WithLayout(node->GetMBLayout()), true /*childrenInThisLoop*/, true /*childrenInOuterLoop*/);
         node->EndBackprop();
     }
+
+    if (m_onGradientFinal)
+    {
+        lock_guard<mutex> lock(m_onGradientFinalMutex);
+        m_onGradientFinal(node);
+    }
+}
+
+/*static*/ size_t ComputationNetwork::s_numConcurrentNodeThreads = 0;
+
+// the thread pool to execute the nested nodes on, or null to execute them sequentially
+// Concurrent execution must be enabled with SetConcurrentNodeExecution(). The schedule is formed on first use, which
+// must be after AllocateAllMatrices() since it depends on which nodes share matrices.
+std::shared_ptr<WorkStealingThreadPool> ComputationNetwork::PARTraversalFlowControlNode::GetThreadPoolForConcurrentExecution()
+{
+    size_t numThreads = s_numConcurrentNodeThreads;
+    if (numThreads < 2)
+        return nullptr;
+    auto threadPool = WorkStealingThreadPool::GetInstance(numThreads);
+    if (threadPool->IsWorkerThread()) // already running on the pool, e.g. inside a node that evaluates a nested network
+        return nullptr;
+    if (!m_scheduler)
+        m_scheduler = make_shared<ComputationScheduler>(m_nestedNodes);
+    return threadPool;
 }
 /*virtual*/ void ComputationNetwork::PARTraversalFlowControlNode::RequestMatricesBeforeForwardProp(MatrixPool& matrixPool) /*override*/
 {
@@ -215,11 +307,17 @@ ComputationNetwork::PARTraversalFlowControlNode::PARTraversalFlowControlNode(con
     // for every time step run through all nodes in this particular loop (treat the loop like a little ComputationNetwork)
     // Note: Currently, this is limited to linear-time loops. But nothing stops the iteration below to, e.g., be a 2D iteration over an image
     // if we implement an according FrameRangeIteration.
+    // When profiling, the nested nodes are recorded per time step, and the loop as a whole is traced as a phase.
+    ComputationProfiler* profiler = GetProfiler(*this);
+    ComputationProfiler::PhaseScope loopScope(profiler, NodeName() + L" ForwardProp");
+    const size_t numParallelSequences = GetMBLayout()->GetNumParallelSequences();
+
     FrameRangeIteration range(GetMBLayout(), m_steppingDirection);
     for (auto t = range.begin(); t != range.end(); t++)
     {
         for (auto& node : m_nestedNodes)
         {
+            ComputationProfiler::NodeScope profilerScope(profiler, *node, /*backprop=*/false, numParallelSequences, /*traceEvent=*/false);
             node->ForwardProp(t);
             node->BumpEvalTimeStamp();
         }
@@ -245,12 +343,17 @@ ComputationNetwork::PARTraversalFlowControlNode::PARTraversalFlowControlNode(con
     childrenInThisLoop, childrenInOuterLoop;    // TODO: think through what these mean when coming from PAR mode
     const auto& recurrentNodes = m_nestedNodes; // BUGBUG: -ForForward?? Does this mean we can remove non-ForForward?
     auto pMBLayout = recurrentNodes[0]->GetMBLayout();
+    ComputationProfiler* profiler = GetProfiler(*this);
+    ComputationProfiler::PhaseScope loopScope(profiler, NodeName() + L" Backprop");
+    const size_t numParallelSequences = pMBLayout->GetNumParallelSequences();
+
     FrameRangeIteration range(pMBLayout, m_steppingDirection);
     for (auto t = range.rbegin(); t != range.rend(); t++) // note: reverse iteration
     {
         for (auto nodeIter2 = recurrentNodes.rbegin(); nodeIter2 != recurrentNodes.rend(); ++nodeIter2)
         {
             auto& node2 = *nodeIter2;
+            ComputationProfiler::NodeScope profilerScope(profiler, *node2, /*backprop=*/true, numParallelSequences, /*traceEvent=*/false);
             node2->Backprop(t, true /*childrenInThisLoop*/, false /*childrenInOuterLoop*/);
             // The above flags tell Backprop() to skip back-propagation from inside a node into
             // a node that is outside the loop, which is done later in EndBackprop() in PAR mode.
@@ -263,9 +366,12 @@ ComputationNetwork::PARTraversalFlowControlNode::PARTraversalFlowControlNode(con
 {
     // The following loop handles the case that a node inside the loop back-propagates a gradient into a node outside of the loop.
     // For efficiency, we perform this outside the loop in PAR mode. E.g., in one LSTM speech setup, we measured 12..14% overall speed-up.
+    // (profiled as backprop over no columns, since the operations were already counted per time step)
+    ComputationProfiler* profiler = GetProfiler(*this);
     for (auto nodeIter2 = m_nestedNodes.rbegin(); nodeIter2 != m_nestedNodes.rend(); ++nodeIter2)
     {
         auto& node2 = *nodeIter2;
+        ComputationProfiler::NodeScope profilerScope(profiler, *node2, /*backprop=*/true, 0, /*traceEvent=*/false);
         node2->Backprop(FrameRange(m_nestedNodes[0]->GetMBLayout()), false /*childrenInThisLoop*/, true /*childrenInOuterLoop*/);
     }
 
@@ -450,7 +556,12 @@ void ComputationNetwork::CompileNetwork()
     ValidateNetwork();
 
     // STEP: Optimize the network.
-    // :)
+    // This changes the graph, so the network is compiled again from scratch.
+    if (FuseElementwiseNodes())
+    {
+        CompileNetwork();
+        return;
+    }
 
     // STEP: Some final details.
     ResetEvalTimeStamps(); // invalidate all m_value fields. Really belongs into StartEvaluateMinibatchLoop()
@@ -837,6 +948,48 @@ void ComputationNetwork::PrintMemorySharingStructure(const std::vector<Computati
 }
 
 
+// reuse filter for the MatrixPool that only hands a matrix released by one node to a node that depends on it or that it depends on
+// With concurrent node execution, this keeps independent branches of the network from sharing matrices, which would force
+// ComputationScheduler to execute them one after another. Memory for this is quadratic in the number of nodes (1 bit per pair).
+static MatrixPool::ReuseFilter DependentNodesReuseFilter(const std::list<ComputationNodeBasePtr>& allNodesEvalOrder)
+{
+    auto nodeIndices = make_shared<unordered_map<const ComputationNodeBase*, size_t>>();
+    for (const auto& node : allNodesEvalOrder)
+        nodeIndices->insert(make_pair(node.get(), nodeIndices->size()));
+
+    // ancestors[i] = set of nodes that node i depends on, as a bit vector
+    // (Recurrent inputs come later in evaluation order and are only partially accounted for; this is merely a heuristic.)
+    size_t numWords = (nodeIndices->size() + 63) / 64;
+    auto ancestors = make_shared<vector<vector<uint64_t>>>(nodeIndices->size(), vector<uint64_t>(numWords, 0));
+    for (const auto& node : allNodesEvalOrder)
+    {
+        auto& nodeAncestors = (*ancestors)[nodeIndices->at(node.get())];
+        for (const auto& input : node->GetInputs())
+        {
+            auto inputIndex = nodeIndices->find(input.get());
+            if (inputIndex == nodeIndices->end())
+                continue;
+            size_t k = inputIndex->second;
+            nodeAncestors[k / 64] |= (uint64_t) 1 << (k % 64);
+            for (size_t w = 0; w < numWords; w++)
+                nodeAncestors[w] |= (*ancestors)[k][w];
+        }
+    }
+
+    return [nodeIndices, ancestors](const ComputationNodeBase* releasedBy, const ComputationNodeBase* requestedBy)
+    {
+        auto releasedIndex = nodeIndices->find(releasedBy);
+        auto requestedIndex = nodeIndices->find(requestedBy);
+        if (releasedIndex == nodeIndices->end() || requestedIndex == nodeIndices->end())
+            return true;
+        size_t i = releasedIndex->second;
+        size_t k = requestedIndex->second;
+        return i == k ||
+               ((*ancestors)[i][k / 64] >> (k % 64)) & 1 ||
+               ((*ancestors)[k][i / 64] >> (i % 64)) & 1;
+    };
+}
+
 // this function will need to be called before actual validation and execution to
 // predetermine how to share matrices to reduce memory usage.
 // TODO: find a simple topological order and allocateEvalMatrices on that order directly
@@ -853,6 +1006,9 @@ void ComputationNetwork::AllocateAllMatrices(const std::vector<ComputationNodeBa
 
     VerifyIsCompiled("AllocateAllMatrices");
 
+    if (s_numConcurrentNodeThreads > 1 && m_deviceId == CPUDEVICE)
+        m_matrixPool.SetReuseFilter(DependentNodesReuseFilter(GetEvalOrder(nullptr)));
+
     std::vector<ComputationNodeBasePtr> forwardPropRoots;
     forwardPropRoots.insert(forwardPropRoots.end(), evalRootNodes.begin(), evalRootNodes.end());
     forwardPropRoots.insert(forwardPropRoots.end(), outValueRootNodes.begin(), outValueRootNodes.end());
@@ -985,6 +1141,15 @@ void ComputationNetwork::AllocateAllMatrices(const std::vector<ComputationNodeBa
     }
 
     m_areMatricesAllocated = true;
+    m_matrixPool.SetReuseFilter(nullptr);
+
+    // schedules for concurrent execution depend on which nodes share matrices
+    for (auto& nestedNetwork : m_nestedNetworks)
+    {
+        auto parNetwork = dynamic_pointer_cast<PARTraversalFlowControlNode>(nestedNetwork.second);
+        if (parNetwork)
+            parNetwork->InvalidateScheduler();
+    }
 
     //print the memory sharing structure
     std::vector<ComputationNodeBasePtr> allNodes = GetAllNodes();
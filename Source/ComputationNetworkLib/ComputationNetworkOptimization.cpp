@@ -0,0 +1,562 @@
+//
+// Copyright (c) Microsoft. All rights reserved.
+// Licensed under the MIT license. See LICENSE.md file in the project root for full license information.
+//
+
+#define _CRT_SECURE_NO_WARNINGS // "secure" CRT not available on all platforms  --add this at the top of all CPP files that give "function or variable may be unsafe" warnings
+
+#include "Basics.h"
+#include "ComputationNode.h"
+#include "ComputationNetwork.h"
+#include "InputAndParamNodes.h"
+#include "LinearAlgebraNodes.h"
+#include "ConvolutionalNodes.h"
+#include "TrainingNodes.h"
+#include "SpecialPurposeNodes.h"
+#include "MatrixPool.h"
+#include <string>
+#include <vector>
+#include <map>
+#include <set>
+#include <functional>
+#include <algorithm>
+#include <chrono>
+
+using namespace std;
+
+namespace Microsoft { namespace MSR { namespace CNTK {
+
+// -----------------------------------------------------------------------
+// network optimization
+// -----------------------------------------------------------------------
+
+// The methods below rewrite a compiled network into an equivalent one that runs faster.
+// FuseElementwiseNodes() is called from CompileNetwork() after validation if enabled; if it changes the network, it gets
+// compiled again. It only changes the network at runtime: Save() writes the original nodes in place of the fused ones.
+// OptimizeForInference() is called explicitly, since its result can no longer be trained.
+
+/*static*/ bool ComputationNetwork::s_fuseElementwiseNodes = false;
+
+// the nodes that are referenced from the node groups (e.g. outputs), which must be kept under their names
+static set<ComputationNodeBasePtr> NodesInGroups(const vector<vector<ComputationNodeBasePtr>*>& groups)
+{
+    set<ComputationNodeBasePtr> nodes;
+    for (auto group : groups)
+        nodes.insert(group->begin(), group->end());
+    return nodes;
+}
+
+// create a FusedElementwiseNode that computes the tree 'treeNodes' (in post-order, i.e. the root is the last one) from 'inputs'
+template <class ElemType>
+static ComputationNodeBasePtr NewFusedElementwiseNode(const vector<ComputationNodeBasePtr>& treeNodes, const vector<ComputationNodeBasePtr>& inputs)
+{
+    typedef typename FusedElementwiseNode<ElemType>::Step Step;
+    vector<Step> steps;
+    for (const auto& node : treeNodes)
+    {
+        Step step;
+        FusedElementwiseNode<ElemType>::GetFusableOperation(node->OperationName(), step.m_op);
+        step.m_operands[0] = step.m_operands[1] = SIZE_MAX;
+        for (size_t j = 0; j < node->GetNumInputs(); j++)
+        {
+            auto treeIter = find(treeNodes.begin(), treeNodes.end(), node->Input(j));
+            if (treeIter != treeNodes.end())
+                step.m_operands[j] = inputs.size() + (treeIter - treeNodes.begin());
+            else
+                step.m_operands[j] = find(inputs.begin(), inputs.end(), node->Input(j)) - inputs.begin();
+        }
+        steps.push_back(step);
+    }
+
+    const auto& root = treeNodes.back();
+    auto fusedNode = New<FusedElementwiseNode<ElemType>>(root->GetDeviceId(), root->NodeName(), steps, treeNodes);
+    fusedNode->AttachInputs(inputs);
+    return fusedNode;
+}
+
+// FuseElementwiseNodes() -- replace trees of element-wise nodes by FusedElementwiseNodes
+// Plus, Minus, ElementTimes, Sigmoid, Tanh, and RectifiedLinear nodes each write their full result into a matrix of
+// its own and make a separate pass over the minibatch. A FusedElementwiseNode computes a whole tree of them block by
+// block, so that the intermediate results stay in the cache and are never stored for the whole minibatch.
+// A node is absorbed into the node that consumes it if
+//  - it is the only consumer,
+//  - both have the same dimensions and MBLayout,
+//  - the node is not in a node group (e.g. it is not an output), and
+//  - neither is part of a recurrent loop (those are evaluated one time step at a time).
+// The fused node takes the name of the root of the tree, and keeps the nodes of the tree (with their inputs) so that
+// the network can still be saved unfused. Only done for networks on the CPU; on the GPU the intermediate results
+// would not be cached anyway, so there is nothing to gain from evaluating in blocks.
+// This is off by default (SetElementwiseFusion()), since the intermediate nodes can no longer be accessed by name.
+// Requires a validated network with its loops determined. Returns true if anything was fused.
+bool ComputationNetwork::FuseElementwiseNodes()
+{
+    if (!s_fuseElementwiseNodes || !m_allowElementwiseFusion || m_deviceId != CPUDEVICE)
+        return false;
+
+    // count the consumers of each node, and find the nodes that are referenced from outside (node groups)
+    map<ComputationNodeBasePtr, size_t> numConsumers;
+    map<ComputationNodeBasePtr, ComputationNodeBasePtr> consumers;
+    for (const auto& iter : m_nameToNodeMap)
+    {
+        for (const auto& input : iter.second->GetInputs())
+        {
+            numConsumers[input]++;
+            consumers[input] = iter.second;
+        }
+    }
+    let groupedNodes = NodesInGroups(GetAllNodeGroups());
+
+    let isFusable = [](const ComputationNodeBasePtr& node)
+    {
+        ElementWiseOperator op;
+        return FusedElementwiseNode<float>::GetFusableOperation(node->OperationName(), op) &&
+               !node->IsPartOfLoop() && node->HasMBLayout();
+    };
+    let isAbsorbed = [&](const ComputationNodeBasePtr& node)
+    {
+        if (!isFusable(node) || numConsumers[node] != 1 || groupedNodes.find(node) != groupedNodes.end())
+            return false;
+        const auto& consumer = consumers[node];
+        return isFusable(consumer) &&
+               node->GetMBLayout() == consumer->GetMBLayout() &&
+               node->GetSampleLayout() == consumer->GetSampleLayout() &&
+               node->Is<ComputationNode<float>>() == consumer->Is<ComputationNode<float>>();
+    };
+
+    // the roots of the trees are the fusable nodes that are not absorbed into their consumer
+    vector<ComputationNodeBasePtr> roots;
+    for (const auto& iter : m_nameToNodeMap)
+        if (isFusable(iter.second) && !isAbsorbed(iter.second))
+            roots.push_back(iter.second);
+
+    size_t numFusedNodes = 0, numTrees = 0;
+    for (const auto& root : roots)
+    {
+        // collect the nodes of the tree in post-order (they become the steps) and the nodes it consumes (the inputs)
+        vector<ComputationNodeBasePtr> treeNodes, inputs;
+        function<void(const ComputationNodeBasePtr&)> collect = [&](const ComputationNodeBasePtr& node)
+        {
+            for (const auto& input : node->GetInputs())
+            {
+                if (isAbsorbed(input))
+                    collect(input);
+                else if (find(inputs.begin(), inputs.end(), input) == inputs.end())
+                    inputs.push_back(input);
+            }
+            treeNodes.push_back(node);
+        };
+        collect(root);
+
+        if (treeNodes.size() < 2)
+            continue;
+        // the blocks are evaluated on dense matrices
+        if (any_of(inputs.begin(), inputs.end(), [](const ComputationNodeBasePtr& input) { return input->OperationName() == OperationNameOf(SparseInputValue); }))
+            continue;
+
+        ComputationNodeBasePtr fusedNode;
+        if (root->Is<ComputationNode<float>>())
+            fusedNode = NewFusedElementwiseNode<float>(treeNodes, inputs);
+        else
+            fusedNode = NewFusedElementwiseNode<double>(treeNodes, inputs);
+
+        // replace the root, including in the node groups, and remove the tree from the network
+        // The nodes of the tree keep their inputs; they are owned by the fused node from now on.
+        ChangeNodeInputs(root, fusedNode);
+        for (auto group : GetAllNodeGroups())
+            replace(group->begin(), group->end(), root, fusedNode);
+        for (const auto& node : treeNodes)
+            RemoveNodeFromNet(node);
+        AddNodeToNet(fusedNode);
+
+        numFusedNodes += treeNodes.size();
+        numTrees++;
+    }
+
+    if (numTrees == 0)
+        return false;
+
+    fprintf(stderr, "\nFuseElementwiseNodes: %d element-wise nodes were fused into %d %ls nodes.\n",
+            (int) numFusedNodes, (int) numTrees, OperationNameOf(FusedElementwiseNode).c_str());
+    return true;
+}
+
+// -----------------------------------------------------------------------
+// optimization for inference
+// -----------------------------------------------------------------------
+
+// OptimizeForInference() -- rewrite a trained network into an equivalent one that is cheaper to evaluate
+//  - Dropout nodes are removed, they are the identity during inference,
+//  - nodes that depend on parameters only are computed once and replaced by (constant) parameters, and
+//  - BatchNormalization nodes that follow a Times or Convolution node are folded into its weights and a bias.
+// Nodes that are no longer used afterwards are removed. Nodes referenced by node groups (e.g. outputs) are kept under
+// their names. The result is meant for evaluation only (e.g. training it further would train without BatchNormalization).
+// Must be called on a compiled network before its matrices are allocated, i.e. before it is evaluated.
+template <class ElemType>
+void ComputationNetwork::OptimizeForInference(size_t latencyTestSamples)
+{
+    VerifyIsCompiled("OptimizeForInference");
+    if (AreMatricesAllocated())
+        LogicError("OptimizeForInference: The network must be optimized before it is evaluated.");
+
+    const size_t numNodesBefore = m_nameToNodeMap.size();
+    const double latencyBefore = latencyTestSamples > 0 ? MeasureForwardPropLatency<ElemType>(latencyTestSamples) : 0;
+
+    // nodes that are used by the node groups; the ones that are no longer used afterwards get removed
+    let collectUsedNodes = [this]()
+    {
+        set<ComputationNodeBasePtr> usedNodes;
+        function<void(const ComputationNodeBasePtr&)> visit = [&](const ComputationNodeBasePtr& node)
+        {
+            if (usedNodes.insert(node).second)
+                for (const auto& input : node->GetInputs())
+                    visit(input);
+        };
+        for (const auto& node : NodesInGroups(GetAllNodeGroups()))
+            visit(node);
+        return usedNodes;
+    };
+    let usedNodesBefore = collectUsedNodes();
+
+    const size_t numDropoutNodes = RemoveDropoutNodes();
+    const size_t numConstantNodes = FoldConstantSubexpressions<ElemType>();
+    const size_t numBatchNormalizationNodes = FoldBatchNormalizationNodes<ElemType>();
+
+    let usedNodesAfter = collectUsedNodes();
+    vector<ComputationNodeBasePtr> unusedNodes;
+    for (const auto& iter : m_nameToNodeMap)
+    {
+        if (usedNodesAfter.find(iter.second) == usedNodesAfter.end() && usedNodesBefore.find(iter.second) != usedNodesBefore.end())
+            unusedNodes.push_back(iter.second);
+    }
+    for (const auto& node : unusedNodes)
+    {
+        node->DetachInputs();
+        RemoveNodeFromNet(node);
+    }
+
+    InvalidateCompiledNetwork();
+    CompileNetwork();
+
+    fprintf(stderr, "\nOptimizeForInference: %d %ls nodes removed, %d constant subexpressions precomputed, %d %ls nodes folded; %d nodes -> %d nodes.\n",
+            (int) numDropoutNodes, OperationNameOf(DropoutNode).c_str(), (int) numConstantNodes,
+            (int) numBatchNormalizationNodes, OperationNameOf(BatchNormalizationNode).c_str(),
+            (int) numNodesBefore, (int) m_nameToNodeMap.size());
+    if (latencyTestSamples > 0)
+    {
+        const double latencyAfter = MeasureForwardPropLatency<ElemType>(latencyTestSamples);
+        fprintf(stderr, "OptimizeForInference: ForwardProp latency for %d samples %.3f ms -> %.3f ms.\n",
+                (int) latencyTestSamples, latencyBefore * 1e3, latencyAfter * 1e3);
+    }
+}
+
+// remove the Dropout nodes (except those in node groups), connecting their consumers to their input
+// Returns the number of nodes removed.
+size_t ComputationNetwork::RemoveDropoutNodes()
+{
+    let groupedNodes = NodesInGroups(GetAllNodeGroups());
+    vector<ComputationNodeBasePtr> dropoutNodes;
+    for (const auto& iter : m_nameToNodeMap)
+    {
+        if (iter.second->OperationName() == OperationNameOf(DropoutNode) && groupedNodes.find(iter.second) == groupedNodes.end())
+            dropoutNodes.push_back(iter.second);
+    }
+
+    for (const auto& node : dropoutNodes)
+    {
+        ChangeNodeInputs(node, node->Input(0));
+        node->DetachInputs();
+        RemoveNodeFromNet(node);
+    }
+    return dropoutNodes.size();
+}
+
+// replace the nodes that depend on parameters only by parameters that hold their values
+// Such nodes are otherwise computed anew for every minibatch. Of each such subexpression, only the nodes used by
+// other nodes or by node groups are replaced; the rest becomes unused. Returns the number of nodes replaced.
+template <class ElemType>
+size_t ComputationNetwork::FoldConstantSubexpressions()
+{
+    // all nodes in evaluation order (inputs first)
+    vector<ComputationNodeBasePtr> nodes;
+    set<ComputationNodeBasePtr> visited;
+    function<void(const ComputationNodeBasePtr&)> visit = [&](const ComputationNodeBasePtr& node)
+    {
+        if (!visited.insert(node).second)
+            return;
+        for (const auto& input : node->GetInputs())
+            visit(input);
+        nodes.push_back(node);
+    };
+    for (const auto& iter : m_nameToNodeMap)
+        visit(iter.second);
+
+    // constants are parameters, results of precomputation, and nodes without MBLayout whose inputs are all constants
+    set<ComputationNodeBasePtr> constantNodes;
+    vector<ComputationNodeBasePtr> computedNodes; // the constants that are computed by ForwardProp()
+    for (const auto& node : nodes)
+    {
+        if (node->OperationName() == OperationNameOf(LearnableParameter))
+            constantNodes.insert(node);
+        else if (node->RequiresPreCompute())
+        {
+            if (node->Is<IPreComputeNode>() && node->As<IPreComputeNode>()->HasComputed())
+                constantNodes.insert(node);
+        }
+        else if (!node->IsLeaf() && !node->HasMBLayout() && node->Is<ComputationNode<ElemType>>() &&
+                 all_of(node->GetInputs().begin(), node->GetInputs().end(), [&](const ComputationNodeBasePtr& input) { return constantNodes.find(input) != constantNodes.end(); }))
+        {
+            constantNodes.insert(node);
+            computedNodes.push_back(node);
+        }
+    }
+
+    // replace those that are needed by other nodes or are in a node group
+    set<ComputationNodeBasePtr> foldedNodes = NodesInGroups(GetAllNodeGroups());
+    for (const auto& node : nodes)
+    {
+        if (constantNodes.find(node) == constantNodes.end())
+            foldedNodes.insert(node->GetInputs().begin(), node->GetInputs().end());
+    }
+
+    MatrixPool matrixPool;
+    const auto previousOperationMode = Environment().SetOperationMode(NetworkOperationMode::inferring);
+    size_t numFoldedNodes = 0;
+    for (const auto& node : computedNodes)
+    {
+        node->RequestMatricesBeforeForwardProp(matrixPool);
+        node->BeginForwardProp();
+        node->ForwardProp(FrameRange(nullptr));
+        node->EndForwardProp();
+
+        if (foldedNodes.find(node) == foldedNodes.end())
+            continue;
+
+        auto newParameter = New<LearnableParameter<ElemType>>(node->GetDeviceId(), node->NodeName(), node->GetSampleLayout());
+        newParameter->Value().SetValue(node->As<ComputationNode<ElemType>>()->Value());
+        ComputationNodeBasePtr parameter = newParameter;
+        parameter->SetLearningRateMultiplier(0); // a constant
+
+        // (nodes of the subexpression that are computed later now take the value from the parameter)
+        ChangeNodeInputs(node, parameter);
+        for (auto group : GetAllNodeGroups())
+            replace(group->begin(), group->end(), node, parameter);
+        node->DetachInputs();
+        RemoveNodeFromNet(node);
+        AddNodeToNet(parameter);
+        numFoldedNodes++;
+    }
+    Environment().SetOperationMode(previousOperationMode);
+    return numFoldedNodes;
+}
+
+// fold BatchNormalization nodes into the Times or Convolution node that computes their input
+// During inference, BatchNormalization computes 'a .* x + b' per output (per channel if spatial), so BatchNormalization(W x)
+// is the same as (a .* W) x + b, where a scales the rows of W. If the input is Plus(W x, c), c is replaced by a .* c + b.
+// The weights must be parameters that are used by no other node, the inputs of BatchNormalization must be parameters.
+// The BatchNormalization node is replaced by the Plus node, which gets its name. Returns the number of nodes folded.
+template <class ElemType>
+size_t ComputationNetwork::FoldBatchNormalizationNodes()
+{
+    map<ComputationNodeBasePtr, size_t> numConsumers;
+    vector<ComputationNodeBasePtr> batchNormalizationNodes;
+    for (const auto& iter : m_nameToNodeMap)
+    {
+        for (const auto& input : iter.second->GetInputs())
+            numConsumers[input]++;
+        if (iter.second->OperationName() == OperationNameOf(BatchNormalizationNode) && iter.second->Is<BatchNormalizationNode<ElemType>>())
+            batchNormalizationNodes.push_back(iter.second);
+    }
+    let groupedNodes = NodesInGroups(GetAllNodeGroups());
+    let isExclusive = [&](const ComputationNodeBasePtr& node)
+    {
+        return numConsumers[node] == 1 && groupedNodes.find(node) == groupedNodes.end();
+    };
+    let isParameter = [](const ComputationNodeBasePtr& node)
+    {
+        return node->OperationName() == OperationNameOf(LearnableParameter);
+    };
+
+    size_t numFoldedNodes = 0;
+    for (const auto& node : batchNormalizationNodes)
+    {
+        auto batchNormalization = node->As<BatchNormalizationNode<ElemType>>();
+        if (!all_of(node->GetInputs().begin() + 1, node->GetInputs().end(), isParameter))
+            continue;
+
+        // find the linear operation, and the Plus node that adds a bias to it if any
+        ComputationNodeBasePtr linear = node->Input(0), plus, bias;
+        if (linear->OperationName() == OperationNameOf(PlusNode) && isExclusive(linear))
+        {
+            plus = linear;
+            for (size_t i = 0; i < 2 && !bias; i++)
+            {
+                if (isParameter(plus->Input(i)) && isExclusive(plus->Input(i)))
+                {
+                    bias = plus->Input(i);
+                    linear = plus->Input(1 - i);
+                }
+            }
+            if (!bias)
+                continue;
+        }
+
+        const bool isConvolution = linear->OperationName() == OperationNameOf(ConvolutionNode) &&
+                                   !linear->As<ConvolutionNode<ElemType>>()->IsTransposed() &&
+                                   linear->As<ConvolutionNode<ElemType>>()->GetImageLayoutKind() == ImageLayoutKind::CHW;
+        const bool isTimes = linear->OperationName() == OperationNameOf(TimesNode);
+        if (!(isTimes || isConvolution) || !isExclusive(linear) || !isParameter(linear->Input(0)) || !isExclusive(linear->Input(0)) ||
+            batchNormalization->IsSpatial() != isConvolution)
+        {
+            continue;
+        }
+
+        // the weights have a row per output (Times) or output channel (Convolution), as do the scale and shift
+        Matrix<ElemType>& weights = linear->Input(0)->As<ComputationNode<ElemType>>()->Value();
+        const TensorShape& outputShape = node->GetSampleLayout();
+        const size_t numChannels = node->Input(1)->GetSampleLayout().GetNumElements();
+        TensorShape biasShape = outputShape;
+        if (isConvolution) // channels are the last dimension in CHW layout
+        {
+            SmallVector<size_t> dims(outputShape.GetRank(), 1);
+            dims[dims.size() - 1] = numChannels;
+            biasShape = TensorShape(dims);
+        }
+        if (weights.GetNumRows() != numChannels || biasShape.GetNumElements() != numChannels ||
+            (isConvolution && outputShape[outputShape.GetRank() - 1] != numChannels))
+        {
+            continue;
+        }
+        if (bias && (bias->GetSampleLayout().GetRank() > biasShape.GetRank() || bias->GetSampleLayout().PadRank(biasShape.GetRank()) != biasShape))
+            continue;
+
+        Matrix<ElemType> scale(node->GetDeviceId()), shift(node->GetDeviceId());
+        batchNormalization->GetInferenceScaleAndShift(scale, shift);
+        scale.Reshape(numChannels, 1);
+        shift.Reshape(numChannels, 1);
+        if (isTimes)
+            weights.ColumnElementMultiplyWith(scale);
+        else
+        {
+            // the convolution engines read the kernel matrix in row-major order, i.e. the kernel of each channel is contiguous
+            const size_t numRows = weights.GetNumRows(), numCols = weights.GetNumCols();
+            weights.Reshape(numCols, numRows);
+            scale.Reshape(1, numChannels);
+            weights.RowElementMultiplyWith(scale);
+            scale.Reshape(numChannels, 1);
+            weights.Reshape(numRows, numCols);
+        }
+
+        const wstring nodeName = node->NodeName();
+        if (bias)
+        {
+            Matrix<ElemType>& biasValue = bias->As<ComputationNode<ElemType>>()->Value();
+            const size_t numRows = biasValue.GetNumRows(), numCols = biasValue.GetNumCols();
+            biasValue.Reshape(numChannels, 1);
+            biasValue.ElementMultiplyWith(scale);
+            biasValue += shift;
+            biasValue.Reshape(numRows, numCols);
+        }
+        else
+        {
+            let uniqueName = [this](wstring name)
+            {
+                while (NodeNameExists(name))
+                    name = L"_" + name;
+                return name;
+            };
+            auto newBias = New<LearnableParameter<ElemType>>(node->GetDeviceId(), uniqueName(nodeName + L"_bias"), biasShape);
+            shift.Reshape(newBias->Value().GetNumRows(), newBias->Value().GetNumCols());
+            newBias->Value().SetValue(shift);
+            AddNodeToNet(newBias);
+            bias = newBias;
+
+            plus = New<PlusNode<ElemType>>(node->GetDeviceId(), uniqueName(L"_" + nodeName));
+            plus->AttachInputs({ linear, bias });
+            AddNodeToNet(plus);
+        }
+
+        // the Plus node takes the place and name of the BatchNormalization node
+        ChangeNodeInputs(node, plus);
+        for (auto group : GetAllNodeGroups())
+            replace(group->begin(), group->end(), node, plus);
+        node->DetachInputs();
+        RemoveNodeFromNet(node);
+        RenameNode(plus, nodeName);
+        numFoldedNodes++;
+    }
+    return numFoldedNodes;
+}
+
+// measure the time that ForwardProp() of the outputs takes for a sequence of 'numSamples' samples (all zero)
+// This is done on a copy of the network, since the matrices of a network can only be allocated once.
+// Without output nodes, the criterion and evaluation nodes are measured. Returns the average over a few runs in seconds.
+template <class ElemType>
+double ComputationNetwork::MeasureForwardPropLatency(size_t numSamples)
+{
+    auto net = make_shared<ComputationNetwork>(m_deviceId);
+    for (const auto& iter : m_nameToNodeMap)
+        net->AddNodeToNet(iter.second->Duplicate(iter.first, CopyNodeFlags::copyNodeValue));
+    for (const auto& iter : m_nameToNodeMap)
+    {
+        for (size_t i = 0; i < iter.second->GetNumInputs(); i++)
+            net->GetNodeFromName(iter.first)->SetInput(i, net->GetNodeFromName(iter.second->Input(i)->NodeName()));
+    }
+    let groups = GetAllNodeGroups();
+    let netGroups = net->GetAllNodeGroups();
+    for (size_t k = 0; k < groups.size(); k++)
+    {
+        for (const auto& node : *groups[k])
+            netGroups[k]->push_back(net->GetNodeFromName(node->NodeName()));
+    }
+    net->CompileNetwork();
+
+    vector<ComputationNodeBasePtr> rootNodes = net->OutputNodes();
+    if (rootNodes.empty())
+    {
+        rootNodes = net->FinalCriterionNodes();
+        rootNodes.insert(rootNodes.end(), net->EvaluationNodes().begin(), net->EvaluationNodes().end());
+    }
+    net->AllocateAllMatrices({}, rootNodes, nullptr);
+
+    set<ComputationNodeBasePtr> inputSet;
+    for (const auto& rootNode : rootNodes)
+        inputSet.insert(net->InputNodes(rootNode).begin(), net->InputNodes(rootNode).end());
+    const vector<ComputationNodeBasePtr> inputNodes(inputSet.begin(), inputSet.end());
+    for (const auto& input : inputNodes)
+    {
+        if (!input->HasMBLayout())
+            continue;
+        input->GetMBLayout()->Init(1, numSamples); // (the layout may be shared by several inputs)
+        input->GetMBLayout()->AddSequence(0, 0, 0, numSamples);
+        auto& value = input->As<ComputationNode<ElemType>>()->Value();
+        value.Resize(input->GetSampleLayout().GetNumElements(), numSamples);
+        value.SetValue(0);
+    }
+
+    ScopedNetworkOperationMode modeGuard(net, NetworkOperationMode::inferring);
+    net->StartEvaluateMinibatchLoop(rootNodes);
+
+    // the first run allocates memory, it is not counted
+    const size_t numRuns = 10;
+    chrono::steady_clock::time_point startTime;
+    for (size_t run = 0; run <= numRuns; run++)
+    {
+        if (run == 1)
+            startTime = chrono::steady_clock::now();
+        ComputationNetwork::BumpEvalTimeStamp(inputNodes);
+        net->ForwardProp(rootNodes);
+    }
+    // wait for the GPU
+    for (const auto& rootNode : rootNodes)
+    {
+        const auto& value = rootNode->As<ComputationNode<ElemType>>()->Value();
+        if (!value.IsEmpty())
+            value.Get00Element();
+    }
+    return chrono::duration<double>(chrono::steady_clock::now() - startTime).count() / numRuns;
+}
+
+template void ComputationNetwork::OptimizeForInference<float>(size_t latencyTestSamples);
+template void ComputationNetwork::OptimizeForInference<double>(size_t latencyTestSamples);
+
+}}}
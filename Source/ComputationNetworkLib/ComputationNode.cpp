@@ -486,6 +486,30 @@ template <class ElemType>
     }
 }
 
+// append printf-formatted text to a string (does not throw, so that it can be used inside parallel regions)
+static void AppendFormatted(string& out, const char* format, ...)
+{
+    char buffer[256];
+    va_list args;
+    va_start(args, format);
+    int n = vsnprintf(buffer, sizeof(buffer), format, args);
+    va_end(args);
+    if (n < 0)
+        return;
+    if (n < (int)sizeof(buffer))
+    {
+        out.append(buffer, n);
+        return;
+    }
+    // too long for the local buffer: format again straight into the output
+    size_t offset = out.size();
+    out.resize(offset + n + 1);
+    va_start(args, format);
+    vsnprintf(&out[offset], n + 1, format, args);
+    va_end(args);
+    out.resize(offset + n);
+}
+
 // write out the content of a node in formatted/readable form
 // 'transpose' means print one row per sample (non-transposed is one column per sample).
 // 'isSparse' will print all non-zero values as one row (non-transposed, which makes sense for one-hot) or column (transposed).
@@ -497,6 +521,24 @@ void ComputationNode<ElemType>::WriteMinibatchWithFormatting(FILE* f, const Fram
                                                              const string& elementSeparator, const string& sampleSeparator,
                                                              string valueFormatString,
                                                              bool outputGradient) const
+{
+    let text = FormatMinibatch(fr, onlyUpToRow, onlyUpToT, transpose, isCategoryLabel, isSparse, labelMapping,
+                               sequenceSeparator, sequencePrologue, sequenceEpilogue, elementSeparator, sampleSeparator,
+                               valueFormatString, outputGradient);
+    fwriteOrDie(text.data(), sizeof(char), text.size(), f);
+    fflushOrDie(f);
+}
+
+// same as WriteMinibatchWithFormatting() but returns the text instead of writing it
+// Sequences are formatted in parallel, since formatting dominates the cost of writing large outputs.
+template <class ElemType>
+string ComputationNode<ElemType>::FormatMinibatch(const FrameRange& fr,
+                                                  size_t onlyUpToRow, size_t onlyUpToT, bool transpose, bool isCategoryLabel, bool isSparse,
+                                                  const vector<string>& labelMapping, const string& sequenceSeparator, 
+                                                  const string& sequencePrologue, const string& sequenceEpilogue,
+                                                  const string& elementSeparator, const string& sampleSeparator,
+                                                  string valueFormatString,
+                                                  bool outputGradient) const
 {
     // get minibatch matrix -> matData, matRows, matStride
     const Matrix<ElemType>& outputValues = outputGradient ? Gradient() : Value();
@@ -529,8 +571,27 @@ void ComputationNode<ElemType>::WriteMinibatchWithFormatting(FILE* f, const Fram
     bool sequencePrologueHasSeqId = sequencePrologue.find("%d") != sequencePrologue.npos;
     bool sampleSeparatorHasSeqId  = sampleSeparator.find("%d")  != sampleSeparator.npos;
 
-    for (size_t s = 0; s < sequences.size(); s++)
+    // output it according to our format specification
+    auto formatChar = valueFormatString.back();
+    if (isCategoryLabel && formatChar == 's') // verify label dimension
+    {
+        if (outputValues.GetNumRows() != labelMapping.size() &&
+            sampleLayout[0] != labelMapping.size()) // if we match the first dim then use that
+        {
+            static size_t warnings = 0;
+            if (warnings++ < 5)
+                fprintf(stderr, "write: Row dimension %d does not match number of entries %d in labelMappingFile, not using mapping\n", (int)matRows, (int)labelMapping.size());
+            valueFormatString.back() = 'u'; // this is a fallback
+            formatChar = valueFormatString.back();
+        }
+    }
+
+    // each sequence is formatted into its own string, sequences occupy disjoint columns
+    vector<string> sequenceTexts(sequences.size());
+#pragma omp parallel for if (sequences.size() > 1)
+    for (long long sl = 0; sl < (long long)sequences.size(); sl++)
     {
+        let s = (size_t)sl;
         const auto& seqInfo = sequences[s];
         if (seqInfo.seqId == GAP_SEQUENCE_ID) // nothing in gaps to print
             continue;
@@ -577,26 +638,13 @@ void ComputationNode<ElemType>::WriteMinibatchWithFormatting(FILE* f, const Fram
                 sampleSep = msra::strfun::ReplaceAll<std::string>(sampleSep, "%d", sh);
         }
 
+        string& out = sequenceTexts[s];
         if (s > 0)
-            fprintfOrDie(f, "%s", sequenceSeparator.c_str());
-        fprintfOrDie(f, "%s", seqProl.c_str());
+            out += sequenceSeparator;
+        out += seqProl;
 
-        // output it according to our format specification
-        auto formatChar = valueFormatString.back();
         if (isCategoryLabel) // if is category then find the max value and output its index (possibly mapped to a string)
         {
-            if (formatChar == 's') // verify label dimension
-            {
-                if (outputValues.GetNumRows() != labelMapping.size() &&
-                    sampleLayout[0] != labelMapping.size()) // if we match the first dim then use that
-                {
-                    static size_t warnings = 0;
-                    if (warnings++ < 5)
-                        fprintf(stderr, "write: Row dimension %d does not match number of entries %d in labelMappingFile, not using mapping\n", (int)seqRows, (int)labelMapping.size());
-                    valueFormatString.back() = 'u'; // this is a fallback
-                    formatChar = valueFormatString.back();
-                }
-            }
             // update the matrix in-place from one-hot (or max) to index
             // find the max in each column
             for (size_t j = 0; j < seqCols; j++) // loop over all time steps of the sequence
@@ -622,11 +670,11 @@ void ComputationNode<ElemType>::WriteMinibatchWithFormatting(FILE* f, const Fram
             if (formatChar == 'f') // print as real number
             {
                 if (dval == 0) dval = fabs(dval);    // clear the sign of a negative 0, which are produced inconsistently between CPU and GPU
-                fprintfOrDie(f, valueFormatString.c_str(), dval);
+                AppendFormatted(out, valueFormatString.c_str(), dval);
             }
             else if (formatChar == 'u') // print category as integer index
             {
-                fprintfOrDie(f, valueFormatString.c_str(), (unsigned int)dval);
+                AppendFormatted(out, valueFormatString.c_str(), (unsigned int)dval);
             }
             else if (formatChar == 's') // print category as a label string
             {
@@ -635,7 +683,7 @@ void ComputationNode<ElemType>::WriteMinibatchWithFormatting(FILE* f, const Fram
                     uval %= labelMapping.size();
                 assert(uval < labelMapping.size());
                 const char * sval = labelMapping[uval].c_str();
-                fprintfOrDie(f, valueFormatString.c_str(), sval);
+                AppendFormatted(out, valueFormatString.c_str(), sval);
             }
         };
         // bounds for printing
@@ -658,21 +706,21 @@ void ComputationNode<ElemType>::WriteMinibatchWithFormatting(FILE* f, const Fram
                     if (dval == 0) // only print non-0 values
                         continue;
                     if (numPrinted++ > 0)
-                        fprintfOrDie(f, "%s", transpose ? sampleSeparator.c_str() : elementSeparator.c_str());
+                        out += transpose ? sampleSeparator : elementSeparator;
                     if (dval != 1.0 || formatChar != 'f') // hack: we assume that we are either one-hot or never precisely hitting 1.0
                         print(dval);
                     size_t row = transpose ? i : j;
                     size_t col = transpose ? j : i;
                     for (size_t k = 0; k < sampleLayout.size(); k++)
                     {
-                        fprintfOrDie(f, "%c%d", k == 0 ? '[' : ',', row % sampleLayout[k]);
+                        AppendFormatted(out, "%c%d", k == 0 ? '[' : ',', row % sampleLayout[k]);
                         if (sampleLayout[k] == labelMapping.size()) // annotate index with label if dimensions match (which may misfire once in a while)
-                            fprintfOrDie(f, "=%s", labelMapping[row % sampleLayout[k]].c_str());
+                            AppendFormatted(out, "=%s", labelMapping[row % sampleLayout[k]].c_str());
                         row /= sampleLayout[k];
                     }
                     if (seqInfo.GetNumTimeSteps() > 1)
-                        fprintfOrDie(f, ";%d", col);
-                    fprintfOrDie(f, "]");
+                        AppendFormatted(out, ";%d", col);
+                    out += "]";
                 }
             }
         }
@@ -681,27 +729,27 @@ void ComputationNode<ElemType>::WriteMinibatchWithFormatting(FILE* f, const Fram
             for (size_t j = 0; j < jend; j++) // loop over output rows     --BUGBUG: row index is 'i'!! Rename these!!
             {
                 if (j > 0)
-                    fprintfOrDie(f, "%s", sampleSep.c_str());
+                    out += sampleSep;
                 if (j == jstop && jstop < jend - 1) // if jstop == jend-1 we may as well just print the value instead of '...'
                 {
-                    fprintfOrDie(f, "...+%d", (int)(jend - jstop)); // 'nuff said
+                    AppendFormatted(out, "...+%d", (int)(jend - jstop)); // 'nuff said
                     break;
                 }
                 // inject sample tensor index if we are printing row-wise and it's a tensor
                 if (!transpose && sampleLayout.size() > 1 && !isCategoryLabel) // each row is a different sample dimension
                 {
                     for (size_t k = 0; k < sampleLayout.size(); k++)
-                        fprintfOrDie(f, "%c%d", k == 0 ? '[' : ',', (int)((j / sampleLayout.GetStrides()[k])) % sampleLayout[k]);
-                    fprintfOrDie(f, "]\t");
+                        AppendFormatted(out, "%c%d", k == 0 ? '[' : ',', (int)((j / sampleLayout.GetStrides()[k])) % sampleLayout[k]);
+                    out += "]\t";
                 }
                 // print a row of values
                 for (size_t i = 0; i < iend; i++) // loop over elements
                 {
                     if (i > 0)
-                        fprintfOrDie(f, "%s", elementSeparator.c_str());
+                        out += elementSeparator;
                     if (i == istop && istop < iend - 1)
                     {
-                        fprintfOrDie(f, "...+%d", (int)(iend - istop));
+                        AppendFormatted(out, "...+%d", (int)(iend - istop));
                         break;
                     }
                     double dval = seqData[i * istride + j * jstride];
@@ -709,9 +757,17 @@ void ComputationNode<ElemType>::WriteMinibatchWithFormatting(FILE* f, const Fram
                 }
             }
         }
-        fprintfOrDie(f, "%s", sequenceEpilogue.c_str());
+        out += sequenceEpilogue;
     } // end loop over sequences
-    fflushOrDie(f);
+
+    size_t totalLength = 0;
+    for (let& text : sequenceTexts)
+        totalLength += text.size();
+    string result;
+    result.reserve(totalLength);
+    for (let& text : sequenceTexts)
+        result += text;
+    return result;
 }
 
 /*static*/ string WriteFormattingOptions::Processed(const wstring& nodeName, string fragment, size_t minibatchId)
@@ -742,9 +798,20 @@ WriteFormattingOptions::WriteFormattingOptions(const ConfigRecordType& config) :
             if      (type == L"real")     ; // default
             else if (type == L"category") isCategoryLabel = true;
             else if (type == L"sparse")   isSparse = true;
-            else                         InvalidArgument("write: type must be 'real', 'category', or 'sparse'");
+            else if (type == L"binary")   isBinary = true;
+            else                         InvalidArgument("write: type must be 'real', 'category', 'sparse', or 'binary'");
             labelMappingFile = (wstring)formatConfig(L"labelMappingFile", L"");
         }
+        if (isBinary)
+        {
+            wstring binaryPrecision = formatConfig(L"binaryPrecision", L"float");
+            if      (binaryPrecision == L"float")  binaryElementSize = sizeof(float);
+            else if (binaryPrecision == L"half")   binaryElementSize = sizeof(uint16_t);
+            else if (binaryPrecision == L"double") binaryElementSize = sizeof(double);
+            else                                   InvalidArgument("write: binaryPrecision must be 'float', 'half', or 'double'");
+            writeSequenceKeys = formatConfig(L"writeSequenceKeys", writeSequenceKeys);
+        }
+        asyncWrite = formatConfig(L"asyncWrite", asyncWrite);
         transpose = formatConfig(L"transpose", transpose);
         prologue  = formatConfig(L"prologue",  prologue);
         epilogue  = formatConfig(L"epilogue",  epilogue);
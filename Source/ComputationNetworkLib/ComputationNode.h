@@ -132,6 +132,13 @@ struct /*interface*/ IStatefulNode
     typedef std::shared_ptr<INodeState> NodeStatePtr;
     virtual NodeStatePtr ExportState() = 0;
     virtual void ImportState(const NodeStatePtr& state) = 0;
+
+    // Per-sequence state, for minibatches that combine independent sequences (e.g. of evaluation sessions), each of
+    // which continues in another minibatch, possibly in another parallel sequence:
+    // ExportSequenceState() returns what the sequence in parallel sequence s of the last minibatch leaves behind,
+    // ImportSequenceStates() prepares the next minibatch, with the state for each of its parallel sequences (nullptr if it starts there).
+    virtual NodeStatePtr ExportSequenceState(size_t s) = 0;
+    virtual void ImportSequenceStates(const std::vector<NodeStatePtr>& states) = 0;
 };
 typedef IStatefulNode::NodeStatePtr NodeStatePtr;
 
@@ -592,6 +599,11 @@ public:
     virtual double Get00Element() const = 0;
     virtual MatrixBasePtr ValuePtr() const = 0; // for use in readers that pass the agnostic object around
 
+    // for the profiler (ComputationProfiler)
+    virtual size_t GetMatrixBufferSize() const = 0; // bytes currently allocated for value and gradient
+    // estimated number of floating-point operations per output element of ForwardProp(); by default one per input
+    virtual double GetForwardPropFlopsPerElement() const { return (double) std::max(GetNumInputs(), (size_t) 1); }
+
     // TODO: two sets of functions, choose one
     const std::wstring& NodeName() const { return m_nodeName; }
     std::wstring GetName() const { return m_nodeName; }
@@ -739,6 +751,18 @@ public:
     void SetOutputNeededDuringBackprop(bool f) { m_outputNeededDuringBackprop = f; }
     bool IsOutputNeededDuringBackprop() const { return !g_shareNodeValueMatrices || m_outputNeededDuringBackprop; }
 
+    // matrices this node has obtained from the MatrixPool, which it may share with other nodes
+    const std::vector<const void*>& GetMatricesFromPool() const { return m_matricesFromPool; }
+
+    // -----------------------------------------------------------------------
+    // concurrent execution
+    // -----------------------------------------------------------------------
+
+    // Can ForwardProp() and Backprop() of this node run concurrently with nodes it does not depend on?
+    // This requires that the node only modifies its own members, its own matrices, and its inputs' gradients.
+    // Base-class version makes conservative assumption that it cannot. Override if it can.
+    virtual bool IsThreadSafe() const { return false; }
+
     // -----------------------------------------------------------------------
     // helpers for network traversal
     // -----------------------------------------------------------------------
@@ -863,6 +887,7 @@ protected:
     float m_learningRateMultiplier;    // update parameters? Only used for LearnableParameters.    --TODO: Should we make this a member of LearnableParameters actually? And require a type cast? Currently it is read out for all leaves.
     bool m_gradientInitialized;        // indicates whether the gradient matrix has been resized and initialized to 0
     bool m_outputNeededDuringBackprop; // indicates whether the output value of the node is needed during backprop
+    std::vector<const void*> m_matricesFromPool; // matrices obtained from the MatrixPool (only used to identify them)
 };
 typedef ComputationNodeBase::ComputationNodeBasePtr ComputationNodeBasePtr;
 
@@ -1156,6 +1181,11 @@ public:
     MatrixBasePtr GradientPtr() const { return m_gradient; }
     // TODO: This is only used for testing whether a gradient has been allocated. Maybe reduce to bool HasGradient()?
 
+    size_t GetMatrixBufferSize() const override final
+    {
+        return (m_value ? m_value->BufferSize() : 0) + (m_gradient ? m_gradient->BufferSize() : 0);
+    }
+
 private:
 
     template<class E>
@@ -1529,14 +1559,15 @@ protected:
     {
         if (matrixPtr == nullptr)
         {
-            matrixPtr = matrixPool.Request<ElemType>(m_deviceId);
+            matrixPtr = matrixPool.Request<ElemType>(m_deviceId, this);
+            m_matricesFromPool.push_back(matrixPtr.get());
         }
     }
 
     void ReleaseMatrixToPool(shared_ptr<Matrix<ElemType>>& matrixPtr, MatrixPool& matrixPool)
     {
         assert(matrixPtr != nullptr);
-        matrixPool.Release<ElemType>(matrixPtr);
+        matrixPool.Release<ElemType>(matrixPtr, this);
     }
 
 public:
@@ -1552,6 +1583,11 @@ public:
                                       const std::string& sequencePrologue, const std::string& sequenceEpilogue, const std::string& elementSeparator,
                                       const std::string& sampleSeparator, std::string valueFormatString,
                                       bool outputGradient = false) const;
+    std::string FormatMinibatch(const FrameRange& fr, size_t onlyUpToRow, size_t onlyUpToT, bool transpose, bool isCategoryLabel, bool isSparse,
+                                const std::vector<std::string>& labelMapping, const std::string& sequenceSeparator, 
+                                const std::string& sequencePrologue, const std::string& sequenceEpilogue, const std::string& elementSeparator,
+                                const std::string& sampleSeparator, std::string valueFormatString,
+                                bool outputGradient = false) const;
 
     // simple helper to log the content of a minibatch
     void DebugLogMinibatch(bool outputGradient = false) const
@@ -1753,6 +1789,12 @@ struct WriteFormattingOptions
     std::string sampleSeparator;   // and this between rows
     // Optional printf precision parameter:
     std::string precisionFormat;        // printf precision, e.g. ".2" to get a "%.2f"
+    // Binary output (type = "binary"), raw values instead of text. Only used by the write command, not saved with the model.
+    bool isBinary = false;
+    size_t binaryElementSize = sizeof(float); // binaryPrecision: 'float', 'half' or 'double'
+    bool writeSequenceKeys = false;           // prefix each sequence with its sequence id
+    // Write the output on a background thread while the next minibatch is evaluated. Not saved with the model.
+    bool asyncWrite = true;
 
     WriteFormattingOptions() : // TODO: replace by initializers?
         isCategoryLabel(false), transpose(true), sequenceEpilogue("\n"), elementSeparator(" "), sampleSeparator("\n")
@@ -1832,6 +1874,7 @@ public:
     virtual ComputationNodeBasePtr Duplicate(const std::wstring& newName, const CopyNodeFlags flags) const override { NOT_IMPLEMENTED; }
     virtual double Get00Element() const override { NOT_IMPLEMENTED; }
     virtual MatrixBasePtr ValuePtr() const override { NOT_IMPLEMENTED; }
+    virtual size_t GetMatrixBufferSize() const override { return 0; }
     virtual void UpdateFunctionMBSize() override { NOT_IMPLEMENTED; }
     virtual void AttachInputs(const std::vector<ComputationNodeBasePtr>& inputs) override { NOT_IMPLEMENTED; }
     virtual void PrintSelf(bool) const override { NOT_IMPLEMENTED; }
@@ -1891,6 +1934,14 @@ public:
 
 struct IRecurrentNode { virtual int GetRecurrenceSteppingDirection() const = 0; };
 
+// =======================================================================
+// IFusedNode -- interface implemented by ComputationNodes that stand in for a subgraph
+// of other nodes at runtime (FusedElementwiseNode)
+// =======================================================================
+
+// The network saves the original nodes in their place, so that model files never contain fused nodes.
+struct IFusedNode { virtual const std::vector<ComputationNodeBasePtr>& GetFusedNodes() const = 0; };
+
 // =======================================================================
 // PreComputedNodeBase -- interface implemented by ComputationNodes that precompute
 // TODO: We can use this interface in more places.
@@ -2067,6 +2118,8 @@ public:
     {
         ValidateUnaryMap(isFinalValidationPass);
     }
+
+    virtual bool IsThreadSafe() const override { return true; }
 };
 
 #define UsingUnaryElementwiseNodeBaseMembers UsingComputationNodeMembersBoilerplate;
@@ -2091,6 +2144,7 @@ public:
     {
     }
 
+    virtual bool IsThreadSafe() const override { return true; }
 #if DUMPOUTPUT
     virtual bool OutputUsedInComputingInputNodesGradients() const override { return true; }
 #else
@@ -0,0 +1,227 @@
+//
+// Copyright (c) Microsoft. All rights reserved.
+// Licensed under the MIT license. See LICENSE.md file in the project root for full license information.
+//
+
+#define _CRT_SECURE_NO_WARNINGS // "secure" CRT not available on all platforms  --add this at the top of all CPP files that give "function or variable may be unsafe" warnings
+
+#include "Basics.h"
+#include "ComputationProfiler.h"
+#include "ComputationNode.h"
+#include "fileutil.h"
+#define __STDC_FORMAT_MACROS
+#include <inttypes.h>
+#include <string>
+#include <vector>
+#include <algorithm>
+
+using namespace std;
+
+namespace Microsoft { namespace MSR { namespace CNTK {
+
+// string as a JSON string literal (without the quotes)
+static string JsonEscape(const wstring& s)
+{
+    string utf8 = msra::strfun::utf8(s);
+    string result;
+    result.reserve(utf8.size());
+    for (char c : utf8)
+    {
+        if (c == '"' || c == '\\')
+        {
+            result.push_back('\\');
+            result.push_back(c);
+        }
+        else if ((unsigned char) c < 0x20)
+        {
+            char buf[8];
+            sprintf(buf, "\\u%04x", (int) (unsigned char) c);
+            result += buf;
+        }
+        else
+            result.push_back(c);
+    }
+    return result;
+}
+
+ComputationProfiler::ComputationProfiler(const wstring& traceFileName)
+    : m_startTime(chrono::steady_clock::now()), m_traceFile(nullptr), m_firstTraceEvent(true)
+{
+    if (!traceFileName.empty())
+    {
+        m_traceFile = fopenOrDie(traceFileName, L"w");
+        fprintfOrDie(m_traceFile, "[\n");
+        fprintf(stderr, "ComputationProfiler: writing trace to '%ls'\n", traceFileName.c_str());
+    }
+}
+
+ComputationProfiler::~ComputationProfiler()
+{
+    if (m_traceFile)
+    {
+        fprintf(m_traceFile, "\n]\n");
+        if (ferror(m_traceFile) || fclose(m_traceFile) != 0)
+            fprintf(stderr, "ComputationProfiler: WARNING: failed to write the trace file\n");
+    }
+}
+
+double ComputationProfiler::Now() const
+{
+    return chrono::duration<double>(chrono::steady_clock::now() - m_startTime).count();
+}
+
+size_t ComputationProfiler::GetThreadIndex()
+{
+    auto result = m_threadIndices.insert(make_pair(this_thread::get_id(), m_threadIndices.size()));
+    return result.first->second;
+}
+
+void ComputationProfiler::WriteTraceEvent(const wstring& name, const char* category, double startTime, double endTime, const string& args)
+{
+    if (!m_traceFile)
+        return;
+
+    fprintf(m_traceFile, "%s{\"name\":\"%s\",\"cat\":\"%s\",\"ph\":\"X\",\"pid\":0,\"tid\":%d,\"ts\":%.3f,\"dur\":%.3f,\"args\":{%s}}",
+            m_firstTraceEvent ? "" : ",\n", JsonEscape(name).c_str(), category, (int) GetThreadIndex(),
+            startTime * 1e6, (endTime - startTime) * 1e6, args.c_str());
+    m_firstTraceEvent = false;
+}
+
+void ComputationProfiler::RecordNode(const ComputationNodeBase& node, bool backprop, bool traceEvent, double startTime, double endTime, size_t bytesAllocated, double flops)
+{
+    lock_guard<mutex> lock(m_mutex);
+    NodeStats& stats = m_nodeStats[node.NodeName()];
+    if (stats.m_operationName.empty())
+        stats.m_operationName = node.OperationName();
+
+    PassStats& pass = backprop ? stats.m_backward : stats.m_forward;
+    pass.m_numCalls++;
+    pass.m_seconds += endTime - startTime;
+    pass.m_bytesAllocated += bytesAllocated;
+    pass.m_flops += flops;
+
+    if (traceEvent)
+    {
+        char args[256];
+        sprintf(args, "\"op\":\"%s\",\"flops\":%.0f,\"bytesAllocated\":%" PRIu64, JsonEscape(stats.m_operationName).c_str(), flops, (uint64_t) bytesAllocated);
+        WriteTraceEvent(node.NodeName(), backprop ? "backprop" : "forward", startTime, endTime, args);
+    }
+}
+
+void ComputationProfiler::RecordPhase(const wstring& name, double startTime, double endTime)
+{
+    lock_guard<mutex> lock(m_mutex);
+    PhaseStats& stats = m_phaseStats[name];
+    stats.m_numCalls++;
+    stats.m_seconds += endTime - startTime;
+    WriteTraceEvent(name, "phase", startTime, endTime, string());
+}
+
+size_t ComputationProfiler::GetNumCalls(const wstring& nodeName, bool backprop) const
+{
+    lock_guard<mutex> lock(m_mutex);
+    auto stats = m_nodeStats.find(nodeName);
+    if (stats == m_nodeStats.end())
+        return 0;
+    return backprop ? stats->second.m_backward.m_numCalls : stats->second.m_forward.m_numCalls;
+}
+
+void ComputationProfiler::Reset()
+{
+    lock_guard<mutex> lock(m_mutex);
+    m_nodeStats.clear();
+    m_phaseStats.clear();
+    if (m_traceFile)
+        fflush(m_traceFile);
+}
+
+void ComputationProfiler::PrintReport(const string& title, size_t maxNodes) const
+{
+    lock_guard<mutex> lock(m_mutex);
+
+    PassStats forward, backward;
+    vector<pair<double, const pair<const wstring, NodeStats>*>> nodesByTime;
+    for (const auto& entry : m_nodeStats)
+    {
+        forward.m_seconds  += entry.second.m_forward.m_seconds;
+        forward.m_flops    += entry.second.m_forward.m_flops;
+        backward.m_seconds += entry.second.m_backward.m_seconds;
+        backward.m_flops   += entry.second.m_backward.m_flops;
+        nodesByTime.push_back(make_pair(entry.second.m_forward.m_seconds + entry.second.m_backward.m_seconds, &entry));
+    }
+    sort(nodesByTime.begin(), nodesByTime.end(), [](const pair<double, const pair<const wstring, NodeStats>*>& a, const pair<double, const pair<const wstring, NodeStats>*>& b)
+    {
+        return a.first > b.first;
+    });
+    const double totalSeconds = forward.m_seconds + backward.m_seconds;
+
+    fprintf(stderr, "\nProfile %s: ForwardProp %.3f s (%.2f GFlop/s), Backprop %.3f s (%.2f GFlop/s)\n", title.c_str(),
+            forward.m_seconds, forward.m_seconds > 0 ? forward.m_flops / forward.m_seconds * 1e-9 : 0.0,
+            backward.m_seconds, backward.m_seconds > 0 ? backward.m_flops / backward.m_seconds * 1e-9 : 0.0);
+
+    for (const auto& entry : m_phaseStats)
+        fprintf(stderr, "    %-40ls %8d calls %12.3f s\n", entry.first.c_str(), (int) entry.second.m_numCalls, entry.second.m_seconds);
+
+    fprintf(stderr, "    %-40s %-24s %8s %12s %12s %7s %12s %12s\n", "node", "operation", "calls", "forward ms", "backprop ms", "time %", "GFlop/s", "MB allocated");
+    for (size_t i = 0; i < nodesByTime.size() && i < maxNodes; i++)
+    {
+        const wstring& nodeName = nodesByTime[i].second->first;
+        const NodeStats& stats = nodesByTime[i].second->second;
+        const double seconds = nodesByTime[i].first;
+        const double flops = stats.m_forward.m_flops + stats.m_backward.m_flops;
+        fprintf(stderr, "    %-40ls %-24ls %8d %12.3f %12.3f %7.2f %12.2f %12.2f\n",
+                nodeName.c_str(), stats.m_operationName.c_str(), (int) stats.m_forward.m_numCalls,
+                stats.m_forward.m_seconds * 1e3, stats.m_backward.m_seconds * 1e3,
+                totalSeconds > 0 ? 100.0 * seconds / totalSeconds : 0.0,
+                seconds > 0 ? flops / seconds * 1e-9 : 0.0,
+                (stats.m_forward.m_bytesAllocated + stats.m_backward.m_bytesAllocated) / (1024.0 * 1024.0));
+    }
+    if (nodesByTime.size() > maxNodes)
+        fprintf(stderr, "    (%d more nodes)\n", (int) (nodesByTime.size() - maxNodes));
+}
+
+// -----------------------------------------------------------------------
+// scopes
+// -----------------------------------------------------------------------
+
+ComputationProfiler::NodeScope::NodeScope(ComputationProfiler* profiler, const ComputationNodeBase& node, bool backprop, size_t numColumns, bool traceEvent)
+    : m_profiler(profiler), m_node(node), m_backprop(backprop), m_numColumns(numColumns), m_traceEvent(traceEvent), m_startBufferSize(0), m_startTime(0)
+{
+    if (m_profiler)
+    {
+        m_startBufferSize = m_node.GetMatrixBufferSize();
+        m_startTime = m_profiler->Now();
+    }
+}
+
+ComputationProfiler::NodeScope::~NodeScope()
+{
+    if (!m_profiler)
+        return;
+
+    const double endTime = m_profiler->Now();
+    const size_t bufferSize = m_node.GetMatrixBufferSize();
+    // BackpropTo() is counted as twice the ForwardProp() (gradients w.r.t. the inputs and, e.g., the weights)
+    double flops = m_node.GetForwardPropFlopsPerElement() * m_node.GetSampleLayout().GetNumElements() * m_numColumns;
+    if (m_backprop)
+        flops *= 2;
+    m_profiler->RecordNode(m_node, m_backprop, m_traceEvent, m_startTime, endTime, bufferSize > m_startBufferSize ? bufferSize - m_startBufferSize : 0, flops);
+}
+
+ComputationProfiler::PhaseScope::PhaseScope(ComputationProfiler* profiler, const wstring& name)
+    : m_profiler(profiler), m_startTime(0)
+{
+    if (m_profiler)
+    {
+        m_name = name;
+        m_startTime = m_profiler->Now();
+    }
+}
+
+ComputationProfiler::PhaseScope::~PhaseScope()
+{
+    if (m_profiler)
+        m_profiler->RecordPhase(m_name, m_startTime, m_profiler->Now());
+}
+
+}}}
@@ -0,0 +1,128 @@
+//
+// Copyright (c) Microsoft. All rights reserved.
+// Licensed under the MIT license. See LICENSE.md file in the project root for full license information.
+//
+
+#pragma once
+
+#include "Basics.h"
+#include <cstdio>
+#include <string>
+#include <map>
+#include <vector>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <chrono>
+
+namespace Microsoft { namespace MSR { namespace CNTK {
+
+class ComputationNodeBase;
+
+// ===========================================================================
+// ComputationProfiler -- per-node profile of forward and backward propagation
+// ===========================================================================
+
+// The profiler records, for each ForwardProp() and Backprop() call of a node, the wall time, the bytes newly allocated
+// for the node's value and gradient, and an estimate of the floating-point operations, plus the time spent in named
+// phases (e.g. waiting for the reader or aggregating gradients). The numbers are summed up per node and phase
+// until the next Reset(); SGD prints them with PrintReport() and resets them at the end of every epoch.
+// Optionally, all events are also written to a trace file in the Chrome trace event format (open it in chrome://tracing).
+// A network is profiled while a profiler is attached to its ComputationEnvironment.
+// Note: GPU kernels are launched asynchronously, so without CUDA_LAUNCH_BLOCKING=1 the time of a node may show up
+// in a later node that waits for the GPU.
+class ComputationProfiler
+{
+public:
+    // 'traceFileName' may be empty, in which case no trace is written
+    ComputationProfiler(const std::wstring& traceFileName = std::wstring());
+    ~ComputationProfiler();
+
+    // prints the statistics since the last Reset() to stderr, nodes sorted by total time, at most 'maxNodes' of them
+    void PrintReport(const std::string& title, size_t maxNodes = 30) const;
+
+    // number of recorded ForwardProp() or Backprop() calls of a node since the last Reset()
+    size_t GetNumCalls(const std::wstring& nodeName, bool backprop) const;
+
+    // clears the statistics (the trace file is continued)
+    void Reset();
+
+    // measures one ForwardProp() or Backprop() call of a node over 'numColumns' columns
+    // Does nothing if 'profiler' is null. Calls of nodes inside recurrent loops are made per time step,
+    // for them 'traceEvent' is false so that only their totals are recorded, and the loop itself is traced as a phase.
+    class NodeScope
+    {
+    public:
+        NodeScope(ComputationProfiler* profiler, const ComputationNodeBase& node, bool backprop, size_t numColumns, bool traceEvent = true);
+        ~NodeScope();
+
+    private:
+        ComputationProfiler* m_profiler;
+        const ComputationNodeBase& m_node;
+        bool m_backprop;
+        size_t m_numColumns;
+        bool m_traceEvent;
+        size_t m_startBufferSize;
+        double m_startTime;
+    };
+
+    // measures a named phase, e.g. L"reader wait"
+    class PhaseScope
+    {
+    public:
+        PhaseScope(ComputationProfiler* profiler, const std::wstring& name);
+        ~PhaseScope();
+
+    private:
+        ComputationProfiler* m_profiler;
+        std::wstring m_name;
+        double m_startTime;
+    };
+
+private:
+    DISABLE_COPY_AND_MOVE(ComputationProfiler);
+
+    struct PassStats
+    {
+        PassStats() : m_numCalls(0), m_seconds(0), m_bytesAllocated(0), m_flops(0) {}
+        size_t m_numCalls;
+        double m_seconds;
+        size_t m_bytesAllocated;
+        double m_flops;
+    };
+
+    struct NodeStats
+    {
+        std::wstring m_operationName;
+        PassStats m_forward;
+        PassStats m_backward;
+    };
+
+    struct PhaseStats
+    {
+        PhaseStats() : m_numCalls(0), m_seconds(0) {}
+        size_t m_numCalls;
+        double m_seconds;
+    };
+
+    // seconds since the profiler was created
+    double Now() const;
+
+    void RecordNode(const ComputationNodeBase& node, bool backprop, bool traceEvent, double startTime, double endTime, size_t bytesAllocated, double flops);
+    void RecordPhase(const std::wstring& name, double startTime, double endTime);
+    void WriteTraceEvent(const std::wstring& name, const char* category, double startTime, double endTime, const std::string& args);
+    size_t GetThreadIndex();
+
+    std::chrono::steady_clock::time_point m_startTime;
+    mutable std::mutex m_mutex; // nodes may be run on several threads
+    std::map<std::wstring, NodeStats> m_nodeStats;
+    std::map<std::wstring, PhaseStats> m_phaseStats;
+    std::map<std::thread::id, size_t> m_threadIndices;
+
+    FILE* m_traceFile;
+    bool m_firstTraceEvent;
+};
+
+typedef std::shared_ptr<ComputationProfiler> ComputationProfilerPtr;
+
+}}}
@@ -0,0 +1,392 @@
+//
+// Copyright (c) Microsoft. All rights reserved.
+// Licensed under the MIT license. See LICENSE.md file in the project root for full license information.
+//
+
+#include "stdafx.h"
+#include "Basics.h"
+#include "ComputationScheduler.h"
+#include "ComputationNode.h"
+#include <set>
+#include <map>
+#include <unordered_map>
+#include <algorithm>
+#include <exception>
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+
+using namespace std;
+
+namespace Microsoft { namespace MSR { namespace CNTK {
+
+// -----------------------------------------------------------------------
+// WorkStealingThreadPool methods
+// -----------------------------------------------------------------------
+
+WorkStealingThreadPool::WorkStealingThreadPool(size_t numThreads)
+    : m_numQueuedTasks(0), m_nextWorker(0), m_stopping(false)
+{
+    if (numThreads == 0)
+        InvalidArgument("WorkStealingThreadPool: At least one thread is required.");
+#ifdef _OPENMP
+    m_numOpenMPThreadsPerWorker = max(1, omp_get_max_threads() / (int) numThreads);
+#else
+    m_numOpenMPThreadsPerWorker = 1;
+#endif
+    for (size_t i = 0; i < numThreads; i++)
+        m_workers.push_back(unique_ptr<Worker>(new Worker()));
+    for (size_t i = 0; i < numThreads; i++)
+        m_workers[i]->m_thread = thread(&WorkStealingThreadPool::WorkerLoop, this, i);
+}
+
+WorkStealingThreadPool::~WorkStealingThreadPool()
+{
+    {
+        lock_guard<mutex> lock(m_sleepMutex);
+        m_stopping = true;
+    }
+    m_wakeUp.notify_all();
+    for (auto& worker : m_workers)
+        worker->m_thread.join();
+}
+
+size_t WorkStealingThreadPool::CurrentWorkerIndex() const
+{
+    auto threadId = this_thread::get_id();
+    for (size_t i = 0; i < m_workers.size(); i++)
+    {
+        if (m_workers[i]->m_thread.get_id() == threadId)
+            return i;
+    }
+    return SIZE_MAX;
+}
+
+void WorkStealingThreadPool::Submit(Task&& task)
+{
+    size_t workerIndex = CurrentWorkerIndex();
+    bool fromWorker = workerIndex != SIZE_MAX;
+    if (!fromWorker)
+        workerIndex = m_nextWorker++ % m_workers.size();
+
+    auto& worker = *m_workers[workerIndex];
+    {
+        lock_guard<mutex> lock(worker.m_mutex);
+        m_numQueuedTasks++; // (under the queue lock, so that the task cannot be taken before it is counted)
+        if (fromWorker)
+            worker.m_tasks.push_front(move(task));
+        else
+            worker.m_tasks.push_back(move(task));
+    }
+    {
+        lock_guard<mutex> lock(m_sleepMutex); // a worker that found no task is now waiting
+    }
+    m_wakeUp.notify_one();
+}
+
+// take a task from the front of the worker's own queue, or else from the back of another worker's queue
+bool WorkStealingThreadPool::TryGetTask(size_t workerIndex, Task& task)
+{
+    for (size_t k = 0; k < m_workers.size(); k++)
+    {
+        bool own = k == 0;
+        auto& worker = *m_workers[(workerIndex + k) % m_workers.size()];
+        lock_guard<mutex> lock(worker.m_mutex);
+        if (worker.m_tasks.empty())
+            continue;
+        if (own)
+        {
+            task = move(worker.m_tasks.front());
+            worker.m_tasks.pop_front();
+        }
+        else
+        {
+            task = move(worker.m_tasks.back());
+            worker.m_tasks.pop_back();
+        }
+        m_numQueuedTasks--;
+        return true;
+    }
+    return false;
+}
+
+void WorkStealingThreadPool::WorkerLoop(size_t workerIndex)
+{
+#ifdef _OPENMP
+    omp_set_num_threads(m_numOpenMPThreadsPerWorker); // (this only affects parallel regions started by this thread)
+#endif
+    Task task;
+    for (;;)
+    {
+        if (TryGetTask(workerIndex, task))
+        {
+            task();
+            task = nullptr;
+            continue;
+        }
+        unique_lock<mutex> lock(m_sleepMutex);
+        m_wakeUp.wait(lock, [this]() { return m_stopping || m_numQueuedTasks > 0; });
+        if (m_stopping)
+            return;
+    }
+}
+
+// (not function-local statics, since their initialization is not thread-safe with all of our compilers)
+static mutex s_threadPoolMutex;
+static shared_ptr<WorkStealingThreadPool> s_threadPool;
+
+/*static*/ shared_ptr<WorkStealingThreadPool> WorkStealingThreadPool::GetInstance(size_t numThreads)
+{
+    lock_guard<mutex> lock(s_threadPoolMutex);
+    if (!s_threadPool || s_threadPool->GetNumThreads() != numThreads)
+        s_threadPool = make_shared<WorkStealingThreadPool>(numThreads);
+    return s_threadPool;
+}
+
+// -----------------------------------------------------------------------
+// ComputationScheduler methods
+// -----------------------------------------------------------------------
+
+ComputationScheduler::ComputationScheduler(const vector<ComputationNodeBasePtr>& units)
+{
+    // determine the nodes that each unit executes (a recurrent loop executes all its nested nodes), and the unit of each node
+    size_t numUnits = units.size();
+    vector<vector<ComputationNodeBasePtr>> nodesOfUnit(numUnits);
+    unordered_map<const ComputationNodeBase*, size_t> unitOfNode;
+    vector<bool> isLeaf(numUnits, true);
+    m_isThreadSafe.assign(numUnits, true);
+    bool isOnCPU = true;
+    for (size_t i = 0; i < numUnits; i++)
+    {
+        auto flowControlNode = dynamic_pointer_cast<FlowControlNode>(units[i]);
+        if (flowControlNode)
+            nodesOfUnit[i] = flowControlNode->m_nestedNodes;
+        else
+            nodesOfUnit[i].push_back(units[i]);
+        for (const auto& node : nodesOfUnit[i])
+        {
+            unitOfNode[node.get()] = i;
+            isLeaf[i] = isLeaf[i] && node->IsLeaf();
+            m_isThreadSafe[i] = m_isThreadSafe[i] && node->IsThreadSafe();
+            isOnCPU = isOnCPU && node->GetDeviceId() == CPUDEVICE;
+            if (node->HasMBLayout() && find(m_layouts.begin(), m_layouts.end(), node->GetMBLayout()) == m_layouts.end())
+                m_layouts.push_back(node->GetMBLayout());
+        }
+    }
+    if (!isOnCPU) // on the GPU, all nodes are launched into the same stream anyway
+        return;
+
+    // collect which units touch which pooled matrix (as owner, or as consumer of the owner's value and producer of its gradient),
+    // and which units write into the gradient of each node
+    map<const void*, set<size_t>> unitsOfMatrix;
+    unordered_map<const ComputationNodeBase*, set<size_t>> gradientWritersOfNode;
+    vector<set<size_t>> forwardSuccessors(numUnits);
+    for (size_t i = 0; i < numUnits; i++)
+    {
+        for (const auto& node : nodesOfUnit[i])
+        {
+            for (auto matrix : node->GetMatricesFromPool())
+                unitsOfMatrix[matrix].insert(i);
+            for (const auto& input : node->GetInputs())
+            {
+                auto inputUnit = unitOfNode.find(input.get());
+                if (inputUnit != unitOfNode.end() && inputUnit->second != i) // data dependency
+                    forwardSuccessors[inputUnit->second].insert(i);
+                for (auto matrix : input->GetMatricesFromPool())
+                    unitsOfMatrix[matrix].insert(i);
+                if (input->NeedsGradient())
+                    gradientWritersOfNode[input.get()].insert(i);
+            }
+        }
+    }
+
+    // units sharing a matrix are executed in their sequential order
+    for (const auto& matrixUnits : unitsOfMatrix)
+    {
+        for (auto iter = matrixUnits.second.begin(); next(iter) != matrixUnits.second.end(); iter++)
+            forwardSuccessors[*iter].insert(*next(iter));
+    }
+
+    // a unit that is not thread-safe waits for everything before it, and everything after it waits for it
+    size_t barrier = SIZE_MAX;
+    vector<size_t> sinceBarrier;
+    for (size_t i = 0; i < numUnits; i++)
+    {
+        if (barrier != SIZE_MAX)
+            forwardSuccessors[barrier].insert(i);
+        if (m_isThreadSafe[i])
+            sinceBarrier.push_back(i);
+        else
+        {
+            for (auto k : sinceBarrier)
+                forwardSuccessors[k].insert(i);
+            sinceBarrier.clear();
+            barrier = i;
+        }
+    }
+
+    // Backprop() runs the same constraints in reverse, and additionally serializes the accumulation into a gradient
+    vector<set<size_t>> backwardSuccessors(numUnits);
+    for (size_t i = 0; i < numUnits; i++)
+    {
+        for (auto k : forwardSuccessors[i])
+            backwardSuccessors[k].insert(i);
+    }
+    for (const auto& writers : gradientWritersOfNode)
+    {
+        for (auto iter = writers.second.rbegin(); next(iter) != writers.second.rend(); iter++)
+            backwardSuccessors[*iter].insert(*next(iter));
+    }
+
+    FormGraph(m_forward,  forwardSuccessors,  isLeaf);
+    FormGraph(m_backward, backwardSuccessors, isLeaf);
+}
+
+// convert the successor sets into the graph, and determine whether there are non-leaf units that can run concurrently
+/*static*/ void ComputationScheduler::FormGraph(Graph& graph, const vector<set<size_t>>& successors, const vector<bool>& isLeaf)
+{
+    size_t numUnits = successors.size();
+    graph.m_successors.resize(numUnits);
+    graph.m_numPredecessors.assign(numUnits, 0);
+    for (size_t i = 0; i < numUnits; i++)
+    {
+        graph.m_successors[i].assign(successors[i].begin(), successors[i].end());
+        for (auto k : successors[i])
+            graph.m_numPredecessors[k]++;
+    }
+
+    // level of a unit = number of non-leaf units on the longest path to it; two non-leaf units on the same level can run concurrently
+    vector<size_t> level(numUnits, 0);
+    vector<size_t> numPending(graph.m_numPredecessors);
+    vector<size_t> ready;
+    for (size_t i = 0; i < numUnits; i++)
+    {
+        if (numPending[i] == 0)
+            ready.push_back(i);
+    }
+    map<size_t, size_t> numNonLeafUnitsOnLevel;
+    while (!ready.empty())
+    {
+        size_t i = ready.back();
+        ready.pop_back();
+        if (!isLeaf[i] && ++numNonLeafUnitsOnLevel[level[i]] > 1)
+            graph.m_hasConcurrency = true;
+        for (auto k : graph.m_successors[i])
+        {
+            level[k] = max(level[k], level[i] + (isLeaf[i] ? 0 : 1));
+            if (--numPending[k] == 0)
+                ready.push_back(k);
+        }
+    }
+}
+
+// state of one ForwardProp() or Backprop() run, shared by its tasks
+struct ComputationScheduler::RunState
+{
+    RunState(const ComputationScheduler& scheduler, const Graph& graph, WorkStealingThreadPool& threadPool, const function<void(size_t)>& execute)
+        : m_scheduler(scheduler), m_graph(graph), m_threadPool(threadPool), m_execute(execute),
+          m_numPending(new atomic<size_t>[graph.m_numPredecessors.size()]), m_numRemaining(graph.m_numPredecessors.size()), m_failed(false)
+    {
+        for (size_t i = 0; i < graph.m_numPredecessors.size(); i++)
+            m_numPending[i] = graph.m_numPredecessors[i];
+    }
+
+    const ComputationScheduler& m_scheduler;
+    const Graph& m_graph;
+    WorkStealingThreadPool& m_threadPool;
+    function<void(size_t)> m_execute;
+    unique_ptr<atomic<size_t>[]> m_numPending; // [unit] number of predecessors not done yet
+    atomic<size_t> m_numRemaining;             // number of units not done yet
+    atomic<bool> m_failed;
+    exception_ptr m_error;
+    mutex m_mutex;
+    condition_variable m_allDone;
+};
+
+// execute a unit, then the successors that became ready: the first one on this thread, the others as new tasks
+/*static*/ void ComputationScheduler::RunUnit(const shared_ptr<RunState>& state, size_t unit)
+{
+    for (;;)
+    {
+        if (!state->m_failed) // after a failure, the remaining units are only counted down
+        {
+            try
+            {
+                state->m_execute(unit);
+                // a node that is not thread-safe (e.g. WhereNode) may have changed a layout, while the others run concurrently again
+                if (!state->m_scheduler.m_isThreadSafe[unit])
+                    state->m_scheduler.PrepareLayouts();
+            }
+            catch (...)
+            {
+                lock_guard<mutex> lock(state->m_mutex);
+                if (!state->m_error)
+                    state->m_error = current_exception();
+                state->m_failed = true;
+            }
+        }
+
+        size_t nextUnit = SIZE_MAX;
+        for (auto successor : state->m_graph.m_successors[unit])
+        {
+            if (--state->m_numPending[successor] != 0)
+                continue;
+            if (nextUnit == SIZE_MAX)
+                nextUnit = successor;
+            else
+                state->m_threadPool.Submit([state, successor]() { RunUnit(state, successor); });
+        }
+
+        if (--state->m_numRemaining == 0)
+        {
+            lock_guard<mutex> lock(state->m_mutex);
+            state->m_allDone.notify_all();
+        }
+        if (nextUnit == SIZE_MAX)
+            return;
+        unit = nextUnit;
+    }
+}
+
+void ComputationScheduler::Run(const Graph& graph, WorkStealingThreadPool& threadPool, const function<void(size_t)>& execute) const
+{
+    if (threadPool.IsWorkerThread()) // (waiting for the pool on one of its own threads could deadlock)
+        LogicError("ComputationScheduler: Cannot run on a thread of its own thread pool.");
+
+    PrepareLayouts();
+
+    auto state = make_shared<RunState>(*this, graph, threadPool, execute);
+    for (size_t i = 0; i < graph.m_numPredecessors.size(); i++)
+    {
+        if (graph.m_numPredecessors[i] == 0)
+            threadPool.Submit([state, i]() { RunUnit(state, i); });
+    }
+    {
+        unique_lock<mutex> lock(state->m_mutex);
+        state->m_allDone.wait(lock, [&state]() { return state->m_numRemaining == 0; });
+    }
+    if (state->m_error)
+        rethrow_exception(state->m_error);
+}
+
+void ComputationScheduler::ForwardProp(WorkStealingThreadPool& threadPool, const function<void(size_t)>& execute) const
+{
+    Run(m_forward, threadPool, execute);
+}
+
+void ComputationScheduler::Backprop(WorkStealingThreadPool& threadPool, const function<void(size_t)>& execute) const
+{
+    Run(m_backward, threadPool, execute);
+}
+
+// MBLayout creates its column-validity mask lazily when first masking; do that here rather than concurrently
+void ComputationScheduler::PrepareLayouts() const
+{
+    for (const auto& layout : m_layouts)
+    {
+        if (layout->HasGaps())
+            layout->GetColumnsValidityMask(CPUDEVICE);
+    }
+}
+
+}}}
@@ -0,0 +1,120 @@
+//
+// Copyright (c) Microsoft. All rights reserved.
+// Licensed under the MIT license. See LICENSE.md file in the project root for full license information.
+//
+
+#pragma once
+
+#include "Basics.h"
+#include "Sequences.h"
+#include <vector>
+#include <set>
+#include <deque>
+#include <memory>
+#include <functional>
+#include <mutex>
+#include <condition_variable>
+#include <thread>
+#include <atomic>
+
+namespace Microsoft { namespace MSR { namespace CNTK {
+
+class ComputationNodeBase;
+
+// ===========================================================================
+// WorkStealingThreadPool -- fixed set of worker threads with one task queue each
+// ===========================================================================
+
+// A task submitted from a worker goes to the front of that worker's own queue (it is likely to use what the
+// worker just computed); other tasks are distributed round-robin. Idle workers take tasks from the back of
+// other workers' queues. Each worker restricts its OpenMP parallel regions to its share of the OpenMP threads,
+// so that concurrent tasks do not oversubscribe the cores.
+class WorkStealingThreadPool
+{
+public:
+    typedef std::function<void()> Task;
+
+    WorkStealingThreadPool(size_t numThreads);
+    ~WorkStealingThreadPool();
+
+    size_t GetNumThreads() const { return m_workers.size(); }
+    void Submit(Task&& task);
+    bool IsWorkerThread() const { return CurrentWorkerIndex() != SIZE_MAX; }
+
+    // process-wide pool with the given number of threads (re-created if the number changes)
+    static std::shared_ptr<WorkStealingThreadPool> GetInstance(size_t numThreads);
+
+private:
+    struct Worker
+    {
+        std::mutex m_mutex;
+        std::deque<Task> m_tasks;
+        std::thread m_thread;
+    };
+
+    size_t CurrentWorkerIndex() const;
+    bool TryGetTask(size_t workerIndex, Task& task);
+    void WorkerLoop(size_t workerIndex);
+
+    std::vector<std::unique_ptr<Worker>> m_workers;
+    int m_numOpenMPThreadsPerWorker;
+    std::atomic<size_t> m_numQueuedTasks;
+    std::atomic<size_t> m_nextWorker; // for round-robin distribution of tasks submitted from outside
+    std::mutex m_sleepMutex;
+    std::condition_variable m_wakeUp;
+    bool m_stopping;
+};
+
+// ===========================================================================
+// ComputationScheduler -- dependency-aware concurrent execution of a PAR traversal
+// ===========================================================================
+
+// The units of a PAR traversal (its nested nodes, in evaluation order, a recurrent loop being one unit) are
+// executed as soon as all units they depend on are done, as tasks on a WorkStealingThreadPool. Besides the
+// data dependencies, a unit waits for
+//  - every earlier unit that touches a matrix it shares through the MatrixPool with one of its own matrices
+//    (the pool assigned the matrix assuming sequential execution), in evaluation order for ForwardProp()
+//    and in reverse for Backprop();
+//  - in Backprop(), every other unit that accumulates into the gradient of one of its inputs;
+//  - every unit since the previous node that is not thread-safe (see ComputationNodeBase::IsThreadSafe()),
+//    and such a node is in turn waited for by all units after it; these execute as in sequential order.
+// This gives the same results as sequential execution, as long as thread-safe nodes only write their own
+// matrices and their inputs' gradients.
+class ComputationScheduler
+{
+public:
+    typedef std::shared_ptr<ComputationNodeBase> ComputationNodeBasePtr;
+
+    // 'units' are the nested nodes of a PAR traversal in evaluation order, after matrix allocation
+    ComputationScheduler(const std::vector<ComputationNodeBasePtr>& units);
+
+    // false if the units are not all on the CPU, or if there is nothing to execute concurrently
+    bool IsConcurrentForwardProp() const { return m_forward.m_hasConcurrency; }
+    bool IsConcurrentBackprop() const { return m_backward.m_hasConcurrency; }
+
+    // execute all units by calling 'execute' with their index, concurrently on 'threadPool'
+    // The first exception thrown by 'execute' is rethrown here after all started units have finished.
+    void ForwardProp(WorkStealingThreadPool& threadPool, const std::function<void(size_t)>& execute) const;
+    void Backprop(WorkStealingThreadPool& threadPool, const std::function<void(size_t)>& execute) const;
+
+private:
+    struct Graph
+    {
+        std::vector<std::vector<size_t>> m_successors;
+        std::vector<size_t> m_numPredecessors;
+        bool m_hasConcurrency = false;
+    };
+    struct RunState;
+
+    static void FormGraph(Graph& graph, const std::vector<std::set<size_t>>& successors, const std::vector<bool>& isLeaf);
+    static void RunUnit(const std::shared_ptr<RunState>& state, size_t unit);
+    void Run(const Graph& graph, WorkStealingThreadPool& threadPool, const std::function<void(size_t)>& execute) const;
+    void PrepareLayouts() const;
+
+    Graph m_forward;
+    Graph m_backward;
+    std::vector<bool> m_isThreadSafe;   // [unit]
+    std::vector<MBLayoutPtr> m_layouts; // layouts of all nodes, whose validity masks are computed lazily
+};
+
+}}}
@@ -139,6 +139,9 @@ public:
         fstream << "PoolKind: " << (int)m_poolKind << "\n";
     }
 
+    bool IsTransposed() const { return m_transpose; }
+    ImageLayoutKind GetImageLayoutKind() const { return m_imageLayout; }
+
 protected:
     TensorShape m_kernelShape;
     TensorShape m_mapCount;
@@ -411,6 +414,12 @@ public:
             m_convEng->SetmMaxTempMemSizeInSamples(maxTempMemSizeInSamples);
     }
 
+    // each output element is an inner product with the kernel (for a transposed convolution this is an upper bound)
+    double GetForwardPropFlopsPerElement() const override
+    {
+        return 2.0 * m_kernelShape.GetNumElements();
+    }
+
 protected:
     // Flag that indicates whether the node is created using 2D-syntax.
     bool m_convolution2D;
@@ -469,6 +478,7 @@ public:
         m_convEng->BackwardPooling(sliceOutputValue, sliceOutputGrad, sliceInput0Value, sliceInput0Grad);
     }
 
+    virtual bool IsThreadSafe() const override { return true; }
     bool OutputUsedInComputingInputNodesGradients() const override
     {
         // The PoolingNode requires output values only for max pooling.
@@ -45,6 +45,7 @@ public:
         LogicError("%ls operation is used for evaluation only.", OperationName().c_str());
     }
 
+    virtual bool IsThreadSafe() const override { return true; }
     virtual bool OutputUsedInComputingInputNodesGradients() const override
     {
         return false;
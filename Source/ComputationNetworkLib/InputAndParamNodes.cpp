@@ -165,6 +165,9 @@ void LearnableParameter<ElemType>::InitFromArray(const std::vector<ElemType>& ar
 template <class ElemType>
 void LearnableParameter<ElemType>::Save(File& fstream) const /*override*/
 {
+    if (m_halfPrecisionValue)
+        LogicError("%ls: Cannot save a parameter that is stored in half precision.", NodeDescription().c_str());
+
     Base::Save(fstream);
     fstream << m_learningRateMultiplier;
     m_sampleLayout.Save(fstream);
@@ -286,6 +289,48 @@ template <class ElemType>
     PrintNodeValuesToFile(printValues, printMetadata, fstream);
 }
 
+template <class ElemType>
+void LearnableParameter<ElemType>::StoreValueInHalfPrecision()
+{
+    if (m_halfPrecisionValue)
+        return;
+    if (m_deviceId != CPUDEVICE || Value().GetMatrixType() != MatrixType::DENSE)
+        InvalidArgument("%ls: Only dense parameters on the CPU can be stored in half precision.", NodeDescription().c_str());
+
+    const auto& value = Value();
+    const size_t numElements = value.GetNumElements();
+    auto halfPrecisionValue = make_shared<CPUHalfMatrix>(value.Data(), value.GetNumRows(), value.GetNumCols());
+
+    // report the conversion error against the full-precision value
+    vector<ElemType> roundTrip(numElements);
+    halfPrecisionValue->CopyColumnsTo(0, halfPrecisionValue->GetNumCols(), roundTrip.data());
+    const ElemType* data = value.Data();
+    double maxAbsError = 0, sumSquaredError = 0, sumSquared = 0;
+    for (size_t i = 0; i < numElements; i++)
+    {
+        double error = fabs((double)roundTrip[i] - (double)data[i]);
+        maxAbsError = max(maxAbsError, error);
+        sumSquaredError += error * error;
+        sumSquared += (double)data[i] * data[i];
+    }
+    fprintf(stderr, "%ls: stored in half precision [%lu x %lu], max abs error %.3g, relative RMS error %.3g\n",
+            NodeDescription().c_str(), (unsigned long)value.GetNumRows(), (unsigned long)value.GetNumCols(),
+            maxAbsError, sumSquared > 0 ? sqrt(sumSquaredError / sumSquared) : 0.0);
+
+    m_halfPrecisionValue = halfPrecisionValue;
+    Value().Resize(0, 0, 0, /*growOnly=*/false); // release the full-precision memory
+}
+
+// the full-precision value is empty when stored in half precision, so it must not be verified against the node dimensions
+template <class ElemType>
+/*virtual*/ void LearnableParameter<ElemType>::BeginForwardProp() /*override*/
+{
+    if (m_halfPrecisionValue)
+        ComputationNodeBase::BeginForwardProp();
+    else
+        Base::BeginForwardProp();
+}
+
 template class LearnableParameter<float>;
 template class LearnableParameter<double>;
 
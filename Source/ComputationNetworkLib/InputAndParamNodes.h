@@ -6,6 +6,7 @@
 
 #include "Basics.h"
 #include "ComputationNode.h"
+#include "CPUHalfMatrix.h"
 #include "ScriptableObjects.h"
 #include "TensorShape.h"
 #include "Matrix.h"
@@ -97,6 +98,7 @@ public:
     virtual void /*ComputationNode::*/ ForwardProp(const FrameRange&) override;
     virtual void /*ComputationNode::*/ BackpropTo(const size_t /*inputIndex*/, const FrameRange&) override;
     virtual void /*ComputationNodeBase::*/ Validate(bool isFinalValidationPass) override;
+    virtual bool IsThreadSafe() const override { return true; }
 
     // called from ComputationNode::ValidateInferInputDimsFrom()
     // In case of an error, this function just backs out without updating.
@@ -106,6 +108,16 @@ public:
     void InferInputDimsFrom(const TensorShape& otherShape);
 
     virtual void DumpNodeInfo(const bool printValues, const bool printMetadata, File& fstream) const override;
+
+    // For inference on the CPU: keep the value in IEEE half precision and release the full-precision value.
+    // Only consumers that know about this (TimesNode) can use the parameter afterwards, it cannot be trained or saved anymore.
+    void StoreValueInHalfPrecision();
+    const CPUHalfMatrix* HalfPrecisionValue() const { return m_halfPrecisionValue.get(); }
+
+    virtual void /*IComputationNode::*/ BeginForwardProp() override;
+
+private:
+    shared_ptr<CPUHalfMatrix> m_halfPrecisionValue;
 };
 
 // -----------------------------------------------------------------------
@@ -290,6 +302,8 @@ public:
         LogicError("%ls is a leaf node. BackpropTo() should never be called.", NodeName().c_str());
     }
 
+    virtual bool IsThreadSafe() const override { return true; }
+
     virtual void DumpNodeInfo(const bool printValues, const bool printMetadata, File& fstream) const override
     {
         Base::DumpNodeInfo(printValues, printMetadata, fstream);
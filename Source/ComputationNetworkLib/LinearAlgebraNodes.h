@@ -6,6 +6,7 @@
 
 #include "Basics.h"
 #include "ComputationNode.h"
+#include "InputAndParamNodes.h"
 #include "Matrix.h"
 #include "TensorView.h"
 
@@ -290,6 +291,16 @@ public:
             return;
         }
 
+        // A stored in half precision: the product is computed on matrices, converting A on the fly
+        if (HalfPrecisionInput0())
+        {
+            size_t rows, cols;
+            GetInput0MatrixDims(rows, cols);
+            auto output = ValueFor(fr);
+            Matrix<ElemType>::MultiplyAndWeightedAdd(1, HalfPrecisionInput0()->Reshaped(rows, cols), m_transpose, Input(1)->ValueFor(fr), false, 0, output);
+            return;
+        }
+
         // TensorView::DoMatrixProductOf() will reduce each tensor object into a 2D tensor (or fail if it cannot)
         // and recreate actual Matrix objects (in case of sparse, they must be identical to the original tensor storage object).
         // Transposition is applied after flattening into 2D, but only allowed if the input sample is 2D anyway.
@@ -312,6 +323,9 @@ public:
             return;
         }
 
+        if (HalfPrecisionInput0())
+            LogicError("%ls %ls operation: Parameters stored in half precision can only be used for inference.", NodeName().c_str(), OperationName().c_str());
+
         // this potentially computes inner products over time, so we must mask gaps to 0
         if (Input(inputIndex)->ReducesInTimeWrt(shared_from_this()))
             MaskMissingGradientColumnsToZero(fr);
@@ -339,9 +353,49 @@ public:
         }
     }
 
+    virtual bool IsThreadSafe() const override { return true; }
     virtual bool OutputUsedInComputingInputNodesGradients() const override { return false; }
     // but both *inputs* are used, so we don't overload the InputUsed-() function which defaults to 'true'
 
+    // Input(0) stored in half precision (see LearnableParameter::StoreValueInHalfPrecision()), or null
+    const CPUHalfMatrix* HalfPrecisionInput0() const
+    {
+        auto parameter = dynamic_cast<LearnableParameter<ElemType>*>(Input(0).get());
+        return parameter ? parameter->HalfPrecisionValue() : nullptr;
+    }
+
+    // whether Input(0) could be stored in half precision: it is used as a plain matrix against minibatch data
+    bool CanUseHalfPrecisionInput0() const
+    {
+        if (Input(0)->HasMBLayout() || !Input(1)->HasMBLayout())
+            return false;
+        size_t rows, cols;
+        GetInput0MatrixDims(rows, cols);
+        return (m_transpose ? rows : cols) == Input(1)->GetSampleLayout().GetNumElements();
+    }
+
+    // each output element is an inner product over the reduction dimension
+    virtual double GetForwardPropFlopsPerElement() const override
+    {
+        size_t rows, cols;
+        GetInput0MatrixDims(rows, cols);
+        return 2.0 * (m_transpose ? rows : cols);
+    }
+
+private:
+    // dimensions of Input(0) as a matrix: [outputRank dims x reduction dims], or [dim 0 x dim 1] if transposing
+    void GetInput0MatrixDims(size_t& rows, size_t& cols) const
+    {
+        const auto& shape = Input(0)->GetSampleLayout();
+        rows = 1;
+        size_t numRowDims = m_transpose ? 1 : m_outputRank;
+        for (size_t k = 0; k < numRowDims && k < shape.GetRank(); k++)
+            rows *= shape[k];
+        cols = rows > 0 ? shape.GetNumElements() / rows : 0;
+    }
+
+public:
+
     virtual void /*ComputationNodeBase::*/ Validate(bool isFinalValidationPass) override
     {
         Base::Validate(isFinalValidationPass);
@@ -563,6 +617,7 @@ public:
         }
     }
 
+    virtual bool IsThreadSafe() const override { return true; }
     virtual bool OutputUsedInComputingInputNodesGradients() const override
     {
         // The DiagTimesNode does not require its output value for computing
@@ -894,6 +949,8 @@ public:
         SetDims(TensorShape(1), Input(1)->HasMBLayout());
     }
 
+    virtual bool IsThreadSafe() const override { return true; }
+
     virtual void CopyTo(ComputationNodeBasePtr nodeP, const std::wstring& newName, const CopyNodeFlags flags) const override
     {
         Base::CopyTo(nodeP, newName, flags);
@@ -9,6 +9,7 @@
 #include <stdexcept>
 #include <vector>
 #include <algorithm>
+#include <functional>
 #include <stdlib.h>
 
 #include "Basics.h"
@@ -17,53 +18,73 @@
 
 namespace Microsoft { namespace MSR { namespace CNTK {
 
+class ComputationNodeBase;
+
 // MatrixPool -- class to support memory sharing
 // Despite the gather general name of this class, it is specifically designed to support the memory sharing of ComputationNodes.
 // Note: see #define SUPRESS_MEMSHARING below as for how to temporarily disable memory sharing altogether, for debugging
 class MatrixPool
 {
-    vector<shared_ptr<Matrix<float>>>  m_releasedFloatMatrices;
-    vector<shared_ptr<Matrix<double>>> m_releasedDoubleMatrices;
+public:
+    // optional restriction on handing a matrix released by one node to another node
+    // E.g. nodes that may be executed concurrently must not share a matrix.
+    typedef std::function<bool(const ComputationNodeBase* releasedBy, const ComputationNodeBase* requestedBy)> ReuseFilter;
+
+private:
+    // released matrices, each with the node that released it
+    vector<pair<shared_ptr<Matrix<float>>,  const ComputationNodeBase*>> m_releasedFloatMatrices;
+    vector<pair<shared_ptr<Matrix<double>>, const ComputationNodeBase*>> m_releasedDoubleMatrices;
+
+    ReuseFilter m_reuseFilter;
 
     template <class ElemType>
-    vector<shared_ptr<Matrix<ElemType>>>& GetReleasedMatrices();
+    vector<pair<shared_ptr<Matrix<ElemType>>, const ComputationNodeBase*>>& GetReleasedMatrices();
 
 public:
+    void SetReuseFilter(const ReuseFilter& reuseFilter) { m_reuseFilter = reuseFilter; }
+
     // release here means the matrix can be put back and shared by others
     template <class ElemType>
-    void Release(shared_ptr<Matrix<ElemType>> freeMatrix)
+    void Release(shared_ptr<Matrix<ElemType>> freeMatrix, const ComputationNodeBase* releasedBy = nullptr)
     {
         if (freeMatrix == nullptr || freeMatrix->GetMatrixType() == SPARSE)
             LogicError("MatrixPool::Release: freeMatrix should not be null or sparse.");
 //#define SUPRESS_MEMSHARING // #define this to disable memory sharing through this structure
         // TODO: Make this a runtime option.
 #ifndef SUPRESS_MEMSHARING
-        vector<shared_ptr<Matrix<ElemType>>>& releasedMatrices = GetReleasedMatrices<ElemType>();
+        auto& releasedMatrices = GetReleasedMatrices<ElemType>();
 #ifdef _DEBUG
         for (int i = 0; i < releasedMatrices.size(); i++)
         {
-            if (releasedMatrices[i] == freeMatrix)
+            if (releasedMatrices[i].first == freeMatrix)
                 RuntimeError("MatrixPool::Release: freeMatrix is already in the released pool.");
         }
 
 #endif
-        releasedMatrices.push_back(freeMatrix);
+        releasedMatrices.push_back(make_pair(freeMatrix, releasedBy));
 #endif
     }
 
     template <class ElemType>
-    shared_ptr<Matrix<ElemType>> Request(DEVICEID_TYPE deviceId)
+    shared_ptr<Matrix<ElemType>> Request(DEVICEID_TYPE deviceId, const ComputationNodeBase* requestedBy = nullptr)
     {
-        vector<shared_ptr<Matrix<ElemType>>>& releasedMatrices = GetReleasedMatrices<ElemType>();
+        auto& releasedMatrices = GetReleasedMatrices<ElemType>();
+        // reuse the most recently released matrix that the filter admits
+        auto iter = releasedMatrices.rbegin();
+        if (m_reuseFilter)
+        {
+            while (iter != releasedMatrices.rend() && !m_reuseFilter(iter->second, requestedBy))
+                iter++;
+        }
         shared_ptr<Matrix<ElemType>> matrixPtr;
-        if (releasedMatrices.empty())
+        if (iter == releasedMatrices.rend())
         {
             matrixPtr = make_shared<Matrix<ElemType>>(deviceId);
         }
         else
         {
-            matrixPtr = releasedMatrices.back();
-            releasedMatrices.pop_back();
+            matrixPtr = iter->first;
+            releasedMatrices.erase(std::next(iter).base());
         }
 
         if (!matrixPtr) // this can't really happen
@@ -89,6 +89,7 @@ public:
         ValidateUnaryMap(isFinalValidationPass);
     }
 
+    virtual bool IsThreadSafe() const override { return true; }
     virtual bool OutputUsedInComputingInputNodesGradients() const override
     {
         return opType == binaryWithOutputGradient;
@@ -213,6 +214,8 @@ public:
         ValidateUnaryMap(isFinalValidationPass);
     }
 
+    virtual bool IsThreadSafe() const override { return true; }
+
     virtual void CopyTo(ComputationNodeBasePtr nodeP, const std::wstring& newName, const CopyNodeFlags flags) const override
     {
         Base::CopyTo(nodeP, newName, flags);
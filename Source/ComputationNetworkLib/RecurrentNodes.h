@@ -242,6 +242,7 @@ public:
         }
     }
 
+    virtual bool IsThreadSafe() const override { return true; }
     virtual bool OutputUsedInComputingInputNodesGradients() const override { return false; }
     virtual bool InputUsedInComputingInputNodesGradients(size_t /*childIndex*/) const override { return false; }
 
@@ -405,7 +406,7 @@ public:
             {
                 auto pState = make_shared<DelayedValueNodeState<ElemType>>(m_deviceId);
                 pState->CacheDelayedMBLayout(m_delayedActivationMBLayout);
-                // return an empty one
+                pExportedState = pState; // return an empty one
             }
             else
             {
@@ -445,6 +446,8 @@ public:
         if (!pState)
             LogicError("Expecting DelayValueNodeState after downcasting");
 
+        if (!m_delayedActivationMBLayout)
+            m_delayedActivationMBLayout = make_shared<MBLayout>();
         pState->ExportDelayedMBLayout(m_delayedActivationMBLayout); // pstate copy to m_delayedActivationMBLayout
         if (pState->IsEmpty())
         {
@@ -454,6 +457,8 @@ public:
         const Matrix<ElemType>& delayedActivation = pState->ExportCachedActivity();
         size_t nT = m_delayedActivationMBLayout->GetNumTimeSteps();
         size_t nU = m_delayedActivationMBLayout->GetNumParallelSequences();
+        // m_delayedValue may have been left behind by a minibatch of a different length (e.g. of another evaluation session)
+        m_delayedValue.Resize(delayedActivation.GetNumRows(), nT * nU);
 
         int dir = direction;
         if (dir == -1) // looking backward
@@ -464,6 +469,50 @@ public:
             LogicError("Unrecognized direction in DelayedValueNodeBase");
     }
 
+    virtual NodeStatePtr /*IStatefulNode::*/ ExportSequenceState(size_t s) override
+    {
+        if (m_timeStep != 1)
+            RuntimeError("Currently importing/exporting state info for timeStep>1 is not supported.");
+
+        // the frame next to the boundary that the sequence in parallel sequence s crosses: its last one if we look into the past
+        auto pState = make_shared<DelayedValueNodeState<ElemType>>(m_deviceId);
+        if (!m_delayedActivationMBLayout)
+            return pState;
+        size_t nT = m_delayedActivationMBLayout->GetNumTimeSteps();
+        int dir = direction;
+        for (const auto& seq : m_delayedActivationMBLayout->GetAllSequences())
+        {
+            if (seq.s != s || seq.seqId == GAP_SEQUENCE_ID)
+                continue;
+            size_t t = dir < 0 ? min(seq.tEnd, nT) - 1 : (size_t) max(seq.tBegin, (ptrdiff_t) 0);
+            pState->CacheState(DataWithMBLayoutFor(m_delayedValue, FrameRange(m_delayedActivationMBLayout, t).Sequence(s), m_delayedActivationMBLayout));
+        }
+        return pState;
+    }
+
+    virtual void /*IStatefulNode::*/ ImportSequenceStates(const std::vector<NodeStatePtr>& states) override
+    {
+        // The states form a previous minibatch of a single time step, with the same parallel sequences as the next one.
+        size_t nU = states.size();
+        m_delayedValue.Resize(GetSampleMatrixNumRows(), nU);
+        m_delayedValue.SetValue(m_initialActivationValue);
+        m_delayedActivationMBLayout = make_shared<MBLayout>();
+        m_delayedActivationMBLayout->Init(nU, 1);
+        for (size_t s = 0; s < nU; s++)
+        {
+            DelayedNodeStatePtr pState = dynamic_pointer_cast<DelayedValueNodeState<ElemType>>(states[s]);
+            if (states[s] && !pState)
+                LogicError("Expecting DelayValueNodeState after downcasting");
+            if (!pState || pState->IsEmpty())
+            {
+                m_delayedActivationMBLayout->AddGap(s, 0, 1);
+                continue;
+            }
+            m_delayedValue.SetColumnSlice(pState->ExportCachedActivity(), s, 1);
+            m_delayedActivationMBLayout->AddSequence(NEW_SEQUENCE_ID, s, 0, 1);
+        }
+    }
+
 protected:
     ElemType m_initialActivationValue;       // starting value for hidden activation vector at boundary
     Matrix<ElemType> m_delayedValue;         // saves the activation of the previous step that this node points to
@@ -213,6 +213,7 @@ public:
     virtual void /*ComputationNodeBase::*/ Save(File& fstream) const override;
     virtual void /*ComputationNode::*/ ForwardProp(const FrameRange& fr) override;
     virtual void /*ComputationNode::*/ BackpropTo(const size_t inputIndex, const FrameRange& fr) override;
+    virtual bool IsThreadSafe() const override { return true; }
     virtual bool /*ComputationNodeBase::*/ OutputUsedInComputingInputNodesGradients() const override;
     virtual bool /*ComputationNodeBase::*/ InputUsedInComputingInputNodesGradients(size_t childIndex) const override;
     virtual void /*ComputationNodeBase::*/ Validate(bool isFinalValidationPass) override;
@@ -369,6 +370,7 @@ public:
         inputGrad.AddCopyOf(outputGrad);
     }
 
+    virtual bool IsThreadSafe() const override { return true; }
     virtual bool OutputUsedInComputingInputNodesGradients() const override { return false; }
     virtual bool InputUsedInComputingInputNodesGradients(size_t /*childIndex*/) const override { return false; }
 
@@ -482,6 +484,7 @@ public:
         inputGrad.AddCopyOf(outputGrad);
     }
 
+    virtual bool IsThreadSafe() const override { return true; }
     virtual bool OutputUsedInComputingInputNodesGradients() const override { return false; }
     virtual bool InputUsedInComputingInputNodesGradients(size_t /*childIndex*/) const override { return false; }
 
@@ -6,11 +6,14 @@
 #include "Basics.h"
 #include "ComputationNode.h"
 #include "SpecialPurposeNodes.h"
+#include "LinearAlgebraNodes.h"
+#include "NonlinearityNodes.h"
 
 #include <string>
 #include <vector>
 #include <stdexcept>
 #include <memory>
+#include <algorithm>
 
 namespace Microsoft { namespace MSR { namespace CNTK {
 
@@ -133,4 +136,313 @@ template <class ElemType>
 template class TraceNode<float>;
 template class TraceNode<double>;
 
+// -----------------------------------------------------------------------
+// FusedElementwiseNode (input1, input2, ...)
+// -----------------------------------------------------------------------
+
+// number of elements of the blocks of columns that are processed at once on the CPU
+// The temporaries of all steps of one block should fit into the L2 cache.
+static const size_t s_fusedElementwiseBlockElements = 16384;
+
+template <class ElemType>
+/*static*/ bool FusedElementwiseNode<ElemType>::GetFusableOperation(const std::wstring& operationName, ElementWiseOperator& op)
+{
+    if      (operationName == OperationNameOf(PlusNode))            op = opSum;
+    else if (operationName == OperationNameOf(MinusNode))           op = opDifference;
+    else if (operationName == OperationNameOf(ElementTimesNode))    op = opElementwiseProduct; // includes Scale()
+    else if (operationName == OperationNameOf(SigmoidNode))         op = opSigmoid;
+    else if (operationName == OperationNameOf(TanhNode))            op = opTanh;
+    else if (operationName == OperationNameOf(RectifiedLinearNode)) op = opLinearRectifier;
+    else
+        return false;
+    return true;
+}
+
+template <class ElemType>
+/*virtual*/ void FusedElementwiseNode<ElemType>::CopyTo(ComputationNodeBasePtr nodeP, const std::wstring& newName, const CopyNodeFlags flags) const /*override*/
+{
+    Base::CopyTo(nodeP, newName, flags);
+    if (flags & CopyNodeFlags::copyNodeValue)
+    {
+        auto node = dynamic_pointer_cast<FusedElementwiseNode<ElemType>>(nodeP);
+        node->m_steps = m_steps;
+        node->m_fusedNodes = m_fusedNodes;
+    }
+}
+
+template <class ElemType>
+/*virtual*/ void FusedElementwiseNode<ElemType>::BeginForwardProp() /*override*/
+{
+    Base::BeginForwardProp();
+    // as in BinaryElementWiseNode: ColumnSlice doesn't support all the sparse formats
+    Value().SwitchToMatrixType(MatrixType::DENSE, MatrixFormat::matrixFormatDense, false);
+}
+
+template <class ElemType>
+TensorView<ElemType> FusedElementwiseNode<ElemType>::BlockTensorFor(const ComputationNodeBase& node, const MatrixBasePtr& data, size_t rank, size_t firstColumn, size_t numColumns) const
+{
+    TensorShape shape = node.GetSampleLayout().PadRank(rank);
+    if (node.HasMBLayout()) // otherwise the tensor is broadcast along the columns
+    {
+        shape.AppendInPlace(rank, node.GetMBLayout()->GetNumCols());
+        shape.NarrowTo(rank, firstColumn, firstColumn + numColumns);
+    }
+    return TensorView<ElemType>(data, shape);
+}
+
+template <class ElemType>
+TensorView<ElemType> FusedElementwiseNode<ElemType>::StepTensorFor(const shared_ptr<Matrix<ElemType>>& data, size_t rank, size_t numColumns) const
+{
+    TensorShape shape = GetSampleLayout().PadRank(rank);
+    shape.AppendInPlace(rank, data->GetNumCols());
+    shape.NarrowTo(rank, 0, numColumns);
+    return TensorView<ElemType>(data, shape);
+}
+
+template <class ElemType>
+TensorView<ElemType> FusedElementwiseNode<ElemType>::OperandValueTensorFor(size_t operand, size_t rank, size_t firstColumn, size_t numColumns) const
+{
+    if (operand < GetNumInputs())
+        return BlockTensorFor(*Input(operand), Input(operand)->ValuePtr(), rank, firstColumn, numColumns);
+    else
+        return StepTensorFor(m_stepValues[operand - GetNumInputs()], rank, numColumns);
+}
+
+// allocates the temporaries for blocks of the given number of columns, and returns the number of columns per block
+template <class ElemType>
+size_t FusedElementwiseNode<ElemType>::PrepareBlocks(size_t numColumns, bool withGradients)
+{
+    const size_t sampleSize = GetSampleLayout().GetNumElements();
+    size_t blockColumns = numColumns;
+    if (Value().GetDeviceId() == CPUDEVICE)
+        blockColumns = min(numColumns, max((size_t) 1, s_fusedElementwiseBlockElements / max(sampleSize, (size_t) 1)));
+
+    auto prepareTemp = [&](shared_ptr<Matrix<ElemType>>& temp)
+    {
+        if (!temp)
+            temp = make_shared<Matrix<ElemType>>(Value().GetDeviceId());
+        temp->Resize(sampleSize, max(blockColumns, (size_t) 1));
+    };
+    m_stepValues.resize(m_steps.size());
+    m_stepGradients.resize(m_steps.size());
+    for (size_t k = 0; k < m_steps.size(); k++)
+    {
+        prepareTemp(m_stepValues[k]);
+        if (withGradients)
+            prepareTemp(m_stepGradients[k]);
+    }
+    return blockColumns;
+}
+
+// computes all steps for a block of columns; the last one goes into the node's value unless 'outputToTemp'
+template <class ElemType>
+void FusedElementwiseNode<ElemType>::ForwardBlock(size_t rank, size_t firstColumn, size_t numColumns, bool outputToTemp)
+{
+    for (size_t k = 0; k < m_steps.size(); k++)
+    {
+        const auto& step = m_steps[k];
+        auto result = (k + 1 == m_steps.size() && !outputToTemp) ? BlockTensorFor(*this, ValuePtr(), rank, firstColumn, numColumns)
+                                                                 : StepTensorFor(m_stepValues[k], rank, numColumns);
+        auto input0 = OperandValueTensorFor(step.m_operands[0], rank, firstColumn, numColumns);
+        if (IsUnary(step.m_op))
+            result.DoUnaryOpOf(0, input0, 1, step.m_op, opSum);
+        else
+            result.DoBinaryOpOf(0, input0, OperandValueTensorFor(step.m_operands[1], rank, firstColumn, numColumns), 1, step.m_op, opSum);
+    }
+}
+
+template <class ElemType>
+/*virtual*/ void FusedElementwiseNode<ElemType>::ForwardProp(const FrameRange& fr) /*override*/
+{
+    size_t rank = DetermineElementwiseTensorRank();
+    auto columnRange = ColumnRangeWithMBLayoutFor(Value().GetNumCols(), fr, GetMBLayout());
+    const size_t numColumns = HasMBLayout() ? columnRange.second : 1; // without layout the whole tensor is one sample
+    const size_t blockColumns = PrepareBlocks(numColumns, /*withGradients=*/false);
+    for (size_t c = 0; c < numColumns; c += blockColumns)
+        ForwardBlock(rank, columnRange.first + c, min(blockColumns, numColumns - c), /*outputToTemp=*/false);
+}
+
+template <class ElemType>
+/*virtual*/ void FusedElementwiseNode<ElemType>::BackpropTo(const size_t inputIndex, const FrameRange& fr) /*override*/
+{
+    // The gradients of all inputs are computed in one pass, when Backprop() asks for the first input that needs one.
+    // The others are zeroed here first, since Backprop() would only do that right before asking for them.
+    for (size_t i = 0; i < inputIndex; i++)
+        if (Input(i)->NeedsGradient())
+            return;
+
+    const size_t numInputs = GetNumInputs();
+    bool reducesInTime = false;
+    for (size_t i = 0; i < numInputs; i++)
+    {
+        if (Input(i)->NeedsGradient())
+        {
+            Input(i)->LazyZeroGradient();
+            reducesInTime |= Input(i)->ReducesInTimeWrt(shared_from_this());
+        }
+    }
+
+    // if an input's gradient is reduced over the columns then the gaps must not contribute (cf. ElementTimesNode)
+    if (reducesInTime)
+    {
+        MaskMissingGradientColumnsToZero(fr);
+        for (size_t i = 0; i < numInputs; i++)
+            if (Input(i)->HasMBLayout())
+                Input(i)->MaskMissingValueColumnsToZero(fr);
+    }
+
+    // a step's gradient is only needed if an input below it needs one
+    vector<bool> stepNeedsGradient(m_steps.size(), false);
+    for (size_t k = 0; k < m_steps.size(); k++)
+    {
+        const auto& step = m_steps[k];
+        for (size_t j = 0; j < (IsUnary(step.m_op) ? 1 : 2); j++)
+        {
+            size_t operand = step.m_operands[j];
+            if (operand < numInputs ? Input(operand)->NeedsGradient() : stepNeedsGradient[operand - numInputs])
+                stepNeedsGradient[k] = true;
+        }
+    }
+
+    size_t rank = DetermineElementwiseTensorRank();
+    auto columnRange = ColumnRangeWithMBLayoutFor(Value().GetNumCols(), fr, GetMBLayout());
+    const size_t numColumns = HasMBLayout() ? columnRange.second : 1;
+    const size_t blockColumns = PrepareBlocks(numColumns, /*withGradients=*/true);
+    for (size_t c = 0; c < numColumns; c += blockColumns)
+    {
+        const size_t firstColumn = columnRange.first + c;
+        const size_t blockSize = min(blockColumns, numColumns - c);
+
+        // recompute the intermediate results of this block, then propagate the gradient through the steps in reverse order
+        ForwardBlock(rank, firstColumn, blockSize, /*outputToTemp=*/true);
+        vector<bool> stepGradientInitialized(m_steps.size(), false);
+        for (size_t k = m_steps.size(); k-- > 0;)
+        {
+            if (!stepNeedsGradient[k])
+                continue;
+            const auto& step = m_steps[k];
+            auto gradient = (k + 1 == m_steps.size()) ? BlockTensorFor(*this, GradientPtr(), rank, firstColumn, blockSize)
+                                                      : StepTensorFor(m_stepGradients[k], rank, blockSize);
+            for (size_t j = 0; j < (IsUnary(step.m_op) ? 1 : 2); j++)
+            {
+                const size_t operand = step.m_operands[j];
+                ElemType beta = 1; // input gradients are accumulated; the first contribution to a step's gradient overwrites it
+                if (operand < numInputs)
+                {
+                    if (!Input(operand)->NeedsGradient())
+                        continue;
+                }
+                else
+                {
+                    if (!stepNeedsGradient[operand - numInputs])
+                        continue;
+                    if (!stepGradientInitialized[operand - numInputs])
+                        beta = 0;
+                    stepGradientInitialized[operand - numInputs] = true;
+                }
+                auto inputGradient = (operand < numInputs) ? BlockTensorFor(*Input(operand), Input(operand)->GradientPtr(), rank, firstColumn, blockSize)
+                                                           : StepTensorFor(m_stepGradients[operand - numInputs], rank, blockSize);
+                switch (step.m_op)
+                {
+                case opSum:
+                    inputGradient.DoUnaryOpOf(beta, gradient, 1, opCopy, opSum);
+                    break;
+                case opDifference:
+                    inputGradient.DoUnaryOpOf(beta, gradient, j == 0 ? 1 : -1, opCopy, opSum);
+                    break;
+                case opElementwiseProduct:
+                    inputGradient.DoBinaryOpOf(beta, gradient, OperandValueTensorFor(step.m_operands[1 - j], rank, firstColumn, blockSize), 1, opElementwiseProduct, opSum);
+                    break;
+                case opSigmoid:
+                    inputGradient.DoBinaryOpOf(beta, gradient, StepTensorFor(m_stepValues[k], rank, blockSize), 1, opElementwiseProductWithSigmoidDerivativeFromOutput, opSum);
+                    break;
+                case opTanh:
+                    inputGradient.DoBinaryOpOf(beta, gradient, StepTensorFor(m_stepValues[k], rank, blockSize), 1, opElementwiseProductWithTanhDerivativeFromOutput, opSum);
+                    break;
+                case opLinearRectifier:
+                    inputGradient.DoBinaryOpOf(beta, gradient, StepTensorFor(m_stepValues[k], rank, blockSize), 1, opElementwiseProductWithLinearRectifierDerivativeFromOutput, opSum);
+                    break;
+                default:
+                    LogicError("%ls: Unsupported operation %d.", NodeDescription().c_str(), (int) step.m_op);
+                }
+            }
+        }
+    }
+}
+
+template <class ElemType>
+/*virtual*/ void FusedElementwiseNode<ElemType>::Validate(bool isFinalValidationPass) /*override*/
+{
+    Base::Validate(isFinalValidationPass);
+    InferMBLayoutFromInputsForStandardCase(isFinalValidationPass);
+
+    const size_t numInputs = GetNumInputs();
+    if (m_steps.empty())
+        InvalidArgument("%ls: The expression has no operations.", NodeDescription().c_str());
+
+    if (isFinalValidationPass)
+    {
+        for (size_t i = 0; i < numInputs; i++)
+            if (Input(i)->HasMBLayout() && Input(i)->GetMBLayout() != GetMBLayout())
+                LogicError("%ls: Minibatch layouts are not the same between arguments and might get out of sync during runtime. If this is by design, use ReconcileDynamicAxis() to forward layouts between nodes.", NodeDescription().c_str());
+    }
+
+    // the result of each step has the dimensions of its operands, broadcasting as in ValidateBinaryZip()
+    vector<TensorShape> stepShapes;
+    vector<bool> stepUsed(m_steps.size(), false);
+    for (size_t k = 0; k < m_steps.size(); k++)
+    {
+        const auto& step = m_steps[k];
+        if (!IsUnary(step.m_op) && step.m_op != opSum && step.m_op != opDifference && step.m_op != opElementwiseProduct)
+            InvalidArgument("%ls: Unsupported operation %d.", NodeDescription().c_str(), (int) step.m_op);
+
+        SmallVector<size_t> dims;
+        for (size_t j = 0; j < (IsUnary(step.m_op) ? 1 : 2); j++)
+        {
+            const size_t operand = step.m_operands[j];
+            if (operand >= numInputs + k)
+                InvalidArgument("%ls: Operation %d refers to an undefined operand.", NodeDescription().c_str(), (int) k);
+            if (operand >= numInputs)
+                stepUsed[operand - numInputs] = true;
+
+            const TensorShape& shape = operand < numInputs ? Input(operand)->GetSampleLayout() : stepShapes[operand - numInputs];
+            if (j == 0)
+            {
+                dims = shape.GetDims();
+                continue;
+            }
+            if (shape.GetRank() > dims.size())
+                dims.resize(shape.GetRank(), 1);
+            for (size_t d = 0; d < shape.GetRank(); d++)
+            {
+                if (dims[d] <= 1 && shape[d] != 0)
+                    dims[d] = shape[d];
+                else if (shape[d] <= 1 && dims[d] != 0)
+                    ;
+                else if (isFinalValidationPass && shape[d] != dims[d])
+                    InvalidArgument("%ls: Input dimensions of operation %d are not compatible.", NodeDescription().c_str(), (int) k);
+            }
+        }
+        stepShapes.push_back(TensorShape(dims));
+    }
+
+    // the intermediate results are stored in blocks shaped like the output, and each of them must be used
+    if (isFinalValidationPass)
+    {
+        for (size_t k = 0; k + 1 < m_steps.size(); k++)
+        {
+            if (!stepUsed[k])
+                InvalidArgument("%ls: The result of operation %d is not used.", NodeDescription().c_str(), (int) k);
+            if (stepShapes[k] != stepShapes.back())
+                InvalidArgument("%ls: Intermediate result [%s] of operation %d does not have the output dimensions [%s].",
+                                NodeDescription().c_str(), string(stepShapes[k]).c_str(), (int) k, string(stepShapes.back()).c_str());
+        }
+    }
+
+    SetDims(stepShapes.back(), HasMBLayout());
+}
+
+template class FusedElementwiseNode<float>;
+template class FusedElementwiseNode<double>;
+
 }}}
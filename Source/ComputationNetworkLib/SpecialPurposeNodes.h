@@ -762,4 +762,76 @@ public:
 template class DummyCriterionNode<float>;
 template class DummyCriterionNode<double>;
 
+// -----------------------------------------------------------------------
+// FusedElementwiseNode (input1, input2, ...) -- a chain of element-wise operations evaluated in one pass
+//
+// This node is not created by users but by ComputationNetwork::FuseElementwiseNodes(), which replaces
+// trees of Plus, Minus, ElementTimes, Sigmoid, Tanh, and RectifiedLinear nodes with a single node.
+// The expression is a program of steps, each applying one operation to inputs or to results of earlier steps;
+// the last step is the node's value. The columns are processed in blocks small enough that the intermediate
+// results stay in the cache; they are never stored for the whole minibatch. The backward pass recomputes
+// the intermediate results of each block and then computes the gradients of all inputs in the same pass.
+// The node exists at runtime only. It keeps the nodes it replaces, and the network saves those instead.
+// -----------------------------------------------------------------------
+
+template <class ElemType>
+class FusedElementwiseNode : public ComputationNode<ElemType>, public IFusedNode // note: not deriving from NumInputs<> because this one takes a variable number of inputs
+{
+    typedef ComputationNode<ElemType> Base; UsingComputationNodeMembersBoilerplate;
+    static const std::wstring TypeName() { return L"FusedElementwise"; }
+
+public:
+    // one operation of the expression
+    // An operand index below GetNumInputs() refers to that input, an index k + GetNumInputs() to the result of step k.
+    struct Step
+    {
+        ElementWiseOperator m_op;  // opSum, opDifference, opElementwiseProduct (binary) or opSigmoid, opTanh, opLinearRectifier (unary)
+        size_t m_operands[2];      // second operand is SIZE_MAX for unary operations
+    };
+
+    FusedElementwiseNode(DEVICEID_TYPE deviceId, const wstring& name, const std::vector<Step>& steps = std::vector<Step>(),
+                         const std::vector<ComputationNodeBasePtr>& fusedNodes = std::vector<ComputationNodeBasePtr>())
+        : Base(deviceId, name), m_steps(steps), m_fusedNodes(fusedNodes)
+    {
+    }
+
+    // the operation of a node that can be fused, e.g. opSum for Plus; returns false for all other nodes
+    static bool GetFusableOperation(const std::wstring& operationName, ElementWiseOperator& op);
+
+    // the original nodes, one per step, with their inputs
+    virtual const std::vector<ComputationNodeBasePtr>& /*IFusedNode::*/ GetFusedNodes() const override { return m_fusedNodes; }
+
+    virtual void CopyTo(ComputationNodeBasePtr nodeP, const std::wstring& newName, const CopyNodeFlags flags) const override;
+    virtual void /*IComputationNode::*/ BeginForwardProp() override;
+    virtual void /*ComputationNode::*/ ForwardProp(const FrameRange& fr) override;
+    virtual void /*ComputationNode::*/ BackpropTo(const size_t inputIndex, const FrameRange& fr) override;
+    virtual void /*ComputationNodeBase::*/ Validate(bool isFinalValidationPass) override;
+
+    virtual bool IsThreadSafe() const override { return true; }
+    // the intermediate results are recomputed from the inputs in BackpropTo()
+    virtual bool OutputUsedInComputingInputNodesGradients() const override { return false; }
+    virtual bool InputUsedInComputingInputNodesGradients(size_t /*childIndex*/) const override { return true; }
+
+    virtual double GetForwardPropFlopsPerElement() const override { return (double) m_steps.size(); }
+
+private:
+    static bool IsUnary(ElementWiseOperator op) { return op == opSigmoid || op == opTanh || op == opLinearRectifier; }
+
+    // tensor view of a block of columns of an input's value or gradient, or of the node's own
+    TensorView<ElemType> BlockTensorFor(const ComputationNodeBase& node, const MatrixBasePtr& data, size_t rank, size_t firstColumn, size_t numColumns) const;
+    // tensor view of the first 'numColumns' columns of the temporary matrix of a step
+    TensorView<ElemType> StepTensorFor(const shared_ptr<Matrix<ElemType>>& data, size_t rank, size_t numColumns) const;
+    // value of an operand (input or step) for a block of columns
+    TensorView<ElemType> OperandValueTensorFor(size_t operand, size_t rank, size_t firstColumn, size_t numColumns) const;
+    size_t PrepareBlocks(size_t numColumns, bool withGradients);
+    void ForwardBlock(size_t rank, size_t firstColumn, size_t numColumns, bool outputToTemp);
+
+    std::vector<Step> m_steps;
+    std::vector<ComputationNodeBasePtr> m_fusedNodes; // saved in place of this node
+
+    // temporaries for one block of columns (not persisted)
+    std::vector<shared_ptr<Matrix<ElemType>>> m_stepValues;
+    std::vector<shared_ptr<Matrix<ElemType>>> m_stepGradients;
+};
+
 } } }
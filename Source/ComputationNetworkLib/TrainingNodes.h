@@ -61,6 +61,7 @@ public:
         Matrix<ElemType>::Multiply1x1AndWeightedAdd(inputIndex == 0 ? 2.0f : -2.0f, Gradient() /*1x1*/, *m_leftMinusRight, 1.0f, gradient); // O = (I0-I1)^2; dO/dI0 = 2*(I0-I1); dO/dI1 = -2*(I0-I1)
     }
 
+    virtual bool IsThreadSafe() const override { return true; }
     virtual bool OutputUsedInComputingInputNodesGradients() const override { return false; }
     virtual bool InputUsedInComputingInputNodesGradients(size_t /*childIndex*/) const override { return false; }
 
@@ -128,6 +129,12 @@ public:
         // left input is scalar
         if (inputIndex == 0) // left derivative
         {
+            // the fused kernel does not keep the log softmax around
+            if (UseFusedKernel())
+            {
+                m_logSoftmaxOfRight->AssignLogSoftmaxOf(Input(1)->ValueFor(fr), true);
+                MaskMissingColumnsToZero(*m_logSoftmaxOfRight, Input(1)->GetMBLayout(), fr);
+            }
 #if DUMPOUTPUT
             m_logSoftmaxOfRight->Print("CrossEntropyWithSoftmax Partial-logSoftmaxOfRight");
             Gradient().Print("CrossEntropyWithSoftmax Partial-gradientValues");
@@ -144,14 +151,18 @@ public:
         else if (inputIndex == 1) // right derivative
         {
 #if DUMPOUTPUT
-            m_softmaxOfRight->Print("CrossEntropyWithSoftmax Partial-softmaxOfRight");
+            if (!UseFusedKernel())
+                m_softmaxOfRight->Print("CrossEntropyWithSoftmax Partial-softmaxOfRight");
             Input(0)->ValueFor(fr).Print("CrossEntropyWithSoftmax Partial-inputFunctionValues");
             Gradient().Print("CrossEntropyWithSoftmax Partial-gradientValues");
             Input(1)->GradientFor(fr).Print("CrossEntropyWithSoftmaxNode Partial-Right-in");
 #endif
 
             auto gradient = Input(1)->GradientFor(fr);
-            Matrix<ElemType>::AddScaledDifference(Gradient(), *m_softmaxOfRight, Input(0)->ValueFor(fr), gradient);
+            if (UseFusedKernel())
+                Matrix<ElemType>::AddCrossEntropyWithSoftmaxGradient(Gradient(), Input(0)->ValueFor(fr), Input(1)->ValueFor(fr), *m_logSumExpOfRight, gradient);
+            else
+                Matrix<ElemType>::AddScaledDifference(Gradient(), *m_softmaxOfRight, Input(0)->ValueFor(fr), gradient);
 #if DUMPOUTPUT
             Input(1)->GradientFor(fr).Print("CrossEntropyWithSoftmaxNode Partial-Right");
 #endif
@@ -161,6 +172,7 @@ public:
         }
     }
 
+    virtual bool IsThreadSafe() const override { return true; }
     virtual bool OutputUsedInComputingInputNodesGradients() const override
     {
         return false;
@@ -168,6 +180,10 @@ public:
 
     virtual void UpdateFunctionMBSize() override
     {
+        // the fused kernel only needs one value per column, the (log) softmax is not materialized
+        if (UseFusedKernel())
+            return;
+
         m_logSoftmaxOfRight->Resize(Input(1)->Value());
         m_softmaxOfRight->Resize(*m_logSoftmaxOfRight);
     }
@@ -175,17 +191,29 @@ public:
     virtual void /*ComputationNodeNonLooping::*/ ForwardPropNonLooping() override // -sum(left_i * log(softmax_i(right)))
     {
         FrameRange fr(Input(0)->GetMBLayout());
-        // first compute the softmax (column-wise)
-        // Note that we need both log and non-log for gradient computation.
-        m_logSoftmaxOfRight->AssignLogSoftmaxOf(Input(1)->ValueFor(fr), true);
-        // BUGBUG: No need to compute m_softmaxOfRight in ForwardProp, should be moved to BackpropTo().
-        m_softmaxOfRight->SetValue(*m_logSoftmaxOfRight);
-        m_softmaxOfRight->InplaceExp();
-        // flatten all gaps to zero, such that gaps will contribute zero to the sum
-        MaskMissingColumnsToZero(*m_logSoftmaxOfRight, Input(1)->GetMBLayout(), fr);
-        // reduce over all frames
-        Value().AssignInnerProductOfMatrices(Input(0)->MaskedValueFor(fr), *m_logSoftmaxOfRight);
-        Value() *= -1;
+        if (UseFusedKernel())
+        {
+            // compute the cross entropy of every column in one go, remembering the log-sum-exp for the gradient
+            m_crossEntropyPerColumn->AssignCrossEntropyWithSoftmaxOf(Input(0)->ValueFor(fr), Input(1)->ValueFor(fr), *m_logSumExpOfRight);
+            // flatten all gaps to zero, such that gaps will contribute zero to the sum
+            MaskMissingColumnsToZero(*m_crossEntropyPerColumn, Input(1)->GetMBLayout(), fr);
+            // reduce over all frames
+            Value().AssignSumOfElements(*m_crossEntropyPerColumn);
+        }
+        else
+        {
+            // first compute the softmax (column-wise)
+            // Note that we need both log and non-log for gradient computation.
+            m_logSoftmaxOfRight->AssignLogSoftmaxOf(Input(1)->ValueFor(fr), true);
+            // BUGBUG: No need to compute m_softmaxOfRight in ForwardProp, should be moved to BackpropTo().
+            m_softmaxOfRight->SetValue(*m_logSoftmaxOfRight);
+            m_softmaxOfRight->InplaceExp();
+            // flatten all gaps to zero, such that gaps will contribute zero to the sum
+            MaskMissingColumnsToZero(*m_logSoftmaxOfRight, Input(1)->GetMBLayout(), fr);
+            // reduce over all frames
+            Value().AssignInnerProductOfMatrices(Input(0)->MaskedValueFor(fr), *m_logSoftmaxOfRight);
+            Value() *= -1;
+        }
 #if NANCHECK
         Value().HasNan("CrossEntropyWithSoftmax");
 #endif
@@ -207,6 +235,8 @@ public:
             auto node = dynamic_pointer_cast<CrossEntropyWithSoftmaxNode<ElemType>>(nodeP);
             node->m_logSoftmaxOfRight->SetValue(*m_logSoftmaxOfRight);
             node->m_softmaxOfRight->SetValue(*m_softmaxOfRight);
+            node->m_logSumExpOfRight->SetValue(*m_logSumExpOfRight);
+            node->m_crossEntropyPerColumn->SetValue(*m_crossEntropyPerColumn);
         }
     }
 
@@ -216,11 +246,26 @@ public:
         Base::RequestMatricesBeforeForwardProp(matrixPool);
         RequestMatrixFromPool(m_logSoftmaxOfRight, matrixPool);
         RequestMatrixFromPool(m_softmaxOfRight, matrixPool);
+        RequestMatrixFromPool(m_logSumExpOfRight, matrixPool);
+        RequestMatrixFromPool(m_crossEntropyPerColumn, matrixPool);
     }
 
 protected:
+    // On the CPU, the loss and the gradient w.r.t. the prediction are computed by a fused kernel that makes two passes
+    // over each column in ForwardProp and one in BackpropTo, parallel over columns, instead of storing the softmax.
+    // Sparse (e.g. one-hot) labels are used as they are. Everything else takes the unfused path.
+    virtual bool UseFusedKernel() const
+    {
+        const auto& labels = Input(0)->Value();
+        const auto& prediction = Input(1)->Value();
+        return prediction.GetDeviceId() == CPUDEVICE && prediction.GetMatrixType() == MatrixType::DENSE &&
+               labels.GetDeviceId() == CPUDEVICE && (labels.GetMatrixType() == MatrixType::DENSE || labels.GetFormat() == matrixFormatSparseCSC);
+    }
+
     shared_ptr<Matrix<ElemType>> m_logSoftmaxOfRight;
     shared_ptr<Matrix<ElemType>> m_softmaxOfRight;
+    shared_ptr<Matrix<ElemType>> m_logSumExpOfRight;     // [1 x T] log-sum-exp of each column of the prediction (fused kernel only)
+    shared_ptr<Matrix<ElemType>> m_crossEntropyPerColumn; // [1 x T] cross entropy of each column (fused kernel only)
 };
 
 template class CrossEntropyWithSoftmaxNode<float>;
@@ -1437,6 +1482,7 @@ public:
             sliceInput0Grad += sliceOutputGrad;
     }
 
+    virtual bool IsThreadSafe() const override { return true; }
     virtual bool OutputUsedInComputingInputNodesGradients() const override { return false; }
     virtual bool InputUsedInComputingInputNodesGradients(size_t /*childIndex*/) const override { return false; }
 
@@ -1840,6 +1886,32 @@ public:
             ReleaseMatrixToPool(m_dBias, matrixPool);
         }
 
+    bool IsSpatial() const { return m_spatial; }
+
+    // Computes the affine transform 'out = a .* in + b' that this node applies during inference, i.e. with the
+    // running statistics. 'a' and 'b' get the dimensions of the scale. Used to fold the node into a preceding layer.
+    void GetInferenceScaleAndShift(Matrix<ElemType>& a, Matrix<ElemType>& b) const
+    {
+        const Matrix<ElemType>& scale = Input(1)->Value();
+        const Matrix<ElemType>& bias = Input(2)->Value();
+        const Matrix<ElemType>& runMean = Input(3)->Value();
+
+        a.SetValue(Input(4)->Value());
+        if (!m_useCntkEngine)
+        {
+            // the cuDNN engine keeps the running variance in place of the inverse standard deviation
+            a += (ElemType) max(m_epsilon, 1e-5 /*CUDNN_BN_MIN_EPSILON*/);
+            a.InplaceSqrt();
+            a.ElementInverse();
+        }
+        a.ElementMultiplyWith(scale);
+
+        Matrix<ElemType> meanScaled(a.GetDeviceId());
+        meanScaled.AssignElementProductOf(a, runMean);
+        b.SetValue(bias);
+        b -= meanScaled;
+    }
+
     void SetNormalizationTimeConstants(double normalizationTimeConstant, double prevNormalizationTimeConstant,
                                        double blendTimeConstant, double prevBlendTimeConstant)
     {
@@ -44,6 +44,7 @@ void CNTKEvalBase<ElemType>::Init(const std::string& config)
     size_t nThreads = m_config("numCPUThreads", "1");
     CPUMatrix<ElemType>::SetNumThreads(nThreads);
     g_shareNodeValueMatrices = m_config(L"shareNodeValueMatrices", false);
+    ComputationNetwork::SetConcurrentNodeExecution(m_config(L"concurrentNodeThreads", (size_t) 0));
 }
 
 
@@ -274,6 +275,27 @@ void CNTKEvalExtended<ElemType>::StartForwardEvaluation(const std::vector<wstrin
             RuntimeError("Sparse outputs are not supported by this API.");
     }
 
+    // collect the nodes whose state the sessions carry over
+    m_statefulNodes.clear();
+    m_hasFutureDependency = false;
+    std::set<ComputationNodeBasePtr> visited;
+    for (const auto& output : m_outputNodes)
+    {
+        for (const auto& node : this->m_net->GetAllNodesForRoot(output))
+        {
+            if (!visited.insert(node).second)
+                continue;
+            auto statefulNode = dynamic_pointer_cast<IStatefulNode>(node);
+            if (statefulNode)
+                m_statefulNodes.push_back(statefulNode);
+            auto recurrentNode = dynamic_pointer_cast<IRecurrentNode>(node);
+            if (recurrentNode && recurrentNode->GetRecurrenceSteppingDirection() < 0)
+                m_hasFutureDependency = true;
+        }
+    }
+    for (auto& session : m_sessions)
+        session.second = Session();
+
     m_started = true;
 }
 
@@ -307,6 +329,33 @@ VariableSchema CNTKEvalExtended<ElemType>::GetInputSchema() const
     return inputLayouts;
 }
 
+template<typename ElemType>
+template<template<typename> class ValueContainer>
+size_t CNTKEvalExtended<ElemType>::GetNumSamples(size_t i, const ValueBuffer<ElemType, ValueContainer>& buffer, MatrixType type, size_t numRows) const
+{
+    if (type == MatrixType::DENSE)
+    {
+        if (buffer.m_buffer.size() % numRows != 0)
+            RuntimeError("Input %ls: Expected input data to be a multiple of %" PRIu64 ", but it is %" PRIu64 ".", 
+                         m_inputNodes[i]->GetName().c_str(), numRows, buffer.m_buffer.size());
+        if (buffer.m_buffer.size() == 0)
+            RuntimeError("Input %ls: Expected at least one element.", m_inputNodes[i]->GetName().c_str());
+    }
+    else if (type == MatrixType::SPARSE)
+    {
+        if (buffer.m_colIndices.size() < 2)
+            RuntimeError("Input %ls: Expected at least one element.", m_inputNodes[i]->GetName().c_str());
+        if (buffer.m_colIndices[0] != 0)
+            RuntimeError("Input %ls: First element of column indices must be 0", m_inputNodes[i]->GetName().c_str());
+        if (buffer.m_colIndices[buffer.m_colIndices.size() - 1] != buffer.m_indices.size())
+            RuntimeError("Input %ls: Last element of column indices must be equal to the size of indices (%ld), but was %d", 
+                         m_inputNodes[i]->GetName().c_str(), buffer.m_indices.size(), 
+                         buffer.m_colIndices[buffer.m_colIndices.size() - 1]);
+    }
+
+    return type == MatrixType::DENSE ? buffer.m_buffer.size() / numRows : buffer.m_colIndices.size() - 1;
+}
+
 template<typename ElemType>
 template<template<typename> class ValueContainer>
 void CNTKEvalExtended<ElemType>::ForwardPassT(const std::vector<ValueBuffer<ElemType, ValueContainer> >& inputs, std::vector<ValueBuffer<ElemType, ValueContainer> >& outputs)
@@ -330,27 +379,7 @@ void CNTKEvalExtended<ElemType>::ForwardPassT(const std::vector<ValueBuffer<Elem
         auto type = matrix->GetMatrixType();
         size_t numRows = input.second.sampleLayout.GetNumElements();
 
-        if (type == MatrixType::DENSE)
-        {
-            if (buffer.m_buffer.size() % numRows != 0)
-                RuntimeError("Input %ls: Expected input data to be a multiple of %" PRIu64 ", but it is %" PRIu64 ".", 
-                             m_inputNodes[i]->GetName().c_str(), numRows, buffer.m_buffer.size());
-            if (buffer.m_buffer.size() == 0)
-                RuntimeError("Input %ls: Expected at least one element.", m_inputNodes[i]->GetName().c_str());
-        }
-        else if (type == MatrixType::SPARSE)
-        {
-            if (buffer.m_colIndices.size() < 2)
-                RuntimeError("Input %ls: Expected at least one element.", m_inputNodes[i]->GetName().c_str());
-            if (buffer.m_colIndices[0] != 0)
-                RuntimeError("Input %ls: First element of column indices must be 0", m_inputNodes[i]->GetName().c_str());
-            if (buffer.m_colIndices[buffer.m_colIndices.size() - 1] != buffer.m_indices.size())
-                RuntimeError("Input %ls: Last element of column indices must be equal to the size of indices (%ld), but was %d", 
-                             m_inputNodes[i]->GetName().c_str(), buffer.m_indices.size(), 
-                             buffer.m_colIndices[buffer.m_colIndices.size() - 1]);
-        }
-
-        int numCols = type == MatrixType::DENSE ? buffer.m_buffer.size() / numRows : buffer.m_colIndices.size() - 1;
+        int numCols = (int)GetNumSamples(i, buffer, type, numRows);
         assert(numCols >= 1);
         input.second.pMBLayout->Init(1, numCols);
         input.second.pMBLayout->AddSequence(0, 0, 0, numCols);
@@ -402,6 +431,212 @@ void CNTKEvalExtended<ElemType>::ForwardPassT(const std::vector<ValueBuffer<Elem
     }
 }
 
+// Evaluates the inputs of several sessions in one forward pass. Every session is a parallel sequence of the
+// minibatch, which starts before the minibatch unless it is the session's first call. The recurrent state of
+// the sessions is gathered into the stateful nodes before, and scattered back into the sessions after.
+template<typename ElemType>
+template<template<typename> class ValueContainer>
+void CNTKEvalExtended<ElemType>::ForwardPassT(const std::vector<size_t>& sessionIds,
+                                              const std::vector<const std::vector<ValueBuffer<ElemType, ValueContainer> >*>& inputs,
+                                              const std::vector<std::vector<ValueBuffer<ElemType, ValueContainer> >*>& outputs)
+{
+    if (!m_started)
+        RuntimeError("ForwardPass() called before StartForwardEvaluation()");
+
+    if (m_hasFutureDependency)
+        RuntimeError("ForwardPass: Models that look into the future (FutureValue) cannot be evaluated in a session.");
+
+    size_t numSequences = sessionIds.size();
+    if (inputs.size() != numSequences || outputs.size() != numSequences)
+        RuntimeError("Expected inputs and outputs for %d sessions, but got %d and %d.", (int)numSequences, (int)inputs.size(), (int)outputs.size());
+
+    std::vector<Session*> sessions(numSequences);
+    for (size_t s = 0; s < numSequences; ++s)
+    {
+        sessions[s] = &GetSession(sessionIds[s]);
+        if (std::find(sessions.begin(), sessions.begin() + s, sessions[s]) != sessions.begin() + s)
+            InvalidArgument("Session %" PRIu64 " is passed more than once.", sessionIds[s]);
+
+        if (inputs[s]->size() != (size_t)std::distance(m_inputMatrices.begin(), m_inputMatrices.end()))
+            RuntimeError("Expected %d inputs, but got %d.", (int)std::distance(m_inputMatrices.begin(), m_inputMatrices.end()), (int)inputs[s]->size());
+
+        if (outputs[s]->size() != m_outputNodes.size())
+            RuntimeError("Expected %d outputs, but got %d.", (int)m_outputNodes.size(), (int)outputs[s]->size());
+    }
+
+    std::vector<size_t> numSamples(numSequences, 0);
+    size_t i = 0;
+    for (auto& input : m_inputMatrices)
+    {
+        shared_ptr<Matrix<ElemType>> matrix = dynamic_pointer_cast<Matrix<ElemType>>(input.second.matrix);
+        auto type = matrix->GetMatrixType();
+        size_t numRows = input.second.sampleLayout.GetNumElements();
+
+        size_t numTimeSteps = 0;
+        for (size_t s = 0; s < numSequences; ++s)
+        {
+            size_t n = GetNumSamples(i, (*inputs[s])[i], type, numRows);
+            if (i > 0 && n != numSamples[s])
+                RuntimeError("Input %ls: Expected %" PRIu64 " samples like the other inputs, but got %" PRIu64 ".",
+                             m_inputNodes[i]->GetName().c_str(), numSamples[s], n);
+            numSamples[s] = n;
+            numTimeSteps = max(numTimeSteps, n);
+        }
+
+        auto& pMBLayout = input.second.pMBLayout;
+        pMBLayout->Init(numSequences, numTimeSteps);
+        for (size_t s = 0; s < numSequences; ++s)
+        {
+            pMBLayout->AddSequence(s, s, -(ptrdiff_t)sessions[s]->m_numSamples, numSamples[s]);
+            pMBLayout->AddGap(s, numSamples[s], numTimeSteps);
+        }
+
+        // Interleave the samples of the sessions: column t * numSequences + s holds sample t of session s.
+        size_t numCols = numTimeSteps * numSequences;
+        if (type == MatrixType::DENSE)
+        {
+            const ElemType* data = (*inputs[0])[i].m_buffer.data();
+            if (numSequences > 1)
+            {
+                m_packedValues.assign(numRows * numCols, 0);
+                for (size_t s = 0; s < numSequences; ++s)
+                {
+                    const ElemType* sequenceData = (*inputs[s])[i].m_buffer.data();
+                    for (size_t t = 0; t < numSamples[s]; ++t)
+                        std::copy(sequenceData + t * numRows, sequenceData + (t + 1) * numRows, m_packedValues.begin() + (t * numSequences + s) * numRows);
+                }
+                data = m_packedValues.data();
+            }
+            matrix->SetValue(numRows, numCols, matrix->GetDeviceId(), const_cast<ElemType*>(data), matrixFlagNormal);
+        }
+        else if (type == MatrixType::SPARSE)
+        {
+            const ValueBuffer<ElemType, ValueContainer>& buffer = (*inputs[0])[i];
+            const ElemType* values = buffer.m_buffer.data();
+            const int* indices = buffer.m_indices.data();
+            const int* colIndices = buffer.m_colIndices.data();
+            size_t nnz = buffer.m_buffer.size();
+            if (numSequences > 1)
+            {
+                m_packedValues.clear();
+                m_packedIndices.clear();
+                m_packedColIndices.assign(1, 0);
+                for (size_t t = 0; t < numTimeSteps; ++t)
+                {
+                    for (size_t s = 0; s < numSequences; ++s)
+                    {
+                        if (t < numSamples[s])
+                        {
+                            const ValueBuffer<ElemType, ValueContainer>& sequenceBuffer = (*inputs[s])[i];
+                            int begin = sequenceBuffer.m_colIndices[t], end = sequenceBuffer.m_colIndices[t + 1];
+                            m_packedValues.insert(m_packedValues.end(), sequenceBuffer.m_buffer.data() + begin, sequenceBuffer.m_buffer.data() + end);
+                            m_packedIndices.insert(m_packedIndices.end(), sequenceBuffer.m_indices.data() + begin, sequenceBuffer.m_indices.data() + end);
+                        }
+                        m_packedColIndices.push_back((int)m_packedIndices.size());
+                    }
+                }
+                values = m_packedValues.data();
+                indices = m_packedIndices.data();
+                colIndices = m_packedColIndices.data();
+                nnz = m_packedValues.size();
+            }
+            matrix->SetMatrixFromCSCFormat(colIndices, indices, values, nnz, numRows, numCols);
+        }
+
+        ++i;
+    }
+
+    // gather the state of the sessions
+    std::vector<NodeStatePtr> states(numSequences);
+    for (size_t k = 0; k < m_statefulNodes.size(); ++k)
+    {
+        bool hasState = false;
+        for (size_t s = 0; s < numSequences; ++s)
+        {
+            states[s] = sessions[s]->m_nodeStates.empty() ? nullptr : sessions[s]->m_nodeStates[k];
+            hasState |= states[s] != nullptr;
+        }
+        if (hasState)
+            m_statefulNodes[k]->ImportSequenceStates(states);
+    }
+
+    ComputationNetwork::BumpEvalTimeStamp(m_inputNodes);
+
+    for (size_t i = 0; i < m_outputNodes.size(); ++i)
+    {
+        auto node = m_outputNodes[i];
+        this->m_net->ForwardProp(node);
+        shared_ptr<Matrix<ElemType>> outputMatrix = dynamic_pointer_cast<Matrix<ElemType>>(node->ValuePtr());
+        auto pMBLayout = node->GetMBLayout();
+        if (pMBLayout && pMBLayout->GetNumParallelSequences() != numSequences)
+            RuntimeError("Output %ls: Expected one parallel sequence per session.", node->GetName().c_str());
+
+        size_t numRows = outputMatrix->GetNumRows();
+        size_t numElements = outputMatrix->GetNumElements();
+        m_outputValues.resize(numElements);
+        ElemType* outputData = m_outputValues.data();
+        outputMatrix->CopyToArray(outputData, numElements);
+
+        // scatter the samples of the sessions (all of them if the output has no dynamic axis)
+        for (size_t s = 0; s < numSequences; ++s)
+        {
+            ValueContainer<ElemType>& vec = (*outputs[s])[i].m_buffer;
+            std::vector<size_t> columns;
+            if (pMBLayout)
+            {
+                for (size_t t = 0; t < pMBLayout->GetNumTimeSteps(); ++t)
+                {
+                    if (!pMBLayout->IsGap(FrameRange(pMBLayout, t).Sequence(s)))
+                        columns.push_back(t * numSequences + s);
+                }
+            }
+            else
+            {
+                for (size_t j = 0; j < outputMatrix->GetNumCols(); ++j)
+                    columns.push_back(j);
+            }
+
+            if (vec.capacity() < columns.size() * numRows)
+            {
+                // Bad luck - we can't reallocate memory of an external object at this point.
+                RuntimeError("Not enough space in output buffer for output '%ls'.", node->GetName().c_str());
+            }
+
+            vec.resize(columns.size() * numRows);
+            ElemType* data = const_cast<ElemType*>(vec.data());
+            for (size_t j = 0; j < columns.size(); ++j)
+                std::copy(outputData + columns[j] * numRows, outputData + (columns[j] + 1) * numRows, data + j * numRows);
+        }
+    }
+
+    // scatter the state back into the sessions
+    for (size_t s = 0; s < numSequences; ++s)
+    {
+        sessions[s]->m_nodeStates.resize(m_statefulNodes.size());
+        for (size_t k = 0; k < m_statefulNodes.size(); ++k)
+            sessions[s]->m_nodeStates[k] = m_statefulNodes[k]->ExportSequenceState(s);
+        sessions[s]->m_numSamples += numSamples[s];
+    }
+}
+
+template <typename T>
+static std::vector<T*> ToPointers(std::vector<T>& values)
+{
+    std::vector<T*> pointers;
+    for (auto& value : values)
+        pointers.push_back(&value);
+    return pointers;
+}
+
+template <typename T>
+static std::vector<const T*> ToPointers(const std::vector<T>& values)
+{
+    std::vector<const T*> pointers;
+    for (const auto& value : values)
+        pointers.push_back(&value);
+    return pointers;
+}
+
 template<typename ElemType>
 void CNTKEvalExtended<ElemType>::ForwardPass(const Values<ElemType>& inputs, Values<ElemType>& outputs)
 {
@@ -414,6 +649,60 @@ void CNTKEvalExtended<ElemType>::ForwardPass(const ValueRefs<ElemType>& inputs,
     ForwardPassT(inputs, outputs);
 }
 
+template<typename ElemType>
+void CNTKEvalExtended<ElemType>::ForwardPass(size_t session, const Values<ElemType>& inputs, Values<ElemType>& outputs)
+{
+    ForwardPassT(std::vector<size_t>{ session }, std::vector<const Values<ElemType>*>{ &inputs }, std::vector<Values<ElemType>*>{ &outputs });
+}
+
+template<typename ElemType>
+void CNTKEvalExtended<ElemType>::ForwardPass(size_t session, const ValueRefs<ElemType>& inputs, ValueRefs<ElemType>& outputs)
+{
+    ForwardPassT(std::vector<size_t>{ session }, std::vector<const ValueRefs<ElemType>*>{ &inputs }, std::vector<ValueRefs<ElemType>*>{ &outputs });
+}
+
+template<typename ElemType>
+void CNTKEvalExtended<ElemType>::ForwardPass(const std::vector<size_t>& sessions, const std::vector<Values<ElemType>>& inputs, std::vector<Values<ElemType>>& outputs)
+{
+    ForwardPassT(sessions, ToPointers(inputs), ToPointers(outputs));
+}
+
+template<typename ElemType>
+void CNTKEvalExtended<ElemType>::ForwardPass(const std::vector<size_t>& sessions, const std::vector<ValueRefs<ElemType>>& inputs, std::vector<ValueRefs<ElemType>>& outputs)
+{
+    ForwardPassT(sessions, ToPointers(inputs), ToPointers(outputs));
+}
+
+template<typename ElemType>
+size_t CNTKEvalExtended<ElemType>::CreateSession()
+{
+    size_t session = m_nextSessionId++;
+    m_sessions[session] = Session();
+    return session;
+}
+
+template<typename ElemType>
+void CNTKEvalExtended<ElemType>::ResetSession(size_t session)
+{
+    GetSession(session) = Session();
+}
+
+template<typename ElemType>
+void CNTKEvalExtended<ElemType>::DestroySession(size_t session)
+{
+    GetSession(session);
+    m_sessions.erase(session);
+}
+
+template<typename ElemType>
+typename CNTKEvalExtended<ElemType>::Session& CNTKEvalExtended<ElemType>::GetSession(size_t session)
+{
+    auto iter = m_sessions.find(session);
+    if (iter == m_sessions.end())
+        InvalidArgument("Invalid session handle %" PRIu64 ".", session);
+    return iter->second;
+}
+
 template <typename ElemType>
 void CNTKEvalExtended<ElemType>::Destroy()
 {
@@ -90,7 +90,7 @@ template <typename ElemType>
 class CNTKEvalExtended : public CNTKEvalBase<ElemType>, public IEvaluateModelExtended<ElemType>
 {
 public:
-    CNTKEvalExtended() : CNTKEvalBase<ElemType>(), m_started(false) {}
+    CNTKEvalExtended() : CNTKEvalBase<ElemType>(), m_started(false), m_hasFutureDependency(false), m_nextSessionId(0) {}
 
     virtual VariableSchema GetOutputSchema() const override;
 
@@ -102,6 +102,20 @@ public:
 
     virtual void ForwardPass(const ValueRefs<ElemType>& inputs, ValueRefs<ElemType>& output) override;
 
+    virtual size_t CreateSession() override;
+
+    virtual void ResetSession(size_t session) override;
+
+    virtual void DestroySession(size_t session) override;
+
+    virtual void ForwardPass(size_t session, const Values<ElemType>& inputs, Values<ElemType>& output) override;
+
+    virtual void ForwardPass(size_t session, const ValueRefs<ElemType>& inputs, ValueRefs<ElemType>& output) override;
+
+    virtual void ForwardPass(const std::vector<size_t>& sessions, const std::vector<Values<ElemType>>& inputs, std::vector<Values<ElemType>>& outputs) override;
+
+    virtual void ForwardPass(const std::vector<size_t>& sessions, const std::vector<ValueRefs<ElemType>>& inputs, std::vector<ValueRefs<ElemType>>& outputs) override;
+
     virtual void Destroy() override;
 
     virtual void CreateNetwork(const std::string& networkDescription) override
@@ -121,8 +135,38 @@ private:
     StreamMinibatchInputs m_inputMatrices;
     bool m_started;
 
+    // State of a streaming session between two ForwardPass() calls.
+    struct Session
+    {
+        std::vector<NodeStatePtr> m_nodeStates; // exported state per node in m_statefulNodes, empty at the start of a sequence
+        size_t m_numSamples;                    // number of samples of the current sequence passed so far
+        Session() : m_numSamples(0) {}
+    };
+
+    std::vector<shared_ptr<IStatefulNode>> m_statefulNodes; // stateful nodes needed to compute the outputs
+    bool m_hasFutureDependency;                             // true if any of these looks into the future
+    std::map<size_t, Session> m_sessions;
+    size_t m_nextSessionId;
+
+    // buffers for combining the inputs of several sessions
+    std::vector<ElemType> m_packedValues;
+    std::vector<int> m_packedIndices;
+    std::vector<int> m_packedColIndices;
+    std::vector<ElemType> m_outputValues;
+
+    Session& GetSession(size_t session);
+
+    // checks the input buffer for input i and returns its number of samples
+    template<template<typename> class ValueContainer>
+    size_t GetNumSamples(size_t i, const ValueBuffer<ElemType, ValueContainer>& buffer, MatrixType type, size_t numRows) const;
+
     template<template<typename> class ValueContainer> 
     void ForwardPassT(const std::vector < ValueBuffer<ElemType, ValueContainer> >& inputs,
                       std::vector < ValueBuffer<ElemType, ValueContainer> >& outputs);
+
+    template<template<typename> class ValueContainer>
+    void ForwardPassT(const std::vector<size_t>& sessions,
+                      const std::vector<const std::vector < ValueBuffer<ElemType, ValueContainer> >*>& inputs,
+                      const std::vector<std::vector < ValueBuffer<ElemType, ValueContainer> >*>& outputs);
 };
 } } }
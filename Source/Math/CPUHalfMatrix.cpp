@@ -0,0 +1,94 @@
+//
+// Copyright (c) Microsoft. All rights reserved.
+// Licensed under the MIT license. See LICENSE.md file in the project root for full license information.
+//
+#include "stdafx.h"
+#include "Basics.h"
+#include "CPUHalfMatrix.h"
+#include <omp.h>
+#include <algorithm>
+#if defined(__F16C__) || (defined(_MSC_VER) && defined(__AVX2__))
+#include <immintrin.h>
+#define USE_F16C
+#endif
+
+namespace Microsoft { namespace MSR { namespace CNTK {
+
+// number of values above which conversions are split across threads
+static const size_t s_parallelConversionThreshold = 1 << 16;
+
+template <class ElemType>
+CPUHalfMatrix::CPUHalfMatrix(const ElemType* data, size_t numRows, size_t numCols)
+    : m_numRows(numRows), m_numCols(numCols), m_data(std::make_shared<std::vector<uint16_t>>(numRows * numCols))
+{
+    const long long numElements = (long long)GetNumElements();
+    uint16_t* target = m_data->data();
+#pragma omp parallel for if (numElements > (long long)s_parallelConversionThreshold)
+    for (long long i = 0; i < numElements; i++)
+        target[i] = FloatToHalf((float)data[i]);
+}
+
+CPUHalfMatrix CPUHalfMatrix::Reshaped(size_t numRows, size_t numCols) const
+{
+    if (numRows * numCols != GetNumElements())
+        InvalidArgument("CPUHalfMatrix::Reshaped: Cannot reshape a [%d x %d] matrix to [%d x %d].", (int)m_numRows, (int)m_numCols, (int)numRows, (int)numCols);
+
+    CPUHalfMatrix result(*this);
+    result.m_numRows = numRows;
+    result.m_numCols = numCols;
+    return result;
+}
+
+// converts 'count' values, with F16C if the build enables it
+static void ConvertHalfToFloat(const uint16_t* source, float* target, size_t count)
+{
+    size_t i = 0;
+#ifdef USE_F16C
+    for (; i + 8 <= count; i += 8)
+    {
+        __m128i halfs = _mm_loadu_si128(reinterpret_cast<const __m128i*>(source + i));
+        _mm256_storeu_ps(target + i, _mm256_cvtph_ps(halfs));
+    }
+#endif
+    for (; i < count; i++)
+        target[i] = CPUHalfMatrix::HalfToFloat(source[i]);
+}
+
+static void ConvertHalfToFloat(const uint16_t* source, double* target, size_t count)
+{
+    for (size_t i = 0; i < count; i++)
+        target[i] = CPUHalfMatrix::HalfToFloat(source[i]);
+}
+
+template <class ElemType>
+void CPUHalfMatrix::CopyColumnsTo(size_t firstColumn, size_t numColumns, ElemType* target) const
+{
+    if (firstColumn + numColumns > m_numCols)
+        InvalidArgument("CPUHalfMatrix::CopyColumnsTo: Columns [%d, %d) are out of range for a matrix with %d columns.", (int)firstColumn, (int)(firstColumn + numColumns), (int)m_numCols);
+
+    const uint16_t* source = Data() + firstColumn * m_numRows;
+    const size_t count = numColumns * m_numRows;
+    if (count <= s_parallelConversionThreshold)
+    {
+        ConvertHalfToFloat(source, target, count);
+        return;
+    }
+
+    // split into blocks of whole cache lines for the threads
+    const size_t blockSize = s_parallelConversionThreshold / 4;
+    const long long numBlocks = (long long)((count + blockSize - 1) / blockSize);
+#pragma omp parallel for
+    for (long long block = 0; block < numBlocks; block++)
+    {
+        const size_t begin = (size_t)block * blockSize;
+        const size_t end = std::min(begin + blockSize, count);
+        ConvertHalfToFloat(source + begin, target + begin, end - begin);
+    }
+}
+
+template CPUHalfMatrix::CPUHalfMatrix(const float* data, size_t numRows, size_t numCols);
+template CPUHalfMatrix::CPUHalfMatrix(const double* data, size_t numRows, size_t numCols);
+template void CPUHalfMatrix::CopyColumnsTo<float>(size_t firstColumn, size_t numColumns, float* target) const;
+template void CPUHalfMatrix::CopyColumnsTo<double>(size_t firstColumn, size_t numColumns, double* target) const;
+
+}}}
@@ -0,0 +1,116 @@
+//
+// Copyright (c) Microsoft. All rights reserved.
+// Licensed under the MIT license. See LICENSE.md file in the project root for full license information.
+//
+#pragma once
+
+#include "CommonMatrix.h"
+#include <stdint.h>
+#include <string.h>
+#include <memory>
+#include <vector>
+
+namespace Microsoft { namespace MSR { namespace CNTK {
+
+// A dense, column-major matrix stored in IEEE 754 half precision on the CPU.
+// Used to hold inference parameters at half the memory (and memory bandwidth) of float.
+// It is not a computation object: values are converted back to float/double in panels when they are used,
+// see CPUMatrix::MultiplyAndWeightedAdd() with a CPUHalfMatrix as left operand.
+class MATH_API CPUHalfMatrix
+{
+public:
+    CPUHalfMatrix()
+        : m_numRows(0), m_numCols(0)
+    {
+    }
+
+    // converts 'numRows' x 'numCols' column-major values
+    template <class ElemType>
+    CPUHalfMatrix(const ElemType* data, size_t numRows, size_t numCols);
+
+    size_t GetNumRows() const { return m_numRows; }
+    size_t GetNumCols() const { return m_numCols; }
+    size_t GetNumElements() const { return m_numRows * m_numCols; }
+    const uint16_t* Data() const { return m_data ? m_data->data() : nullptr; }
+
+    // the same values, interpreted with different matrix dimensions (no copy)
+    CPUHalfMatrix Reshaped(size_t numRows, size_t numCols) const;
+
+    // converts the columns [firstColumn, firstColumn + numColumns) into 'target' (column-major, GetNumRows() values per column)
+    template <class ElemType>
+    void CopyColumnsTo(size_t firstColumn, size_t numColumns, ElemType* target) const;
+
+    // IEEE 754 single to half precision, rounding to nearest even
+    static uint16_t FloatToHalf(float value)
+    {
+        uint32_t bits;
+        memcpy(&bits, &value, sizeof(bits));
+        const uint16_t sign = (uint16_t)((bits >> 16) & 0x8000);
+        const uint32_t exponent = (bits >> 23) & 0xff;
+        uint32_t mantissa = bits & 0x7fffff;
+
+        if (exponent == 0xff) // Inf or NaN
+            return sign | 0x7c00 | (mantissa ? 0x200 : 0);
+
+        int halfExponent = (int)exponent - 127 + 15;
+        if (halfExponent >= 0x1f) // overflow to Inf
+            return sign | 0x7c00;
+
+        if (halfExponent <= 0) // subnormal or zero
+        {
+            if (halfExponent < -10)
+                return sign;
+            mantissa |= 0x800000;
+            const uint32_t shift = (uint32_t)(14 - halfExponent);
+            uint32_t halfMantissa = mantissa >> shift;
+            const uint32_t remainder = mantissa & ((1u << shift) - 1);
+            const uint32_t halfway = 1u << (shift - 1);
+            if (remainder > halfway || (remainder == halfway && (halfMantissa & 1)))
+                halfMantissa++;
+            return sign | (uint16_t)halfMantissa;
+        }
+
+        uint32_t half = ((uint32_t)halfExponent << 10) | (mantissa >> 13);
+        const uint32_t remainder = mantissa & 0x1fff;
+        if (remainder > 0x1000 || (remainder == 0x1000 && (half & 1)))
+            half++; // may carry into the exponent, which correctly rounds up to the next power of 2 or Inf
+        return sign | (uint16_t)half;
+    }
+
+    // IEEE 754 half to single precision (exact)
+    static float HalfToFloat(uint16_t value)
+    {
+        const uint32_t sign = (uint32_t)(value & 0x8000) << 16;
+        uint32_t exponent = (value >> 10) & 0x1f;
+        uint32_t mantissa = value & 0x3ff;
+        uint32_t bits;
+
+        if (exponent == 0x1f) // Inf or NaN
+            bits = sign | 0x7f800000 | (mantissa << 13);
+        else if (exponent != 0) // normal
+            bits = sign | ((exponent + 127 - 15) << 23) | (mantissa << 13);
+        else if (mantissa == 0) // zero
+            bits = sign;
+        else // subnormal: normalize
+        {
+            exponent = 127 - 15 + 1;
+            while (!(mantissa & 0x400))
+            {
+                mantissa <<= 1;
+                exponent--;
+            }
+            bits = sign | (exponent << 23) | ((mantissa & 0x3ff) << 13);
+        }
+
+        float result;
+        memcpy(&result, &bits, sizeof(result));
+        return result;
+    }
+
+private:
+    size_t m_numRows;
+    size_t m_numCols;
+    std::shared_ptr<std::vector<uint16_t>> m_data; // shared between reshaped copies
+};
+
+}}}
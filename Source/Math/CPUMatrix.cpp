@@ -886,8 +886,11 @@ void CPUMatrix<ElemType>::SetValue(const size_t numRows, const size_t numCols, E
     if (matrixFlags & matrixFlagDontOwnBuffer)
     {
         // free previous array allocation if any before overwriting
-		delete[] Buffer();
+        // (a previous external buffer is not ours, e.g. when a reader hands over a new buffer for every minibatch)
+        if (OwnBuffer())
+            delete[] Buffer();
 
+        m_sliceViewOffset = 0;
         m_numRows = numRows;
         m_numCols = numCols;
         SetBuffer(pArray, GetNumElements() * sizeof(ElemType), true);
@@ -2302,6 +2305,92 @@ CPUMatrix<ElemType>& CPUMatrix<ElemType>::AssignLogSoftmaxOf(const CPUMatrix<Ele
     return *this;
 }
 
+//[this](0,j) = log(sum_i exp(a(i,j)))
+template <class ElemType>
+CPUMatrix<ElemType>& CPUMatrix<ElemType>::AssignColumnwiseLogSumExpOf(const CPUMatrix<ElemType>& a)
+{
+    if (a.IsEmpty())
+        LogicError("AssignColumnwiseLogSumExpOf: Matrix a is empty.");
+
+    const long numRows = (long) a.GetNumRows();
+    const long numCols = (long) a.GetNumCols();
+    RequireSize(1, numCols);
+
+    const ElemType* aData = a.Data();
+    ElemType* usData = Data();
+
+#pragma omp parallel for
+    for (long j = 0; j < numCols; j++)
+    {
+        const ElemType* x = aData + (size_t) j * numRows;
+
+        // we need to extract max before applying exp to avoid overflow
+        ElemType maxV = x[0];
+        for (long i = 1; i < numRows; i++)
+            maxV = std::max(maxV, x[i]);
+
+        ElemType sum = 0;
+        for (long i = 0; i < numRows; i++)
+            sum += exp(x[i] - maxV);
+
+        usData[j] = maxV + log(sum);
+    }
+
+    return *this;
+}
+
+//[this](0,j) = -sum_i labels(i,j) * logSoftmax(prediction)(i,j)
+// Fused CrossEntropyWithSoftmax: each column is read twice, once for its maximum and once for the sum of exp
+// and the inner product with the labels. The log-sum-exp of each column goes to 'logSumExp' (1 x N), from which
+// AddCrossEntropyWithSoftmaxGradient() computes the gradient without the softmax ever being stored.
+template <class ElemType>
+CPUMatrix<ElemType>& CPUMatrix<ElemType>::AssignCrossEntropyWithSoftmaxOf(const CPUMatrix<ElemType>& labels, const CPUMatrix<ElemType>& prediction, CPUMatrix<ElemType>& logSumExp)
+{
+    if (prediction.IsEmpty())
+        LogicError("AssignCrossEntropyWithSoftmaxOf: Matrix prediction is empty.");
+
+    if (labels.GetNumRows() != prediction.GetNumRows() || labels.GetNumCols() != prediction.GetNumCols())
+        InvalidArgument("AssignCrossEntropyWithSoftmaxOf: The dimensions of labels and prediction do not match.");
+
+    const long numRows = (long) prediction.GetNumRows();
+    const long numCols = (long) prediction.GetNumCols();
+    RequireSize(1, numCols);
+    logSumExp.RequireSize(1, numCols);
+
+    const ElemType* labelsData = labels.Data();
+    const ElemType* predictionData = prediction.Data();
+    ElemType* logSumExpData = logSumExp.Data();
+    ElemType* usData = Data();
+
+#pragma omp parallel for
+    for (long j = 0; j < numCols; j++)
+    {
+        const ElemType* x = predictionData + (size_t) j * numRows;
+        const ElemType* l = labelsData + (size_t) j * numRows;
+
+        ElemType maxV = x[0];
+        for (long i = 1; i < numRows; i++)
+            maxV = std::max(maxV, x[i]);
+
+        ElemType sumOfExp = 0;
+        ElemType sumOfLabels = 0;
+        ElemType labelsTimesShifted = 0; // sum_i l[i] * (x[i] - maxV)
+        for (long i = 0; i < numRows; i++)
+        {
+            const ElemType shifted = x[i] - maxV;
+            sumOfExp += exp(shifted);
+            sumOfLabels += l[i];
+            labelsTimesShifted += l[i] * shifted;
+        }
+
+        const ElemType logSumOfExp = log(sumOfExp);
+        logSumExpData[j] = maxV + logSumOfExp;
+        usData[j] = sumOfLabels * logSumOfExp - labelsTimesShifted;
+    }
+
+    return *this;
+}
+
 //[this]=hardmax([this])
 //the max element is 1 else is 0
 template <class ElemType>
@@ -4564,6 +4653,92 @@ void CPUMatrix<ElemType>::MultiplyAndWeightedAdd(ElemType alpha, const CPUMatrix
     }
 }
 
+// c = alpha * op(a) * op(b) + beta * c, with 'a' stored in half precision.
+// 'a' is converted to ElemType in panels of whole columns that fit into the cache, each panel is multiplied with BLAS:
+//  - op(a) = a:   the panels split the inner dimension, c accumulates the partial products
+//  - op(a) = a^T: the panels split the rows of c
+template <class ElemType>
+void CPUMatrix<ElemType>::MultiplyAndWeightedAdd(ElemType alpha, const CPUHalfMatrix& a, const bool transposeA, const CPUMatrix<ElemType>& b, const bool transposeB,
+                                                 ElemType beta, CPUMatrix<ElemType>& c)
+{
+    if (a.GetNumElements() == 0 || b.IsEmpty())
+        return;
+
+    const size_t m = transposeA ? a.GetNumCols() : a.GetNumRows();
+    const size_t k = transposeA ? a.GetNumRows() : a.GetNumCols();
+    const size_t l = transposeB ? b.GetNumCols() : b.GetNumRows();
+    const size_t n = transposeB ? b.GetNumRows() : b.GetNumCols();
+    if (k != l)
+        InvalidArgument("CPUMatrix<ElemType>::MultiplyAndWeightedAdd : The inner dimensions of a and b must match.");
+
+    if (beta == 0)
+        c.RequireSize(m, n);
+    else
+        c.VerifySize(m, n); // Can't resize if beta != 0
+
+    // about 1 MB of converted values per panel
+    const size_t panelColumns = std::max<size_t>(1, (1 << 20) / (sizeof(ElemType) * a.GetNumRows()));
+    std::unique_ptr<ElemType[]> panelBuffer(new ElemType[std::min(panelColumns, a.GetNumCols()) * a.GetNumRows()]);
+
+    const int ldb = (int) b.GetNumRows();
+    const int ldc = (int) c.GetNumRows();
+#ifdef USE_ACML
+    char transA = (char) (transposeA ? MatrixTranspose::Trans : MatrixTranspose::NoTrans);
+    char transB = (char) (transposeB ? MatrixTranspose::Trans : MatrixTranspose::NoTrans);
+#else
+    CBLAS_TRANSPOSE mklTransA = transposeA ? CBLAS_TRANSPOSE::CblasTrans : CBLAS_TRANSPOSE::CblasNoTrans;
+    CBLAS_TRANSPOSE mklTransB = transposeB ? CBLAS_TRANSPOSE::CblasTrans : CBLAS_TRANSPOSE::CblasNoTrans;
+#endif
+
+    for (size_t firstColumn = 0; firstColumn < a.GetNumCols(); firstColumn += panelColumns)
+    {
+        const size_t numColumns = std::min(panelColumns, a.GetNumCols() - firstColumn);
+        a.CopyColumnsTo(firstColumn, numColumns, panelBuffer.get());
+
+        // panel dimensions and the parts of b and c it is multiplied with
+        int pm, pk, lda;
+        ElemType* pb;
+        ElemType* pc;
+        ElemType pbeta;
+        if (transposeA) // panel^T is rows [firstColumn, firstColumn + numColumns) of op(a)
+        {
+            pm = (int) numColumns;
+            pk = (int) k;
+            lda = (int) a.GetNumRows();
+            pb = b.Data();
+            pc = c.Data() + firstColumn;
+            pbeta = beta;
+        }
+        else // panel is columns [firstColumn, firstColumn + numColumns) of a, i.e. a slice of the inner dimension
+        {
+            pm = (int) m;
+            pk = (int) numColumns;
+            lda = (int) m;
+            pb = b.Data() + (transposeB ? firstColumn * b.GetNumRows() : firstColumn);
+            pc = c.Data();
+            pbeta = firstColumn == 0 ? beta : 1;
+        }
+
+        if (sizeof(ElemType) == sizeof(double))
+        {
+#ifdef USE_ACML
+            dgemm(transA, transB, pm, (int) n, pk, alpha, reinterpret_cast<double*>(panelBuffer.get()), lda, reinterpret_cast<double*>(pb), ldb, pbeta, reinterpret_cast<double*>(pc), ldc);
+#else
+            cblas_dgemm((CBLAS_ORDER) BLAS_COLMAJOR mklTransA, mklTransB, pm, (int) n, pk, alpha, reinterpret_cast<double*>(panelBuffer.get()), lda, reinterpret_cast<double*>(pb), ldb, pbeta, reinterpret_cast<double*>(pc), ldc);
+#endif
+        }
+        else
+        {
+#pragma warning(suppress : 4244)
+#ifdef USE_ACML
+            sgemm(BLAS_COLMAJOR transA, transB, pm, (int) n, pk, alpha, reinterpret_cast<float*>(panelBuffer.get()), lda, reinterpret_cast<float*>(pb), ldb, pbeta, reinterpret_cast<float*>(pc), ldc);
+#else
+            cblas_sgemm((CBLAS_ORDER) BLAS_COLMAJOR mklTransA, mklTransB, pm, (int) n, pk, alpha, reinterpret_cast<float*>(panelBuffer.get()), lda, reinterpret_cast<float*>(pb), ldb, pbeta, reinterpret_cast<float*>(pc), ldc);
+#endif
+        }
+    }
+}
+
 template <class ElemType>
 void CPUMatrix<ElemType>::Multiply1x1AndWeightedAdd(ElemType alpha, const CPUMatrix<ElemType>& a, const CPUMatrix<ElemType>& b,
                                                     ElemType beta, CPUMatrix<ElemType>& c)
@@ -5078,6 +5253,35 @@ void CPUMatrix<ElemType>::AddScaledDifference(const CPUMatrix<ElemType>& alpha,
     AddScaledDifference(alpha(0, 0), a, b, c);
 }
 
+// c += alpha * (softmax(prediction) - labels), column-wise
+// 'logSumExp' holds the log-sum-exp of each column of 'prediction', as computed by AssignCrossEntropyWithSoftmaxOf().
+template <class ElemType>
+void CPUMatrix<ElemType>::AddCrossEntropyWithSoftmaxGradient(ElemType alpha, const CPUMatrix<ElemType>& labels, const CPUMatrix<ElemType>& prediction, const CPUMatrix<ElemType>& logSumExp, CPUMatrix<ElemType>& c)
+{
+    if (labels.GetNumRows() != prediction.GetNumRows() || labels.GetNumCols() != prediction.GetNumCols() ||
+        c.GetNumRows() != prediction.GetNumRows() || c.GetNumCols() != prediction.GetNumCols() ||
+        logSumExp.GetNumElements() != prediction.GetNumCols())
+        InvalidArgument("AddCrossEntropyWithSoftmaxGradient: The input matrix dimensions do not match.");
+
+    const long numRows = (long) prediction.GetNumRows();
+    const long numCols = (long) prediction.GetNumCols();
+    const ElemType* labelsData = labels.Data();
+    const ElemType* predictionData = prediction.Data();
+    const ElemType* logSumExpData = logSumExp.Data();
+    ElemType* cData = c.Data();
+
+#pragma omp parallel for
+    for (long j = 0; j < numCols; j++)
+    {
+        const ElemType* x = predictionData + (size_t) j * numRows;
+        const ElemType* l = labelsData + (size_t) j * numRows;
+        ElemType* g = cData + (size_t) j * numRows;
+        const ElemType logSumOfExp = logSumExpData[j];
+        for (long i = 0; i < numRows; i++)
+            g[i] += alpha * (exp(x[i] - logSumOfExp) - l[i]);
+    }
+}
+
 /// <summary> c = alpha * (a-b)</summary>
 /// if a, b, c  must have same dim
 /// <param name="alpha">1X1 matrix</param>
@@ -17,6 +17,7 @@
 #include <random>
 #include <chrono>
 #include <iostream>
+#include <algorithm>
 #ifdef LEAKDETECT
 #include <vld.h>
 #endif
@@ -741,8 +742,120 @@ void CPUSparseMatrix<ElemType>::Reset()
     SetBlockIdShift(0);
 }
 
+// number of multiply-adds above which dense x sparse products are split across threads
+static const size_t s_parallelSparseProductThreshold = 1 << 15;
+
+// the nonzero elements of op(rhs) for a sparse CSC 'rhs', grouped by column of op(rhs)
+// Group g holds the elements of column m_columns[g] of op(rhs), as pairs (row in op(rhs), position in rhs.Buffer()),
+// in m_elements[m_groupBegin[g]..m_groupBegin[g+1]). Each group produces one column of the product, so that the
+// groups can be processed concurrently.
+struct SparseColumnGroups
+{
+    vector<size_t> m_columns;
+    vector<size_t> m_groupBegin;
+    vector<pair<size_t, size_t>> m_elements;
+
+    template <class ElemType>
+    SparseColumnGroups(const CPUSparseMatrix<ElemType>& rhs, const bool transposeB)
+    {
+        const CPUSPARSE_INDEX_TYPE* colLocation = rhs.SecondaryIndexLocation();
+        const CPUSPARSE_INDEX_TYPE* rowLocation = rhs.MajorIndexLocation();
+        const size_t numCols = rhs.GetNumCols();
+
+        if (!transposeB)
+        {
+            // the columns of rhs, skipping empty ones
+            m_elements.reserve(colLocation[numCols] - colLocation[0]);
+            for (size_t j = 0; j < numCols; j++)
+            {
+                if (colLocation[j] == colLocation[j + 1])
+                    continue;
+                m_columns.push_back(j);
+                m_groupBegin.push_back(m_elements.size());
+                for (size_t p = colLocation[j]; p < colLocation[j + 1]; p++)
+                    m_elements.push_back(make_pair((size_t) rowLocation[p], p));
+            }
+        }
+        else
+        {
+            // the rows of rhs: sort the elements by row, keeping the column order within a row
+            struct Element
+            {
+                size_t row;
+                size_t col;
+                size_t pos;
+            };
+            vector<Element> elements;
+            elements.reserve(colLocation[numCols] - colLocation[0]);
+            for (size_t j = 0; j < numCols; j++)
+                for (size_t p = colLocation[j]; p < colLocation[j + 1]; p++)
+                    elements.push_back(Element{(size_t) rowLocation[p], j, p});
+            stable_sort(elements.begin(), elements.end(), [](const Element& a, const Element& b) { return a.row < b.row; });
+
+            m_elements.reserve(elements.size());
+            for (size_t e = 0; e < elements.size(); e++)
+            {
+                if (e == 0 || elements[e].row != elements[e - 1].row)
+                {
+                    m_columns.push_back(elements[e].row);
+                    m_groupBegin.push_back(m_elements.size());
+                }
+                m_elements.push_back(make_pair(elements[e].col, elements[e].pos));
+            }
+        }
+        m_groupBegin.push_back(m_elements.size());
+    }
+
+    size_t GetNumGroups() const { return m_columns.size(); }
+
+    // number of tasks to split the rows [0, numRows) of each group into, to keep all threads busy if there are only few groups
+    size_t GetNumRowBlocks(size_t numRows) const
+    {
+        const size_t numThreads = (size_t) omp_get_max_threads();
+        const size_t minRowsPerBlock = 64;
+        if (GetNumGroups() >= numThreads || numRows < 2 * minRowsPerBlock)
+            return 1;
+        return min(numThreads, numRows / minRowsPerBlock);
+    }
+
+    // c[rowBegin..rowEnd) += alpha * op(lhs)[rowBegin..rowEnd, :] * op(rhs)[:, m_columns[g]]
+    template <class ElemType>
+    void MultiplyAndAddColumn(size_t g, ElemType alpha, const CPUMatrix<ElemType>& lhs, const bool transposeA, const ElemType* rhsValues,
+                              size_t rowBegin, size_t rowEnd, ElemType* c) const
+    {
+        const pair<size_t, size_t>* begin = m_elements.data() + m_groupBegin[g];
+        const pair<size_t, size_t>* end = m_elements.data() + m_groupBegin[g + 1];
+        const ElemType* lhsData = lhs.Data();
+        const size_t ld = lhs.GetNumRows();
+        if (!transposeA)
+        {
+            // a contiguous, vectorizable c += v * lhs(:, k) per element
+            for (auto e = begin; e != end; e++)
+            {
+                const ElemType* a = lhsData + e->first * ld;
+                const ElemType v = alpha * rhsValues[e->second];
+                for (size_t h = rowBegin; h < rowEnd; h++)
+                    c[h] += v * a[h];
+            }
+        }
+        else
+        {
+            // op(lhs)(h, k) = lhs(k, h): one sparse dot product with column h of lhs per row of the result
+            for (size_t h = rowBegin; h < rowEnd; h++)
+            {
+                const ElemType* a = lhsData + h * ld;
+                ElemType sum = 0;
+                for (auto e = begin; e != end; e++)
+                    sum += a[e->first] * rhsValues[e->second];
+                c[h] += alpha * sum;
+            }
+        }
+    }
+};
+
 // c = alpha*op(lhs) * op(rhs) + beta*c
 // dense x sparse = dense
+// The columns of the result are computed in parallel. For transposeB, the nonzero elements of rhs are first grouped by row.
 template <class ElemType>
 void CPUSparseMatrix<ElemType>::MultiplyAndWeightedAdd(ElemType alpha, const CPUMatrix<ElemType>& lhs, const bool transposeA,
                                                        const CPUSparseMatrix<ElemType>& rhs, const bool transposeB, ElemType beta, CPUMatrix<ElemType>& c)
@@ -784,54 +897,26 @@ void CPUSparseMatrix<ElemType>::MultiplyAndWeightedAdd(ElemType alpha, const CPU
     if (rhs.GetFormat() != matrixFormatSparseCSC)
         NOT_IMPLEMENTED;
 
-    if (!transposeA && !transposeB)
-    {
-        for (size_t j = 0; j < rhs.GetNumCols(); j++)
-        {
-            size_t start = rhs.SecondaryIndexLocation()[j]; // ColLocation
-            size_t end = rhs.SecondaryIndexLocation()[j + 1];
-            for (size_t p = start; p < end; p++)
-            {
-                size_t i = rhs.MajorIndexLocation()[p]; // RowLocation
-                ElemType val = rhs.Buffer()[p];
-
-                for (size_t h = 0; h < lhs.GetNumRows(); h++)
-                {
-                    c(h, j) += alpha * lhs(h, i) * val;
-                }
-            }
-        }
-    }
-    else if (!transposeA && transposeB)
-    {
-        for (size_t j = 0; j < rhs.GetNumCols(); j++)
-        {
-            size_t start = rhs.SecondaryIndexLocation()[j];
-            size_t end = rhs.SecondaryIndexLocation()[j + 1];
+    const SparseColumnGroups groups(rhs, transposeB);
+    const size_t numRowBlocks = groups.GetNumRowBlocks(m);
+    const long long numTasks = (long long) (groups.GetNumGroups() * numRowBlocks);
+    const long long numMultiplyAdds = (long long) (groups.m_elements.size() * m);
+    const ElemType* rhsValues = rhs.Buffer();
+    ElemType* cData = c.Data();
 
-            for (size_t p = start; p < end; p++)
-            {
-                size_t i = rhs.MajorIndexLocation()[p];
-                ElemType val = rhs.Buffer()[p];
-                for (size_t h = 0; h < lhs.GetNumRows(); h++)
-                {
-                    c(h, i) += alpha * lhs(h, j) * val;
-                }
-            }
-        }
-    }
-    else if (transposeA && !transposeB)
+#pragma omp parallel for if (numMultiplyAdds > (long long) s_parallelSparseProductThreshold)
+    for (long long t = 0; t < numTasks; t++)
     {
-        NOT_IMPLEMENTED;
-    }
-    else
-    {
-        NOT_IMPLEMENTED;
+        const size_t g = (size_t) t / numRowBlocks;
+        const size_t b = (size_t) t % numRowBlocks;
+        groups.MultiplyAndAddColumn(g, alpha, lhs, transposeA, rhsValues, m * b / numRowBlocks, m * (b + 1) / numRowBlocks, cData + groups.m_columns[g] * m);
     }
 }
 
 // dense x sparse = sparse
 // c = alpha * op(lhs) * op(rhs)
+// The result is in block-column format with one block per nonzero column of op(rhs), e.g. the gradient of an embedding
+// for the words present in a minibatch. The blocks are computed in parallel.
 template <class ElemType>
 void CPUSparseMatrix<ElemType>::MultiplyAndAdd(ElemType alpha, const CPUMatrix<ElemType>& lhs, const bool transposeA,
                                                const CPUSparseMatrix<ElemType>& rhs, const bool transposeB, CPUSparseMatrix<ElemType>& c)
@@ -858,69 +943,104 @@ void CPUSparseMatrix<ElemType>::MultiplyAndAdd(ElemType alpha, const CPUMatrix<E
 
     c.Reset();
 
-    if (!transposeA && !transposeB)
-    {
+    if (rhs.GetFormat() != matrixFormatSparseCSC)
         NOT_IMPLEMENTED;
+
+    const SparseColumnGroups groups(rhs, transposeB);
+    const size_t numBlocks = groups.GetNumGroups();
+
+    // allocate enough memory
+    c.SetFormat(matrixFormatSparseBlockCol);
+    c.RequireSizeAndAllocate(m, n, m * numBlocks, true, false);
+    for (size_t g = 0; g < numBlocks; g++)
+        c.GetBlockIds()[g] = groups.m_columns[g];
+    c.SetBlockSize(numBlocks);
+    if (c.GetBlockSize() * m > c.GetSizeAllocated())
+    {
+        LogicError("Sparse matrix is unexpectedly out of range.");
     }
-    else if (!transposeA && transposeB)
+
+    const size_t numRowBlocks = groups.GetNumRowBlocks(m);
+    const long long numTasks = (long long) (numBlocks * numRowBlocks);
+    const long long numMultiplyAdds = (long long) (groups.m_elements.size() * m);
+    const ElemType* rhsValues = rhs.Buffer();
+    ElemType* blockValues = c.Buffer();
+
+#pragma omp parallel for if (numMultiplyAdds > (long long) s_parallelSparseProductThreshold)
+    for (long long t = 0; t < numTasks; t++)
     {
-        if (rhs.GetFormat() != matrixFormatSparseCSC)
-            NOT_IMPLEMENTED;
+        const size_t g = (size_t) t / numRowBlocks;
+        const size_t b = (size_t) t % numRowBlocks;
+        const size_t rowBegin = m * b / numRowBlocks;
+        const size_t rowEnd = m * (b + 1) / numRowBlocks;
+        ElemType* block = blockValues + g * m;
+        memset(block + rowBegin, 0, sizeof(ElemType) * (rowEnd - rowBegin));
+        groups.MultiplyAndAddColumn(g, alpha, lhs, transposeA, rhsValues, rowBegin, rowEnd, block);
+    }
+}
 
-        // allocate enough memory
-        c.SetFormat(matrixFormatSparseBlockCol);
-        c.RequireSizeAndAllocate(m, n, m * min(n, rhs.NzCount()), true, false);
+// c(0,j) = -sum_i labels(i,j) * logSoftmax(prediction)(i,j) for sparse labels, e.g. one-hot
+// Same as CPUMatrix::AssignCrossEntropyWithSoftmaxOf(), except that only the nonzero labels are visited.
+template <class ElemType>
+void CPUSparseMatrix<ElemType>::AssignCrossEntropyWithSoftmaxOf(const CPUSparseMatrix<ElemType>& labels, const CPUMatrix<ElemType>& prediction, CPUMatrix<ElemType>& logSumExp, CPUMatrix<ElemType>& c)
+{
+    if (labels.GetNumRows() != prediction.GetNumRows() || labels.GetNumCols() != prediction.GetNumCols())
+        InvalidArgument("CPUSparseMatrix::AssignCrossEntropyWithSoftmaxOf: The dimensions of labels and prediction do not match.");
 
-        map<size_t, size_t> w2Id;
-        for (size_t j = 0; j < rhs.GetNumCols(); j++)
-        { // j ranges over batches
-            size_t start = rhs.SecondaryIndexLocation()[j];
-            size_t end = rhs.SecondaryIndexLocation()[j + 1];
+    if (labels.GetFormat() != matrixFormatSparseCSC)
+        NOT_IMPLEMENTED;
 
-            for (size_t p = start; p < end; p++)
-            {
-                size_t i = rhs.MajorIndexLocation()[p]; // i ranges over words
-                ElemType val = rhs.Buffer()[p];  // 1 for(i, j)
+    logSumExp.AssignColumnwiseLogSumExpOf(prediction);
 
-                bool first = true;
-                if (w2Id.find(i) == w2Id.end())
-                {
-                    size_t id = w2Id.size();
-                    w2Id[i] = id;
-                    c.GetBlockIds()[c.GetBlockSize()] = i;
-                    c.SetBlockSize(c.GetBlockSize() + 1);
-                }
-                else
-                {
-                    first = false;
-                }
-                size_t pos = w2Id[i] * lhs.GetNumRows();
-                for (size_t h = 0; h < lhs.GetNumRows(); h++)
-                { // h range over hidden layer
-                    if (first == true)
-                    {
-                        c.Buffer()[pos] = alpha * lhs(h, j) * val;
-                    }
-                    else
-                    {
-                        c.Buffer()[pos] += alpha * lhs(h, j) * val;
-                    }
-                    pos++;
-                }
-            }
-        }
-        if (c.GetBlockSize() * m > c.GetSizeAllocated())
-        {
-            LogicError("Sparse matrix is unexpectedly out of range.");
-        }
-    }
-    else if (transposeA && !transposeB)
+    const long numCols = (long) prediction.GetNumCols();
+    c.RequireSize(1, numCols);
+
+    const CPUSPARSE_INDEX_TYPE* colLocation = labels.SecondaryIndexLocation();
+    const CPUSPARSE_INDEX_TYPE* rowLocation = labels.MajorIndexLocation();
+    const ElemType* labelValues = labels.Buffer();
+
+#pragma omp parallel for
+    for (long j = 0; j < numCols; j++)
     {
-        NOT_IMPLEMENTED;
+        ElemType loss = 0;
+        for (size_t p = colLocation[j]; p < colLocation[j + 1]; p++)
+            loss += labelValues[p] * (logSumExp(0, j) - prediction(rowLocation[p], j));
+
+        c(0, j) = loss;
     }
-    else
-    {
+}
+
+// c += alpha * (softmax(prediction) - labels) for sparse labels, see CPUMatrix::AddCrossEntropyWithSoftmaxGradient()
+template <class ElemType>
+void CPUSparseMatrix<ElemType>::AddCrossEntropyWithSoftmaxGradient(ElemType alpha, const CPUSparseMatrix<ElemType>& labels, const CPUMatrix<ElemType>& prediction, const CPUMatrix<ElemType>& logSumExp, CPUMatrix<ElemType>& c)
+{
+    if (labels.GetNumRows() != prediction.GetNumRows() || labels.GetNumCols() != prediction.GetNumCols() ||
+        c.GetNumRows() != prediction.GetNumRows() || c.GetNumCols() != prediction.GetNumCols() ||
+        logSumExp.GetNumElements() != prediction.GetNumCols())
+        InvalidArgument("CPUSparseMatrix::AddCrossEntropyWithSoftmaxGradient: The input matrix dimensions do not match.");
+
+    if (labels.GetFormat() != matrixFormatSparseCSC)
         NOT_IMPLEMENTED;
+
+    const long numRows = (long) prediction.GetNumRows();
+    const long numCols = (long) prediction.GetNumCols();
+    const CPUSPARSE_INDEX_TYPE* colLocation = labels.SecondaryIndexLocation();
+    const CPUSPARSE_INDEX_TYPE* rowLocation = labels.MajorIndexLocation();
+    const ElemType* labelValues = labels.Buffer();
+    const ElemType* predictionData = prediction.Data();
+    ElemType* cData = c.Data();
+
+#pragma omp parallel for
+    for (long j = 0; j < numCols; j++)
+    {
+        const ElemType* x = predictionData + (size_t) j * numRows;
+        ElemType* g = cData + (size_t) j * numRows;
+        const ElemType logSumOfExp = logSumExp(0, j);
+        for (long i = 0; i < numRows; i++)
+            g[i] += alpha * exp(x[i] - logSumOfExp);
+
+        for (size_t p = colLocation[j]; p < colLocation[j + 1]; p++)
+            g[rowLocation[p]] -= alpha * labelValues[p];
     }
 }
 
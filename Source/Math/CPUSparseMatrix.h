@@ -126,6 +126,10 @@ public:
 
     static void ScaleAndAdd(const ElemType alpha, const CPUSparseMatrix<ElemType>& lhs, CPUMatrix<ElemType>& c);
 
+    // fused CrossEntropyWithSoftmax with sparse labels, see CPUMatrix::AssignCrossEntropyWithSoftmaxOf()
+    static void AssignCrossEntropyWithSoftmaxOf(const CPUSparseMatrix<ElemType>& labels, const CPUMatrix<ElemType>& prediction, CPUMatrix<ElemType>& logSumExp, CPUMatrix<ElemType>& c);
+    static void AddCrossEntropyWithSoftmaxGradient(ElemType alpha, const CPUSparseMatrix<ElemType>& labels, const CPUMatrix<ElemType>& prediction, const CPUMatrix<ElemType>& logSumExp, CPUMatrix<ElemType>& c);
+
     static bool AreEqual(const CPUSparseMatrix<ElemType>& a, const CPUSparseMatrix<ElemType>& b, const ElemType threshold = 1e-8);
 
     // sum(vec(a).*vec(b))
@@ -2555,6 +2555,33 @@ Matrix<ElemType>& Matrix<ElemType>::AssignLogSoftmaxOf(const Matrix<ElemType>& a
     return *this;
 }
 
+//[this](0,j) = -sum_i labels(i,j) * logSoftmax(prediction)(i,j), logSumExp(0,j) = log(sum_i exp(prediction(i,j)))
+// Fused CrossEntropyWithSoftmax, currently CPU only. 'labels' may be dense or sparse CSC.
+template <class ElemType>
+Matrix<ElemType>& Matrix<ElemType>::AssignCrossEntropyWithSoftmaxOf(const Matrix<ElemType>& labels, const Matrix<ElemType>& prediction, Matrix<ElemType>& logSumExp)
+{
+    if (prediction.IsEmpty())
+        LogicError("AssignCrossEntropyWithSoftmaxOf: Matrix prediction is empty.");
+
+    DecideAndMoveToRightDevice(prediction, labels, logSumExp, *this);
+    if (prediction.GetDeviceId() != CPUDEVICE || prediction.GetMatrixType() != MatrixType::DENSE)
+        NOT_IMPLEMENTED;
+
+    SwitchToMatrixType(MatrixType::DENSE, matrixFormatDense, false);
+    logSumExp.SwitchToMatrixType(MatrixType::DENSE, matrixFormatDense, false);
+
+    DISPATCH_MATRIX_ON_FLAG(&labels,
+                            nullptr,
+                            m_CPUMatrix->AssignCrossEntropyWithSoftmaxOf(*labels.m_CPUMatrix, *prediction.m_CPUMatrix, *logSumExp.m_CPUMatrix),
+                            NOT_IMPLEMENTED,
+                            CPUSparseMatrix<ElemType>::AssignCrossEntropyWithSoftmaxOf(*labels.m_CPUSparseMatrix, *prediction.m_CPUMatrix, *logSumExp.m_CPUMatrix, *m_CPUMatrix),
+                            NOT_IMPLEMENTED);
+
+    SetDataLocation(CPU, DENSE);
+    logSumExp.SetDataLocation(CPU, DENSE);
+    return *this;
+}
+
 //[this]=softmax([this]) element wise
 template <class ElemType>
 Matrix<ElemType>& Matrix<ElemType>::InplaceHardmax(const bool isColWise)
@@ -4454,6 +4481,28 @@ void Matrix<ElemType>::MultiplyAndWeightedAdd(ElemType alpha, const Matrix<ElemT
     }
 }
 
+// c = alpha * op(a) * op(b) + beta * c with a half-precision 'a' (CPU only, a is converted on the fly)
+// If b is sparse, a is converted into a temporary dense matrix.
+template <class ElemType>
+void Matrix<ElemType>::MultiplyAndWeightedAdd(ElemType alpha, const CPUHalfMatrix& a, const bool transposeA, const Matrix<ElemType>& b, const bool transposeB,
+                                              ElemType beta, Matrix<ElemType>& c)
+{
+    if (b.GetDeviceId() != CPUDEVICE || c.GetDeviceId() != CPUDEVICE)
+        RuntimeError("MultiplyAndWeightedAdd: Half-precision matrices are only supported on the CPU.");
+
+    if (b.GetMatrixType() == MatrixType::SPARSE)
+    {
+        Matrix<ElemType> denseA(a.GetNumRows(), a.GetNumCols(), CPUDEVICE);
+        a.CopyColumnsTo(0, a.GetNumCols(), denseA.Data());
+        MultiplyAndWeightedAdd(alpha, denseA, transposeA, b, transposeB, beta, c);
+        return;
+    }
+
+    c.SwitchToMatrixType(MatrixType::DENSE, matrixFormatDense, false);
+    CPUMatrix<ElemType>::MultiplyAndWeightedAdd(alpha, a, transposeA, *b.m_CPUMatrix, transposeB, beta, *c.m_CPUMatrix);
+    c.SetDataLocation(CPU, DENSE);
+}
+
 template <class ElemType>
 /*static*/ void Matrix<ElemType>::Multiply1x1AndWeightedAdd(ElemType alpha, const Matrix<ElemType>& a, const Matrix<ElemType>& b, ElemType beta, Matrix<ElemType>& c)
 {
@@ -4705,6 +4754,34 @@ void Matrix<ElemType>::AddScaledDifference(const Matrix<ElemType>& alpha, const
                             NOT_IMPLEMENTED);
 }
 
+/// <summary>c += alpha * (softmax(prediction) - labels), column-wise</summary>
+/// Gradient of AssignCrossEntropyWithSoftmaxOf() with respect to the prediction, currently CPU only.
+/// <param name="alpha">1x1 matrix</param>
+/// <param name="labels">Dense or sparse CSC labels</param>
+/// <param name="prediction">Input matrix</param>
+/// <param name="logSumExp">Log-sum-exp of every column of prediction, as computed by AssignCrossEntropyWithSoftmaxOf()</param>
+/// <param name="c">Resulting matrix, user is responsible for allocating this</param>
+template <class ElemType>
+void Matrix<ElemType>::AddCrossEntropyWithSoftmaxGradient(const Matrix<ElemType>& alpha, const Matrix<ElemType>& labels, const Matrix<ElemType>& prediction, const Matrix<ElemType>& logSumExp, Matrix<ElemType>& c)
+{
+    if (alpha.GetNumElements() != 1)
+        InvalidArgument("AddCrossEntropyWithSoftmaxGradient: alpha must be a 1X1 matrix.");
+
+    DecideAndMoveToRightDevice(c, prediction, labels, logSumExp);
+    if (c.GetDeviceId() != CPUDEVICE || c.GetMatrixType() != MatrixType::DENSE || prediction.GetMatrixType() != MatrixType::DENSE)
+        NOT_IMPLEMENTED;
+
+    const ElemType alphaValue = alpha.Get00Element();
+    DISPATCH_MATRIX_ON_FLAG(&labels,
+                            nullptr,
+                            CPUMatrix<ElemType>::AddCrossEntropyWithSoftmaxGradient(alphaValue, *labels.m_CPUMatrix, *prediction.m_CPUMatrix, *logSumExp.m_CPUMatrix, *c.m_CPUMatrix),
+                            NOT_IMPLEMENTED,
+                            CPUSparseMatrix<ElemType>::AddCrossEntropyWithSoftmaxGradient(alphaValue, *labels.m_CPUSparseMatrix, *prediction.m_CPUMatrix, *logSumExp.m_CPUMatrix, *c.m_CPUMatrix),
+                            NOT_IMPLEMENTED);
+
+    c.SetDataLocation(CPU, DENSE);
+}
+
 /// <summary> c = alpha * (a-b)</summary>
 /// if a, b, c  must have same dim
 /// <param name="alpha">Scalar</param>
@@ -3,6 +3,9 @@
 
 namespace Microsoft { namespace MSR { namespace CNTK {
 
+// number of values above which the columns are (un)quantized in parallel
+static const size_t s_parallelQuantizationThreshold = 1 << 14;
+
 template <class ElemType>
 MatrixQuantizerCPU<ElemType>::MatrixQuantizerCPU()
     : MatrixQuantizerImpl<ElemType>(CPUDEVICE)
@@ -26,40 +29,36 @@ void MatrixQuantizerCPU<ElemType>::QuantizeAsync(const Matrix<ElemType>& inMatri
     assert((inResidual.GetNumRows() == nRow) && (inResidual.GetNumCols() == nCol));
     assert((outResidual.GetNumRows() == nRow) && (outResidual.GetNumCols() == nCol));
 
+    // columns are quantized independently, split them across the threads if there is enough work
     const size_t ldNbits = ValueQuantizer<ElemType>::ld(nBits);
-#ifdef QUANTUSEPPL
-    Concurrency::parallel_for((size_t) 0, us.cols(), [&](size_t j)
-#else
-    for (size_t j = 0; j < nCol; j++)
-#endif
-                              {
-                                  auto& qcol = *(outQMatrix.GetQuantizedColumn(j));
-                                  if (zeroThresholdFor1Bit)
-                                  {
-                                      // Explicit use of 'template' keyword is needed to compile with GCC
-                                      ColumnQuantizer<ElemType>::template ComputeRangeStatColj<true>(inMatrix.Data(), inResidual.Data(), (long) nRow, j, nBits, qcol.lower, qcol.upper);
-                                  }
-                                  else
-                                  {
-                                      // Explicit use of 'template' keyword is needed to compile with GCC
-                                      ColumnQuantizer<ElemType>::template ComputeRangeStatColj<false>(inMatrix.Data(), inResidual.Data(), (long) nRow, j, nBits, qcol.lower, qcol.upper);
-                                  }
-
-                                  ColumnQuantizer<ElemType> q(ldNbits, qcol.lower, qcol.upper);
-                                  if (zeroThresholdFor1Bit)
-                                  {
-                                      // Explicit use of 'template' keyword is needed to compile with GCC
-                                      q.template Quantize<true>(inMatrix.Data(), inResidual.Data(), (long) nRow, j, qcol.bits, outResidual.Data());
-                                  }
-                                  else
-                                  {
-                                      // Explicit use of 'template' keyword is needed to compile with GCC
-                                      q.template Quantize<false>(inMatrix.Data(), inResidual.Data(), (long) nRow, j, qcol.bits, outResidual.Data());
-                                  }
-                              }
-#ifdef QUANTUSEPPL
-                              );
-#endif
+    const long long numCols = (long long) nCol;
+#pragma omp parallel for if ((nCol > 1) && (nRow * nCol >= s_parallelQuantizationThreshold))
+    for (long long j = 0; j < numCols; j++)
+    {
+        auto& qcol = *(outQMatrix.GetQuantizedColumn(j));
+        if (zeroThresholdFor1Bit)
+        {
+            // Explicit use of 'template' keyword is needed to compile with GCC
+            ColumnQuantizer<ElemType>::template ComputeRangeStatColj<true>(inMatrix.Data(), inResidual.Data(), (long) nRow, (size_t) j, nBits, qcol.lower, qcol.upper);
+        }
+        else
+        {
+            // Explicit use of 'template' keyword is needed to compile with GCC
+            ColumnQuantizer<ElemType>::template ComputeRangeStatColj<false>(inMatrix.Data(), inResidual.Data(), (long) nRow, (size_t) j, nBits, qcol.lower, qcol.upper);
+        }
+
+        ColumnQuantizer<ElemType> q(ldNbits, qcol.lower, qcol.upper);
+        if (zeroThresholdFor1Bit)
+        {
+            // Explicit use of 'template' keyword is needed to compile with GCC
+            q.template Quantize<true>(inMatrix.Data(), inResidual.Data(), (long) nRow, (size_t) j, qcol.bits, outResidual.Data());
+        }
+        else
+        {
+            // Explicit use of 'template' keyword is needed to compile with GCC
+            q.template Quantize<false>(inMatrix.Data(), inResidual.Data(), (long) nRow, (size_t) j, qcol.bits, outResidual.Data());
+        }
+    }
 }
 
 template <class ElemType>
@@ -84,19 +83,14 @@ void MatrixQuantizerCPU<ElemType>::UnquantizeAsync(QuantizedMatrix<ElemType>& in
     assert((outMatrix.GetNumRows() == nRow) && (outMatrix.GetNumCols() == nCol));
 
     const size_t ldNbits = ValueQuantizer<ElemType>::ld(nBits);
-#ifdef QUANTUSEPPL
-    Concurrency::parallel_for((size_t) 0, us.cols(), [&](size_t j)
-#else
-    for (size_t j = 0; j < nCol; j++)
-#endif
-                              {
-                                  const auto& qcol = *(inQMatrix.GetQuantizedColumn(j));
-                                  ColumnQuantizer<ElemType> q(ldNbits, qcol.lower, qcol.upper);
-                                  q.Unquantize(outMatrix.Data(), (long) nRow, j, qcol.bits, add);
-                              }
-#ifdef QUANTUSEPPL
-                              );
-#endif
+    const long long numCols = (long long) nCol;
+#pragma omp parallel for if ((nCol > 1) && (nRow * nCol >= s_parallelQuantizationThreshold))
+    for (long long j = 0; j < numCols; j++)
+    {
+        const auto& qcol = *(inQMatrix.GetQuantizedColumn(j));
+        ColumnQuantizer<ElemType> q(ldNbits, qcol.lower, qcol.upper);
+        q.Unquantize(outMatrix.Data(), (long) nRow, (size_t) j, qcol.bits, add);
+    }
 }
 
 template <class ElemType>
@@ -0,0 +1,460 @@
+//
+// Copyright (c) Microsoft. All rights reserved.
+// Licensed under the MIT license. See LICENSE.md file in the project root for full license information.
+//
+
+#include "stdafx.h"
+#define __STDC_FORMAT_MACROS
+#include <inttypes.h>
+#include "BinaryDataDeserializer.h"
+#include "Basics.h"
+#include "fileutil.h"
+#include "StringUtil.h"
+#include "ElementTypeUtils.h"
+#ifdef _WIN32
+#include <io.h>
+#else
+#include <sys/mman.h>
+#include <unistd.h>
+#endif
+
+namespace Microsoft { namespace MSR { namespace CNTK {
+
+using namespace std;
+
+static const char s_magic[8] = { 'C', 'N', 'T', 'K', 'B', 'i', 'n', 'F' };
+static const uint32_t s_formatVersion = 1;
+
+// Offsets of all blocks inside a file or chunk are padded to a multiple of this.
+static const size_t s_alignment = 8;
+
+static inline size_t Align(size_t offset)
+{
+    return (offset + s_alignment - 1) / s_alignment * s_alignment;
+}
+
+// A read-only memory mapping of a byte range of a file.
+class BinaryDataDeserializer::MappedRegion
+{
+public:
+    MappedRegion(FILE* file, uint64_t offset, uint64_t byteSize, const wstring& filename)
+        : m_base(nullptr), m_mappedSize(0), m_data(nullptr)
+    {
+        // mappings have to start at a multiple of the allocation granularity
+#ifdef _WIN32
+        SYSTEM_INFO systemInfo;
+        GetSystemInfo(&systemInfo);
+        const uint64_t granularity = systemInfo.dwAllocationGranularity;
+#else
+        const uint64_t granularity = (uint64_t) sysconf(_SC_PAGE_SIZE);
+#endif
+        const uint64_t mappedOffset = offset / granularity * granularity;
+        m_mappedSize = (size_t) (offset - mappedOffset + byteSize);
+
+#ifdef _WIN32
+        HANDLE fileHandle = (HANDLE) _get_osfhandle(_fileno(file));
+        const uint64_t mappingEnd = mappedOffset + m_mappedSize;
+        HANDLE mapping = CreateFileMapping(fileHandle, NULL, PAGE_READONLY, (DWORD) (mappingEnd >> 32), (DWORD) mappingEnd, NULL);
+        if (mapping == NULL)
+            RuntimeError("Cannot create a file mapping for '%ls' (error %d).", filename.c_str(), (int) GetLastError());
+        m_base = MapViewOfFile(mapping, FILE_MAP_READ, (DWORD) (mappedOffset >> 32), (DWORD) mappedOffset, m_mappedSize);
+        CloseHandle(mapping); // the view keeps the mapping alive
+        if (m_base == NULL)
+            RuntimeError("Cannot map %" PRIu64 " bytes at offset %" PRIu64 " of '%ls' (error %d).", byteSize, offset, filename.c_str(), (int) GetLastError());
+#else
+        m_base = mmap(nullptr, m_mappedSize, PROT_READ, MAP_SHARED, fileno(file), (off_t) mappedOffset);
+        if (m_base == MAP_FAILED)
+            RuntimeError("Cannot map %" PRIu64 " bytes at offset %" PRIu64 " of '%ls' (errno %d).", byteSize, offset, filename.c_str(), errno);
+        // the data is read front to back, one sequence at a time
+        madvise(m_base, m_mappedSize, MADV_WILLNEED);
+#endif
+        m_data = (const char*) m_base + (offset - mappedOffset);
+    }
+
+    ~MappedRegion()
+    {
+#ifdef _WIN32
+        UnmapViewOfFile(m_base);
+#else
+        munmap(m_base, m_mappedSize);
+#endif
+    }
+
+    const char* Data() const { return m_data; }
+
+private:
+    void* m_base;
+    size_t m_mappedSize;
+    const char* m_data;
+
+    DISABLE_COPY_AND_MOVE(MappedRegion);
+};
+
+// Dense sequence converted to the precision of the exposed stream.
+struct ConvertedDenseSequenceData : DenseSequenceData
+{
+    vector<char> m_buffer;
+};
+
+// Sparse sequence pointing into a mapped chunk, with values converted to the precision of the exposed stream if needed.
+struct BinarySparseSequenceData : SparseSequenceData
+{
+    vector<char> m_buffer;
+};
+
+template <class TargetType, class SourceType>
+static void ConvertValues(const char* source, size_t count, vector<char>& target)
+{
+    target.resize(count * sizeof(TargetType));
+    const SourceType* from = reinterpret_cast<const SourceType*>(source);
+    TargetType* to = reinterpret_cast<TargetType*>(target.data());
+    for (size_t i = 0; i < count; i++)
+        to[i] = (TargetType) from[i];
+}
+
+// Represents a mapped chunk. Given up to the randomizer.
+// Sequences keep a reference to their chunk, because they point into its mapping.
+class BinaryDataDeserializer::BinaryChunk : public Chunk, public std::enable_shared_from_this<BinaryChunk>
+{
+public:
+    BinaryChunk(const BinaryDataDeserializer* parent, ChunkIdType chunkId) : m_parent(parent)
+    {
+        const ChunkInfo& chunk = m_parent->m_chunks[chunkId];
+        m_region = m_parent->Map(chunk.m_offset, chunk.m_byteSize);
+
+        // locate the data of every sequence and stream
+        const size_t numStreams = m_parent->m_fileStreams.size();
+        const size_t valueSize = GetSizeByType(m_parent->m_fileElementType);
+        m_dataOffsets.resize(chunk.m_numberOfSequences * numStreams);
+        size_t offset = Align(m_parent->GetSequenceTableSize(chunk));
+        for (size_t i = 0; i < chunk.m_numberOfSequences; i++)
+        {
+            const uint32_t* counts = GetCounts(i);
+            for (size_t s = 0; s < numStreams; s++)
+            {
+                const StreamInfo& stream = m_parent->m_fileStreams[s];
+                const size_t numSamples = counts[2 * s];
+                const size_t nnzCount = counts[2 * s + 1];
+                m_dataOffsets[i * numStreams + s] = offset;
+                if (stream.m_storageType == StorageType::dense)
+                    offset += numSamples * stream.m_sampleDimension * valueSize;
+                else
+                    offset += nnzCount * (valueSize + sizeof(int32_t)) + numSamples * sizeof(int32_t);
+                offset = Align(offset);
+            }
+        }
+
+        if (offset > chunk.m_byteSize)
+            RuntimeError("Chunk %u of '%ls' is truncated or corrupt (%" PRIu64 " bytes, its sequences need %" PRIu64 ").",
+                         (unsigned int) chunkId, m_parent->m_filename.c_str(), chunk.m_byteSize, (uint64_t) offset);
+    }
+
+    // Gets data for the sequence.
+    virtual void GetSequence(size_t sequenceId, vector<SequenceDataPtr>& result) override
+    {
+        const size_t numStreams = m_parent->m_fileStreams.size();
+        const uint32_t* counts = GetCounts(sequenceId);
+        const bool convert = m_parent->m_fileElementType != m_parent->m_elementType;
+        const size_t valueSize = GetSizeByType(m_parent->m_fileElementType);
+
+        vector<SequenceDataPtr> sequences(m_parent->m_streams.size());
+        for (size_t s = 0; s < numStreams; s++)
+        {
+            const StreamInfo& stream = m_parent->m_fileStreams[s];
+            if (stream.m_exposedIndex == SIZE_MAX)
+                continue;
+
+            const char* data = m_region->Data() + m_dataOffsets[sequenceId * numStreams + s];
+            const uint32_t numSamples = counts[2 * s];
+            const uint32_t nnzCount = counts[2 * s + 1];
+
+            SequenceDataPtr sequence;
+            if (stream.m_storageType == StorageType::dense)
+            {
+                DenseSequenceDataPtr dense;
+                if (!convert)
+                {
+                    dense = make_shared<DenseSequenceData>();
+                    dense->m_data = const_cast<char*>(data);
+                }
+                else
+                {
+                    auto converted = make_shared<ConvertedDenseSequenceData>();
+                    Convert(data, numSamples * stream.m_sampleDimension, converted->m_buffer);
+                    converted->m_data = converted->m_buffer.data();
+                    dense = converted;
+                }
+                dense->m_sampleLayout = m_parent->m_streams[stream.m_exposedIndex]->m_sampleLayout;
+                sequence = dense;
+            }
+            else
+            {
+                auto sparse = make_shared<BinarySparseSequenceData>();
+                if (!convert)
+                {
+                    sparse->m_data = const_cast<char*>(data);
+                }
+                else
+                {
+                    Convert(data, nnzCount, sparse->m_buffer);
+                    sparse->m_data = sparse->m_buffer.data();
+                }
+                const char* indices = data + nnzCount * valueSize;
+                const IndexType* nnzCounts = reinterpret_cast<const IndexType*>(indices + nnzCount * sizeof(IndexType));
+                sparse->m_indices = const_cast<IndexType*>(reinterpret_cast<const IndexType*>(indices));
+                sparse->m_nnzCounts.assign(nnzCounts, nnzCounts + numSamples);
+                sparse->m_totalNnzCount = (IndexType) nnzCount;
+                sequence = sparse;
+            }
+
+            sequence->m_id = sequenceId;
+            sequence->m_numberOfSamples = numSamples;
+            sequence->m_chunk = shared_from_this();
+            sequences[stream.m_exposedIndex] = sequence;
+        }
+        result.insert(result.end(), sequences.begin(), sequences.end());
+    }
+
+private:
+    // Number of samples and nonzero values of each stream of a sequence, from the sequence table.
+    const uint32_t* GetCounts(size_t sequenceId) const
+    {
+        const size_t entrySize = sizeof(uint64_t) + m_parent->m_fileStreams.size() * 2 * sizeof(uint32_t);
+        return reinterpret_cast<const uint32_t*>(m_region->Data() + sequenceId * entrySize + sizeof(uint64_t));
+    }
+
+    void Convert(const char* values, size_t count, vector<char>& target) const
+    {
+        if (m_parent->m_elementType == ElementType::tdouble)
+            ConvertValues<double, float>(values, count, target);
+        else
+            ConvertValues<float, double>(values, count, target);
+    }
+
+    const BinaryDataDeserializer* m_parent;
+    unique_ptr<MappedRegion> m_region;
+    vector<size_t> m_dataOffsets; // [sequence * number of streams + stream] offset of the data in the chunk
+
+    DISABLE_COPY_AND_MOVE(BinaryChunk);
+};
+
+BinaryDataDeserializer::BinaryDataDeserializer(CorpusDescriptorPtr corpus, const ConfigParameters& config, bool primary)
+    : m_file(nullptr), m_corpus(corpus), m_primary(primary)
+{
+    m_filename = msra::strfun::utf16(config(L"file"));
+    m_verbosity = config(L"verbosity", 0);
+
+    string precision = config.Find("precision", "float");
+    if (AreEqualIgnoreCase(precision, "double"))
+        m_elementType = ElementType::tdouble;
+    else if (AreEqualIgnoreCase(precision, "float"))
+        m_elementType = ElementType::tfloat;
+    else
+        RuntimeError("Not supported precision '%s'. Expected 'double' or 'float'.", precision.c_str());
+
+    m_file = fopenOrDie(m_filename, L"rb");
+    ReadHeader();
+    InitializeStreams(config);
+    ReadSequenceTables();
+    m_loadedChunks.resize(m_chunks.size());
+}
+
+BinaryDataDeserializer::~BinaryDataDeserializer()
+{
+    if (m_file)
+        fclose(m_file);
+}
+
+void BinaryDataDeserializer::ReadHeader()
+{
+    char magic[sizeof(s_magic)];
+    freadOrDie(magic, 1, sizeof(magic), m_file);
+    if (memcmp(magic, s_magic, sizeof(s_magic)) != 0)
+        RuntimeError("'%ls' is not a file in the CNTK binary format.", m_filename.c_str());
+
+    uint32_t header[4]; // version, element type, number of streams, number of chunks
+    freadOrDie(header, sizeof(uint32_t), 4, m_file);
+    if (header[0] != s_formatVersion)
+        RuntimeError("'%ls' has an unsupported format version %u (expected %u).", m_filename.c_str(), header[0], s_formatVersion);
+    if (header[1] > 1)
+        RuntimeError("'%ls' has an invalid element type %u.", m_filename.c_str(), header[1]);
+    m_fileElementType = header[1] == 0 ? ElementType::tfloat : ElementType::tdouble;
+
+    size_t headerSize = sizeof(s_magic) + sizeof(header);
+    m_fileStreams.resize(header[2]);
+    for (auto& stream : m_fileStreams)
+    {
+        uint32_t streamHeader[3]; // storage type, sample dimension, name length
+        freadOrDie(streamHeader, sizeof(uint32_t), 3, m_file);
+        if (streamHeader[0] > 1)
+            RuntimeError("'%ls' has an invalid storage type %u.", m_filename.c_str(), streamHeader[0]);
+        stream.m_storageType = streamHeader[0] == 0 ? StorageType::dense : StorageType::sparse_csc;
+        stream.m_sampleDimension = streamHeader[1];
+        stream.m_exposedIndex = SIZE_MAX;
+
+        vector<char> name((streamHeader[2] + 3) / 4 * 4);
+        freadOrDie(name, name.size(), m_file);
+        stream.m_name.assign(name.data(), streamHeader[2]);
+        headerSize += sizeof(streamHeader) + name.size();
+    }
+
+    vector<char> padding(Align(headerSize) - headerSize);
+    freadOrDie(padding, padding.size(), m_file);
+
+    m_chunks.resize(header[3]);
+    static_assert(sizeof(ChunkInfo) == 24, "the chunk table entries are expected to be packed");
+    freadOrDie(m_chunks, m_chunks.size(), m_file);
+}
+
+// Selects and names the exposed streams. Without an "input" section, all streams of the file are exposed with their names,
+// otherwise each entry names a stream, optionally with the name in the file as alias:
+//     input = [ features = [ alias = "x" ] ; labels = [] ]
+void BinaryDataDeserializer::InitializeStreams(const ConfigParameters& config)
+{
+    vector<pair<wstring, string>> exposed; // name, name in the file
+    if (config.ExistsCurrent(L"input"))
+    {
+        const ConfigParameters& input = config(L"input");
+        for (const pair<string, ConfigParameters>& section : input)
+        {
+            string alias = section.second.ExistsCurrent(L"alias") ? (string) section.second(L"alias") : section.first;
+            exposed.push_back(make_pair(msra::strfun::utf16(section.first), alias));
+        }
+    }
+    else
+    {
+        for (const auto& stream : m_fileStreams)
+            exposed.push_back(make_pair(msra::strfun::utf16(stream.m_name), stream.m_name));
+    }
+
+    for (const auto& e : exposed)
+    {
+        auto stream = find_if(m_fileStreams.begin(), m_fileStreams.end(), [&](const StreamInfo& s) { return s.m_name == e.second; });
+        if (stream == m_fileStreams.end())
+            RuntimeError("Input '%ls' refers to stream '%s', which does not exist in '%ls'.", e.first.c_str(), e.second.c_str(), m_filename.c_str());
+        if (stream->m_exposedIndex != SIZE_MAX)
+            RuntimeError("Stream '%s' of '%ls' is mapped to more than one input.", e.second.c_str(), m_filename.c_str());
+
+        auto description = make_shared<StreamDescription>();
+        description->m_id = m_streams.size();
+        description->m_name = e.first;
+        description->m_storageType = stream->m_storageType;
+        description->m_elementType = m_elementType;
+        description->m_sampleLayout = make_shared<TensorShape>(stream->m_sampleDimension);
+        stream->m_exposedIndex = m_streams.size();
+        m_streams.push_back(description);
+    }
+
+    if (m_streams.empty())
+        RuntimeError("No input streams are read from '%ls'.", m_filename.c_str());
+}
+
+// Reads the sequence tables of all chunks. These are small compared to the data, which is only mapped when requested.
+void BinaryDataDeserializer::ReadSequenceTables()
+{
+    const size_t numStreams = m_fileStreams.size();
+    auto& stringRegistry = m_corpus->GetStringRegistry();
+    size_t numSequences = 0;
+    size_t numSamples = 0;
+
+    m_sequences.resize(m_chunks.size());
+    vector<char> table;
+    for (ChunkIdType chunkId = 0; chunkId < m_chunks.size(); chunkId++)
+    {
+        const ChunkInfo& chunk = m_chunks[chunkId];
+        table.resize(GetSequenceTableSize(chunk));
+        if (_fseeki64(m_file, (int64_t) chunk.m_offset, SEEK_SET) != 0)
+            RuntimeError("Error seeking to chunk %u of '%ls'.", (unsigned int) chunkId, m_filename.c_str());
+        freadOrDie(table, table.size(), m_file);
+
+        const size_t entrySize = sizeof(uint64_t) + numStreams * 2 * sizeof(uint32_t);
+        for (uint32_t i = 0; i < chunk.m_numberOfSequences; i++)
+        {
+            const char* entry = table.data() + i * entrySize;
+            const uint64_t sequenceKey = *reinterpret_cast<const uint64_t*>(entry);
+            const uint32_t* counts = reinterpret_cast<const uint32_t*>(entry + sizeof(uint64_t));
+
+            // sequence keys are registered like in the text format, so that both can be combined
+            string key = std::to_string(sequenceKey);
+            if (!m_corpus->IsIncluded(key))
+                continue;
+
+            SequenceDescription description;
+            description.m_id = i;
+            description.m_numberOfSamples = 0;
+            for (size_t s = 0; s < numStreams; s++)
+            {
+                if (m_fileStreams[s].m_exposedIndex != SIZE_MAX)
+                    description.m_numberOfSamples = max(description.m_numberOfSamples, counts[2 * s]);
+            }
+            description.m_chunkId = chunkId;
+            description.m_key.m_sequence = stringRegistry[key];
+            description.m_key.m_sample = 0;
+
+            if (!m_primary)
+                m_keyToChunkLocation[description.m_key.m_sequence] = make_pair(chunkId, m_sequences[chunkId].size());
+            m_sequences[chunkId].push_back(description);
+            numSamples += description.m_numberOfSamples;
+        }
+        numSequences += m_sequences[chunkId].size();
+    }
+
+    if (m_verbosity > 0)
+        fprintf(stderr, "BinaryDataDeserializer: %" PRIu64 " sequences with %" PRIu64 " samples in %" PRIu64 " chunks in '%ls'.\n",
+                numSequences, numSamples, m_chunks.size(), m_filename.c_str());
+}
+
+unique_ptr<BinaryDataDeserializer::MappedRegion> BinaryDataDeserializer::Map(uint64_t offset, uint64_t byteSize) const
+{
+    return unique_ptr<MappedRegion>(new MappedRegion(m_file, offset, byteSize, m_filename));
+}
+
+ChunkDescriptions BinaryDataDeserializer::GetChunkDescriptions()
+{
+    ChunkDescriptions result;
+    result.reserve(m_chunks.size());
+    for (ChunkIdType chunkId = 0; chunkId < m_chunks.size(); chunkId++)
+    {
+        size_t numSamples = 0;
+        for (const auto& sequence : m_sequences[chunkId])
+            numSamples += sequence.m_numberOfSamples;
+
+        auto chunk = make_shared<ChunkDescription>();
+        chunk->m_id = chunkId;
+        chunk->m_numberOfSamples = numSamples;
+        chunk->m_numberOfSequences = m_sequences[chunkId].size();
+        result.push_back(chunk);
+    }
+    return result;
+}
+
+void BinaryDataDeserializer::GetSequencesForChunk(ChunkIdType chunkId, vector<SequenceDescription>& result)
+{
+    const auto& sequences = m_sequences[chunkId];
+    result.insert(result.end(), sequences.begin(), sequences.end());
+}
+
+bool BinaryDataDeserializer::GetSequenceDescriptionByKey(const KeyType& key, SequenceDescription& result)
+{
+    auto location = m_keyToChunkLocation.find(key.m_sequence);
+    if (location == m_keyToChunkLocation.end())
+        return false;
+
+    result = m_sequences[location->second.first][location->second.second];
+    return true;
+}
+
+// Gets a data chunk with the specified chunk id.
+// Sequences of a released chunk can still be alive (i.e. waiting to be packed), in this case the mapping is reused.
+ChunkPtr BinaryDataDeserializer::GetChunk(ChunkIdType chunkId)
+{
+    auto chunk = m_loadedChunks[chunkId].lock();
+    if (!chunk)
+    {
+        chunk = make_shared<BinaryChunk>(this, chunkId);
+        m_loadedChunks[chunkId] = chunk;
+    }
+    return chunk;
+}
+
+}}}
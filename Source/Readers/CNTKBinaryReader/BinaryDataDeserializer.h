@@ -0,0 +1,125 @@
+//
+// Copyright (c) Microsoft. All rights reserved.
+// Licensed under the MIT license. See LICENSE.md file in the project root for full license information.
+//
+
+#pragma once
+
+#include "DataDeserializerBase.h"
+#include "Config.h"
+#include "CorpusDescriptor.h"
+
+namespace Microsoft { namespace MSR { namespace CNTK {
+
+// Deserializer for the chunked CNTK binary format, as produced from the CNTK text format by Scripts/ctf2bin.py.
+//
+// All values are little-endian. The file starts with a fixed header:
+//   char[8]  magic "CNTKBinF"
+//   uint32   format version (1)
+//   uint32   element type of all values (0 = float, 1 = double)
+//   uint32   number of streams
+//   uint32   number of chunks
+//   per stream:
+//     uint32 storage type (0 = dense, 1 = sparse CSC)
+//     uint32 sample dimension
+//     uint32 name length, followed by the name (ASCII), padded with zeros to a multiple of 4 bytes
+//   padding with zeros to a multiple of 8 bytes
+//   per chunk (the chunk table):
+//     uint64 offset of the chunk in the file (a multiple of 8)
+//     uint64 size of the chunk in bytes
+//     uint32 number of sequences
+//     uint32 number of samples (the sum of the sequence lengths)
+//
+// A chunk starts with its sequence table:
+//   per sequence: uint64 sequence key, then per stream: uint32 number of samples, uint32 number of nonzero values (0 for dense)
+// followed by the data of each sequence and stream, in this order, each starting at a multiple of 8 bytes from the chunk start:
+//   dense:  values[number of samples * sample dimension]
+//   sparse: values[nnz], int32 row indices[nnz], int32 number of nonzero values per sample[number of samples]
+// The length of a sequence is the largest number of samples among its streams.
+//
+// Chunks are memory-mapped when the randomizer requests them, and unmapped when their last sequence is released.
+// Dense sequences and the indices of sparse sequences point directly into the mapped file, so that the packer copies
+// them straight from the page cache, unless the values have to be converted to a different precision.
+class BinaryDataDeserializer : public DataDeserializerBase
+{
+public:
+    BinaryDataDeserializer(CorpusDescriptorPtr corpus, const ConfigParameters& config, bool primary);
+    ~BinaryDataDeserializer();
+
+    // Get information about chunks.
+    virtual ChunkDescriptions GetChunkDescriptions() override;
+
+    // Get information about particular chunk.
+    virtual void GetSequencesForChunk(ChunkIdType chunkId, std::vector<SequenceDescription>& result) override;
+
+    // Retrieves data for a chunk.
+    virtual ChunkPtr GetChunk(ChunkIdType chunkId) override;
+
+    // Gets sequence description by its key.
+    virtual bool GetSequenceDescriptionByKey(const KeyType&, SequenceDescription&) override;
+
+    virtual std::vector<std::wstring> GetInputFiles() const override
+    {
+        return std::vector<std::wstring>{ m_filename };
+    }
+
+private:
+    class MappedRegion;
+    class BinaryChunk;
+
+    // An entry of the chunk table.
+    struct ChunkInfo
+    {
+        uint64_t m_offset;
+        uint64_t m_byteSize;
+        uint32_t m_numberOfSequences;
+        uint32_t m_numberOfSamples;
+    };
+
+    // A stream as stored in the file.
+    struct StreamInfo
+    {
+        std::string m_name;
+        StorageType m_storageType;
+        size_t m_sampleDimension;
+        size_t m_exposedIndex; // index in m_streams, SIZE_MAX if the stream is not used
+    };
+
+    void ReadHeader();
+    void InitializeStreams(const ConfigParameters& config);
+    void ReadSequenceTables();
+
+    // Maps the given byte range of the file.
+    std::unique_ptr<MappedRegion> Map(uint64_t offset, uint64_t byteSize) const;
+
+    // Size of the sequence table at the start of every chunk.
+    size_t GetSequenceTableSize(const ChunkInfo& chunk) const
+    {
+        return chunk.m_numberOfSequences * (sizeof(uint64_t) + m_fileStreams.size() * 2 * sizeof(uint32_t));
+    }
+
+    std::wstring m_filename;
+    FILE* m_file;
+    ElementType m_fileElementType; // element type of the values in the file
+    ElementType m_elementType;     // element type of the exposed streams
+    std::vector<StreamInfo> m_fileStreams;
+    std::vector<ChunkInfo> m_chunks;
+
+    // Descriptions of the sequences included in the corpus, per chunk; m_id is the index in the sequence table of the chunk.
+    std::vector<std::vector<SequenceDescription>> m_sequences;
+
+    CorpusDescriptorPtr m_corpus;
+    bool m_primary;
+    int m_verbosity;
+
+    // Chunks that are currently mapped, indexed by chunk id.
+    std::vector<std::weak_ptr<BinaryChunk>> m_loadedChunks;
+
+    // Used to correlate a sequence key with the sequence inside the chunk when deserializer is running not in primary mode.
+    // Key -> <chunkid, index in m_sequences[chunkid]>
+    std::map<size_t, std::pair<ChunkIdType, size_t>> m_keyToChunkLocation;
+
+    DISABLE_COPY_AND_MOVE(BinaryDataDeserializer);
+};
+
+}}}
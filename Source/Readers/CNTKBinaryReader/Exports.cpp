@@ -0,0 +1,33 @@
+//
+// Copyright (c) Microsoft. All rights reserved.
+// Licensed under the MIT license. See LICENSE.md file in the project root for full license information.
+//
+// Exports.cpp : Defines the exported functions for the DLL application.
+//
+
+#include "stdafx.h"
+#define DATAREADER_EXPORTS
+#include "DataReader.h"
+#include "BinaryDataDeserializer.h"
+
+namespace Microsoft { namespace MSR { namespace CNTK {
+
+// TODO: Not safe from the ABI perspective. Will be uglified to make the interface ABI.
+// A factory method for creating binary deserializers.
+extern "C" DATAREADER_API bool CreateDeserializer(IDataDeserializer** deserializer, const std::wstring& type, const ConfigParameters& deserializerConfig, CorpusDescriptorPtr corpus, bool primary)
+{
+    if (type == L"CNTKBinaryFormatDeserializer")
+    {
+        *deserializer = new BinaryDataDeserializer(corpus, deserializerConfig, primary);
+    }
+    else
+    {
+        // Unknown type.
+        return false;
+    }
+
+    // Deserializer created.
+    return true;
+}
+
+}}}
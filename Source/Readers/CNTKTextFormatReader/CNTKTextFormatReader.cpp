@@ -13,6 +13,7 @@
 #include "TextParser.h"
 #include "SequencePacker.h"
 #include "FramePacker.h"
+#include "ConfigUtil.h"
 
 namespace Microsoft { namespace MSR { namespace CNTK {
 
@@ -41,11 +42,11 @@ CNTKTextFormatReader::CNTKTextFormatReader(MemoryProviderPtr provider,
             m_deserializer = shared_ptr<IDataDeserializer>(new ChunkCache(m_deserializer));
         }
 
+        // Verbosity is a general config parameter, not specific to the text format reader.
+        int verbosity = config(L"verbosity", 0);
         size_t window = configHelper.GetRandomizationWindow();
         if (window > 0)
         {
-            // Verbosity is a general config parameter, not specific to the text format reader.
-            int verbosity = config(L"verbosity", 0);
             m_randomizer = make_shared<BlockRandomizer>(verbosity, window, m_deserializer);
         }
         else
@@ -53,19 +54,25 @@ CNTKTextFormatReader::CNTKTextFormatReader(MemoryProviderPtr provider,
             m_randomizer = std::make_shared<NoRandomizer>(m_deserializer);
         }
 
+        // The packer needs a separate set of buffers for each minibatch prefetched or held by the shim.
+        size_t numberOfBuffers = GetNumberOfPackerBuffers(config);
         if (configHelper.IsInFrameMode()) 
         {
             m_packer = std::make_shared<FramePacker>(
                 m_provider,
                 m_randomizer,
-                GetStreamDescriptions());
+                GetStreamDescriptions(),
+                numberOfBuffers,
+                verbosity);
         }
         else
         {
         m_packer = std::make_shared<SequencePacker>(
             m_provider,
             m_randomizer,
-            GetStreamDescriptions());
+            GetStreamDescriptions(),
+            numberOfBuffers,
+            verbosity);
         }
     }
     catch (const std::runtime_error& e)
@@ -1208,7 +1208,7 @@ bool TextParser<ElemType>::GetSequenceDescriptionByKey(const KeyType& key, Seque
 }
 
 template <class ElemType>
-const string& TextParser<ElemType>::GetSequenceKey(const SequenceDescriptor& s) const
+string TextParser<ElemType>::GetSequenceKey(const SequenceDescriptor& s) const
 {
     return m_corpus->GetStringRegistry()[s.m_key.m_sequence];
 }
@@ -18,6 +18,7 @@
 #include "FramePacker.h"
 #include "SequencePacker.h"
 #include "TruncatedBpttPacker.h"
+#include "SequenceBucketizer.h"
 #include "CorpusDescriptor.h"
 #include "ConfigUtil.h"
 #include "StringUtil.h"
@@ -67,6 +68,9 @@ CompositeDataReader::CompositeDataReader(const ConfigParameters& config, MemoryP
 
     m_precision = config("precision", "float");
 
+    // The packer needs a separate set of buffers for each minibatch prefetched or held by the shim.
+    m_numberOfPackerBuffers = GetNumberOfPackerBuffers(config);
+
     // Creating deserializers.
     // TODO: Currently the primary deserializer defines the corpus. The logic will be moved to CorpusDescriptor class.
     CreateDeserializers(config);
@@ -86,6 +90,7 @@ CompositeDataReader::CompositeDataReader(const ConfigParameters& config, MemoryP
     }
 
     int verbosity = config(L"verbosity", 0);
+    m_verbosity = verbosity;
 
     // Pick up the randomizer, always picking up no randomization for the write mode.
     bool randomize = isActionWrite ? false : config(L"randomize", false);
@@ -112,6 +117,20 @@ CompositeDataReader::CompositeDataReader(const ConfigParameters& config, MemoryP
         ? m_sequenceEnumerator 
         : std::make_shared<TransformController>(m_transforms, m_sequenceEnumerator);
 
+    // Optionally grouping sequences of similar length into the same minibatch to reduce padding.
+    size_t numberOfBuckets = config(L"numberOfBuckets", (size_t)1);
+    if (numberOfBuckets > 1)
+    {
+        if (m_packingMode != PackingMode::sequence)
+        {
+            InvalidArgument("Bucketing of sequences by length is only supported in sequence mode.");
+        }
+
+        // By default the bucketing window is 10 minibatches per bucket.
+        size_t bucketingWindow = config(L"bucketingWindow", numberOfBuckets * 10);
+        m_sequenceEnumerator = std::make_shared<SequenceBucketizer>(numberOfBuckets, bucketingWindow, m_sequenceEnumerator);
+    }
+
     // Create output stream descriptions - where to get those? from config? what if it is not the same as network expects?
     // TODO: Currently only dense output streams.
     // TODO: Check here. We should already support repacking sparse into dense in the shim/matrix.
@@ -263,13 +282,17 @@ void CompositeDataReader::StartEpoch(const EpochConfiguration& cfg)
         m_packer = std::make_shared<FramePacker>(
             m_provider,
             m_sequenceEnumerator,
-            m_streams);
+            m_streams,
+            m_numberOfPackerBuffers,
+            m_verbosity);
         break;
     case PackingMode::sequence:
         m_packer = std::make_shared<SequencePacker>(
             m_provider,
             m_sequenceEnumerator,
-            m_streams);
+            m_streams,
+            m_numberOfPackerBuffers,
+            m_verbosity);
         break;
     case PackingMode::truncated:
     {
@@ -277,7 +300,8 @@ void CompositeDataReader::StartEpoch(const EpochConfiguration& cfg)
         m_packer = std::make_shared<TruncatedBPTTPacker>(
             m_provider,
             m_sequenceEnumerator,
-            m_streams);
+            m_streams,
+            m_numberOfPackerBuffers);
         break;
     }
     default:
@@ -45,6 +45,7 @@ struct Minibatch;
 //     - deserializers provide sequences according to the corpus descriptor
 //     - sequences can be transformed by the transformers applied on top of deserializer
 //     - deserializers are bound together using the bundler - it bundles sequences with the same sequence id retrieved from different deserializers
+//     - optionally, sequences of similar length can be grouped into the same minibatch by the bucketizer
 //     - packer is used to pack randomized sequences into the minibatch
 // The composite reader is currently also responsible for asynchronous prefetching of the minibatch data.
 
@@ -127,6 +128,12 @@ private:
 
     // Truncation length for BPTT mode.
     size_t m_truncationLength;
+
+    // Number of buffer sets in the packer, depends on the prefetch depth of the shim.
+    size_t m_numberOfPackerBuffers;
+
+    // General verbosity of the reader.
+    int m_verbosity;
 };
 
 }}}
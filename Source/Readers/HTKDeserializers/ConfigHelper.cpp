@@ -217,6 +217,11 @@ wstring ConfigHelper::GetRandomizer()
     return randomizer;
 }
 
+wstring ConfigHelper::GetScpFilePath() const
+{
+    return m_config(L"scpFile");
+}
+
 vector<wstring> ConfigHelper::GetSequencePaths()
 {
     wstring scriptPath = m_config(L"scpFile");
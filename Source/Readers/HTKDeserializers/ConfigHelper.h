@@ -52,6 +52,9 @@ public:
     // Gets utterance paths from the configuration.
     std::vector<std::wstring> GetSequencePaths();
 
+    // Gets the path of the script file with utterance paths.
+    std::wstring GetScpFilePath() const;
+
     // Gets randomization window.
     size_t GetRandomizationWindow();
 
@@ -101,6 +101,13 @@ void HTKDataDeserializer::InitializeAugmentationWindow(ConfigHelper& config)
     {
         m_augmentationWindow.first = m_augmentationWindow.second = msra::dbn::augmentationextent(m_ioFeatureDimension, m_dimension);
     }
+
+    // Samples are spliced from the frames at pack time, the context window has to fit into the sample.
+    if (m_ioFeatureDimension * (1 + m_augmentationWindow.first + m_augmentationWindow.second) > m_dimension)
+    {
+        InvalidArgument("HTKDataDeserializer: context window of %d frames of dimension %d exceeds the feature dimension %d.",
+            (int)(1 + m_augmentationWindow.first + m_augmentationWindow.second), (int)m_ioFeatureDimension, (int)m_dimension);
+    }
 }
 
 // Initializes chunks based on the configuration and utterance descriptions.
@@ -108,9 +115,11 @@ void HTKDataDeserializer::InitializeChunkDescriptions(ConfigHelper& config)
 {
     // Read utterance descriptions.
     vector<wstring> paths = config.GetSequencePaths();
+    m_inputFiles.push_back(config.GetScpFilePath());
     vector<UtteranceDescription> utterances;
     utterances.reserve(paths.size());
     auto& stringRegistry = m_corpus->GetStringRegistry();
+    stringRegistry.Reserve(stringRegistry.Size() + paths.size(), 0);
     size_t allUtterances = 0, allFrames = 0;
 
     for (const auto& u : paths)
@@ -172,6 +181,8 @@ void HTKDataDeserializer::InitializeChunkDescriptions(ConfigHelper& config)
         currentChunk.Add(move(utterances[i]));
     }
 
+    m_loadedChunks.resize(m_chunks.size());
+
     fprintf(stderr,
         "HTKDataDeserializer::HTKDataDeserializer: "
         "selected %" PRIu64 " utterances grouped into %" PRIu64 " chunks, "
@@ -280,35 +291,10 @@ void HTKDataDeserializer::GetSequencesForChunk(ChunkIdType chunkId, vector<Seque
     }
 }
 
-// A wrapper around a matrix that views it as a vector of column vectors.
-// Does not have any memory associated.
-class MatrixAsVectorOfVectors
-{
-public:
-    MatrixAsVectorOfVectors(msra::dbn::matrixbase& m)
-        : m_matrix(m)
-    {
-    }
-
-    size_t size() const
-    {
-        return m_matrix.cols();
-    }
-
-    const_array_ref<float> operator[](size_t j) const
-    {
-        return array_ref<float>(&m_matrix(0, j), m_matrix.rows());
-    }
-
-private:
-    DISABLE_COPY_AND_MOVE(MatrixAsVectorOfVectors);
-    msra::dbn::matrixbase& m_matrix;
-};
-
-
 // Represents a chunk data in memory. Given up to the randomizer.
 // It is up to the randomizer to decide when to release a particular chunk.
-class HTKDataDeserializer::HTKChunk : public Chunk
+// Sequences keep a reference to their chunk, because they reference its frames.
+class HTKDataDeserializer::HTKChunk : public Chunk, public std::enable_shared_from_this<HTKChunk>
 {
 public:
     HTKChunk(HTKDataDeserializer* parent, ChunkIdType chunkId) : m_parent(parent), m_chunkId(chunkId)
@@ -327,6 +313,7 @@ public:
     virtual void GetSequence(size_t sequenceId, vector<SequenceDataPtr>& result) override
     {
         m_parent->GetSequenceById(m_chunkId, sequenceId, result);
+        result.back()->m_chunk = shared_from_this();
     }
 
     // Unloads the data from memory.
@@ -343,121 +330,96 @@ private:
 };
 
 // Gets a data chunk with the specified chunk id.
+// Sequences of a released chunk can still be alive (i.e. waiting to be packed), in this case the chunk is reused.
 ChunkPtr HTKDataDeserializer::GetChunk(ChunkIdType chunkId)
 {
-    return make_shared<HTKChunk>(this, chunkId);
-};
-
-// A matrix that stores all samples of a sequence without padding (differently from ssematrix).
-// The number of columns equals the number of samples in the sequence.
-// The number of rows equals the size of the feature vector of a sample (= dimensions).
-class FeatureMatrix
-{
-public:
-    FeatureMatrix(size_t numRows, size_t numColumns) : m_numRows(numRows), m_numColumns(numColumns)
-    {
-        m_data.resize(m_numRows * m_numColumns);
-    }
-
-    // Returns a reference to the column.
-    inline array_ref<float> col(size_t column)
-    {
-        return array_ref<float>(m_data.data() + m_numRows * column, m_numRows);
-    }
-
-    // Gets pointer to the data.
-    inline float* GetData()
-    {
-        return m_data.data();
-    }
-
-    // Gets the number of columns. It equals the number of samples in the sequence/utterance.
-    inline size_t GetNumberOfColumns() const
-    {
-        return m_numColumns;
-    }
-
-    // Gets total size in elements of stored features.
-    inline size_t GetTotalSize() const
+    auto chunk = m_loadedChunks[chunkId].lock();
+    if (!chunk)
     {
-        return m_data.size();
+        chunk = make_shared<HTKChunk>(this, chunkId);
+        m_loadedChunks[chunkId] = chunk;
     }
-
-private:
-    // Features
-    std::vector<float> m_data;
-    // Number of rows = dimension of the feature
-    size_t m_numRows;
-    // Number of columns = number of samples in utterance.
-    size_t m_numColumns;
+    return chunk;
 };
 
-// This class stores sequence data for HTK for floats.
-struct HTKFloatSequenceData : DenseSequenceData
+// Sequence data of HTK features that references the frames of the utterance in the chunk.
+// The context window of a sample is spliced only when the packer copies the sample, so neither the chunk
+// nor the retrieved sequences store the augmented features and memory does not depend on the context size.
+// The sequence keeps its chunk (and so the frames) alive through m_chunk.
+template <class ElemType>
+class HTKSplicedSequenceData : public DenseSequenceData
 {
-    HTKFloatSequenceData(FeatureMatrix&& data) : m_buffer(data)
+public:
+    HTKSplicedSequenceData(
+        const float* frames,
+        size_t columnStride,
+        size_t featureDimension,
+        size_t numberOfFrames,
+        size_t firstFrame,
+        size_t numberOfSamples,
+        const std::pair<size_t, size_t>& augmentationWindow)
+        : m_frames(frames),
+          m_columnStride(columnStride),
+          m_featureDimension(featureDimension),
+          m_numberOfFrames(numberOfFrames),
+          m_firstFrame(firstFrame),
+          m_augmentationWindow(augmentationWindow)
     {
-        m_numberOfSamples = (uint32_t)data.GetNumberOfColumns();
-        if (m_numberOfSamples != data.GetNumberOfColumns())
+        m_numberOfSamples = (uint32_t)numberOfSamples;
+        if (m_numberOfSamples != numberOfSamples)
         {
             RuntimeError("Maximum number of samples per sequence exceeded.");
         }
-        m_data = m_buffer.GetData();
     }
 
-private:
-    FeatureMatrix m_buffer;
-};
-
-// This class stores sequence data for HTK for doubles.
-struct HTKDoubleSequenceData : DenseSequenceData
-{
-    HTKDoubleSequenceData(FeatureMatrix& data) : m_buffer(data.GetData(), data.GetData() + data.GetTotalSize())
+    // Augments the frame of the sample with frames to the left and right of it.
+    // Frames outside of the utterance are replaced with the first/last frame of the utterance.
+    virtual void CopySample(size_t sampleIndex, char* destination, size_t sampleSize) const override
     {
-        m_numberOfSamples = (uint32_t)data.GetNumberOfColumns();
-        if (m_numberOfSamples != data.GetNumberOfColumns())
+        assert(sampleIndex < m_numberOfSamples);
+        const size_t frameIndex = m_firstFrame + sampleIndex;
+        const size_t windowSize = 1 + m_augmentationWindow.first + m_augmentationWindow.second;
+        const size_t splicedSize = windowSize * m_featureDimension * sizeof(ElemType);
+        assert(splicedSize <= sampleSize);
+
+        ElemType* target = reinterpret_cast<ElemType*>(destination);
+        for (size_t n = 0; n < windowSize; ++n)
         {
-            RuntimeError("Maximum number of samples per sequence exceeded.");
+            // index does not move beyond boundary
+            size_t currentFrame = frameIndex + n < m_augmentationWindow.first ? 0 : frameIndex + n - m_augmentationWindow.first;
+            currentFrame = std::min(currentFrame, m_numberOfFrames - 1);
+            CopyFrame(m_frames + currentFrame * m_columnStride, target + n * m_featureDimension);
+        }
+
+        // The rest of a sample that is larger than the context window is zero.
+        if (splicedSize < sampleSize)
+        {
+            memset(destination + splicedSize, 0, sampleSize - splicedSize);
         }
-        m_data = m_buffer.data();
     }
 
 private:
-    std::vector<double> m_buffer;
-};
-
-// Copies a source into a destination with the specified destination offset.
-static void CopyToOffset(const const_array_ref<float>& source, array_ref<float>& destination, size_t offset)
-{
-    size_t sourceSize = source.size() * sizeof(float);
-    memcpy_s((char*)destination.begin() + sourceSize * offset, sourceSize, &source.front(), sourceSize);
-}
-
-// TODO: Move augmentation to the separate class outside of deserializer.
-// TODO: Check the CNTK Book why different left and right extents are not supported.
-// Augments a frame with a given index with frames to the left and right of it.
-static void AugmentNeighbors(const MatrixAsVectorOfVectors& utterance,
-                             size_t frameIndex,
-                             const size_t leftExtent,
-                             const size_t rightExtent,
-                             array_ref<float>& destination)
-{
-    CopyToOffset(utterance[frameIndex], destination, leftExtent);
-
-    for (size_t currentFrame = frameIndex, n = 1; n <= leftExtent; n++)
+    void CopyFrame(const float* source, float* target) const
     {
-        if (currentFrame > 0)
-            currentFrame--; // index does not move beyond boundary
-        CopyToOffset(utterance[currentFrame], destination, leftExtent - n);
+        memcpy(target, source, m_featureDimension * sizeof(float));
     }
 
-    for (size_t currentFrame = frameIndex, n = 1; n <= rightExtent; n++)
+    void CopyFrame(const float* source, double* target) const
     {
-        if (currentFrame + 1 < utterance.size())
-            currentFrame++; // index does not move beyond boundary
-        CopyToOffset(utterance[currentFrame], destination, leftExtent + n);
+        std::copy(source, source + m_featureDimension, target);
     }
-}
+
+    // First column of the utterance frames (owned by the chunk).
+    const float* m_frames;
+    size_t m_columnStride;
+    size_t m_featureDimension;
+    size_t m_numberOfFrames;
+
+    // Frame of the utterance that corresponds to the first sample of the sequence.
+    size_t m_firstFrame;
+
+    std::pair<size_t, size_t> m_augmentationWindow;
+};
 
 // Get a sequence by its chunk id and sequence id.
 // Sequence ids are guaranteed to be unique inside a chunk.
@@ -468,36 +430,20 @@ void HTKDataDeserializer::GetSequenceById(ChunkIdType chunkId, size_t id, vector
     const UtteranceDescription* utterance = chunkDescription.GetUtterance(utteranceIndex);
     auto utteranceFrames = chunkDescription.GetUtteranceFrames(utteranceIndex);
 
-    // wrapper that allows m[j].size() and m[j][i] as required by augmentneighbors()
-    MatrixAsVectorOfVectors utteranceFramesWrapper(utteranceFrames);
-    FeatureMatrix features(m_dimension, m_frameMode ? 1 : utterance->GetNumberOfFrames());
-
-    if (m_frameMode)
-    {
-        // For frame mode augment a single frame.
-        size_t frameIndex = id - chunkDescription.GetStartFrameIndexInsideChunk(utteranceIndex);
-        auto fillIn = features.col(0);
-        AugmentNeighbors(utteranceFramesWrapper, frameIndex, m_augmentationWindow.first, m_augmentationWindow.second, fillIn);
-    }
-    else
-    {
-        // Augment complete utterance.
-        for (size_t frameIndex = 0; frameIndex < utterance->GetNumberOfFrames(); ++frameIndex)
-        {
-            auto fillIn = features.col(frameIndex);
-            AugmentNeighbors(utteranceFramesWrapper, frameIndex, m_augmentationWindow.first, m_augmentationWindow.second, fillIn);
-        }
-    }
+    // For frame mode a single frame is exposed, still augmented with the frames of the complete utterance.
+    size_t firstFrame = m_frameMode ? id - chunkDescription.GetStartFrameIndexInsideChunk(utteranceIndex) : 0;
+    size_t numberOfSamples = m_frameMode ? 1 : utterance->GetNumberOfFrames();
 
-    // Copy features to the sequence depending on the type.
     DenseSequenceDataPtr result;
     if (m_elementType == ElementType::tdouble)
     {
-        result = make_shared<HTKDoubleSequenceData>(features);
+        result = make_shared<HTKSplicedSequenceData<double>>(&utteranceFrames(0, 0), utteranceFrames.getcolstride(), utteranceFrames.rows(),
+                                                             utteranceFrames.cols(), firstFrame, numberOfSamples, m_augmentationWindow);
     }
     else if (m_elementType == ElementType::tfloat)
     {
-        result = make_shared<HTKFloatSequenceData>(std::move(features));
+        result = make_shared<HTKSplicedSequenceData<float>>(&utteranceFrames(0, 0), utteranceFrames.getcolstride(), utteranceFrames.rows(),
+                                                            utteranceFrames.cols(), firstFrame, numberOfSamples, m_augmentationWindow);
     }
     else
     {
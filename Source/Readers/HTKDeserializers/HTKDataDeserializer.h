@@ -37,6 +37,12 @@ public:
     // Gets sequence description by its key.
     virtual bool GetSequenceDescriptionByKey(const KeyType&, SequenceDescription&) override;
 
+    // Gets the script file the utterances are read from.
+    virtual std::vector<std::wstring> GetInputFiles() const override
+    {
+        return m_inputFiles;
+    }
+
 private:
     class HTKChunk;
     DISABLE_COPY_AND_MOVE(HTKDataDeserializer);
@@ -59,6 +65,12 @@ private:
     // Chunk descriptions.
     std::vector<HTKChunkDescription> m_chunks;
 
+    // Files the chunk descriptions are built from.
+    std::vector<std::wstring> m_inputFiles;
+
+    // Chunks that are currently in memory, indexed by chunk id.
+    std::vector<std::weak_ptr<HTKChunk>> m_loadedChunks;
+
     // Augmentation window.
     std::pair<size_t, size_t> m_augmentationWindow;
 
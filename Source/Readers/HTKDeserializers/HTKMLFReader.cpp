@@ -16,6 +16,7 @@
 #include "TruncatedBpttPacker.h"
 #include "BlockRandomizer.h"
 #include "NoRandomizer.h"
+#include "ConfigUtil.h"
 
 namespace Microsoft { namespace MSR { namespace CNTK {
 
@@ -144,16 +145,17 @@ HTKMLFReader::HTKMLFReader(MemoryProviderPtr provider,
     // TODO: As the next step the packers will be moved out of the readers into the
     // TODO: core CNTK. They are format agnostic and can be used with any type of 
     // TODO: deserializers.
+    size_t numberOfBuffers = GetNumberOfPackerBuffers(readerConfig);
     switch (m_packingMode)
     {
     case PackingMode::sample:
-        m_packer = std::make_shared<FramePacker>(m_provider, m_randomizer, m_streams);
+        m_packer = std::make_shared<FramePacker>(m_provider, m_randomizer, m_streams, numberOfBuffers, verbosity);
         break;
     case PackingMode::sequence:
-        m_packer = std::make_shared<SequencePacker>(m_provider, m_randomizer, m_streams);
+        m_packer = std::make_shared<SequencePacker>(m_provider, m_randomizer, m_streams, numberOfBuffers, verbosity);
         break;
     case PackingMode::truncated:
-        m_packer = std::make_shared<TruncatedBPTTPacker>(m_provider, m_randomizer, m_streams);
+        m_packer = std::make_shared<TruncatedBPTTPacker>(m_provider, m_randomizer, m_streams, numberOfBuffers);
         break;
     default:
         LogicError("Unsupported type of packer '%d'.", (int)m_packingMode);
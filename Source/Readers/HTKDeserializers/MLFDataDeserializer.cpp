@@ -106,6 +106,11 @@ void MLFDataDeserializer::InitializeChunkDescriptions(CorpusDescriptorPtr corpus
     const msra::lm::CSymbolSet* wordTable = nullptr;
     unordered_map<const char*, int>* symbolTable = nullptr;
     vector<wstring> mlfPaths = config.GetMlfPaths();
+    m_inputFiles = mlfPaths;
+    if (!stateListPath.empty())
+    {
+        m_inputFiles.push_back(stateListPath);
+    }
 
     // TODO: Currently we still use the old IO module. This will be refactored later.
     const double htkTimeToFrame = 100000.0; // default is 10ms
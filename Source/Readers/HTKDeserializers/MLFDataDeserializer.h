@@ -37,6 +37,12 @@ public:
     // TODO: After we switch the timeline to work in chunks, we will also introduce chunking of labels.
     virtual ChunkPtr GetChunk(ChunkIdType) override;
 
+    // Gets the MLF and state list files the labels are read from.
+    virtual std::vector<std::wstring> GetInputFiles() const override
+    {
+        return m_inputFiles;
+    }
+
 private:
     class MLFChunk;
     DISABLE_COPY_AND_MOVE(MLFDataDeserializer);
@@ -54,6 +60,9 @@ private:
     // Number of sequences
     size_t m_numberOfSequences = 0;
 
+    // Files the labels are read from.
+    std::vector<std::wstring> m_inputFiles;
+
     // Array of all labels.
     msra::dbn::biggrowablevector<msra::dbn::CLASSIDTYPE> m_classIds;
 
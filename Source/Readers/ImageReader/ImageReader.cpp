@@ -12,6 +12,7 @@
 #include "NoRandomizer.h"
 #include "ImageDataDeserializer.h"
 #include "FramePacker.h"
+#include "ConfigUtil.h"
 #include <omp.h>
 #include "TransformController.h"
 
@@ -76,7 +77,8 @@ ImageReader::ImageReader(MemoryProviderPtr provider,
     m_packer = std::make_shared<FramePacker>(
         m_provider,
         m_sequenceEnumerator,
-        m_streams);
+        m_streams,
+        GetNumberOfPackerBuffers(config));
 }
 
 std::vector<StreamDescriptionPtr> ImageReader::GetStreamDescriptions()
@@ -8,9 +8,60 @@
 #define __STDC_FORMAT_MACROS
 #include <inttypes.h>
 #include <set>
+#include <future>
+#include <atomic>
+#include <functional>
+#include <thread>
+#include <random>
+#include <sys/stat.h>
+#include "fileutil.h"
 
 namespace Microsoft { namespace MSR { namespace CNTK {
 
+// Version of the format of the cache of cleansed chunks.
+static const uint32_t s_cacheVersion = 2;
+
+// Runs the task with indices [0, numberOfTasks) concurrently, task 0 on the calling thread.
+// Waits for all tasks to finish before an error of any of them is reported.
+static void RunConcurrently(size_t numberOfTasks, const std::function<void(size_t)>& task)
+{
+    std::vector<std::future<void>> others;
+    for (size_t taskIndex = 1; taskIndex < numberOfTasks; ++taskIndex)
+    {
+        others.push_back(std::async(std::launch::async, task, taskIndex));
+    }
+
+    std::exception_ptr error;
+    try
+    {
+        task(0);
+    }
+    catch (...)
+    {
+        error = std::current_exception();
+    }
+
+    for (auto& other : others)
+    {
+        try
+        {
+            other.get();
+        }
+        catch (...)
+        {
+            if (!error)
+            {
+                error = std::current_exception();
+            }
+        }
+    }
+
+    if (error)
+    {
+        std::rethrow_exception(error);
+    }
+}
+
 // Represents bundled chunk description with possible cleansed data.
 struct Bundler::BundlerChunkDescription : public ChunkDescription
 {
@@ -41,6 +92,7 @@ Bundler::Bundler(
     }
 
     m_cleanse = cleanse;
+    m_cacheFile = static_cast<std::wstring>(readerConfig(L"checkDataCache", L""));
     CreateChunkDescriptions();
 }
 
@@ -66,8 +118,10 @@ void Bundler::CreateChunkDescriptions()
         fprintf(stderr, "Bundler::CreateChunkDescriptions(): creating descriptions for %" PRIu64 " chunks\n", m_chunks.size());
 
     // If there is not cleaning required simply build chunks based on the chunk descriptions of the primary deserializer.
+    // The keys are looked up in the secondary deserializers only when a chunk is loaded.
     if (!m_cleanse)
     {
+        m_takePrimarySequenceLength = true;
         for (const auto& c : chunks)
         {
             auto cd = std::make_shared<BundlerChunkDescription>();
@@ -83,64 +137,376 @@ void Bundler::CreateChunkDescriptions()
     if (m_verbosity)
         fprintf(stderr, "Bundler::CreateChunkDescriptions(): starting to clean chunks\n");
 
+    // Otherwise build bundling chunks using underlying deserializers.
+    // The result of the validation does not change while the input does, so it can be cached across runs.
+    uint64_t fingerprint = 0;
+    bool useCache = !m_cacheFile.empty() && ComputeFingerprint(chunks, fingerprint);
+    if (useCache && LoadCleansedChunks(chunks, fingerprint))
+    {
+        fprintf(stderr, "Bundler::CreateChunkDescriptions(): loaded %" PRIu64 " cleaned chunks from '%ls'\n", m_chunks.size(), m_cacheFile.c_str());
+        return;
+    }
+
+    CleanseChunks(chunks);
+
+    if (m_verbosity)
+        fprintf(stderr, "Bundler::CreateChunkDescriptions(): finished cleaning of %" PRIu64 " chunks\n", m_chunks.size());
+
+    if (useCache)
+    {
+        SaveCleansedChunks(fingerprint);
+    }
+}
+
+// Runs the task for all chunks of the driving deserializer, chunks are processed in parallel.
+// The task gets the index of the chunk and a buffer for sequence descriptions.
+static void ForEachChunk(const ChunkDescriptions& chunks, const std::function<void(size_t, std::vector<SequenceDescription>&)>& task)
+{
+    std::atomic<size_t> nextChunk(0);
+    size_t numberOfThreads = std::max<size_t>(1, std::min<size_t>(std::thread::hardware_concurrency(), chunks.size()));
+    RunConcurrently(numberOfThreads, [&](size_t)
+    {
+        std::vector<SequenceDescription> sequenceDescriptions;
+        for (size_t chunkIndex = nextChunk++; chunkIndex < chunks.size(); chunkIndex = nextChunk++)
+        {
+            task(chunkIndex, sequenceDescriptions);
+        }
+    });
+}
+
+// Validates sequences of all chunks of the driving deserializer against the secondary deserializers.
+// Chunks are validated in parallel, this only reads the sequence descriptions of the deserializers.
+void Bundler::CleanseChunks(const ChunkDescriptions& chunks)
+{
+    std::vector<BundlerChunkDescriptionPtr> cleansed(chunks.size());
+    std::vector<char> primaryHasLongestSequences(chunks.size(), 1);
+    ForEachChunk(chunks, [&](size_t chunkIndex, std::vector<SequenceDescription>& sequenceDescriptions)
+    {
+        bool primaryHasLongest = true;
+        cleansed[chunkIndex] = CleanseChunk(chunks[chunkIndex], sequenceDescriptions, primaryHasLongest);
+        primaryHasLongestSequences[chunkIndex] = primaryHasLongest;
+    });
+
+    // Chunk ids follow the order of the driving deserializer.
     m_takePrimarySequenceLength = true;
+    for (size_t chunkIndex = 0; chunkIndex < chunks.size(); ++chunkIndex)
+    {
+        m_takePrimarySequenceLength = m_takePrimarySequenceLength && primaryHasLongestSequences[chunkIndex];
+        if (cleansed[chunkIndex])
+        {
+            cleansed[chunkIndex]->m_id = (ChunkIdType)m_chunks.size();
+            m_chunks.push_back(cleansed[chunkIndex]);
+        }
+    }
+}
 
-    // Otherwise build bundling chunks using underlying deserializers.
-    std::vector<SequenceDescription> sequenceDescriptions;
-    sequenceDescriptions.reserve(chunks.front()->m_numberOfSequences);
+// Validates sequences of a single chunk, returns nullptr if the chunk has no valid sequences.
+// Only the invalid sequences and the counts are kept, the positions in the secondary deserializers
+// are looked up again when the chunk is loaded.
+Bundler::BundlerChunkDescriptionPtr Bundler::CleanseChunk(const ChunkDescriptionPtr& chunk, std::vector<SequenceDescription>& sequenceDescriptions, bool& primaryHasLongestSequences)
+{
+    size_t numberOfSamples = 0;
+    size_t numberOfSequences = 0;
+    sequenceDescriptions.clear();
+
+    // Iterating thru all sequences and identifying whether they are valid among all deserializers.
+    m_driver->GetSequencesForChunk(chunk->m_id, sequenceDescriptions);
+    std::set<size_t> invalid;
     SequenceDescription s;
-    for (ChunkIdType chunkIndex = 0; chunkIndex < chunks.size(); ++chunkIndex)
+    for (size_t sequenceIndex = 0; sequenceIndex < sequenceDescriptions.size(); ++sequenceIndex)
+    {
+        auto sequence = sequenceDescriptions[sequenceIndex];
+        bool isValid = true;
+        size_t sequenceSamples = sequence.m_numberOfSamples;
+        for (size_t deserializerIndex = 1; deserializerIndex < m_deserializers.size(); ++deserializerIndex)
+        {
+            isValid = m_deserializers[deserializerIndex]->GetSequenceDescriptionByKey(sequenceDescriptions[sequenceIndex].m_key, s);
+            if (!isValid)
+            {
+                invalid.insert(sequenceIndex);
+                break;
+            }
+
+            sequenceSamples = std::max<size_t>(sequenceSamples, s.m_numberOfSamples);
+        }
+
+        if (isValid)
+        {
+            numberOfSamples += sequenceSamples;
+            numberOfSequences++;
+
+            // Check whether the primary stream has the longest sequence.
+            // If yes, we can optimize exposed sequence descriptions in GetSequencesByChunk.
+            primaryHasLongestSequences = primaryHasLongestSequences && (sequenceSamples == sequence.m_numberOfSamples);
+        }
+    }
+
+    // Build a chunk for valid sequences.
+    if (numberOfSamples == 0)
+    {
+        return nullptr;
+    }
+
+    auto cd = std::make_shared<BundlerChunkDescription>();
+    cd->m_numberOfSamples = numberOfSamples;
+    cd->m_numberOfSequences = numberOfSequences;
+    cd->m_original = chunk;
+    cd->m_invalid = std::move(invalid);
+    return cd;
+}
+
+// FNV-1a hash used for the fingerprint of the cache of cleansed chunks.
+class Fingerprint
+{
+    uint64_t m_hash = 14695981039346656037ULL;
+
+public:
+    void Add(const void* data, size_t size)
+    {
+        const unsigned char* bytes = static_cast<const unsigned char*>(data);
+        for (size_t i = 0; i < size; ++i)
+        {
+            m_hash = (m_hash ^ bytes[i]) * 1099511628211ULL;
+        }
+    }
+
+    template <class T>
+    void Add(const T& value)
+    {
+        Add(&value, sizeof(value));
+    }
+
+    uint64_t Get() const
+    {
+        return m_hash;
+    }
+};
+
+// Gets size and modification time of a file, returns false if the file cannot be accessed.
+static bool GetFileSizeAndTime(const std::wstring& path, int64_t& size, int64_t& modificationTime)
+{
+#ifdef _WIN32
+    struct _stat64 buffer;
+    if (_wstat64(path.c_str(), &buffer) != 0)
+        return false;
+#else
+    struct stat buffer;
+    if (stat(msra::strfun::utf8(path).c_str(), &buffer) != 0)
+        return false;
+#endif
+    size = buffer.st_size;
+    modificationTime = buffer.st_mtime;
+    return true;
+}
+
+// Computes the fingerprint of the data the cleansed chunks are built from: the input files of all deserializers
+// (paths, sizes and modification times) and their chunk descriptions.
+// Returns false if some deserializer does not provide its input files, in this case nothing can be cached.
+bool Bundler::ComputeFingerprint(const ChunkDescriptions& chunks, uint64_t& result) const
+{
+    Fingerprint fingerprint;
+    fingerprint.Add(s_cacheVersion);
+    fingerprint.Add(m_deserializers.size());
+    for (size_t deserializerIndex = 0; deserializerIndex < m_deserializers.size(); ++deserializerIndex)
+    {
+        const auto& deserializer = m_deserializers[deserializerIndex];
+        auto files = deserializer->GetInputFiles();
+        if (files.empty())
+        {
+            fprintf(stderr, "Bundler::CreateChunkDescriptions(): deserializer %d does not provide its input files, not using the cache '%ls'\n",
+                (int)deserializerIndex, m_cacheFile.c_str());
+            return false;
+        }
+
+        for (const auto& file : files)
+        {
+            int64_t size, modificationTime;
+            if (!GetFileSizeAndTime(file, size, modificationTime))
+            {
+                fprintf(stderr, "Bundler::CreateChunkDescriptions(): cannot access '%ls', not using the cache '%ls'\n", file.c_str(), m_cacheFile.c_str());
+                return false;
+            }
+
+            fingerprint.Add(file.data(), file.size() * sizeof(wchar_t));
+            fingerprint.Add(size);
+            fingerprint.Add(modificationTime);
+        }
+
+        for (const auto& chunk : deserializerIndex == 0 ? chunks : deserializer->GetChunkDescriptions())
+        {
+            fingerprint.Add(chunk->m_id);
+            fingerprint.Add(chunk->m_numberOfSequences);
+            fingerprint.Add(chunk->m_numberOfSamples);
+        }
+    }
+
+    result = fingerprint.Get();
+    return true;
+}
+
+template <class T>
+static void WriteValue(FILE* f, const T& value)
+{
+    fwriteOrDie(&value, sizeof(value), 1, f);
+}
+
+template <class T>
+static T ReadValue(FILE* f)
+{
+    T value;
+    freadOrDie(&value, sizeof(value), 1, f);
+    return value;
+}
+
+// Cache format: tag, fingerprint, whether the primary deserializer has the longest sequences, number of chunks and for each chunk
+// the index of the original chunk, number of samples and sequences and the invalid sequences.
+static const char* s_cacheTag = "BNDL";
+
+// Loads cleansed chunks from the cache. Returns false if the cache does not exist or does not match the fingerprint.
+bool Bundler::LoadCleansedChunks(const ChunkDescriptions& chunks, uint64_t fingerprint)
+{
+    FILE* f = _wfopen(m_cacheFile.c_str(), L"rb");
+    if (f == nullptr)
     {
-        size_t numberOfSamples = 0;
-        size_t numberOfSequences = 0;
-        sequenceDescriptions.clear();
+        return false;
+    }
 
-        // Iterating thru all sequences and identifying whether they are valid among all deserializers.
-        m_driver->GetSequencesForChunk(chunks[chunkIndex]->m_id, sequenceDescriptions);
-        std::set<size_t> invalid;
-        for (size_t sequenceIndex = 0; sequenceIndex < sequenceDescriptions.size(); ++sequenceIndex)
+    std::vector<BundlerChunkDescriptionPtr> cleansed;
+    bool takePrimarySequenceLength = false;
+    bool matches = false;
+    try
+    {
+        char tag[4];
+        freadOrDie(tag, sizeof(char), sizeof(tag), f);
+        matches = memcmp(tag, s_cacheTag, sizeof(tag)) == 0 && ReadValue<uint64_t>(f) == fingerprint;
+        if (matches)
         {
-            auto sequence = sequenceDescriptions[sequenceIndex];
-            bool isValid = true;
-            size_t sequenceSamples = sequence.m_numberOfSamples;
-            for (size_t deserializerIndex = 1; deserializerIndex < m_deserializers.size(); ++deserializerIndex)
+            takePrimarySequenceLength = ReadValue<uint8_t>(f) != 0;
+            size_t numberOfChunks = ReadValue<uint64_t>(f);
+            cleansed.reserve(numberOfChunks);
+            for (size_t i = 0; i < numberOfChunks; ++i)
             {
-                isValid = m_deserializers[deserializerIndex]->GetSequenceDescriptionByKey(sequenceDescriptions[sequenceIndex].m_key, s);
-                if (!isValid)
+                size_t originalIndex = ReadValue<uint64_t>(f);
+                if (originalIndex >= chunks.size() || chunks[originalIndex]->m_id != originalIndex)
                 {
-                    invalid.insert(sequenceIndex);
-                    break;
+                    RuntimeError("invalid chunk index %" PRIu64, originalIndex);
                 }
 
-                sequenceSamples = std::max<size_t>(sequenceSamples, s.m_numberOfSamples);
-            }
+                auto cd = std::make_shared<BundlerChunkDescription>();
+                cd->m_id = (ChunkIdType)cleansed.size();
+                cd->m_original = chunks[originalIndex];
+                cd->m_numberOfSamples = ReadValue<uint64_t>(f);
+                cd->m_numberOfSequences = ReadValue<uint64_t>(f);
 
-            if (isValid)
-            {
-                numberOfSamples += sequenceSamples;
-                numberOfSequences++;
+                size_t numberOfInvalid = ReadValue<uint64_t>(f);
+                for (size_t j = 0; j < numberOfInvalid; ++j)
+                {
+                    cd->m_invalid.insert(cd->m_invalid.end(), (size_t)ReadValue<uint64_t>(f));
+                }
+
+                // The positions of the valid sequences are looked up when the chunk is loaded, so they have to match the original chunk.
+                if (cd->m_invalid.size() != numberOfInvalid ||
+                    cd->m_numberOfSequences + numberOfInvalid != cd->m_original->m_numberOfSequences ||
+                    (numberOfInvalid > 0 && *cd->m_invalid.rbegin() >= cd->m_original->m_numberOfSequences))
+                {
+                    RuntimeError("invalid sequences of chunk %" PRIu64 " do not match", originalIndex);
+                }
 
-                // Check whether the primary stream has the longest sequence.
-                // If yes, we can optimize exposed sequence descriptions in GetSequencesByChunk.
-                m_takePrimarySequenceLength = m_takePrimarySequenceLength && (sequenceSamples == sequence.m_numberOfSamples);
+                cleansed.push_back(cd);
             }
         }
+    }
+    catch (const std::exception& e)
+    {
+        fprintf(stderr, "Bundler::CreateChunkDescriptions(): ignoring the cache '%ls': %s\n", m_cacheFile.c_str(), e.what());
+        matches = false;
+    }
+    fclose(f);
+
+    if (!matches)
+    {
+        return false;
+    }
 
-        // Build a chunk for valid sequences.
-        if (numberOfSamples > 0)
+    m_takePrimarySequenceLength = takePrimarySequenceLength;
+    m_chunks = std::move(cleansed);
+    return true;
+}
+
+// Saves cleansed chunks to the cache. The file is written under a temporary name and renamed,
+// so that concurrent readers (i.e. other workers of distributed training) never see a partial file.
+// Failures are not fatal, the chunks are cleansed again in the next run.
+void Bundler::SaveCleansedChunks(uint64_t fingerprint) const
+{
+    std::wstring temporaryFile = m_cacheFile + L".tmp" + std::to_wstring(std::random_device()());
+    try
+    {
+        FILE* f = fopenOrDie(temporaryFile, L"wb");
+        try
         {
-            auto cd = std::make_shared<BundlerChunkDescription>();
-            cd->m_numberOfSamples = numberOfSamples;
-            cd->m_numberOfSequences = numberOfSequences;
-            cd->m_id = (ChunkIdType) m_chunks.size();
-            cd->m_original = chunks[chunkIndex];
-            m_chunks.push_back(cd);
-            cd->m_invalid = std::move(invalid);
+            fwriteOrDie(s_cacheTag, sizeof(char), 4, f);
+            WriteValue<uint64_t>(f, fingerprint);
+            WriteValue<uint8_t>(f, m_takePrimarySequenceLength ? 1 : 0);
+            WriteValue<uint64_t>(f, m_chunks.size());
+            for (const auto& chunk : m_chunks)
+            {
+                // Original chunk ids are the indices of the chunk descriptions of the driving deserializer.
+                WriteValue<uint64_t>(f, chunk->m_original->m_id);
+                WriteValue<uint64_t>(f, chunk->m_numberOfSamples);
+                WriteValue<uint64_t>(f, chunk->m_numberOfSequences);
+                WriteValue<uint64_t>(f, chunk->m_invalid.size());
+                for (auto sequenceIndex : chunk->m_invalid)
+                {
+                    WriteValue<uint64_t>(f, sequenceIndex);
+                }
+            }
         }
+        catch (...)
+        {
+            fclose(f);
+            throw;
+        }
+
+        fcloseOrDie(f);
+        renameOrDie(temporaryFile, m_cacheFile);
+    }
+    catch (const std::exception& e)
+    {
+        fprintf(stderr, "Bundler::CreateChunkDescriptions(): failed to write the cache '%ls': %s\n", m_cacheFile.c_str(), e.what());
+        _wunlink(temporaryFile.c_str());
     }
+}
 
-    if (m_verbosity)
-        fprintf(stderr, "Bundler::CreateChunkDescriptions(): finished cleaning of %" PRIu64 " chunks\n", m_chunks.size());
+// Looks up the valid sequences of a chunk of the driving deserializer in the secondary deserializers.
+// Index i of the result maps to the sequence (i / (number of deserializers - 1)) of the chunk in
+// the deserializer (i % (number of deserializers - 1) + 1). Different deserializers are consulted concurrently.
+void Bundler::GetSecondarySequences(const BundlerChunkDescription& chunk, const std::vector<SequenceDescription>& sequences, std::vector<SequenceDescription>& result)
+{
+    const size_t numberOfSecondaries = m_deserializers.size() - 1;
+    result.resize(sequences.size() * numberOfSecondaries);
+    if (numberOfSecondaries == 0)
+    {
+        return;
+    }
+
+    RunConcurrently(numberOfSecondaries, [&](size_t secondaryIndex)
+    {
+        const auto& deserializer = m_deserializers[secondaryIndex + 1];
+        for (size_t sequenceIndex = 0; sequenceIndex < sequences.size(); ++sequenceIndex)
+        {
+            if (chunk.m_invalid.find(sequenceIndex) != chunk.m_invalid.end())
+            {
+                continue;
+            }
+
+            // Without cleansing the data is expected to be clean.
+            if (!deserializer->GetSequenceDescriptionByKey(sequences[sequenceIndex].m_key, result[sequenceIndex * numberOfSecondaries + secondaryIndex]))
+            {
+                RuntimeError("Sequence with key %" PRIu64 " of the driving deserializer does not exist in deserializer %d. "
+                    "Please set 'checkData' to true to skip such sequences.", (uint64_t)sequences[sequenceIndex].m_key.m_sequence, (int)secondaryIndex + 1);
+            }
+        }
+    });
 }
 
 // Gets chunk descriptions.
@@ -180,8 +546,10 @@ void Bundler::GetSequencesForChunk(ChunkIdType chunkId, std::vector<SequenceDesc
     else // need to get the max sequence length from other deserializers.
          // TODO: This will change when the sequence length will be exposed per stream.
     {
+        std::vector<SequenceDescription> secondarySequences;
+        GetSecondarySequences(*chunk, sequences, secondarySequences);
+        const size_t numberOfSecondaries = m_deserializers.size() - 1;
         result.reserve(sequences.size());
-        SequenceDescription s;
         for (size_t sequenceIndex = 0; sequenceIndex < sequences.size(); ++sequenceIndex)
         {
             if (chunk->m_invalid.find(sequenceIndex) != chunk->m_invalid.end())
@@ -191,10 +559,9 @@ void Bundler::GetSequencesForChunk(ChunkIdType chunkId, std::vector<SequenceDesc
 
             auto sequence = sequences[sequenceIndex];
             uint32_t sequenceSamples = sequence.m_numberOfSamples;
-            for (size_t deserializerIndex = 1; deserializerIndex < m_deserializers.size(); ++deserializerIndex)
+            for (size_t secondaryIndex = 0; secondaryIndex < numberOfSecondaries; ++secondaryIndex)
             {
-                m_deserializers[deserializerIndex]->GetSequenceDescriptionByKey(sequence.m_key, s);
-                sequenceSamples = std::max(sequenceSamples, s.m_numberOfSamples);
+                sequenceSamples = std::max(sequenceSamples, secondarySequences[sequenceIndex * numberOfSecondaries + secondaryIndex].m_numberOfSamples);
             }
             sequence.m_numberOfSamples = sequenceSamples;
             result.push_back(sequence);
@@ -234,9 +601,17 @@ public:
 
         // Creating chunk mapping.
         m_parent->m_driver->GetSequencesForChunk(original->m_id, sequences);
-        ChunkPtr drivingChunk = m_parent->m_driver->GetChunk(original->m_id);
         m_sequenceToSequence.resize(deserializers.size() * sequences.size());
         m_innerChunks.resize(deserializers.size() * sequences.size());
+
+        // The keys are looked up only now, so that no positions of secondary sequences are kept for chunks that are not loaded.
+        std::vector<SequenceDescription> secondarySequences;
+        m_parent->GetSecondarySequences(*chunk, sequences, secondarySequences);
+
+        // Creating sequence mapping and collecting the chunks required from each deserializer.
+        std::vector<ChunkIdType> innerChunkIds(deserializers.size() * sequences.size(), CHUNKID_MAX);
+        std::vector<std::map<ChunkIdType, ChunkPtr>> requiredChunks(deserializers.size());
+        requiredChunks[0][original->m_id] = nullptr;
         for (size_t sequenceIndex = 0; sequenceIndex < sequences.size(); ++sequenceIndex)
         {
             if (chunk->m_invalid.find(sequenceIndex) != chunk->m_invalid.end())
@@ -246,43 +621,45 @@ public:
 
             size_t currentIndex = sequenceIndex * deserializers.size();
             m_sequenceToSequence[currentIndex] = sequences[sequenceIndex].m_id;
-            m_innerChunks[currentIndex] = drivingChunk;
-        }
-
-        // Creating sequence mapping and requiring underlying chunks.
-        SequenceDescription s;
-        for (size_t deserializerIndex = 1; deserializerIndex < m_parent->m_deserializers.size(); ++deserializerIndex)
-        {
-            std::map<size_t, ChunkPtr> secondaryChunks;
+            innerChunkIds[currentIndex] = original->m_id;
 
-            for (size_t sequenceIndex = 0; sequenceIndex < sequences.size(); ++sequenceIndex)
+            for (size_t deserializerIndex = 1; deserializerIndex < deserializers.size(); ++deserializerIndex)
             {
-                if (chunk->m_invalid.find(sequenceIndex) != chunk->m_invalid.end())
-                {
-                    continue;
-                }
+                const auto& s = secondarySequences[sequenceIndex * (deserializers.size() - 1) + deserializerIndex - 1];
+                m_sequenceToSequence[currentIndex + deserializerIndex] = s.m_id;
+                innerChunkIds[currentIndex + deserializerIndex] = s.m_chunkId;
+                requiredChunks[deserializerIndex][s.m_chunkId] = nullptr;
+            }
+        }
 
-                size_t currentIndex = sequenceIndex * deserializers.size() + deserializerIndex;
-                deserializers[deserializerIndex]->GetSequenceDescriptionByKey(sequences[sequenceIndex].m_key, s);
-                m_sequenceToSequence[currentIndex] = s.m_id;
+        LoadChunks(requiredChunks);
 
-                ChunkPtr secondaryChunk;
-                auto it = secondaryChunks.find(s.m_chunkId);
-                if (it == secondaryChunks.end())
-                {
-                    secondaryChunk = deserializers[deserializerIndex]->GetChunk(s.m_chunkId);
-                    secondaryChunks.insert(make_pair(s.m_chunkId, secondaryChunk));
-                }
-                else
-                {
-                    secondaryChunk = it->second;
-                }
-
-                m_innerChunks[currentIndex] = secondaryChunk;
+        for (size_t i = 0; i < innerChunkIds.size(); ++i)
+        {
+            if (innerChunkIds[i] != CHUNKID_MAX)
+            {
+                m_innerChunks[i] = requiredChunks[i % deserializers.size()][innerChunkIds[i]];
             }
         }
     }
 
+    // Requires underlying chunks. Different deserializers (i.e. features and labels on separate storage) are loaded concurrently,
+    // so the latency is the one of the slowest deserializer. Chunks of a single deserializer are loaded sequentially,
+    // deserializers do not need to support concurrent calls.
+    void LoadChunks(std::vector<std::map<ChunkIdType, ChunkPtr>>& chunks)
+    {
+        auto& deserializers = m_parent->m_deserializers;
+        auto load = [&deserializers, &chunks](size_t deserializerIndex)
+        {
+            for (auto& c : chunks[deserializerIndex])
+            {
+                c.second = deserializers[deserializerIndex]->GetChunk(c.first);
+            }
+        };
+
+        RunConcurrently(deserializers.size(), load);
+    }
+
     // Gets sequence by its id.
     virtual void GetSequence(size_t sequenceId, std::vector<SequenceDataPtr>& result) override
     {
@@ -38,6 +38,18 @@ private:
     // Creates chunk descriptions based on chunks of underlying deserializers.
     void CreateChunkDescriptions();
 
+    // Validates sequences of the driving deserializer against other deserializers.
+    void CleanseChunks(const ChunkDescriptions& chunks);
+    BundlerChunkDescriptionPtr CleanseChunk(const ChunkDescriptionPtr& chunk, std::vector<SequenceDescription>& sequenceDescriptions, bool& primaryHasLongestSequences);
+
+    // Cache of cleansed chunks, so that the validation is not repeated in subsequent runs with the same input.
+    bool ComputeFingerprint(const ChunkDescriptions& chunks, uint64_t& fingerprint) const;
+    bool LoadCleansedChunks(const ChunkDescriptions& chunks, uint64_t fingerprint);
+    void SaveCleansedChunks(uint64_t fingerprint) const;
+
+    // Looks up the valid sequences of a chunk of the driving deserializer in the secondary deserializers.
+    void GetSecondarySequences(const BundlerChunkDescription& chunk, const std::vector<SequenceDescription>& sequences, std::vector<SequenceDescription>& result);
+
     // Underlying deserializers.
     std::vector<IDataDeserializerPtr> m_deserializers;
 
@@ -54,6 +66,9 @@ private:
     // If this flag is set to false, no cleaning will be done, so additional overhead.
     bool m_cleanse;
 
+    // File to cache the cleansed chunks in (checkDataCache), empty if not cached.
+    std::wstring m_cacheFile;
+
     // If flag is set to true the sequence length is counted by the primary deserializer only.
     // Used for optimization when sequences between different deserializers are of the same length
     // (i.e. often in speech)
@@ -37,4 +37,35 @@ inline std::vector<std::string> GetSectionsWithParameter(const std::string& read
     return result;
 }
 
+// Helper function to get the number of minibatches that can be prefetched by the ReaderShim.
+inline size_t GetPrefetchDepth(const ConfigParameters& config)
+{
+    bool prefetch = config(L"prefetch", true);
+    if (!prefetch)
+    {
+        return 1;
+    }
+
+    size_t prefetchDepth = config(L"prefetchDepth", (size_t)1);
+    if (prefetchDepth == 0)
+    {
+        InvalidArgument("prefetchDepth must be at least 1.");
+    }
+
+    return prefetchDepth;
+}
+
+// Helper function to check whether the ReaderShim hands dense minibatch buffers over to CPU input matrices instead of copying.
+inline bool UseZeroCopyMinibatches(const ConfigParameters& config)
+{
+    return config(L"zeroCopy", false);
+}
+
+// Helper function to get the number of buffer sets the packer has to rotate through:
+// one per prefetched minibatch, and one more for the minibatch the network is consuming in place (zero copy).
+inline size_t GetNumberOfPackerBuffers(const ConfigParameters& config)
+{
+    return GetPrefetchDepth(config) + (UseZeroCopyMinibatches(config) ? 1 : 0);
+}
+
 }}}
@@ -76,9 +76,17 @@ typedef std::shared_ptr<SequenceDataBase> SequenceDataPtr;
 // All samples are stored in the 'data' member as a contiguous array.
 // The layout of samples are described in the sampleLayout.
 // All samples in the sequence should have the same layout.
+// A deserializer that constructs samples only when they are packed (i.e. HTK context window splicing)
+// leaves 'data' empty and overrides CopySample instead.
 struct DenseSequenceData : SequenceDataBase
 {
     TensorShapePtr m_sampleLayout; // Sample layout, can be shared by several sequences.
+
+    // Copies the sample with the given index into the destination, sampleSize is the size of a sample in bytes.
+    virtual void CopySample(size_t sampleIndex, char* destination, size_t sampleSize) const
+    {
+        memcpy(destination, (const char*)m_data + sampleIndex * sampleSize, sampleSize);
+    }
 };
 typedef std::shared_ptr<DenseSequenceData> DenseSequenceDataPtr;
 
@@ -170,6 +178,13 @@ public:
     // Gets chunk data given its id.
     virtual ChunkPtr GetChunk(ChunkIdType chunkId) = 0;
 
+    // Gets paths of the files the sequence descriptions are built from (i.e. script or label files).
+    // Used to validate information cached across runs, empty if the deserializer does not provide them.
+    virtual std::vector<std::wstring> GetInputFiles() const
+    {
+        return std::vector<std::wstring>();
+    }
+
     virtual ~IDataDeserializer() {};
 };
 
@@ -16,8 +16,10 @@ public:
     FramePacker(
         MemoryProviderPtr memoryProvider,
         SequenceEnumeratorPtr sequenceEnumerator,
-        const std::vector<StreamDescriptionPtr>& streams) :
-        SequencePacker(memoryProvider, sequenceEnumerator, streams)
+        const std::vector<StreamDescriptionPtr>& streams,
+        size_t numberOfBuffers = 1,
+        int verbosity = 0) :
+        SequencePacker(memoryProvider, sequenceEnumerator, streams, numberOfBuffers, verbosity)
     {}
 
 private:
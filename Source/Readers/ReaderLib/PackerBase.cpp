@@ -17,10 +17,12 @@ using namespace std;
 void PackerBase::StreamBuffer::Resize(size_t newSize)
 {
     m_size = newSize;
-    m_data.reset(reinterpret_cast<char*>(m_memoryProvider->Alloc(1, newSize)),
-        [this](char* p)
+    // Capturing the provider by value, the buffer can be moved around together with the vector it belongs to.
+    auto memoryProvider = m_memoryProvider;
+    m_data.reset(reinterpret_cast<char*>(memoryProvider->Alloc(1, newSize)),
+        [memoryProvider](char* p)
     {
-        m_memoryProvider->Free(p);
+        memoryProvider->Free(p);
     });
 }
 
@@ -35,16 +37,27 @@ void PackerBase::StartEpoch(const EpochConfiguration& config)
 
 PackerBase::PackerBase(MemoryProviderPtr memoryProvider,
     SequenceEnumeratorPtr sequenceEnumerator,
-    const std::vector<StreamDescriptionPtr>& streams) :
+    const std::vector<StreamDescriptionPtr>& streams,
+    size_t numberOfBuffers) :
     m_sequenceEnumerator(sequenceEnumerator),
     m_minibatchSize(0),
-    m_outputStreamDescriptions(streams)
+    m_outputStreamDescriptions(streams),
+    m_currentBufferIndex(0)
 {
+    if (numberOfBuffers == 0)
+    {
+        InvalidArgument("Number of packer buffers cannot be zero.");
+    }
+
     m_inputStreamDescriptions = sequenceEnumerator->GetStreamDescriptions();
     assert(m_inputStreamDescriptions.size() != 0);
     assert(m_inputStreamDescriptions.size() == m_outputStreamDescriptions.size());
 
-    m_streamBuffers.reserve(m_outputStreamDescriptions.size());
+    m_streamBuffers.resize(numberOfBuffers);
+    for (auto& buffers : m_streamBuffers)
+    {
+        buffers.reserve(m_outputStreamDescriptions.size());
+    }
 
     // Sanity checks:
     for (size_t i = 0; i < m_outputStreamDescriptions.size(); ++i)
@@ -65,7 +78,10 @@ PackerBase::PackerBase(MemoryProviderPtr memoryProvider,
                 stream->m_name.c_str());
         }
 
-        m_streamBuffers.push_back(StreamBuffer(memoryProvider));
+        for (auto& buffers : m_streamBuffers)
+        {
+            buffers.push_back(StreamBuffer(memoryProvider));
+        }
     }
 }
 
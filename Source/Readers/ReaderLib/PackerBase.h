@@ -34,7 +34,8 @@ protected:
 
     PackerBase(MemoryProviderPtr memoryProvider,
                SequenceEnumeratorPtr sequenceEnumerator,
-               const std::vector<StreamDescriptionPtr>& streams);
+               const std::vector<StreamDescriptionPtr>& streams,
+               size_t numberOfBuffers = 1);
 
     typedef std::vector<SequenceDataPtr> StreamBatch;
 
@@ -64,8 +65,25 @@ protected:
     // Output stream descriptions expected by the network.
     std::vector<StreamDescriptionPtr> m_inputStreamDescriptions;
 
-    // Buffers for allocated data.
-    std::vector<StreamBuffer> m_streamBuffers;
+    // Buffers for allocated data, one set of stream buffers per minibatch that can be in flight
+    // (indexed as [buffer index][stream index]). The packer fills the sets in round-robin order,
+    // so the data of a returned minibatch stays valid for the next numberOfBuffers - 1 reads.
+    std::vector<std::vector<StreamBuffer>> m_streamBuffers;
+
+    // Index of the buffer set used for the current minibatch.
+    size_t m_currentBufferIndex;
+
+    // Switches to the next buffer set, has to be called once at the beginning of ReadMinibatch.
+    void MoveToNextBuffer()
+    {
+        m_currentBufferIndex = (m_currentBufferIndex + 1) % m_streamBuffers.size();
+    }
+
+    // Returns the buffer of the given stream in the current buffer set.
+    StreamBuffer& GetStreamBuffer(size_t streamIndex)
+    {
+        return m_streamBuffers[m_currentBufferIndex][streamIndex];
+    }
 
     // Minibatch size in samples.
     size_t m_minibatchSize;
@@ -99,6 +117,13 @@ inline void PackerBase::PackSparseSampleAsDense(char* destination, SparseSequenc
 
 inline void PackerBase::PackDenseSample(char* destination, SequenceDataPtr sequence, size_t sampleOffset, size_t sampleSize)
 {
+    if (sequence->m_data == nullptr)
+    {
+        // The sequence constructs its samples on request.
+        static_cast<const DenseSequenceData&>(*sequence).CopySample(sampleOffset / sampleSize, destination, sampleSize);
+        return;
+    }
+
     // Because the sample is dense - simply copying it to the output.
     memcpy(destination, (const char*)(sequence->m_data) + sampleOffset, sampleSize);
 }
@@ -12,7 +12,11 @@
 #endif
 
 #include <sstream>
+#define __STDC_FORMAT_MACROS
+#include <inttypes.h>
 #include "Basics.h"
+#include "TimerUtility.h"
+#include "ConfigUtil.h"
 
 #define DATAREADER_EXPORTS // creating the exports here
 #include "DataReader.h"
@@ -22,7 +26,9 @@ namespace Microsoft { namespace MSR { namespace CNTK {
 
 template <class ElemType>
 ReaderShim<ElemType>::ReaderShim(ReaderFactory factory)
-    : m_factory(factory)
+    : m_factory(factory), m_prefetch(true), m_prefetchDepth(1), m_zeroCopy(false), m_numberOfBuffers(1), m_verbosity(0),
+    m_numMinibatchesInUse(0), m_stopPrefetching(false), m_minibatchHeldByMatrices(false),
+    m_numRetrievedMinibatches(0), m_totalQueueOccupancy(0), m_numEmptyQueueWaits(0), m_consumerWaitTime(0)
 {
 }
 
@@ -32,10 +38,16 @@ void ReaderShim<ElemType>::Init(const ConfigParameters& config)
     intargvector numberOfuttsPerMinibatchForAllEpochs =
         config(L"nbruttsineachrecurrentiter", ConfigParameters::Array(intargvector(vector<int> { 1 })));
 
-    bool prefetch = config(L"prefetch", true);
-    // if prefetch - launching asynchronously,
-    // otherwise deferring - synchronous execution during .get() call
-    m_launchType = prefetch ? launch::async : launch::deferred;
+    // If prefetch - minibatches are read ahead on a dedicated thread into a queue of prefetchDepth minibatches,
+    // otherwise reading synchronously when the network requests the minibatch.
+    m_prefetch = config(L"prefetch", true);
+    m_prefetchDepth = GetPrefetchDepth(config);
+
+    // If zero copy - dense minibatches are not copied into CPU input matrices, the matrices use the packer buffers
+    // until the next minibatch is retrieved. The packer has one more buffer set for that.
+    m_zeroCopy = UseZeroCopyMinibatches(config);
+    m_numberOfBuffers = GetNumberOfPackerBuffers(config);
+    m_verbosity = config(L"verbosity", 0);
 
     m_numParallelSequences = numberOfuttsPerMinibatchForAllEpochs[0];
 
@@ -61,11 +73,11 @@ void ReaderShim<ElemType>::StartDistributedMinibatchLoop(
     size_t numSubsets,
     size_t requestedEpochSamples /*= requestDataSize*/)
 {
+    // The matrices must not point into the packer buffers of the previous epoch.
+    DetachMatricesFromReaderBuffers();
+
     // For adaptive minibatch, make sure there are no outstanding reads.
-    if (m_prefetchTask.valid())
-    {
-        m_prefetchTask.wait();
-    }
+    StopPrefetching();
 
     EpochConfiguration config;
     config.m_workerRank = subsetNum;
@@ -77,15 +89,188 @@ void ReaderShim<ElemType>::StartDistributedMinibatchLoop(
     m_reader->StartEpoch(config);
     m_endOfEpoch = false;
 
-    // Starting the prefetch task. There is always a single async read in flight.
-    // When the network requests a new minibatch, we wait for the current async to finish,
-    // return the result and kick off a new one.
-    m_prefetchTask = std::async(m_launchType, [this]()
+    m_numRetrievedMinibatches = 0;
+    m_totalQueueOccupancy = 0;
+    m_numEmptyQueueWaits = 0;
+    m_consumerWaitTime = 0;
+
+    StartPrefetching();
+}
+
+template <class ElemType>
+void ReaderShim<ElemType>::StartPrefetching()
+{
+    if (!m_prefetch)
     {
-        return m_reader->ReadMinibatch();
+        return;
+    }
+
+    assert(!m_prefetchThread.joinable());
+    assert(m_prefetchQueue.empty() && m_numMinibatchesInUse == 0);
+    m_stopPrefetching = false;
+    m_prefetchThread = std::thread([this]()
+    {
+        PrefetchMinibatches();
     });
 }
 
+template <class ElemType>
+void ReaderShim<ElemType>::StopPrefetching()
+{
+    if (!m_prefetchThread.joinable())
+    {
+        return;
+    }
+
+    {
+        std::unique_lock<std::mutex> lock(m_prefetchMutex);
+        m_stopPrefetching = true;
+    }
+    m_prefetchCondition.notify_all();
+
+    // The thread finishes the read in flight, if any.
+    m_prefetchThread.join();
+
+    m_prefetchQueue.clear();
+    m_numMinibatchesInUse = 0;
+}
+
+// There are at most m_numberOfBuffers minibatches ready in the queue or being consumed by the network.
+// The packer fills its buffer sets in round-robin order and has m_numberOfBuffers of them,
+// so the next minibatch can only be read when one of the previous minibatches has been released.
+template <class ElemType>
+void ReaderShim<ElemType>::PrefetchMinibatches()
+{
+    for (;;)
+    {
+        {
+            std::unique_lock<std::mutex> lock(m_prefetchMutex);
+            m_prefetchCondition.wait(lock, [this]() { return m_stopPrefetching || m_numMinibatchesInUse < m_numberOfBuffers; });
+            if (m_stopPrefetching)
+            {
+                return;
+            }
+
+            m_numMinibatchesInUse++;
+        }
+
+        PrefetchedMinibatch prefetched;
+        try
+        {
+            prefetched.m_minibatch = m_reader->ReadMinibatch();
+        }
+        catch (...)
+        {
+            // Rethrown on the main thread when the minibatch is retrieved.
+            prefetched.m_exception = std::current_exception();
+        }
+
+        bool lastMinibatch = prefetched.m_exception || prefetched.m_minibatch.m_endOfEpoch;
+        {
+            std::unique_lock<std::mutex> lock(m_prefetchMutex);
+            m_prefetchQueue.push_back(std::move(prefetched));
+        }
+        m_prefetchCondition.notify_all();
+
+        if (lastMinibatch)
+        {
+            return;
+        }
+    }
+}
+
+template <class ElemType>
+Minibatch ReaderShim<ElemType>::RetrieveMinibatch()
+{
+    if (!m_prefetch)
+    {
+        return m_reader->ReadMinibatch();
+    }
+
+    assert(m_prefetchThread.joinable());
+
+    PrefetchedMinibatch prefetched;
+    {
+        std::unique_lock<std::mutex> lock(m_prefetchMutex);
+        m_totalQueueOccupancy += m_prefetchQueue.size();
+        if (m_prefetchQueue.empty())
+        {
+            // The reader is behind, the network has to wait.
+            Timer waitTimer;
+            waitTimer.Start();
+            m_prefetchCondition.wait(lock, [this]() { return !m_prefetchQueue.empty(); });
+            waitTimer.Stop();
+
+            m_consumerWaitTime += waitTimer.ElapsedSeconds();
+            m_numEmptyQueueWaits++;
+        }
+
+        prefetched = std::move(m_prefetchQueue.front());
+        m_prefetchQueue.pop_front();
+    }
+    m_numRetrievedMinibatches++;
+
+    if (prefetched.m_exception)
+    {
+        std::rethrow_exception(prefetched.m_exception);
+    }
+
+    return prefetched.m_minibatch;
+}
+
+template <class ElemType>
+void ReaderShim<ElemType>::ReleaseMinibatch()
+{
+    if (!m_prefetch)
+    {
+        return;
+    }
+
+    {
+        std::unique_lock<std::mutex> lock(m_prefetchMutex);
+        assert(m_numMinibatchesInUse > 0);
+        m_numMinibatchesInUse--;
+    }
+    m_prefetchCondition.notify_all();
+}
+
+template <class ElemType>
+void ReaderShim<ElemType>::DetachMatricesFromReaderBuffers()
+{
+    if (!m_minibatchHeldByMatrices)
+    {
+        return;
+    }
+
+    // Moving a deep copy in, so that the matrices own their data again.
+    for (const auto& matrix : m_matricesWithReaderBuffers)
+    {
+        auto& m = dynamic_cast<Matrix<ElemType>&>(*matrix);
+        m = m.DeepClone();
+    }
+
+    m_matricesWithReaderBuffers.clear();
+    m_minibatchHeldByMatrices = false;
+    ReleaseMinibatch();
+}
+
+template <class ElemType>
+void ReaderShim<ElemType>::PrintPrefetchStatistics() const
+{
+    if (!m_prefetch || m_numRetrievedMinibatches == 0 || (m_prefetchDepth == 1 && m_verbosity == 0))
+    {
+        return;
+    }
+
+    fprintf(stderr, "ReaderShim::GetMinibatch: prefetch depth %" PRIu64 ": %" PRIu64 " minibatches, average queue occupancy %.2f, "
+        "waited for data %" PRIu64 " times for %.3f seconds\n",
+        m_prefetchDepth,
+        m_numRetrievedMinibatches,
+        (double)m_totalQueueOccupancy / m_numRetrievedMinibatches,
+        m_numEmptyQueueWaits,
+        m_consumerWaitTime);
+}
+
 string EnumerateInputs(const map<wstring, size_t> &nameToStreamId)
 {
     // TODO use boost::algorithm::join, boost::adapters::transformed, make this a generic function
@@ -112,6 +297,7 @@ bool ReaderShim<ElemType>::GetMinibatch(StreamMinibatchInputs& matrices)
 
     if (m_endOfEpoch)
     {
+        DetachMatricesFromReaderBuffers();
         return false;
     }
 
@@ -121,14 +307,15 @@ bool ReaderShim<ElemType>::GetMinibatch(StreamMinibatchInputs& matrices)
     for (auto mx : matrices)
         assert(mx.second.matrix->GetDeviceId() == deviceId), UNUSED(deviceId);
 
-    assert(m_prefetchTask.valid());
-
-    Minibatch minibatch = m_prefetchTask.get();
+    Minibatch minibatch = RetrieveMinibatch();
     if (minibatch.m_endOfEpoch)
     {
         m_endOfEpoch = true;
+        PrintPrefetchStatistics();
         if (minibatch.m_data.empty())
         {
+            DetachMatricesFromReaderBuffers();
+            ReleaseMinibatch();
             return false;
         }
     }
@@ -142,10 +329,13 @@ bool ReaderShim<ElemType>::GetMinibatch(StreamMinibatchInputs& matrices)
 
     // a map to generate error messages when checking layout constraints. 
     map<wstring, wstring> layoutToInputMap;
+
+    // matrices that use the buffers of this minibatch instead of a copy.
+    vector<MatrixBasePtr> matricesWithReaderBuffers;
     if (!minibatch.m_data.empty())
     {
         // TODO: Use alternating pinned buffer in the packer, do not copy anything, but pack into the pinned memory.
-        // Copy returned minibatch to the matrices.
+        // Copy returned minibatch to the matrices, or hand the buffers over in case of zero copy.
         for (const auto& mx : matrices)
         {
             if (m_nameToStreamId.find(mx.first) == m_nameToStreamId.end())
@@ -183,32 +373,57 @@ bool ReaderShim<ElemType>::GetMinibatch(StreamMinibatchInputs& matrices)
 
             size_t sampleSize = m_streams[streamId]->m_sampleLayout->GetNumElements();
             auto& matrix = matrices.GetInputMatrix<ElemType>(mx.first);
-            FillMatrixFromStream(m_streams[streamId]->m_storageType, &matrix, sampleSize, stream);
+            if (FillMatrixFromStream(m_streams[streamId]->m_storageType, &matrix, sampleSize, stream))
+            {
+                matricesWithReaderBuffers.push_back(mx.second.matrix);
+            }
         }
     }
 
-    if (!m_endOfEpoch)
+    // All matrices have been refilled, so the previous minibatch is not referenced anymore,
+    // unless some matrix is not among the inputs this time.
+    for (const auto& matrix : m_matricesWithReaderBuffers)
     {
-        // Starting the prefetch task. There is always a single async read in flight.
-        // When the network requests a new minibatch, we wait for the current async to finish,
-        // return the result and kick off a new one.
-        m_prefetchTask = std::async(m_launchType, [this]()
+        if (find(matricesWithReaderBuffers.begin(), matricesWithReaderBuffers.end(), matrix) == matricesWithReaderBuffers.end())
         {
-            return m_reader->ReadMinibatch();
-        });
+            auto& m = dynamic_cast<Matrix<ElemType>&>(*matrix);
+            m = m.DeepClone();
+        }
+    }
+
+    if (m_minibatchHeldByMatrices)
+    {
+        ReleaseMinibatch();
+    }
+
+    m_matricesWithReaderBuffers = std::move(matricesWithReaderBuffers);
+    m_minibatchHeldByMatrices = !m_matricesWithReaderBuffers.empty();
+
+    // If the data has been copied to the matrices, the packer can reuse the buffers of this minibatch.
+    // Otherwise they are released when the next minibatch is retrieved.
+    if (!m_minibatchHeldByMatrices)
+    {
+        ReleaseMinibatch();
     }
 
     return !minibatch.m_data.empty();
 }
 
 template <class ElemType>
-void ReaderShim<ElemType>::FillMatrixFromStream(StorageType type, Matrix<ElemType>* matrix, size_t numRows, const StreamMinibatchPtr& stream)
+bool ReaderShim<ElemType>::FillMatrixFromStream(StorageType type, Matrix<ElemType>* matrix, size_t numRows, const StreamMinibatchPtr& stream)
 {
     size_t numCols = stream->m_layout->GetNumCols();
 
     if (type == StorageType::dense)
     {
         auto data = reinterpret_cast<const ElemType*>(stream->m_data);
+        if (m_zeroCopy && matrix->GetDeviceId() == CPUDEVICE && matrix->GetMatrixType() == MatrixType::DENSE)
+        {
+            // The matrix uses the packer buffer directly, the buffer stays untouched till the next minibatch is retrieved.
+            matrix->SetValue(numRows, numCols, CPUDEVICE, const_cast<ElemType*>(data), matrixFlagDontOwnBuffer);
+            return true;
+        }
+
         matrix->SetValue(numRows, numCols, matrix->GetDeviceId(), const_cast<ElemType*>(data), matrixFlagNormal);
     }
     else if (type == StorageType::sparse_csc)
@@ -226,6 +441,8 @@ void ReaderShim<ElemType>::FillMatrixFromStream(StorageType type, Matrix<ElemTyp
     {
         RuntimeError("Storage type %d is not supported.", (int)type);
     }
+
+    return false;
 }
 
 template <class ElemType>
@@ -11,7 +11,11 @@
 #include <map>
 #include <string>
 #include "DataReader.h"
-#include <future>
+#include <deque>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <exception>
 #include "Reader.h"
 
 namespace Microsoft { namespace MSR { namespace CNTK {
@@ -23,7 +27,12 @@ class ReaderShim : public IDataReader
 {
 public:
     explicit ReaderShim(ReaderFactory factory);
-    virtual ~ReaderShim() { }
+    virtual ~ReaderShim()
+    {
+        // Make sure there are no outstanding reads and the matrices do not reference the packer buffers.
+        DetachMatricesFromReaderBuffers();
+        StopPrefetching();
+    }
 
     virtual void Init(const ScriptableObjects::IConfigRecord& /*config*/) override
     {
@@ -33,13 +42,6 @@ public:
 
     virtual void Destroy() override
     {
-        // Make sure there are no outstanding reads.
-        if (m_prefetchTask.valid())
-        {
-            // If there are some, give them time to finish.
-            m_prefetchTask.wait_for(std::chrono::seconds(5));
-        }
-
         delete this;
     }
 
@@ -60,7 +62,34 @@ public:
     virtual size_t GetNumParallelSequencesForFixingBPTTMode() override;
 
 private:
-    std::future<Minibatch> m_prefetchTask;
+    // A minibatch produced by the prefetch thread, or the exception that occurred while reading it.
+    struct PrefetchedMinibatch
+    {
+        Minibatch m_minibatch;
+        std::exception_ptr m_exception;
+    };
+
+    // Body of the prefetch thread: reads minibatches into the queue until the end of the epoch.
+    void PrefetchMinibatches();
+
+    // Starts the prefetch thread for the current epoch.
+    void StartPrefetching();
+
+    // Stops the prefetch thread and drops all prefetched minibatches.
+    void StopPrefetching();
+
+    // Retrieves the next minibatch, either from the prefetch queue or synchronously from the reader.
+    Minibatch RetrieveMinibatch();
+
+    // Signals the prefetch thread that the network has consumed the data of the last retrieved minibatch.
+    void ReleaseMinibatch();
+
+    // Makes the matrices that use the buffers of the current minibatch own a copy of their data, and releases the minibatch.
+    void DetachMatricesFromReaderBuffers();
+
+    // Prints prefetch statistics of the epoch.
+    void PrintPrefetchStatistics() const;
+
     ReaderPtr m_reader;
     ReaderFactory m_factory;
     bool m_endOfEpoch;
@@ -69,9 +98,46 @@ private:
 
     std::map<std::wstring, size_t> m_nameToStreamId;
     std::vector<StreamDescriptionPtr> m_streams;
-    launch m_launchType;
 
-    void FillMatrixFromStream(StorageType type, Matrix<ElemType>* matrix, size_t numRows, const StreamMinibatchPtr& stream);
+    // Whether minibatches are read ahead on the prefetch thread.
+    bool m_prefetch;
+
+    // Maximum number of minibatches that are ready in the queue.
+    size_t m_prefetchDepth;
+
+    // Whether dense minibatches are handed over to CPU input matrices without copying.
+    bool m_zeroCopy;
+
+    // Maximum number of minibatches that are ready or being consumed at any time.
+    // The packer has the same number of buffer sets, so their data stays valid while in use.
+    size_t m_numberOfBuffers;
+
+    int m_verbosity;
+
+    // Prefetch thread and the bounded queue of ready minibatches it fills.
+    std::thread m_prefetchThread;
+    std::mutex m_prefetchMutex;
+    std::condition_variable m_prefetchCondition;
+    std::deque<PrefetchedMinibatch> m_prefetchQueue;
+
+    // Number of minibatches that are either queued, or retrieved and not yet released.
+    size_t m_numMinibatchesInUse;
+
+    // Flag requesting the prefetch thread to stop.
+    bool m_stopPrefetching;
+
+    // Zero copy: whether the last retrieved minibatch is still referenced by the matrices, and the matrices referencing it.
+    bool m_minibatchHeldByMatrices;
+    std::vector<MatrixBasePtr> m_matricesWithReaderBuffers;
+
+    // Prefetch statistics for the current epoch.
+    size_t m_numRetrievedMinibatches;
+    size_t m_totalQueueOccupancy;
+    size_t m_numEmptyQueueWaits;
+    double m_consumerWaitTime;
+
+    // Fills the matrix with the data of the stream. Returns true if the matrix uses the stream buffer directly instead of a copy.
+    bool FillMatrixFromStream(StorageType type, Matrix<ElemType>* matrix, size_t numRows, const StreamMinibatchPtr& stream);
 };
 
 }}}
@@ -0,0 +1,235 @@
+//
+// Copyright (c) Microsoft. All rights reserved.
+// Licensed under the MIT license. See LICENSE.md file in the project root for full license information.
+//
+
+#define _CRT_SECURE_NO_WARNINGS
+#define _SCL_SECURE_NO_WARNINGS
+
+#include <algorithm>
+#define __STDC_FORMAT_MACROS
+#include <inttypes.h>
+#include "SequenceBucketizer.h"
+
+namespace Microsoft { namespace MSR { namespace CNTK {
+
+SequenceBucketizer::SequenceBucketizer(
+    size_t numberOfBuckets,
+    size_t windowSizeInMinibatches,
+    SequenceEnumeratorPtr sequenceProvider)
+    : m_sequenceProvider(sequenceProvider),
+      m_numberOfBuckets(numberOfBuckets),
+      m_windowSizeInMinibatches(windowSizeInMinibatches),
+      m_numberOfSamplesInWindow(0),
+      m_endOfEpochReached(false),
+      m_numberOfSamples(0),
+      m_numberOfColumns(0),
+      m_numberOfMinibatches(0)
+{
+    assert(m_sequenceProvider != nullptr);
+    if (m_numberOfBuckets == 0)
+    {
+        InvalidArgument("Number of buckets cannot be zero.");
+    }
+
+    if (m_windowSizeInMinibatches == 0)
+    {
+        InvalidArgument("Bucketing window size cannot be zero.");
+    }
+}
+
+void SequenceBucketizer::StartEpoch(const EpochConfiguration& config)
+{
+    m_sequenceProvider->StartEpoch(config);
+
+    // Sequences left from the previous epoch are dropped, the underlying enumerator repositions itself.
+    m_window.clear();
+    m_numberOfSamplesInWindow = 0;
+    m_endOfEpochReached = false;
+
+    m_numberOfSamples = 0;
+    m_numberOfColumns = 0;
+    m_numberOfMinibatches = 0;
+}
+
+void SequenceBucketizer::FillWindow(size_t sampleCount)
+{
+    size_t windowSize = sampleCount * m_windowSizeInMinibatches;
+    while (!m_endOfEpochReached && m_numberOfSamplesInWindow < windowSize)
+    {
+        Sequences sequences = m_sequenceProvider->GetNextSequences(sampleCount);
+        m_endOfEpochReached = sequences.m_endOfEpoch;
+        if (sequences.m_data.empty())
+        {
+            continue;
+        }
+
+        for (size_t i = 0; i < sequences.m_data.front().size(); ++i)
+        {
+            WindowSequence sequence;
+            sequence.m_numberOfSamples = 0;
+            sequence.m_data.reserve(sequences.m_data.size());
+            for (const auto& stream : sequences.m_data)
+            {
+                sequence.m_data.push_back(stream[i]);
+                sequence.m_numberOfSamples = std::max<size_t>(sequence.m_numberOfSamples, stream[i]->m_numberOfSamples);
+            }
+
+            m_numberOfSamplesInWindow += sequence.m_numberOfSamples;
+            m_window.push_back(std::move(sequence));
+        }
+    }
+}
+
+// Buckets are defined by quantiles of the sequence lengths,
+// the boundary i is the largest length of bucket i.
+std::vector<size_t> SequenceBucketizer::GetBucketBoundaries(std::vector<size_t> lengths, size_t numberOfBuckets)
+{
+    std::vector<size_t> boundaries;
+    if (lengths.empty())
+    {
+        return boundaries;
+    }
+
+    std::sort(lengths.begin(), lengths.end());
+
+    boundaries.reserve(numberOfBuckets);
+    for (size_t i = 1; i <= numberOfBuckets; ++i)
+    {
+        size_t index = (lengths.size() * i) / numberOfBuckets;
+        boundaries.push_back(lengths[std::max<size_t>(index, 1) - 1]);
+    }
+
+    return boundaries;
+}
+
+size_t SequenceBucketizer::GetBucket(const std::vector<size_t>& boundaries, size_t length)
+{
+    return std::lower_bound(boundaries.begin(), boundaries.end(), length) - boundaries.begin();
+}
+
+std::vector<size_t> SequenceBucketizer::GetWindowBucketBoundaries() const
+{
+    std::vector<size_t> lengths;
+    lengths.reserve(m_window.size());
+    for (const auto& sequence : m_window)
+    {
+        lengths.push_back(sequence.m_numberOfSamples);
+    }
+
+    return GetBucketBoundaries(std::move(lengths), m_numberOfBuckets);
+}
+
+Sequences SequenceBucketizer::GetNextSequences(size_t sampleCount)
+{
+    FillWindow(sampleCount);
+
+    Sequences result;
+    if (m_window.empty())
+    {
+        result.m_endOfEpoch = m_endOfEpochReached;
+        if (result.m_endOfEpoch)
+        {
+            PrintPaddingStatistics();
+        }
+
+        return result;
+    }
+
+    // Finding the bucket of the oldest sequence.
+    std::vector<size_t> boundaries = GetWindowBucketBoundaries();
+    size_t bucket = GetBucket(boundaries, m_window.front().m_numberOfSamples);
+
+    // Taking sequences of the bucket in the retrieval order, always at least one sequence.
+    std::vector<bool> selected(m_window.size(), false);
+    std::vector<size_t> selectedLengths;
+    size_t numberOfSamples = 0;
+    for (size_t i = 0; i < m_window.size(); ++i)
+    {
+        const auto& sequence = m_window[i];
+        if (GetBucket(boundaries, sequence.m_numberOfSamples) != bucket)
+        {
+            continue;
+        }
+
+        if (!selectedLengths.empty() && numberOfSamples + sequence.m_numberOfSamples > sampleCount)
+        {
+            break;
+        }
+
+        selected[i] = true;
+        selectedLengths.push_back(sequence.m_numberOfSamples);
+        numberOfSamples += sequence.m_numberOfSamples;
+    }
+
+    result.m_data.resize(m_window.front().m_data.size());
+    std::deque<WindowSequence> rest;
+    for (size_t i = 0; i < m_window.size(); ++i)
+    {
+        auto& sequence = m_window[i];
+        if (!selected[i])
+        {
+            rest.push_back(std::move(sequence));
+            continue;
+        }
+
+        for (size_t streamIndex = 0; streamIndex < sequence.m_data.size(); ++streamIndex)
+        {
+            result.m_data[streamIndex].push_back(sequence.m_data[streamIndex]);
+        }
+    }
+
+    m_window.swap(rest);
+    m_numberOfSamplesInWindow -= numberOfSamples;
+
+    UpdatePaddingStatistics(selectedLengths);
+
+    result.m_endOfEpoch = m_endOfEpochReached && m_window.empty();
+    if (result.m_endOfEpoch)
+    {
+        PrintPaddingStatistics();
+    }
+
+    return result;
+}
+
+// Uses the same packing as SequencePacker::CreateMBLayout to count the columns of the minibatch.
+void SequenceBucketizer::UpdatePaddingStatistics(const std::vector<size_t>& sequenceLengths)
+{
+    std::vector<MBLayout::SequenceInfo> infos;
+    infos.reserve(sequenceLengths.size());
+    for (size_t index = 0; index < sequenceLengths.size(); ++index)
+    {
+        MBLayout::SequenceInfo info;
+        info.seqId = index;
+        info.tBegin = 0;
+        info.tEnd = sequenceLengths[index];
+        infos.push_back(info);
+    }
+
+    std::vector<std::pair<size_t, size_t>> placement;
+    std::vector<size_t> rowAllocations;
+    MBLayout layout;
+    layout.InitAsPackedSequences(infos, placement, rowAllocations);
+
+    m_numberOfSamples += layout.GetActualNumSamples();
+    m_numberOfColumns += layout.GetNumCols();
+    m_numberOfMinibatches++;
+}
+
+void SequenceBucketizer::PrintPaddingStatistics() const
+{
+    if (m_numberOfColumns == 0)
+    {
+        return;
+    }
+
+    fprintf(stderr, "SequenceBucketizer: %" PRIu64 " buckets, %" PRIu64 " minibatches, %" PRIu64 " samples in %" PRIu64 " columns, padding efficiency %.2f%%\n",
+        m_numberOfBuckets,
+        m_numberOfMinibatches,
+        m_numberOfSamples,
+        m_numberOfColumns,
+        100.0 * m_numberOfSamples / m_numberOfColumns);
+}
+
+}}}
@@ -0,0 +1,81 @@
+//
+// Copyright (c) Microsoft. All rights reserved.
+// Licensed under the MIT license. See LICENSE.md file in the project root for full license information.
+//
+
+#pragma once
+
+#include <deque>
+#include "SequenceEnumerator.h"
+
+namespace Microsoft { namespace MSR { namespace CNTK {
+
+// A sequence enumerator that groups sequences of similar length into the same minibatch, so that
+// the packer produces less gaps in the minibatch layout.
+// Delegates retrieving of sequences to another sequence enumerator (usually the randomizer), keeps a window of
+// retrieved sequences and splits it into the configured number of buckets by length (quantiles of the window).
+// Each minibatch is seeded with the oldest sequence of the window and filled with sequences from the same bucket
+// in the order they were retrieved, so the order across buckets still follows the randomized order.
+class SequenceBucketizer : public SequenceEnumerator
+{
+public:
+    // numberOfBuckets - number of length buckets the window is split into,
+    // windowSizeInMinibatches - size of the window of retrieved sequences, in minibatches.
+    SequenceBucketizer(size_t numberOfBuckets, size_t windowSizeInMinibatches, SequenceEnumeratorPtr sequenceProvider);
+
+    virtual std::vector<StreamDescriptionPtr> GetStreamDescriptions() const override
+    {
+        return m_sequenceProvider->GetStreamDescriptions();
+    }
+
+    virtual void StartEpoch(const EpochConfiguration& config) override;
+
+    // Gets next sequences of a single bucket up to a maximum count of samples.
+    virtual Sequences GetNextSequences(size_t sampleCount) override;
+
+    // Returns the length boundaries of the buckets for the given sequence lengths (quantiles),
+    // the boundary i is the largest length of bucket i.
+    static std::vector<size_t> GetBucketBoundaries(std::vector<size_t> lengths, size_t numberOfBuckets);
+
+    // Returns the bucket a sequence of the given length belongs to.
+    static size_t GetBucket(const std::vector<size_t>& boundaries, size_t length);
+
+private:
+    // A sequence in the window, with data for all streams.
+    struct WindowSequence
+    {
+        std::vector<SequenceDataPtr> m_data;
+        size_t m_numberOfSamples;
+    };
+
+    // Retrieves sequences from the underlying enumerator until the window is full or the epoch ends.
+    void FillWindow(size_t sampleCount);
+
+    // Returns the length boundaries of the buckets for the current window.
+    std::vector<size_t> GetWindowBucketBoundaries() const;
+
+    // Updates padding statistics with the layout the packer will create for the given sequences.
+    void UpdatePaddingStatistics(const std::vector<size_t>& sequenceLengths);
+
+    void PrintPaddingStatistics() const;
+
+    SequenceEnumeratorPtr m_sequenceProvider;
+    size_t m_numberOfBuckets;
+    size_t m_windowSizeInMinibatches;
+
+    // Retrieved sequences that have not been returned yet, in the order of retrieval.
+    std::deque<WindowSequence> m_window;
+    size_t m_numberOfSamplesInWindow;
+
+    // Indicates that the underlying enumerator has reached the end of the epoch.
+    bool m_endOfEpochReached;
+
+    // Padding statistics for the current epoch.
+    size_t m_numberOfSamples;
+    size_t m_numberOfColumns;
+    size_t m_numberOfMinibatches;
+};
+
+typedef std::shared_ptr<SequenceBucketizer> SequenceBucketizerPtr;
+
+}}}
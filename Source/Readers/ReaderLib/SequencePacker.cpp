@@ -16,24 +16,15 @@ namespace Microsoft { namespace MSR { namespace CNTK {
 
 MBLayoutPtr SequencePacker::CreateMBLayout(const StreamBatch& batch)
 {
-    vector<MBLayout::SequenceInfo> infos;
+    m_sequenceLengths.resize(batch.size());
     for (size_t index = 0; index < batch.size(); ++index)
     {
-        MBLayout::SequenceInfo info;
-
-        info.seqId = index;
-        info.tBegin = 0;
-        info.tEnd = batch[index]->m_numberOfSamples;
-        infos.push_back(info);
+        m_sequenceLengths[index] = batch[index]->m_numberOfSamples;
     }
 
-    vector<pair<size_t, size_t>> placement;
-    vector<size_t> rowAllocations;
-
-    // Creating the minibatch layout.
-    MBLayoutPtr pMBLayout = make_shared<MBLayout>();
-    pMBLayout->InitAsPackedSequences(infos, placement, rowAllocations);
-    return pMBLayout;
+    // Streams of the same minibatch, and minibatches with the same sequence lengths,
+    // share one packed layout. It is only read from afterwards.
+    return m_layoutCache.Get(m_sequenceLengths).m_layout;
 }
 
 Minibatch SequencePacker::ReadMinibatch()
@@ -42,6 +33,11 @@ Minibatch SequencePacker::ReadMinibatch()
     const auto& batch = sequences.m_data;
 
     Minibatch minibatch(sequences.m_endOfEpoch);
+    if (sequences.m_endOfEpoch)
+    {
+        PrintLayoutCacheStatistics();
+    }
+
     if (batch.empty())
     {
         return minibatch;
@@ -49,6 +45,9 @@ Minibatch SequencePacker::ReadMinibatch()
 
     assert(m_outputStreamDescriptions.size() == batch.size());
 
+    // Packing into a new set of buffers, so that previously returned minibatches stay valid.
+    MoveToNextBuffer();
+
     for (int streamIndex = 0; streamIndex < batch.size(); ++streamIndex)
     {
         const auto& streamBatch = batch[streamIndex];
@@ -56,7 +55,7 @@ Minibatch SequencePacker::ReadMinibatch()
         auto pMBLayout = (type == StorageType::dense) ?
             PackDenseStream(streamBatch, streamIndex) : PackSparseStream(streamBatch, streamIndex);
 
-        auto& buffer = m_streamBuffers[streamIndex];
+        auto& buffer = GetStreamBuffer(streamIndex);
 
         auto streamMinibatch = std::make_shared<StreamMinibatch>();
         streamMinibatch->m_data = buffer.m_data.get();
@@ -67,11 +66,17 @@ Minibatch SequencePacker::ReadMinibatch()
     return minibatch;
 }
 
+void SequencePacker::StartEpoch(const EpochConfiguration& config)
+{
+    PackerBase::StartEpoch(config);
+    m_layoutCacheStatisticsPrinted = false;
+}
+
 MBLayoutPtr SequencePacker::PackDenseStream(const StreamBatch& batch, size_t streamIndex)
 {
     assert(m_outputStreamDescriptions[streamIndex]->m_storageType == StorageType::dense);
     const auto& stream = m_inputStreamDescriptions[streamIndex];
-    auto& buffer = m_streamBuffers[streamIndex];
+    auto& buffer = GetStreamBuffer(streamIndex);
     size_t sampleSize = GetSampleSize(stream);
     auto pMBLayout = CreateMBLayout(batch);
     size_t requiredSize = pMBLayout->GetNumCols() * sampleSize;
@@ -171,7 +176,7 @@ MBLayoutPtr SequencePacker::PackSparseStream(const StreamBatch& batch, size_t st
         nnzCount * (elementSize + indexSize) +
         indexSize * (pMBLayout->GetNumCols() + 1);
 
-    auto& buffer = m_streamBuffers[streamIndex];
+    auto& buffer = GetStreamBuffer(streamIndex);
     if (buffer.m_size < requiredSize)
     {
         buffer.Resize(requiredSize);
@@ -273,4 +278,21 @@ MBLayoutPtr SequencePacker::PackSparseStream(const StreamBatch& batch, size_t st
     return pMBLayout;
 }
 
+void SequencePacker::PrintLayoutCacheStatistics()
+{
+    // The end of the epoch may be reported by the last minibatch and again by the reads after it.
+    const auto& statistics = m_layoutCache.GetStatistics();
+    if (m_verbosity == 0 || m_layoutCacheStatisticsPrinted || statistics.m_numHits + statistics.m_numMisses == 0)
+    {
+        return;
+    }
+
+    m_layoutCacheStatisticsPrinted = true;
+
+    fprintf(stderr, "SequencePacker: %" PRIu64 " layouts requested, %.2f%% served from the layout cache, %.3f seconds saved\n",
+        statistics.m_numHits + statistics.m_numMisses,
+        100.0 * statistics.HitRate(),
+        statistics.m_secondsSaved);
+}
+
 }}}
@@ -11,20 +11,27 @@ namespace Microsoft { namespace MSR { namespace CNTK {
 
 // This packer generates minibatches containing full sequences packed for 
 // efficient (concurrent) consumption on a GPU.
+// With a non-zero verbosity, the statistics of the layout cache are printed at the end of each epoch.
 class SequencePacker : public PackerBase
 {
 public:
     SequencePacker(
         MemoryProviderPtr memoryProvider,
         SequenceEnumeratorPtr sequenceEnumerator,
-        const std::vector<StreamDescriptionPtr>& streams) :
-        PackerBase(memoryProvider, sequenceEnumerator, streams)
+        const std::vector<StreamDescriptionPtr>& streams,
+        size_t numberOfBuffers = 1,
+        int verbosity = 0) :
+        PackerBase(memoryProvider, sequenceEnumerator, streams, numberOfBuffers),
+        m_verbosity(verbosity),
+        m_layoutCacheStatisticsPrinted(false)
     {
 
     }
 
     virtual Minibatch ReadMinibatch() override;
 
+    virtual void StartEpoch(const EpochConfiguration& config) override;
+
 protected:
     virtual MBLayoutPtr PackDenseStream(const StreamBatch& batch, size_t streamIndex);
 
@@ -33,6 +40,23 @@ protected:
     // Given a number of sequences, creates an MB layout that is used to guide
     // the actual packing.
     virtual MBLayoutPtr CreateMBLayout(const StreamBatch& batch);
+
+    // Prints the statistics of the layout cache once per epoch, if verbose.
+    void PrintLayoutCacheStatistics();
+
+public:
+    const PackedMBLayoutCache::Statistics& GetLayoutCacheStatistics() const
+    {
+        return m_layoutCache.GetStatistics();
+    }
+
+private:
+    // Packed layouts by sequence lengths of the minibatch.
+    PackedMBLayoutCache m_layoutCache;
+    std::vector<size_t> m_sequenceLengths;
+
+    int m_verbosity;
+    bool m_layoutCacheStatisticsPrinted;
 };
 
 typedef std::shared_ptr<SequencePacker> SequencePackerPtr;
@@ -8,83 +8,250 @@
 #include <string>
 #include <memory>
 #include <vector>
-#include <map>
+#include <stdint.h>
 #include "Basics.h"
 
 namespace Microsoft { namespace MSR { namespace CNTK {
 
 // This class represents a string registry pattern to share strings between different deserializers if needed.
 // It associates a unique key for a given string.
+// Ids are assigned consecutively starting from zero and never change.
 // Currently it is implemented in-memory, but can be unloaded to external disk if needed.
+//
+// The registry can hold tens of millions of sequence keys, so instead of a node based map it keeps
+// the characters of all strings in a single append-only arena (plus an offset per string) and
+// looks them up with an open-addressing hash index, that stores a part of the hash next to the id,
+// so that most of the probes do not touch the arena.
 // TODO: Move this class to Basics.h when it is required by more than one reader.
 template<class TString>
 class TStringToIdMap
 {
+    typedef typename TString::value_type TChar;
+
 public:
-    TStringToIdMap()
+    TStringToIdMap() : m_offsets(1, 0)
     {}
 
-    // Adds string value to the registry.
+    // Reserves memory for the given number of values with the given total number of characters.
+    void Reserve(size_t numberOfValues, size_t numberOfCharacters)
+    {
+        m_data.reserve(numberOfCharacters);
+        m_offsets.reserve(numberOfValues + 1);
+        size_t capacity = m_index.empty() ? s_minIndexSize : m_index.size();
+        while (IsOverloaded(numberOfValues, capacity))
+        {
+            capacity *= 2;
+        }
+
+        if (capacity != m_index.size())
+        {
+            Rehash(capacity);
+        }
+    }
+
+    // Adds string value to the registry, returns the id of the value if it already exists.
     size_t AddValue(const TString& value)
     {
-        auto iter = m_values.insert(std::make_pair(value, m_indexedValues.size()));
-        m_indexedValues.push_back(&((iter.first)->first));
-        return m_indexedValues.size() - 1;
+        return Add(value.data(), value.size(), Hash(value.data(), value.size()));
+    }
+
+    // Adds values in bulk. The resulting id of values[i] is stored in ids[i].
+    void AddValues(const std::vector<TString>& values, std::vector<size_t>& ids)
+    {
+        size_t numberOfCharacters = 0;
+        for (const auto& value : values)
+        {
+            numberOfCharacters += value.size();
+        }
+
+        Reserve(Size() + values.size(), m_data.size() + numberOfCharacters);
+
+        ids.resize(values.size());
+        for (size_t i = 0; i < values.size(); ++i)
+        {
+            ids[i] = AddValue(values[i]);
+        }
     }
 
     // Tries to get a value by id.
     bool TryGet(const TString& value, size_t& id) const
     {
-        const auto& it = m_values.find(value);
-        if (it == m_values.end())
+        size_t slot = 0;
+        if (!Find(value.data(), value.size(), Hash(value.data(), value.size()), slot))
         {
             return false;
         }
-        else
-        {
-            id = it->second;
-            return true;
-        }
+
+        id = m_index[slot].m_id;
+        return true;
     }
 
     // Get integer id for the string value, adding if not exists.
     size_t operator[](const TString& value)
     {
-        const auto& it = m_values.find(value);
-        if (it == m_values.end())
-        {
-            return AddValue(value);
-        }
-        return it->second;
+        return AddValue(value);
     }
 
     // Get integer id for the string value.
     size_t operator[](const TString& value) const
     {
-        const auto& it = m_values.find(value);
-        assert(it != m_values.end());
-        return it->second;
+        size_t id = 0;
+        bool found = TryGet(value, id);
+        assert(found);
+        UNUSED(found);
+        return id;
     }
 
     // Get string value by its integer id.
-    const TString& operator[](size_t id) const
+    TString operator[](size_t id) const
     {
-        assert(id < m_indexedValues.size());
-        return *m_indexedValues[id];
+        assert(id < Size());
+        return TString(m_data.data() + m_offsets[id], m_offsets[id + 1] - m_offsets[id]);
     }
 
     // Checks whether the value exists.
     bool Contains(const TString& value) const
     {
-        return m_values.find(value) != m_values.end();
+        size_t slot = 0;
+        return Find(value.data(), value.size(), Hash(value.data(), value.size()), slot);
+    }
+
+    // Gets the number of values.
+    size_t Size() const
+    {
+        return m_offsets.size() - 1;
+    }
+
+    // Gets the number of bytes allocated by the registry.
+    size_t GetMemoryUsage() const
+    {
+        return m_data.capacity() * sizeof(TChar) +
+            m_offsets.capacity() * sizeof(size_t) +
+            m_index.capacity() * sizeof(Slot);
     }
 
 private:
     // TODO: Move NonCopyable as a separate class to Basics.h
     DISABLE_COPY_AND_MOVE(TStringToIdMap);
 
-    std::map<TString, size_t> m_values;
-    std::vector<const TString*> m_indexedValues;
+    // An entry of the hash index: an id and 32 bits of the hash of the value.
+    struct Slot
+    {
+        uint32_t m_hash;
+        uint32_t m_id;
+    };
+
+    static const uint32_t s_emptySlot = UINT32_MAX;
+    static const size_t s_minIndexSize = 64;
+
+    // The index is kept at most 3/4 full.
+    static bool IsOverloaded(size_t numberOfValues, size_t indexSize)
+    {
+        return numberOfValues * 4 > indexSize * 3;
+    }
+
+    // FNV-1a hash of the characters.
+    static uint32_t Hash(const TChar* value, size_t length)
+    {
+        uint64_t hash = 14695981039346656037ULL;
+        const unsigned char* bytes = reinterpret_cast<const unsigned char*>(value);
+        for (size_t i = 0; i < length * sizeof(TChar); ++i)
+        {
+            hash = (hash ^ bytes[i]) * 1099511628211ULL;
+        }
+
+        return (uint32_t)(hash ^ (hash >> 32));
+    }
+
+    // Finds the slot of the value, or the empty slot where the value would be inserted.
+    bool Find(const TChar* value, size_t length, uint32_t hash, size_t& slot) const
+    {
+        slot = 0;
+        if (m_index.empty())
+        {
+            return false;
+        }
+
+        const size_t mask = m_index.size() - 1;
+        for (slot = hash & mask; m_index[slot].m_id != s_emptySlot; slot = (slot + 1) & mask)
+        {
+            const Slot& entry = m_index[slot];
+            if (entry.m_hash != hash)
+            {
+                continue;
+            }
+
+            size_t begin = m_offsets[entry.m_id];
+            if (m_offsets[entry.m_id + 1] - begin == length &&
+                std::char_traits<TChar>::compare(m_data.data() + begin, value, length) == 0)
+            {
+                return true;
+            }
+        }
+
+        return false;
+    }
+
+    size_t Add(const TChar* value, size_t length, uint32_t hash)
+    {
+        if (m_index.empty() || IsOverloaded(Size() + 1, m_index.size()))
+        {
+            Rehash(m_index.empty() ? s_minIndexSize : m_index.size() * 2);
+        }
+
+        size_t slot = 0;
+        if (Find(value, length, hash, slot))
+        {
+            return m_index[slot].m_id;
+        }
+
+        size_t id = Size();
+        if (id >= s_emptySlot)
+        {
+            RuntimeError("TStringToIdMap: the number of values exceeds the maximum of %u.", (unsigned int)(s_emptySlot - 1));
+        }
+
+        m_data.insert(m_data.end(), value, value + length);
+        m_offsets.push_back(m_data.size());
+        m_index[slot].m_hash = hash;
+        m_index[slot].m_id = (uint32_t)id;
+        return id;
+    }
+
+    // Rebuilds the index with the given (power of two) size, using the stored hashes.
+    void Rehash(size_t indexSize)
+    {
+        assert((indexSize & (indexSize - 1)) == 0);
+        Slot empty;
+        empty.m_hash = 0;
+        empty.m_id = s_emptySlot;
+        std::vector<Slot> index(indexSize, empty);
+
+        const size_t mask = indexSize - 1;
+        for (const auto& entry : m_index)
+        {
+            if (entry.m_id == s_emptySlot)
+            {
+                continue;
+            }
+
+            size_t slot = entry.m_hash & mask;
+            while (index[slot].m_id != s_emptySlot)
+            {
+                slot = (slot + 1) & mask;
+            }
+            index[slot] = entry;
+        }
+
+        m_index.swap(index);
+    }
+
+    // Characters of all values, value i is [m_offsets[i], m_offsets[i + 1]).
+    std::vector<TChar> m_data;
+    std::vector<size_t> m_offsets;
+
+    // Open-addressing hash index with linear probing, the size is a power of two.
+    std::vector<Slot> m_index;
 };
 
 typedef TStringToIdMap<std::wstring> WStringToIdMap;
@@ -108,8 +108,9 @@ struct SequenceBuffer
 TruncatedBPTTPacker::TruncatedBPTTPacker(
     MemoryProviderPtr memoryProvider,
     SequenceEnumeratorPtr sequenceEnumerator,
-    const vector<StreamDescriptionPtr>& streams)
-    : PackerBase(memoryProvider, sequenceEnumerator, streams),
+    const vector<StreamDescriptionPtr>& streams,
+    size_t numberOfBuffers)
+    : PackerBase(memoryProvider, sequenceEnumerator, streams, numberOfBuffers),
     m_truncationSize(0)
 {
     auto sparseOutput = find_if(m_outputStreamDescriptions.begin(), m_outputStreamDescriptions.end(), [](const StreamDescriptionPtr& s){ return s->m_storageType == StorageType::sparse_csc; });
@@ -119,12 +120,16 @@ TruncatedBPTTPacker::TruncatedBPTTPacker(
         RuntimeError("Sparse output is not supported in BPTT mode.");
     }
 
-    // Preparing layouts.
-    for (int i = 0; i < m_outputStreamDescriptions.size(); ++i)
+    // Preparing layouts, a separate set per buffer because layouts are returned as part of the minibatch.
+    m_currentLayouts.resize(m_streamBuffers.size());
+    for (auto& layouts : m_currentLayouts)
     {
-        auto pMBLayout = make_shared<MBLayout>();
-        pMBLayout->SetUniqueAxisName(L"TruncatedBPTTPacker");
-        m_currentLayouts.push_back(pMBLayout);
+        for (int i = 0; i < m_outputStreamDescriptions.size(); ++i)
+        {
+            auto pMBLayout = make_shared<MBLayout>();
+            pMBLayout->SetUniqueAxisName(L"TruncatedBPTTPacker");
+            layouts.push_back(pMBLayout);
+        }
     }
 }
 
@@ -163,8 +168,10 @@ void TruncatedBPTTPacker::StartEpoch(const EpochConfiguration& config)
         for (int i = 0; i < m_outputStreamDescriptions.size(); ++i)
         {
             const auto& stream = m_outputStreamDescriptions[i];
-            auto& buffer = m_streamBuffers[i];
-            buffer.Resize(m_numParallelSequences * m_truncationSize * GetSampleSize(stream));
+            for (auto& buffers : m_streamBuffers)
+            {
+                buffers[i].Resize(m_numParallelSequences * m_truncationSize * GetSampleSize(stream));
+            }
             m_sequenceBufferPerStream.push_back(make_shared<SequenceBuffer>(m_numParallelSequences));
         }
     }
@@ -188,10 +195,13 @@ Minibatch TruncatedBPTTPacker::ReadMinibatch()
         return result;
     }
 
+    // Packing into a new set of buffers, so that previously returned minibatches stay valid.
+    MoveToNextBuffer();
+
     // Iterating over the streams/slots and packing them into the minibatch.
     for (size_t streamIndex = 0; streamIndex < m_outputStreamDescriptions.size(); ++streamIndex)
     {
-        m_currentLayouts[streamIndex]->Init(m_numParallelSequences, m_truncationSize);
+        GetCurrentLayout(streamIndex)->Init(m_numParallelSequences, m_truncationSize);
         size_t sequenceId = 0;
         for (size_t slotIndex = 0; slotIndex < m_numParallelSequences; ++slotIndex)
         {
@@ -199,8 +209,8 @@ Minibatch TruncatedBPTTPacker::ReadMinibatch()
         }
 
         StreamMinibatchPtr m = make_shared<StreamMinibatch>();
-        m->m_data = m_streamBuffers[streamIndex].m_data.get();
-        m->m_layout = m_currentLayouts[streamIndex];
+        m->m_data = GetStreamBuffer(streamIndex).m_data.get();
+        m->m_layout = GetCurrentLayout(streamIndex);
         result.m_data.push_back(m);
     }
 
@@ -220,7 +230,7 @@ void TruncatedBPTTPacker::PackSlot(size_t streamIndex, size_t slotIndex, size_t&
     if (numberOfSamples == 0)
     {
         // Reached the end of the data, put the corresponding row in the minibatch layout to gap.
-        m_currentLayouts[streamIndex]->AddSequence(GAP_SEQUENCE_ID, slotIndex, 0, m_truncationSize);
+        GetCurrentLayout(streamIndex)->AddSequence(GAP_SEQUENCE_ID, slotIndex, 0, m_truncationSize);
 
         // Check that nothing is in the slot any more.
         assert(slot.IsEmpty());
@@ -235,7 +245,7 @@ void TruncatedBPTTPacker::PackSlot(size_t streamIndex, size_t slotIndex, size_t&
     size_t strideSize = m_numParallelSequences * sampleSize;
 
     // Add current sequence to the minibatch layout.
-    m_currentLayouts[streamIndex]->AddSequence(
+    GetCurrentLayout(streamIndex)->AddSequence(
         sequenceId++,
         slotIndex,
         -(int)slot.m_sampleCursor,
@@ -251,7 +261,7 @@ void TruncatedBPTTPacker::PackSlot(size_t streamIndex, size_t slotIndex, size_t&
             slot.PopSequence();
 
             //Adding next sequence to the minibatch.
-            m_currentLayouts[streamIndex]->AddSequence(
+            GetCurrentLayout(streamIndex)->AddSequence(
                 sequenceId++,
                 slotIndex,
                 currentTimestep,
@@ -261,7 +271,7 @@ void TruncatedBPTTPacker::PackSlot(size_t streamIndex, size_t slotIndex, size_t&
         // Fill in the data from the first sequence in the slot.
         auto data = slot.FrontSequence();
         // Get buffer destination for the current sample.
-        auto& buffer = m_streamBuffers[streamIndex];
+        auto& buffer = GetStreamBuffer(streamIndex);
         auto offset = strideSize * currentTimestep + slotIndex * sampleSize;
         assert(offset >= 0 && offset < buffer.m_size);
         char* destination = buffer.m_data.get() + offset;
@@ -297,7 +307,7 @@ void TruncatedBPTTPacker::PackSlot(size_t streamIndex, size_t slotIndex, size_t&
     // Adding the last gap if there is one.
     if (numberOfSamples < m_truncationSize)
     {
-        m_currentLayouts[streamIndex]->AddSequence(
+        GetCurrentLayout(streamIndex)->AddSequence(
             GAP_SEQUENCE_ID,
             slotIndex,
             numberOfSamples,
@@ -23,7 +23,8 @@ public:
     TruncatedBPTTPacker(
         MemoryProviderPtr memoryProvider,
         SequenceEnumeratorPtr sequenceEnumerator,
-        const std::vector<StreamDescriptionPtr>& streams);
+        const std::vector<StreamDescriptionPtr>& streams,
+        size_t numberOfBuffers = 1);
 
     virtual Minibatch ReadMinibatch() override;
 
@@ -59,9 +60,15 @@ private:
     // that get filled with sequences.
     std::vector<SequenceBufferPtr> m_sequenceBufferPerStream;
 
-    // Layout per stream.
+    // Layout per stream, one set per buffer (indexed as [buffer index][stream index]).
     // TODO: currently assume that layout is the same between different streams, this will change.
-    std::vector<MBLayoutPtr> m_currentLayouts;
+    std::vector<std::vector<MBLayoutPtr>> m_currentLayouts;
+
+    // Returns the layout of the given stream in the current buffer set.
+    const MBLayoutPtr& GetCurrentLayout(size_t streamIndex) const
+    {
+        return m_currentLayouts[m_currentBufferIndex][streamIndex];
+    }
 };
 
 typedef std::shared_ptr<TruncatedBPTTPacker> TruncatedBPTTPackerPtr;
@@ -0,0 +1,270 @@
+//
+// Copyright (c) Microsoft. All rights reserved.
+// Licensed under the MIT license. See LICENSE.md file in the project root for full license information.
+//
+#pragma once
+
+#include "Basics.h"
+#include "File.h"
+#include "fileutil.h"
+#include "TimerUtility.h"
+#include <cstdio>
+#include <string>
+#include <deque>
+#include <vector>
+#include <memory>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <exception>
+#include <algorithm>
+
+namespace Microsoft { namespace MSR { namespace CNTK {
+
+// Writes the files of checkpoints (model, SGD state) on a background thread.
+// The files are serialized on the calling thread into host memory: each file is fully buffered (File::SetBuffer())
+// in a buffer that is sized after the same file of the previous checkpoint, so serializing only copies the
+// parameters into memory. The background thread then writes the buffers to temporary files, renames them to their
+// final names once they are complete, and deletes the files of older checkpoints, in submission order.
+// There are 'numBufferSets' sets of buffers (2 = double buffering): a new checkpoint waits in BeginCheckpoint()
+// only if that many checkpoints are still being written.
+// With async = false the files are written on the calling thread, without extra buffers.
+class AsyncCheckpointWriter
+{
+public:
+    AsyncCheckpointWriter(bool async, size_t numBufferSets = 2)
+        : m_async(async), m_writing(false), m_stop(false), m_bufferSets(numBufferSets)
+    {
+        if (numBufferSets == 0)
+            InvalidArgument("AsyncCheckpointWriter: the number of buffer sets must be positive.");
+
+        for (size_t i = 0; i < numBufferSets; i++)
+            m_freeBufferSets.push_back(i);
+
+        if (m_async)
+            m_thread = std::thread([this] { WriteCheckpoints(); });
+    }
+
+    ~AsyncCheckpointWriter()
+    {
+        if (m_async)
+        {
+            {
+                std::unique_lock<std::mutex> lock(m_mutex);
+                m_stop = true;
+            }
+            m_queueChanged.notify_all();
+            m_thread.join();
+        }
+    }
+
+    // Starts a new checkpoint, waiting for a free set of buffers. Rethrows a failure of a previous checkpoint.
+    void BeginCheckpoint()
+    {
+        std::unique_lock<std::mutex> lock(m_mutex);
+        if (m_current)
+        {
+            // the serialization of the previous checkpoint failed, drop it
+            m_current->m_files.clear();
+            m_freeBufferSets.push_back(m_current->m_bufferSet);
+            m_current.reset();
+        }
+
+        m_queueChanged.wait(lock, [this] { return m_error || !m_freeBufferSets.empty(); });
+        RethrowError();
+        m_current.reset(new Checkpoint());
+        m_current->m_bufferSet = m_freeBufferSets.front();
+        m_freeBufferSets.pop_front();
+    }
+
+    // Opens the temporary file for 'fileName' in the current checkpoint, buffered by at least 'sizeHint' bytes of memory.
+    File& AddFile(const std::wstring& fileName, size_t sizeHint)
+    {
+        if (!m_current)
+            LogicError("AsyncCheckpointWriter: AddFile() was called outside of a checkpoint.");
+
+        CheckpointFile file;
+        file.m_fileName = fileName;
+        file.m_tempFileName = fileName + L".tmp";
+        file.m_file.reset(new File(file.m_tempFileName, FileOptions::fileOptionsBinary | FileOptions::fileOptionsWrite));
+        if (m_async)
+        {
+            // the n-th file of a checkpoint always gets the n-th buffer of the set
+            const size_t index = m_current->m_files.size();
+            std::vector<char>& buffer = GetBuffer(m_current->m_bufferSet, index);
+            size_t size = std::max(sizeHint, index < m_lastFileSizes.size() ? m_lastFileSizes[index] : 0);
+            size += size / 8 + s_bufferSlack;
+            if (buffer.size() < size)
+            {
+                std::vector<char>().swap(buffer); // release the old buffer first
+                buffer.resize(size);
+            }
+            file.m_file->SetBuffer(buffer.data(), buffer.size());
+        }
+
+        m_current->m_files.push_back(std::move(file));
+        return *m_current->m_files.back().m_file;
+    }
+
+    // Deletes the given file after the files of this (and all previous) checkpoints have been written.
+    void AddFileToDelete(const std::wstring& fileName)
+    {
+        if (!m_current)
+            LogicError("AsyncCheckpointWriter: AddFileToDelete() was called outside of a checkpoint.");
+
+        m_current->m_filesToDelete.push_back(fileName);
+    }
+
+    // Hands the checkpoint to the background thread (or writes it right away if not async).
+    void EndCheckpoint()
+    {
+        if (!m_current)
+            LogicError("AsyncCheckpointWriter: EndCheckpoint() was called outside of a checkpoint.");
+
+        std::unique_ptr<Checkpoint> checkpoint(std::move(m_current));
+        m_lastFileSizes.resize(std::max(m_lastFileSizes.size(), checkpoint->m_files.size()));
+        for (size_t i = 0; i < checkpoint->m_files.size(); i++)
+            m_lastFileSizes[i] = (size_t) checkpoint->m_files[i].m_file->GetPosition();
+
+        if (!m_async)
+        {
+            // no buffers are used, so the set is free again even if the write fails
+            {
+                std::unique_lock<std::mutex> lock(m_mutex);
+                m_freeBufferSets.push_back(checkpoint->m_bufferSet);
+            }
+            Write(*checkpoint);
+            return;
+        }
+
+        {
+            std::unique_lock<std::mutex> lock(m_mutex);
+            m_pendingCheckpoints.push_back(std::move(checkpoint));
+        }
+        m_queueChanged.notify_all();
+    }
+
+    // waits until all submitted checkpoints are on disk, rethrows a failure of the writes
+    void WaitForPendingCheckpoints()
+    {
+        std::unique_lock<std::mutex> lock(m_mutex);
+        m_queueChanged.wait(lock, [this] { return m_error || (m_pendingCheckpoints.empty() && !m_writing); });
+        RethrowError();
+    }
+
+private:
+    DISABLE_COPY_AND_MOVE(AsyncCheckpointWriter);
+
+    static const size_t s_bufferSlack = 1 << 20;
+
+    struct CheckpointFile
+    {
+        std::wstring m_fileName;
+        std::wstring m_tempFileName;
+        std::unique_ptr<File> m_file;
+    };
+
+    struct Checkpoint
+    {
+        Checkpoint() : m_bufferSet(0) {}
+        size_t m_bufferSet;
+        std::vector<CheckpointFile> m_files;
+        std::vector<std::wstring> m_filesToDelete;
+    };
+
+    std::vector<char>& GetBuffer(size_t bufferSet, size_t index)
+    {
+        std::vector<std::vector<char>>& buffers = m_bufferSets[bufferSet];
+        if (buffers.size() <= index)
+            buffers.resize(index + 1);
+        return buffers[index];
+    }
+
+    void RethrowError()
+    {
+        if (m_error)
+        {
+            std::exception_ptr error = m_error;
+            m_error = nullptr;
+            std::rethrow_exception(error);
+        }
+    }
+
+    // flushes and closes the files, then renames them and deletes the files of older checkpoints
+    static void Write(Checkpoint& checkpoint)
+    {
+        for (auto& file : checkpoint.m_files)
+        {
+            file.m_file->Flush();
+            file.m_file.reset();
+            _wunlink(file.m_fileName.c_str());
+            renameOrDie(file.m_tempFileName, file.m_fileName);
+        }
+
+        for (const auto& fileName : checkpoint.m_filesToDelete)
+            _wunlink(fileName.c_str());
+    }
+
+    void WriteCheckpoints()
+    {
+        for (;;)
+        {
+            std::unique_ptr<Checkpoint> checkpoint;
+            {
+                std::unique_lock<std::mutex> lock(m_mutex);
+                m_queueChanged.wait(lock, [this] { return m_stop || !m_pendingCheckpoints.empty(); });
+                if (m_pendingCheckpoints.empty())
+                    return;
+
+                checkpoint = std::move(m_pendingCheckpoints.front());
+                m_pendingCheckpoints.pop_front();
+                m_writing = true;
+            }
+
+            Timer timer;
+            timer.Start();
+            try
+            {
+                Write(*checkpoint);
+            }
+            catch (...)
+            {
+                std::unique_lock<std::mutex> lock(m_mutex);
+                if (!m_error)
+                    m_error = std::current_exception();
+            }
+            timer.Stop();
+
+            if (!checkpoint->m_files.empty())
+            {
+                fprintf(stderr, "AsyncCheckpointWriter: checkpoint '%ls' written in the background in %.2f seconds\n",
+                        checkpoint->m_files.front().m_fileName.c_str(), timer.ElapsedSeconds());
+            }
+
+            {
+                std::unique_lock<std::mutex> lock(m_mutex);
+                checkpoint->m_files.clear(); // closes the files (if a write failed) before their buffers are reused
+                m_freeBufferSets.push_back(checkpoint->m_bufferSet);
+                m_writing = false;
+            }
+            m_queueChanged.notify_all();
+        }
+    }
+
+    bool m_async;
+
+    std::mutex m_mutex;
+    std::condition_variable m_queueChanged;
+    std::deque<std::unique_ptr<Checkpoint>> m_pendingCheckpoints;
+    std::deque<size_t> m_freeBufferSets;
+    bool m_writing; // the background thread is writing a checkpoint taken from m_pendingCheckpoints
+    bool m_stop;
+    std::exception_ptr m_error;
+    std::thread m_thread;
+
+    std::vector<std::vector<std::vector<char>>> m_bufferSets; // [buffer set][file index]
+    std::vector<size_t> m_lastFileSizes;                      // [file index] size in the previous checkpoint
+    std::unique_ptr<Checkpoint> m_current;                    // the checkpoint between BeginCheckpoint() and EndCheckpoint()
+};
+
+}}}
@@ -0,0 +1,171 @@
+//
+// Copyright (c) Microsoft. All rights reserved.
+// Licensed under the MIT license. See LICENSE.md file in the project root for full license information.
+//
+#pragma once
+
+#include "Basics.h"
+#include "fileutil.h"
+#include <cstdio>
+#include <string>
+#include <deque>
+#include <vector>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <exception>
+
+namespace Microsoft { namespace MSR { namespace CNTK {
+
+// Writes blocks of formatted output to files on a background thread, so that the (blocking) writes
+// of one minibatch overlap with the evaluation and formatting of the next one.
+// Blocks are written in the order they are submitted, also across files.
+// At most 'maxPendingBlocks' blocks are in flight (2 = double buffering), Write() waits when that limit is reached.
+// Written blocks are recycled through GetBuffer() to avoid reallocating the output buffers for every minibatch.
+// With async = false blocks are written synchronously on the calling thread.
+class AsyncFileWriter
+{
+public:
+    AsyncFileWriter(bool async, size_t maxPendingBlocks = 2)
+        : m_async(async), m_maxPendingBlocks(maxPendingBlocks), m_stop(false)
+    {
+        if (m_maxPendingBlocks == 0)
+            InvalidArgument("AsyncFileWriter: the number of pending blocks must be positive.");
+
+        if (m_async)
+            m_thread = std::thread([this] { WriteBlocks(); });
+    }
+
+    ~AsyncFileWriter()
+    {
+        if (m_async)
+        {
+            {
+                std::unique_lock<std::mutex> lock(m_mutex);
+                m_stop = true;
+            }
+            m_queueChanged.notify_all();
+            m_thread.join();
+        }
+    }
+
+    // returns an empty buffer, reusing the memory of an already written block if possible
+    std::string GetBuffer()
+    {
+        std::unique_lock<std::mutex> lock(m_mutex);
+        std::string buffer;
+        if (!m_freeBuffers.empty())
+        {
+            buffer = std::move(m_freeBuffers.back());
+            m_freeBuffers.pop_back();
+        }
+        buffer.clear();
+        return buffer;
+    }
+
+    // submits a block for writing, rethrows a failure of a previous write
+    void Write(FILE* f, std::string&& block)
+    {
+        if (!m_async)
+        {
+            fwriteOrDie(block.data(), sizeof(char), block.size(), f);
+            std::unique_lock<std::mutex> lock(m_mutex);
+            m_freeBuffers.push_back(std::move(block));
+            return;
+        }
+
+        {
+            std::unique_lock<std::mutex> lock(m_mutex);
+            m_queueChanged.wait(lock, [this] { return m_error || m_pendingBlocks.size() < m_maxPendingBlocks; });
+            RethrowError();
+            m_pendingBlocks.push_back(std::make_pair(f, std::move(block)));
+        }
+        m_queueChanged.notify_all();
+    }
+
+    void Write(FILE* f, const std::string& text)
+    {
+        auto block = GetBuffer();
+        block.assign(text);
+        Write(f, std::move(block));
+    }
+
+    // waits until all submitted blocks are written, rethrows a failure of the writer thread
+    void Flush()
+    {
+        if (!m_async)
+            return;
+
+        std::unique_lock<std::mutex> lock(m_mutex);
+        m_queueChanged.wait(lock, [this] { return m_error || m_pendingBlocks.empty(); });
+        RethrowError();
+    }
+
+private:
+    // must be called under the lock
+    void RethrowError()
+    {
+        if (m_error)
+        {
+            auto error = m_error;
+            m_error = nullptr;
+            std::rethrow_exception(error);
+        }
+    }
+
+    // writer thread: writes the pending blocks in order until stopped
+    void WriteBlocks()
+    {
+        std::unique_lock<std::mutex> lock(m_mutex);
+        for (;;)
+        {
+            m_queueChanged.wait(lock, [this] { return m_stop || !m_pendingBlocks.empty(); });
+            if (m_pendingBlocks.empty()) // stopped and nothing left to write
+                return;
+
+            if (m_error) // a write failed: drop the remaining blocks, the error is reported to the caller
+            {
+                for (auto& pending : m_pendingBlocks)
+                    m_freeBuffers.push_back(std::move(pending.second));
+                m_pendingBlocks.clear();
+                m_queueChanged.notify_all();
+                continue;
+            }
+
+            // the block stays in the queue while it is written, so that Flush() waits for it
+            // (only this thread removes blocks, and push_back() does not invalidate references into a deque)
+            FILE* f = m_pendingBlocks.front().first;
+            std::string& block = m_pendingBlocks.front().second;
+            lock.unlock();
+            std::exception_ptr error;
+            try
+            {
+                fwriteOrDie(block.data(), sizeof(char), block.size(), f);
+            }
+            catch (...)
+            {
+                error = std::current_exception();
+            }
+            lock.lock();
+
+            if (error && !m_error)
+                m_error = error;
+            m_freeBuffers.push_back(std::move(m_pendingBlocks.front().second));
+            m_pendingBlocks.pop_front();
+            m_queueChanged.notify_all();
+        }
+    }
+
+    bool m_async;
+    size_t m_maxPendingBlocks;
+
+    std::mutex m_mutex;
+    std::condition_variable m_queueChanged;
+    std::deque<std::pair<FILE*, std::string>> m_pendingBlocks;
+    std::vector<std::string> m_freeBuffers;
+    std::exception_ptr m_error;
+    bool m_stop;
+    std::thread m_thread;
+};
+
+}}}
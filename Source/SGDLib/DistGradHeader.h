@@ -47,6 +47,38 @@ public:
         }
     }
 
+    // number of values of the header as a flat array of doubles, see CopyTo()/CopyFrom()
+    size_t NumValues() const
+    {
+        return 3 + 2 * (size_t) numEvalNode;
+    }
+
+    // flattens the header into doubles, so that the headers of all workers can be summed with a single allreduce
+    // (the sample counts are exact in a double up to 2^53)
+    void CopyTo(double* values) const
+    {
+        values[0] = (double) numSamples;
+        values[1] = (double) numSamplesWithLabel;
+        values[2] = criterion;
+        for (int i = 0; i < numEvalNode; i++)
+        {
+            values[3 + 2 * i] = evalErrors[i].first;
+            values[4 + 2 * i] = (double) evalErrors[i].second;
+        }
+    }
+
+    void CopyFrom(const double* values)
+    {
+        numSamples = (size_t) values[0];
+        numSamplesWithLabel = (size_t) values[1];
+        criterion = values[2];
+        for (int i = 0; i < numEvalNode; i++)
+        {
+            evalErrors[i].first = values[3 + 2 * i];
+            evalErrors[i].second = (size_t) values[4 + 2 * i];
+        }
+    }
+
     size_t Size() const
     {
         return DistGradHeaderSize(numEvalNode);
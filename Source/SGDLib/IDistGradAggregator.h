@@ -21,6 +21,12 @@ public:
     // Returns a boolean indicating if any samples were processed
     virtual bool AggregateGradients(const std::vector<Matrix<ElemType>*>& gradients, DistGradHeader* headerCPU, int epochNumber) = 0;
 
+    // Called during backprop when gradients[index] is final for the current minibatch, before AggregateGradients() is
+    // called with the same gradients. Aggregators that overlap the aggregation with backprop can start on it right away.
+    virtual void GradientReady(const std::vector<Matrix<ElemType>*>& /*gradients*/, size_t /*index*/)
+    {
+    }
+
     size_t NumProc()
     {
         return m_mpi->NumNodesInUse();
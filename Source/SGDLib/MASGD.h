@@ -17,6 +17,8 @@
 #include <stdexcept>
 #include <chrono> 
 #include <random>
+#include <future>
+#include <algorithm>
 
 
 namespace Microsoft { namespace MSR { namespace CNTK {
@@ -39,12 +41,15 @@ namespace Microsoft { namespace MSR { namespace CNTK {
         size_t m_localSamplesProcessedSinceLastReport; 
         double m_accumulatedSecondsOnSyncPointInOneEpoch;
         size_t m_syncPointHitCounterInOneEpoch;
+        double m_accumulatedSecondsSavedByAsyncMAInOneEpoch;
+        size_t m_numAsyncMAFinishedInOneEpoch;
         Timer  m_Timer; 
 
     public:
         MASGDPerfStats(size_t myRank, size_t numWorkers):
             m_numWorkers(numWorkers), m_myRank(myRank), m_numSyncPerformedInCurrentEpoch(0), m_reportFrequency(1), 
-            m_totalSamplesProcessedSinceLastReport(0), m_localSamplesProcessedSinceLastReport(0)
+            m_totalSamplesProcessedSinceLastReport(0), m_localSamplesProcessedSinceLastReport(0),
+            m_accumulatedSecondsSavedByAsyncMAInOneEpoch(0), m_numAsyncMAFinishedInOneEpoch(0)
         {
             m_Timer.Start();
         }
@@ -60,10 +65,17 @@ namespace Microsoft { namespace MSR { namespace CNTK {
             m_numSyncPerformedInCurrentEpoch = 0; 
             m_accumulatedSecondsOnSyncPointInOneEpoch = 0;
             m_syncPointHitCounterInOneEpoch = 0;
+            m_accumulatedSecondsSavedByAsyncMAInOneEpoch = 0;
+            m_numAsyncMAFinishedInOneEpoch = 0;
         }
         void OnEpochEnd()
         {
             m_Timer.Stop();
+            if (m_numAsyncMAFinishedInOneEpoch > 0)
+            {
+                fprintf(stderr, "\t\t(model aggregation stats): %d asynchronous model aggregations in this epoch, %.2f seconds saved compared to synchronous aggregation\n",
+                        (int)m_numAsyncMAFinishedInOneEpoch, m_accumulatedSecondsSavedByAsyncMAInOneEpoch);
+            }
         }
         void OnMAPerformed(size_t localSamplesProcessedSinceLastSync, size_t totalSamplesProcessedSinceLastSync, float secondsOnCommunication)
         {
@@ -100,6 +112,20 @@ namespace Microsoft { namespace MSR { namespace CNTK {
             }
         }
 
+        // an asynchronous model aggregation that took 'secondsOnAggregation' in the background has been applied,
+        // after the worker waited 'secondsWaited' for it; the difference is the time a synchronous aggregation would have cost in addition
+        void OnAsyncMAFinished(double secondsOnAggregation, double secondsWaited)
+        {
+            double secondsSaved = std::max(0.0, secondsOnAggregation - secondsWaited);
+            m_accumulatedSecondsSavedByAsyncMAInOneEpoch += secondsSaved;
+            m_numAsyncMAFinishedInOneEpoch++;
+            if (m_reportFrequency > 0)
+            {
+                fprintf(stderr, "\t\t(model aggregation stats): asynchronous aggregation took %.2f seconds, waited %.2f seconds for it, saved %.2f seconds; accumulated time saved = %.2f seconds\n",
+                        secondsOnAggregation, secondsWaited, secondsSaved, m_accumulatedSecondsSavedByAsyncMAInOneEpoch);
+            }
+        }
+
         void ReportMAPerfStats( size_t totalSamplesProcessedSinceLastReport, 
                                 size_t localSamplesProcessedSinceLastReport, 
                                 float secondOnCommunication)
@@ -130,12 +156,35 @@ namespace Microsoft { namespace MSR { namespace CNTK {
              m_myRank(pMPI->CurrentNodeRank()),
              m_pMPI(pMPI), 
              m_deviceId(devId),
-             m_perfReporter(pMPI->CurrentNodeRank(), pMPI->NumNodesInUse())
+             m_perfReporter(pMPI->CurrentNodeRank(), pMPI->NumNodesInUse()),
+             m_useHierarchicalAggregation(false),
+             m_useAsyncAggregation(false),
+             m_asyncSamplesSinceLastSync(0),
+             m_asyncTotalSamplesProcessed(0),
+             m_asyncSecondsOnCommunication(0.0f)
          {
              m_perfReporter.SetReportFrequency(perfReportFreq);
          }
          virtual ~IMASGD()
          {
+             // the background aggregation refers to members of this object
+             if (m_pendingAsyncAggregation.valid())
+                 m_pendingAsyncAggregation.wait();
+         }
+
+         // In asynchronous mode, the model aggregation of block k runs on a background thread on a snapshot of the model,
+         // while this worker trains on block k+1. The aggregated model arrives one block late and is applied as a correction
+         // (aggregated snapshot - local snapshot), which keeps the local progress made since the snapshot.
+         // The model is aggregated synchronously at the end of each epoch, so all workers end the epoch with the same model.
+         void SetAsyncAggregation(bool useAsyncAggregation)
+         {
+             m_useAsyncAggregation = useAsyncAggregation;
+         }
+
+         // aggregate the models within each host first, and across the hosts by one leader per host
+         void SetHierarchicalAggregation(bool useHierarchicalAggregation)
+         {
+             m_useHierarchicalAggregation = useHierarchicalAggregation;
          }
          
          virtual void OnEpochStart(const std::list<ComputationNodeBasePtr>& /*LearnableNodes*/)
@@ -151,6 +200,7 @@ namespace Microsoft { namespace MSR { namespace CNTK {
                                     size_t                                      samplesSinceLastSync 
                                     )
          {
+             FinishAsyncAggregation();
              m_MAworkerStatus[m_myRank] = MAWorkerStatus::DataEnd;
              Timer syncPointTimer; syncPointTimer.Start(); 
              bool read2sync = UpdateWorkerStatus(MAWorkerStatus::DataEnd);
@@ -176,6 +226,9 @@ namespace Microsoft { namespace MSR { namespace CNTK {
             size_t  samplesSinceLastSync                                    /* input:  samples processed since last sync on this worker only */
              )
          {
+             // MPI is used by one thread at a time, so the previous asynchronous aggregation has to finish before the status exchange
+             FinishAsyncAggregation();
+
              Timer syncPointTimer; 
              syncPointTimer.Start();
              bool read2Sync=UpdateWorkerStatus(MAWorkerStatus::DataProcessing);
@@ -184,7 +237,12 @@ namespace Microsoft { namespace MSR { namespace CNTK {
 
              size_t totalSamplesProcessed=0; 
              float secondsOnCommunication = 0.0f;
-             if (read2Sync)
+             if (read2Sync && m_useAsyncAggregation)
+             {
+                 m_numSyncPerformed++;
+                 StartAsyncAggregation(samplesSinceLastSync, LearnableNodes);
+             }
+             else if (read2Sync)
              {
                  m_numSyncPerformed++;
                  ModelAggregationProcessing(samplesSinceLastSync, LearnableNodes, smoothedGradient, totalSamplesProcessed, secondsOnCommunication);
@@ -205,6 +263,113 @@ namespace Microsoft { namespace MSR { namespace CNTK {
          
 
     protected:
+        // sums the (model) values over all workers
+        void AllReduceModel(ElemType* pData, size_t nData)
+        {
+            if (m_useHierarchicalAggregation)
+                m_pMPI->HierarchicalAllReduce(pData, nData);
+            else
+                m_pMPI->AllReduce(pData, nData);
+        }
+
+        // Aggregates the snapshots of the learnable parameters on the background thread and turns them into the
+        // corrections to apply to the parameters (aggregated - snapshot), in place. Only host memory is touched here.
+        // The default is the sample-weighted model averaging of BasicModelAveragingSGD.
+        virtual void AsyncModelAggregationProcessing(
+            size_t samplesSinceLastSync,                                       /* in */
+            std::vector<std::vector<ElemType>>&       snapshots,               /* in: local snapshot, out: correction */
+            size_t&                                   totalSamplesProcessed,   /* out */
+            float&                                    secondsOnCommunication   /* out */)
+        {
+            int nTotalSamples = (int)samplesSinceLastSync;
+            Timer commTimer;
+            commTimer.Start();
+            m_pMPI->AllReduce(&nTotalSamples, 1);
+            commTimer.Stop();
+            secondsOnCommunication = (float)commTimer.ElapsedSeconds();
+
+            ElemType factor;
+            if (nTotalSamples <= 0)
+            {
+                factor = (ElemType)1 / m_numWorkers;
+                totalSamplesProcessed = samplesSinceLastSync * m_numWorkers;
+            }
+            else
+            {
+                factor = (ElemType)samplesSinceLastSync / nTotalSamples;
+                totalSamplesProcessed = nTotalSamples;
+            }
+
+            std::vector<ElemType> aggregated;
+            for (auto& snapshot : snapshots)
+            {
+                aggregated.resize(snapshot.size());
+                for (size_t k = 0; k < snapshot.size(); k++)
+                    aggregated[k] = factor * snapshot[k];
+
+                commTimer.Restart();
+                AllReduceModel(aggregated.data(), aggregated.size());
+                commTimer.Stop();
+                secondsOnCommunication += (float)commTimer.ElapsedSeconds();
+
+                for (size_t k = 0; k < snapshot.size(); k++)
+                    snapshot[k] = aggregated[k] - snapshot[k];
+            }
+        }
+
+        // takes a snapshot of the learnable parameters and starts aggregating it on a background thread
+        void StartAsyncAggregation(size_t samplesSinceLastSync, const std::list<ComputationNodeBasePtr>& learnableNodes)
+        {
+            assert(!m_pendingAsyncAggregation.valid());
+            m_asyncNodes.clear();
+            for (auto& pBaseNode : learnableNodes)
+            {
+                if (pBaseNode->IsParameterUpdateRequired())
+                    m_asyncNodes.push_back(DownCast(pBaseNode));
+            }
+
+            m_asyncSnapshots.resize(m_asyncNodes.size());
+            for (size_t i = 0; i < m_asyncNodes.size(); i++)
+            {
+                // CopySection() is not implemented for CPU matrices
+                const Matrix<ElemType>& value = m_asyncNodes[i]->Value();
+                unique_ptr<ElemType[]> data(value.CopyToArray());
+                m_asyncSnapshots[i].assign(data.get(), data.get() + value.GetNumElements());
+            }
+
+            m_asyncSamplesSinceLastSync = samplesSinceLastSync;
+            m_asyncAggregationTimer.Restart();
+            m_pendingAsyncAggregation = std::async(std::launch::async, [this, samplesSinceLastSync]
+                                                   {
+                                                       AsyncModelAggregationProcessing(samplesSinceLastSync, m_asyncSnapshots, m_asyncTotalSamplesProcessed, m_asyncSecondsOnCommunication);
+                                                       m_asyncAggregationTimer.Stop();
+                                                   });
+        }
+
+        // waits for the pending asynchronous aggregation (if any) and applies its correction to the learnable parameters
+        void FinishAsyncAggregation()
+        {
+            if (!m_pendingAsyncAggregation.valid())
+                return;
+
+            Timer waitTimer;
+            waitTimer.Start();
+            m_pendingAsyncAggregation.get();
+            waitTimer.Stop();
+
+            for (size_t i = 0; i < m_asyncNodes.size(); i++)
+            {
+                Matrix<ElemType>& value = m_asyncNodes[i]->Value();
+                if (m_asyncSnapshots[i].empty())
+                    continue;
+                Matrix<ElemType> correction(value.GetNumRows(), value.GetNumCols(), m_asyncSnapshots[i].data(), value.GetDeviceId());
+                value += correction;
+            }
+
+            m_perfReporter.OnMAPerformed(m_asyncSamplesSinceLastSync, m_asyncTotalSamplesProcessed, m_asyncSecondsOnCommunication);
+            m_perfReporter.OnAsyncMAFinished(m_asyncAggregationTimer.ElapsedSeconds(), waitTimer.ElapsedSeconds());
+        }
+
         bool    somePeersHaveArrivedAtEnd()
         {
             auto iter = std::find(m_MAworkerStatus.begin(), m_MAworkerStatus.end(), MAWorkerStatus::DataEnd);
@@ -320,6 +485,17 @@ namespace Microsoft { namespace MSR { namespace CNTK {
         MASGDPerfStats              m_perfReporter;
         MPIWrapperPtr m_pMPI;
         DEVICEID_TYPE               m_deviceId;
+        bool                        m_useHierarchicalAggregation;
+
+        // asynchronous model aggregation
+        bool                                m_useAsyncAggregation;
+        std::future<void>                   m_pendingAsyncAggregation;
+        std::vector<ComputationNodePtr>     m_asyncNodes;
+        std::vector<std::vector<ElemType>>  m_asyncSnapshots;       // snapshot of m_asyncNodes, replaced by the correction by the background thread
+        size_t                              m_asyncSamplesSinceLastSync;
+        size_t                              m_asyncTotalSamplesProcessed;
+        float                               m_asyncSecondsOnCommunication;
+        Timer                               m_asyncAggregationTimer;
  };
 
 
@@ -330,6 +506,7 @@ namespace Microsoft { namespace MSR { namespace CNTK {
         typedef IMASGD<ElemType> Base; 
         using Base::m_pMPI;
         using Base::DownCast;
+        using Base::AllReduceModel;
 
     public:
         BasicModelAveragingSGD(const MPIWrapperPtr& pMPI, size_t reportFreq, DEVICEID_TYPE devID)
@@ -393,7 +570,7 @@ namespace Microsoft { namespace MSR { namespace CNTK {
                 size_t    nx = mat.GetNumElements();
                 // 2.1.4. inplace sum 
                 commTimer.Restart();
-                m_pMPI->AllReduce(px.get(), nx);
+                AllReduceModel(px.get(), nx);
                 commTimer.Stop();
                 secondsOnCommunication += (float)commTimer.ElapsedSeconds();
                 // 2.1.5. set value 
@@ -0,0 +1,337 @@
+#pragma once
+
+#include "IDistGradAggregator.h"
+#include "MatrixQuantizerImpl.h"
+#include "TimerUtility.h"
+
+namespace Microsoft { namespace MSR { namespace CNTK {
+
+// Aggregates quantized gradients of all nodes (1-bit SGD style) on the CPU.
+// The columns of each gradient are split into one stripe per node. Every node quantizes its gradient (with error feedback:
+// the quantization error is kept as a residual and added to the next gradient), sends stripe k to node k, sums the stripes it
+// receives for its own stripe, quantizes that sum again (with its own residual) and sends it to all other nodes, which finally
+// unquantize the aggregated stripes of all nodes into the gradient.
+// So with b bits per value, each node sends about 2 b / (8 sizeof(ElemType)) of the data that an unquantized allreduce sends.
+// All receives are posted upfront, and the stripes that arrived are processed between the quantization of the gradients, so that
+// quantization and transfers of consecutive gradients overlap. The (un)quantization of a matrix is parallelized over its columns.
+template <class ElemType>
+class QuantizedDistGradAggregator : public IDistGradAggregator<ElemType>
+{
+    UsingIDistGradAggregatorMembers;
+
+public:
+    QuantizedDistGradAggregator(const MPIWrapperPtr& mpi, size_t numGradientBits, bool zeroThresholdFor1Bit, bool useAsyncAggregation, int syncStatsTrace)
+        : IDistGradAggregator<ElemType>(mpi), m_numGradientBits(numGradientBits), m_zeroThresholdFor1Bit(zeroThresholdFor1Bit), m_syncStatsTrace(syncStatsTrace), m_iterationCount(0)
+    {
+        if ((numGradientBits == 0) || (numGradientBits >= 8 * sizeof(ElemType)) || ((numGradientBits & (numGradientBits - 1)) != 0))
+            InvalidArgument("QuantizedDistGradAggregator: the number of bits per gradient value must be a power of two less than %d.", (int) (8 * sizeof(ElemType)));
+
+        if (useAsyncAggregation)
+            InvalidArgument("QuantizedDistGradAggregator: buffered async gradient aggregation is not supported with quantized gradients.");
+
+        m_quantizer.reset(MatrixQuantizerImpl<ElemType>::Create(CPUDEVICE, false));
+    }
+
+    // Aggregate the gradient matrices across all nodes
+    bool AggregateGradients(const std::vector<Matrix<ElemType>*>& gradients, DistGradHeader* headerCPU, int /*epochNumber*/) override
+    {
+        if (m_gradients.empty())
+            Initialize(gradients);
+
+        bool showSyncPerfStats = (m_syncStatsTrace > 0) && ((m_iterationCount % m_syncStatsTrace) == 0);
+        m_iterationCount++;
+
+        Timer aggregationTimer;
+        if (showSyncPerfStats)
+            aggregationTimer.Start();
+
+        size_t numGradMatrices = gradients.size();
+        if (headerCPU->numSamples == 0)
+        {
+            headerCPU->criterion = 0.0;
+            for (int i = 0; i < headerCPU->numEvalNode; ++i)
+                headerCPU->evalErrors[i] = { 0.0, 0 };
+
+            // If the current node did not process any samples, the gradients should be zero'd
+            for (size_t i = 0; i < numGradMatrices; ++i)
+                gradients[i]->SetValue(0);
+        }
+
+        // Sum the headers of all nodes with a single allreduce, that completes while the gradients are aggregated
+        m_headerValues.resize(headerCPU->NumValues());
+        headerCPU->CopyTo(m_headerValues.data());
+        MPI_Request headerRequest;
+        MPI_Iallreduce(MPI_IN_PLACE, m_headerValues.data(), (int) m_headerValues.size(), MPI_DOUBLE, MPI_SUM, m_mpi->Communicator(), &headerRequest) || MpiFail("MPI_Iallreduce");
+
+        // Post all receives: the stripes of the other nodes for our stripe, and the aggregated stripes of the other nodes
+        m_receiveRequests.clear();
+        m_receivedGradients.clear();
+        m_receivedAggregatedStripes.clear();
+        for (size_t i = 0; i < numGradMatrices; ++i)
+        {
+            GradientState& state = m_gradients[i];
+            state.m_numPendingStripes = 0;
+            state.m_numPendingAggregatedStripes = 0;
+            state.m_quantized = false;
+
+            Stripe myStripe = GetStripe(state.m_numCols, MyRank());
+            for (size_t node = 0; node < NumProc(); ++node)
+            {
+                if (node == MyRank())
+                    continue;
+
+                if (myStripe.m_numCols > 0)
+                {
+                    QuantizedMatrix<ElemType>& received = *state.m_receivedStripes[node];
+                    PostReceive(received.Buffer(), received.GetSize(), node, StripeTag(i), i, false);
+                    state.m_numPendingStripes++;
+                }
+
+                Stripe stripe = GetStripe(state.m_numCols, node);
+                if (stripe.m_numCols > 0)
+                {
+                    PostReceive(StripeBuffer(*state.m_aggregatedGradient, stripe), StripeSize(*state.m_aggregatedGradient, stripe), node, AggregatedStripeTag(i), i, true);
+                    state.m_numPendingAggregatedStripes++;
+                }
+            }
+
+            if (myStripe.m_numCols > 0)
+                state.m_numPendingAggregatedStripes++; // our own, see AggregateStripe()
+        }
+
+        // Quantize the gradients and send their stripes, processing what arrived in the meantime
+        m_sendRequests.clear();
+        for (size_t i = 0; i < numGradMatrices; ++i)
+        {
+            GradientState& state = m_gradients[i];
+            if (state.m_numCols > 0)
+            {
+                m_quantizer->QuantizeAsync(*gradients[i], *state.m_residual, *state.m_quantizedGradient, *state.m_residual, m_zeroThresholdFor1Bit);
+                m_quantizer->WaitQuantizeAsyncDone();
+
+                for (size_t node = 0; node < NumProc(); ++node)
+                {
+                    Stripe stripe = GetStripe(state.m_numCols, node);
+                    if ((node != MyRank()) && (stripe.m_numCols > 0))
+                        PostSend(StripeBuffer(*state.m_quantizedGradient, stripe), StripeSize(*state.m_quantizedGradient, stripe), node, StripeTag(i));
+                }
+            }
+
+            state.m_quantized = true;
+            if (state.m_numPendingStripes == 0)
+                AggregateStripe(gradients, i);
+
+            ProcessReceives(gradients, false);
+        }
+
+        ProcessReceives(gradients, true);
+
+        MPI_Waitall((int) m_sendRequests.size(), m_sendRequests.data(), MPI_STATUSES_IGNORE) || MpiFail("MPI_Waitall");
+
+        // Wait for the aggregate header
+        MPI_Wait(&headerRequest, MPI_STATUSES_IGNORE) || MpiFail("MPI_Wait");
+        headerCPU->CopyFrom(m_headerValues.data());
+
+        if (showSyncPerfStats)
+        {
+            aggregationTimer.Stop();
+            double epochTime = aggregationTimer.ElapsedSeconds();
+            fprintf(stderr, "Actual gradient aggregation time: %.6g (%d bits per value)\n", epochTime, (int) m_numGradientBits);
+        }
+
+        return (headerCPU->numSamples != 0);
+    }
+
+private:
+    // The columns [m_startCol, m_startCol + m_numCols) of a gradient that are aggregated by a node
+    struct Stripe
+    {
+        size_t m_startCol;
+        size_t m_numCols;
+    };
+
+    Stripe GetStripe(size_t numCols, size_t node)
+    {
+        Stripe stripe;
+        stripe.m_startCol = (numCols / NumProc()) * node + std::min(node, numCols % NumProc());
+        stripe.m_numCols = (numCols / NumProc()) + ((node < (numCols % NumProc())) ? 1 : 0);
+        return stripe;
+    }
+
+    // The quantized columns of a stripe are contiguous in the buffer of a quantized matrix
+    static char* StripeBuffer(const QuantizedMatrix<ElemType>& matrix, const Stripe& stripe)
+    {
+        return matrix.Buffer() + stripe.m_startCol * QuantizedColumn<ElemType>::QuantizedColumnSize(matrix.GetNumBits(), matrix.GetNumRows());
+    }
+
+    static size_t StripeSize(const QuantizedMatrix<ElemType>& matrix, const Stripe& stripe)
+    {
+        return stripe.m_numCols * QuantizedColumn<ElemType>::QuantizedColumnSize(matrix.GetNumBits(), matrix.GetNumRows());
+    }
+
+    int StripeTag(size_t gradientIndex) const
+    {
+        return (int) gradientIndex;
+    }
+
+    int AggregatedStripeTag(size_t gradientIndex) const
+    {
+        return (int) (m_gradients.size() + gradientIndex);
+    }
+
+    void PostReceive(char* buffer, size_t size, size_t source, int tag, size_t gradientIndex, bool isAggregatedStripe)
+    {
+        m_receiveRequests.push_back(MPI_REQUEST_NULL);
+        m_receivedGradients.push_back(gradientIndex);
+        m_receivedAggregatedStripes.push_back(isAggregatedStripe);
+        MPI_Irecv(buffer, (int) size, MPI_CHAR, (int) source, tag, m_mpi->Communicator(), &m_receiveRequests.back()) || MpiFail("MPI_Irecv");
+    }
+
+    void PostSend(char* buffer, size_t size, size_t destination, int tag)
+    {
+        m_sendRequests.push_back(MPI_REQUEST_NULL);
+        MPI_Isend(buffer, (int) size, MPI_CHAR, (int) destination, tag, m_mpi->Communicator(), &m_sendRequests.back()) || MpiFail("MPI_Isend");
+    }
+
+    // Handles completed receives; with 'wait' until all receives are completed
+    void ProcessReceives(const std::vector<Matrix<ElemType>*>& gradients, bool wait)
+    {
+        std::vector<int> completed(m_receiveRequests.size());
+        for (;;)
+        {
+            int numCompleted = 0;
+            if (wait)
+                MPI_Waitsome((int) m_receiveRequests.size(), m_receiveRequests.data(), &numCompleted, completed.data(), MPI_STATUSES_IGNORE) || MpiFail("MPI_Waitsome");
+            else
+                MPI_Testsome((int) m_receiveRequests.size(), m_receiveRequests.data(), &numCompleted, completed.data(), MPI_STATUSES_IGNORE) || MpiFail("MPI_Testsome");
+
+            if ((numCompleted == MPI_UNDEFINED) || (numCompleted == 0))
+                return;
+
+            for (int k = 0; k < numCompleted; ++k)
+            {
+                size_t i = m_receivedGradients[completed[k]];
+                GradientState& state = m_gradients[i];
+                if (m_receivedAggregatedStripes[completed[k]])
+                {
+                    AggregatedStripeReceived(gradients, i);
+                }
+                else if ((--state.m_numPendingStripes == 0) && state.m_quantized)
+                {
+                    AggregateStripe(gradients, i);
+                }
+            }
+        }
+    }
+
+    // Sums our stripe of all nodes, and sends its quantized value to the other nodes
+    void AggregateStripe(const std::vector<Matrix<ElemType>*>& gradients, size_t i)
+    {
+        GradientState& state = m_gradients[i];
+        Stripe myStripe = GetStripe(state.m_numCols, MyRank());
+        if (myStripe.m_numCols == 0)
+            return;
+
+        QuantizedMatrix<ElemType> myQuantizedStripe = state.m_quantizedGradient->ColumnSlice(myStripe.m_startCol, myStripe.m_numCols);
+        m_quantizer->UnquantizeAsync(myQuantizedStripe, *state.m_aggregatedStripe, false);
+        for (size_t node = 0; node < NumProc(); ++node)
+        {
+            if (node != MyRank())
+                m_quantizer->UnquantizeAsync(*state.m_receivedStripes[node], *state.m_aggregatedStripe, true);
+        }
+        m_quantizer->WaitUnquantizeAsyncDone();
+
+        QuantizedMatrix<ElemType> aggregatedStripe = state.m_aggregatedGradient->ColumnSlice(myStripe.m_startCol, myStripe.m_numCols);
+        m_quantizer->QuantizeAsync(*state.m_aggregatedStripe, *state.m_stripeResidual, aggregatedStripe, *state.m_stripeResidual, m_zeroThresholdFor1Bit);
+        m_quantizer->WaitQuantizeAsyncDone();
+
+        for (size_t node = 0; node < NumProc(); ++node)
+        {
+            if (node != MyRank())
+                PostSend(StripeBuffer(*state.m_aggregatedGradient, myStripe), StripeSize(*state.m_aggregatedGradient, myStripe), node, AggregatedStripeTag(i));
+        }
+
+        AggregatedStripeReceived(gradients, i);
+    }
+
+    // Once all aggregated stripes are there, the gradient is replaced with their value
+    void AggregatedStripeReceived(const std::vector<Matrix<ElemType>*>& gradients, size_t i)
+    {
+        GradientState& state = m_gradients[i];
+        if (--state.m_numPendingAggregatedStripes > 0)
+            return;
+
+        m_quantizer->UnquantizeAsync(*state.m_aggregatedGradient, *gradients[i], false);
+        m_quantizer->WaitUnquantizeAsyncDone();
+    }
+
+    void Initialize(const std::vector<Matrix<ElemType>*>& gradients)
+    {
+        m_gradients.resize(gradients.size());
+        for (size_t i = 0; i < gradients.size(); i++)
+        {
+            // Make sure none of the gradient matrixes are sparse - we currently do not support aggregation of sparse gradient matrices
+            if (gradients[i]->GetMatrixType() != DENSE)
+                RuntimeError("Gradient aggregation for sparse gradient matrices is currently unsupported!");
+
+            if (gradients[i]->GetDeviceId() != CPUDEVICE)
+                RuntimeError("QuantizedDistGradAggregator: quantized gradient aggregation is only supported for gradients on the CPU.");
+
+            size_t numRows = gradients[i]->GetNumRows();
+            size_t numCols = gradients[i]->GetNumCols();
+            GradientState& state = m_gradients[i];
+            state.m_numCols = (numRows > 0) ? numCols : 0; // nothing to exchange for an empty gradient
+            state.m_residual.reset(new Matrix<ElemType>(numRows, numCols, CPUDEVICE));
+            state.m_residual->SetValue(0);
+            state.m_quantizedGradient.reset(new QuantizedMatrix<ElemType>(numRows, numCols, m_numGradientBits, CPUDEVICE));
+            state.m_aggregatedGradient.reset(new QuantizedMatrix<ElemType>(numRows, numCols, m_numGradientBits, CPUDEVICE));
+
+            Stripe myStripe = GetStripe(state.m_numCols, MyRank());
+            state.m_aggregatedStripe.reset(new Matrix<ElemType>(numRows, myStripe.m_numCols, CPUDEVICE));
+            state.m_stripeResidual.reset(new Matrix<ElemType>(numRows, myStripe.m_numCols, CPUDEVICE));
+            state.m_stripeResidual->SetValue(0);
+            state.m_receivedStripes.resize(NumProc());
+            for (size_t node = 0; node < NumProc(); ++node)
+            {
+                if ((node != MyRank()) && (myStripe.m_numCols > 0))
+                    state.m_receivedStripes[node].reset(new QuantizedMatrix<ElemType>(numRows, myStripe.m_numCols, m_numGradientBits, CPUDEVICE));
+            }
+        }
+    }
+
+private:
+    struct GradientState
+    {
+        // quantization error of the gradient and of the aggregated stripe, added to the next minibatch (error feedback)
+        std::unique_ptr<Matrix<ElemType>> m_residual;
+        std::unique_ptr<Matrix<ElemType>> m_stripeResidual;
+
+        std::unique_ptr<QuantizedMatrix<ElemType>> m_quantizedGradient;
+        std::vector<std::unique_ptr<QuantizedMatrix<ElemType>>> m_receivedStripes; // our stripe from each other node
+        std::unique_ptr<Matrix<ElemType>> m_aggregatedStripe;
+        std::unique_ptr<QuantizedMatrix<ElemType>> m_aggregatedGradient;           // aggregated stripes of all nodes
+
+        size_t m_numCols; // number of columns that are split into stripes
+        size_t m_numPendingStripes;
+        size_t m_numPendingAggregatedStripes;
+        bool m_quantized;
+    };
+
+    std::vector<GradientState> m_gradients;
+    std::unique_ptr<MatrixQuantizerImpl<ElemType>> m_quantizer;
+
+    std::vector<MPI_Request> m_receiveRequests;
+    std::vector<size_t> m_receivedGradients; // gradient index of each receive request
+    std::vector<bool> m_receivedAggregatedStripes; // whether the receive request is for an aggregated stripe
+    std::vector<MPI_Request> m_sendRequests;
+    std::vector<double> m_headerValues;
+
+    size_t m_numGradientBits;
+    bool m_zeroThresholdFor1Bit;
+
+    int m_syncStatsTrace;
+
+    // Only used for controlling frequency of measuring/showing gradient aggregation perf stats
+    size_t m_iterationCount;
+};
+} } }
@@ -17,6 +17,7 @@
 #endif
 
 #include "SimpleDistGradAggregator.h"
+#include "QuantizedDistGradAggregator.h"
 #include "ProgressTracing.h"
 
 #include <map>
@@ -288,6 +289,21 @@ void SGD<ElemType>::TrainOrAdaptModel(int startEpoch, ComputationNetworkPtr net,
     {
         InitModelAggregationHandler(m_syncStatsTrace, net->GetDeviceId());
     }
+
+    if (!m_checkpointWriter && ((m_mpi == nullptr) || m_mpi->IsMainNode()))
+    {
+        m_checkpointWriter.reset(new AsyncCheckpointWriter(m_asyncCheckpoint));
+    }
+
+    if (m_profileNodes || !m_profileTraceFile.empty())
+    {
+        // with several workers, each writes its own trace
+        wstring traceFile = m_profileTraceFile;
+        if (!traceFile.empty() && (m_mpi != nullptr) && (m_mpi->NumNodesInUse() > 1))
+            traceFile += msra::strfun::wstrprintf(L".rank%d", (int) m_mpi->CurrentNodeRank());
+        m_profiler = make_shared<ComputationProfiler>(traceFile);
+        net->Environment().SetProfiler(m_profiler);
+    }
     
     // precompute mean and invStdDev nodes and save initial model
     // When no precompute, only save if we did not load the model from a 
@@ -410,6 +426,7 @@ void SGD<ElemType>::TrainOrAdaptModel(int startEpoch, ComputationNetworkPtr net,
             {
                 // In case of parallel training only the main node should we saving the model to prevent
                 // the parallel training nodes from colliding to write the same file
+                WaitForCheckpoints();
                 if ((m_mpi == nullptr) || m_mpi->IsMainNode())
                     net->Save(m_modelPath);
             }
@@ -461,6 +478,8 @@ void SGD<ElemType>::TrainOrAdaptModel(int startEpoch, ComputationNetworkPtr net,
 
         EpochCriterion epochCriterion; // criterion values are returned in this
         std::vector<EpochCriterion> epochEvalErrors(evaluationNodes.size());
+        if (m_profiler)
+            m_profiler->Reset(); // (drop what was recorded by minibatch-size search and validation)
         TrainOneEpoch(net,
                       refNet,
                       refNode,
@@ -493,6 +512,8 @@ void SGD<ElemType>::TrainOrAdaptModel(int startEpoch, ComputationNetworkPtr net,
         for (size_t j = 0; j < epochEvalErrors.size(); j++)
             epochEvalErrors[j].LogCriterion(evaluationNodes[j]->NodeName());
         fprintf(stderr, "totalSamplesSeen = %d; learningRatePerSample = %.8g; epochTime=%.6gs\n", (int)totalTrainingSamplesSeen, learnRatePerSample, epochTime);
+        if (m_profiler)
+            m_profiler->PrintReport(msra::strfun::strprintf("of Epoch[%2d of %d]", i + 1, (int) m_maxEpochs));
 #if 0
         // TODO: This was only printed if >1 eval criterion. Why? Needed?
         LOGPRINTF(stderr, "Finished Epoch[%2d of %d]:     Criterion Node [%ls] Per Sample = %.8g\n",
@@ -569,6 +590,7 @@ void SGD<ElemType>::TrainOrAdaptModel(int startEpoch, ComputationNetworkPtr net,
                 {
                     // roll back
                     auto bestModelPath = GetModelNameForEpoch(i - m_learnRateAdjustInterval);
+                    WaitForCheckpoints();
                     LOGPRINTF(stderr, "Loading (rolling back to) previous model with best training-criterion value: %ls.\n", bestModelPath.c_str());
                     net->RereadPersistableParameters<ElemType>(bestModelPath);
                     LoadCheckPointInfo(i - m_learnRateAdjustInterval,
@@ -595,6 +617,7 @@ void SGD<ElemType>::TrainOrAdaptModel(int startEpoch, ComputationNetworkPtr net,
                     {
                         // In case of parallel training only the main node should we saving the model to prevent
                         // the parallel training nodes from colliding to write the same file
+                        WaitForCheckpoints();
                         if ((m_mpi == nullptr) || m_mpi->IsMainNode())
                             net->Save(GetModelNameForEpoch(i, true));
 
@@ -669,10 +692,25 @@ void SGD<ElemType>::TrainOrAdaptModel(int startEpoch, ComputationNetworkPtr net,
             }
             else
             {
-                SaveCheckPointInfo(i, totalTrainingSamplesSeen, learnRatePerSample, smoothedGradients, prevCriterion, chosenMinibatchSize);
+                // The checkpoint is serialized into host memory here and written to disk on a background thread,
+                // training only stalls for the serialization (or when the previous checkpoints are still being written).
+                Timer checkpointTimer;
+                checkpointTimer.Start();
+                m_checkpointWriter->BeginCheckpoint();
+
+                size_t checkPointInfoSize = 0;
+                for (const auto& smoothedGradient : smoothedGradients)
+                    checkPointInfoSize += smoothedGradient.GetNumElements() * sizeof(ElemType);
+                File& checkPointFile = m_checkpointWriter->AddFile(GetCheckPointFileNameForEpoch(i), checkPointInfoSize);
+                SaveCheckPointInfo(checkPointFile, totalTrainingSamplesSeen, learnRatePerSample, smoothedGradients, prevCriterion, chosenMinibatchSize);
+
                 auto modelName = GetModelNameForEpoch(i);
                 LOGPRINTF(stderr, "SGD: Saving checkpoint model '%ls'\n", modelName.c_str());
-                net->Save(modelName);
+                size_t modelSize = 0;
+                for (const auto& node : learnableNodes)
+                    modelSize += dynamic_pointer_cast<ComputationNode<ElemType>>(node)->Value().GetNumElements() * sizeof(ElemType);
+                net->Save(m_checkpointWriter->AddFile(modelName, modelSize));
+
                 if (!m_keepCheckPointFiles)
                 {
                     // delete previous checkpoint file to save space
@@ -680,18 +718,23 @@ void SGD<ElemType>::TrainOrAdaptModel(int startEpoch, ComputationNetworkPtr net,
                     {
                         if (epochsSinceLastLearnRateAdjust != 1)
                         {
-                            _wunlink(GetCheckPointFileNameForEpoch(i - 1).c_str());
+                            m_checkpointWriter->AddFileToDelete(GetCheckPointFileNameForEpoch(i - 1));
                         }
                         if (epochsSinceLastLearnRateAdjust == m_learnRateAdjustInterval)
                         {
-                            _wunlink(GetCheckPointFileNameForEpoch(i - m_learnRateAdjustInterval).c_str());
+                            m_checkpointWriter->AddFileToDelete(GetCheckPointFileNameForEpoch(i - m_learnRateAdjustInterval));
                         }
                     }
                     else
                     {
-                        _wunlink(GetCheckPointFileNameForEpoch(i - 1).c_str());
+                        m_checkpointWriter->AddFileToDelete(GetCheckPointFileNameForEpoch(i - 1));
                     }
                 }
+
+                m_checkpointWriter->EndCheckpoint();
+                checkpointTimer.Stop();
+                LOGPRINTF(stderr, "SGD: Checkpoint for epoch %d took %.2f seconds of training time%s\n",
+                          i + 1, checkpointTimer.ElapsedSeconds(), m_asyncCheckpoint ? " (written in the background)" : "");
             }
         }
         else
@@ -713,11 +756,18 @@ void SGD<ElemType>::TrainOrAdaptModel(int startEpoch, ComputationNetworkPtr net,
 
     // Synchronize all ranks before proceeding to ensure that
     // rank 0 has finished writing the model file
+    WaitForCheckpoints();
     if (m_mpi != nullptr)
     {
         m_mpi->WaitAll();
     }
 
+    if (m_profiler)
+    {
+        net->Environment().SetProfiler(nullptr);
+        m_profiler.reset(); // completes the trace file
+    }
+
     // progress tracing for compute cluster management
     ProgressTracing::TraceProgressPercentage(m_maxEpochs, 0.0, true);
     ProgressTracing::TraceTrainLoss(m_lastFinishedEpochTrainLoss);
@@ -786,6 +836,7 @@ size_t SGD<ElemType>::TrainOneEpoch(ComputationNetworkPtr net,
     }
 
     std::vector<Matrix<ElemType>*> learnParamsGradients;
+    std::unordered_map<ComputationNodeBasePtr, size_t> learnParamsGradientIndices; // for overlapped gradient aggregation
     Profiler profiler(m_numMBsToCUDAProfile);
 
     // resetting this, so profiling is performed for one epoch only
@@ -839,6 +890,11 @@ size_t SGD<ElemType>::TrainOneEpoch(ComputationNetworkPtr net,
         {
             fprintf(stderr, ", BufferedAsyncGradientAggregation is ENABLED");
         }
+
+        if (m_overlapGradientAggregation)
+        {
+            fprintf(stderr, ", aggregation overlapped with backprop");
+        }
     }
 
     if (useDistributedMBReading)
@@ -876,8 +932,12 @@ size_t SGD<ElemType>::TrainOneEpoch(ComputationNetworkPtr net,
         // get minibatch
         // TODO: is it guaranteed that the GPU is already completed at this point, is it safe to overwrite the buffers?
         size_t actualMBSize = 0;
-        bool wasDataRead = DataReaderHelpers::GetMinibatchIntoNetwork<ElemType>(*trainSetDataReader, net, criterionNodes[0],
-                                                                                useDistributedMBReading, useParallelTrain, *inputMatrices, actualMBSize, m_mpi);
+        bool wasDataRead;
+        {
+            ComputationProfiler::PhaseScope profilerScope(m_profiler.get(), L"reader wait");
+            wasDataRead = DataReaderHelpers::GetMinibatchIntoNetwork<ElemType>(*trainSetDataReader, net, criterionNodes[0],
+                                                                               useDistributedMBReading, useParallelTrain, *inputMatrices, actualMBSize, m_mpi);
+        }
         if (!wasDataRead && (!useDistributedMBReading || noMoreSamplesToProcess)) // in case of distributed reading, we do a few more loops until all ranks have completed
             break;                                                                // end of epoch
 
@@ -958,7 +1018,11 @@ size_t SGD<ElemType>::TrainOneEpoch(ComputationNetworkPtr net,
                 // ===========================================================
 
                 if (learnRatePerSample > 0.01 * m_minLearnRate) // only compute gradient when learning rate is large enough
-                    net->Backprop(criterionNodes[0]);
+                {
+                    BackpropCriterion(net, criterionNodes[0], actualNumSubminibatches,
+                                      useGradientAggregation && m_overlapGradientAggregation ? m_distGradAgg.get() : nullptr,
+                                      learnParamsGradients, learnParamsGradientIndices);
+                }
 
                 // house-keeping for sub-minibatching
                 if (actualNumSubminibatches > 1)
@@ -994,8 +1058,23 @@ size_t SGD<ElemType>::TrainOneEpoch(ComputationNetworkPtr net,
             // distributed gradient aggregation
             if (learnParamsGradients.size() == 0)
             {
+                // with overlapped aggregation, the gradients are ordered as backprop finalizes them (reverse evaluation order),
+                // so that the aggregation buckets are completed one after the other
+                std::list<ComputationNodeBasePtr> aggregationOrder = learnableNodes;
+                if (m_overlapGradientAggregation)
+                {
+                    std::unordered_map<ComputationNodeBasePtr, size_t> evalOrderIndices;
+                    size_t evalOrderIndex = 0;
+                    for (const auto& node : net->GetEvalOrder(criterionNodes[0]))
+                        evalOrderIndices[node] = evalOrderIndex++;
+                    aggregationOrder.sort([&](const ComputationNodeBasePtr& a, const ComputationNodeBasePtr& b)
+                    {
+                        return evalOrderIndices[a] > evalOrderIndices[b];
+                    });
+                }
+
                 learnParamsGradients.reserve(learnableNodes.size());
-                for (auto nodeIter = learnableNodes.begin(); nodeIter != learnableNodes.end(); nodeIter++)
+                for (auto nodeIter = aggregationOrder.begin(); nodeIter != aggregationOrder.end(); nodeIter++)
                 {
                     ComputationNodePtr node = dynamic_pointer_cast<ComputationNode<ElemType>>(*nodeIter);
                     if (node->IsParameterUpdateRequired())
@@ -1010,6 +1089,7 @@ size_t SGD<ElemType>::TrainOneEpoch(ComputationNetworkPtr net,
                             currParamsGradient->Resize(currParamsValues->GetNumRows(), currParamsValues->GetNumCols());
                         }
 
+                        learnParamsGradientIndices[*nodeIter] = learnParamsGradients.size();
                         learnParamsGradients.push_back(currParamsGradient);
                     }
                 }
@@ -1027,7 +1107,11 @@ size_t SGD<ElemType>::TrainOneEpoch(ComputationNetworkPtr net,
             for (size_t i = 0; i < evaluationNodes.size(); i++)
                 m_gradHeader->evalErrors[i] = localEpochEvalErrors.GetCriterion(i);
 
-            bool samplesProcessed = m_distGradAgg->AggregateGradients(learnParamsGradients, m_gradHeader.get(), epochNumber);
+            bool samplesProcessed;
+            {
+                ComputationProfiler::PhaseScope profilerScope(m_profiler.get(), L"gradient aggregation");
+                samplesProcessed = m_distGradAgg->AggregateGradients(learnParamsGradients, m_gradHeader.get(), epochNumber);
+            }
             noMoreSamplesToProcess = !samplesProcessed;
 
             aggregateNumSamples          = m_gradHeader->numSamples;
@@ -1050,6 +1134,7 @@ size_t SGD<ElemType>::TrainOneEpoch(ComputationNetworkPtr net,
             if (numSamplesInMinibatch != aggregateNumSamples)
                 fprintf(stderr, "SGD: using true #samples %d instead of MB size %d\n", (int)numSamplesInMinibatch, (int)aggregateNumSamples);
 #endif
+            ComputationProfiler::PhaseScope profilerScope(m_profiler.get(), L"UpdateWeights");
             auto smoothedGradientIter = smoothedGradients.begin();
             for (auto nodeIter = learnableNodes.begin(); nodeIter != learnableNodes.end(); nodeIter++, smoothedGradientIter++)
             {
@@ -1079,6 +1164,7 @@ size_t SGD<ElemType>::TrainOneEpoch(ComputationNetworkPtr net,
         {
             if (nSamplesSinceLastModelSync >= blockSizePerWorker)
             {
+                ComputationProfiler::PhaseScope profilerScope(m_profiler.get(), L"model aggregation");
                 bool synced = m_pMASGDHelper->OnArrivingAtSyncPoint(learnableNodes, smoothedGradients, nSamplesSinceLastModelSync);
                 if (synced)
                 {
@@ -1802,11 +1888,10 @@ void SGD<ElemType>::InitDistGradAgg(int numEvalNodes, int traceLevel)
             m_distGradAgg = std::make_shared<AllReduceDistGradAggregator<ElemType>>(m_mpi, m_numGradientBits, m_zeroThresholdFor1Bit, true /*useQuantizationForSelfStripe*/, m_bufferedAsyncGradientAggregation, traceLevel, m_syncStatsTrace);
 #else
             if (m_numGradientBits != (8 * sizeof(ElemType)))
-            {
-                RuntimeError("Gradient quantization is unsupported in CNTK binaries built without quantized gradient aggregation support!");
-            }
-
-            m_distGradAgg = std::make_shared<SimpleDistGradAggregator<ElemType>>(m_mpi, m_bufferedAsyncGradientAggregation, m_syncStatsTrace);
+                m_distGradAgg = std::make_shared<QuantizedDistGradAggregator<ElemType>>(m_mpi, m_numGradientBits, m_zeroThresholdFor1Bit, m_bufferedAsyncGradientAggregation, m_syncStatsTrace);
+            else
+                m_distGradAgg = std::make_shared<SimpleDistGradAggregator<ElemType>>(m_mpi, m_bufferedAsyncGradientAggregation, m_syncStatsTrace, m_gradientBucketSizeInBytes, m_useRingAllReduce, m_overlapGradientAggregation,
+                                                                                     m_useHierarchicalAllReduce);
 #endif // !CNTK_PARALLEL_TRAINING_SUPPORT
         }
 
@@ -1829,6 +1914,10 @@ void SGD<ElemType>::InitModelAggregationHandler(int traceLevel, DEVICEID_TYPE de
     if (GetParallelizationMethod() == ParallelizationMethod::modelAveragingSGD)
     {
         m_pMASGDHelper = make_shared<BasicModelAveragingSGD<ElemType>>(m_mpi, traceLevel, devID);
+        m_pMASGDHelper->SetAsyncAggregation(m_useAsyncModelAggregation);
+        m_pMASGDHelper->SetHierarchicalAggregation(m_useHierarchicalAllReduce && m_mpi->HasHostHierarchy());
+        if (m_useAsyncModelAggregation)
+            fprintf(stderr, "Model averaging of each block is performed asynchronously while training on the next block\n");
     }
     else if (GetParallelizationMethod() == ParallelizationMethod::blockMomentumSGD)
     {
@@ -1843,6 +1932,29 @@ void SGD<ElemType>::InitModelAggregationHandler(int traceLevel, DEVICEID_TYPE de
     }
 }
 // public:
+// BackpropCriterion - backprop of the criterion of a minibatch or of one of its sub-minibatches
+// With an overlapped aggregator, each parameter gradient is handed to it as soon as backprop has finalized it.
+// This is only done if the minibatch is not split: the sub-minibatch dispatcher sums up the gradients after the backprop
+// of each sub-minibatch and sets the sum only in DoneWithCurrentMinibatch(), so the aggregation must not start earlier.
+template <class ElemType>
+/*static*/ void SGD<ElemType>::BackpropCriterion(const ComputationNetworkPtr& net, const ComputationNodeBasePtr& criterionNode, size_t numSubminibatches,
+                                                 IDistGradAggregator<ElemType>* overlappedAggregator,
+                                                 const std::vector<Matrix<ElemType>*>& gradients,
+                                                 const std::unordered_map<ComputationNodeBasePtr, size_t>& gradientIndices)
+{
+    if (overlappedAggregator && numSubminibatches == 1 && !gradients.empty())
+    {
+        net->Backprop(criterionNode, [&](const ComputationNodeBasePtr& node)
+        {
+            auto gradientIndex = gradientIndices.find(node);
+            if (gradientIndex != gradientIndices.end())
+                overlappedAggregator->GradientReady(gradients, gradientIndex->second);
+        });
+    }
+    else
+        net->Backprop(criterionNode);
+}
+
 // UpdateWeightsS - static version of UpdateWeights()
 // not static since it wants to access protected methods on the SGD object
 template <class ElemType>
@@ -1995,46 +2107,59 @@ void SGD<ElemType>::SaveCheckPointInfo(const size_t epoch, const size_t totalSam
     // the parallel training nodes from colliding to write the same file
     if ((m_mpi == nullptr) || m_mpi->IsMainNode())
     {
-        wstring checkPointFileName = GetCheckPointFileNameForEpoch(int(epoch));
-        // Saving into temporary file and then renaming it to the checkPointFileName
+        // The checkpoint writer saves into a temporary file and then renames it to the checkpoint file name.
         // This is a standard trick to avoid havign corrupted checkpoints files if process dies during writing
-        wstring tempFileName = checkPointFileName + L".tmp";
+        m_checkpointWriter->BeginCheckpoint();
+        File& fstream = m_checkpointWriter->AddFile(GetCheckPointFileNameForEpoch(int(epoch)), 0);
+        SaveCheckPointInfo(fstream, totalSamplesSeen, learnRatePerSample, smoothedGradients, prevCriterion, minibatchSize);
+        m_checkpointWriter->EndCheckpoint();
+    }
+}
 
-        {
-            File fstream(tempFileName, FileOptions::fileOptionsBinary | FileOptions::fileOptionsWrite);
-            fstream.PutMarker(FileMarker::fileMarkerBeginSection, L"BVersion"); 
-            fstream << (size_t)CURRENT_CNTK_CHECKPOINT_VERSION; 
-            fstream.PutMarker(FileMarker::fileMarkerEndSection, L"EVersion");
+template <class ElemType>
+void SGD<ElemType>::SaveCheckPointInfo(File& fstream, const size_t totalSamplesSeen,
+                                       const double learnRatePerSample,
+                                       const std::list<Matrix<ElemType>>& smoothedGradients,
+                                       const double prevCriterion,
+                                       const size_t minibatchSize)
+{
+    fstream.PutMarker(FileMarker::fileMarkerBeginSection, L"BVersion"); 
+    fstream << (size_t)CURRENT_CNTK_CHECKPOINT_VERSION; 
+    fstream.PutMarker(FileMarker::fileMarkerEndSection, L"EVersion");
 
-            fstream.PutMarker(FileMarker::fileMarkerBeginSection, L"BCKP");
-            fstream.PutMarker(FileMarker::fileMarkerBeginSection, L"BLearnRate");
-            fstream << totalSamplesSeen << learnRatePerSample << prevCriterion;
-            fstream.PutMarker(FileMarker::fileMarkerEndSection, L"ELearnRate");
+    fstream.PutMarker(FileMarker::fileMarkerBeginSection, L"BCKP");
+    fstream.PutMarker(FileMarker::fileMarkerBeginSection, L"BLearnRate");
+    fstream << totalSamplesSeen << learnRatePerSample << prevCriterion;
+    fstream.PutMarker(FileMarker::fileMarkerEndSection, L"ELearnRate");
 
-            fstream.PutMarker(FileMarker::fileMarkerBeginSection, L"BMinibatchSize");
-            fstream << minibatchSize;
-            fstream.PutMarker(FileMarker::fileMarkerEndSection, L"EMinibatchSize");
+    fstream.PutMarker(FileMarker::fileMarkerBeginSection, L"BMinibatchSize");
+    fstream << minibatchSize;
+    fstream.PutMarker(FileMarker::fileMarkerEndSection, L"EMinibatchSize");
 
-            fstream.PutMarker(FileMarker::fileMarkerBeginSection, L"BGradient");
+    fstream.PutMarker(FileMarker::fileMarkerBeginSection, L"BGradient");
 
-            for (auto smoothedGradientIter = smoothedGradients.begin(); smoothedGradientIter != smoothedGradients.end(); smoothedGradientIter++)
-            {
-                const Matrix<ElemType>& smoothedGradient = *smoothedGradientIter;
-                fstream << smoothedGradient;
-            }
+    for (auto smoothedGradientIter = smoothedGradients.begin(); smoothedGradientIter != smoothedGradients.end(); smoothedGradientIter++)
+    {
+        const Matrix<ElemType>& smoothedGradient = *smoothedGradientIter;
+        fstream << smoothedGradient;
+    }
 
-            fstream.PutMarker(FileMarker::fileMarkerEndSection, L"EGradient");
+    fstream.PutMarker(FileMarker::fileMarkerEndSection, L"EGradient");
 
-            fstream.PutMarker(FileMarker::fileMarkerEndSection, L"ECKP");
-            if (m_pMASGDHelper)
-                m_pMASGDHelper->SaveToCheckPoint(fstream);
-            // Ensuring that data is written
-            fstream.Flush();
-        }
+    fstream.PutMarker(FileMarker::fileMarkerEndSection, L"ECKP");
+    if (m_pMASGDHelper)
+        m_pMASGDHelper->SaveToCheckPoint(fstream);
+}
 
-        _wunlink(checkPointFileName.c_str());
-        renameOrDie(tempFileName, checkPointFileName);
-    }
+template <class ElemType>
+void SGD<ElemType>::WaitForCheckpoints()
+{
+    if (m_checkpointWriter)
+        m_checkpointWriter->WaitForPendingCheckpoints();
+
+    // the other ranks may read the files written by the main node
+    if (m_asyncCheckpoint && (m_mpi != nullptr))
+        m_mpi->WaitAll();
 }
 
 template <class ElemType>
@@ -2400,6 +2525,8 @@ SGDParams::SGDParams(const ConfigRecordType& configSGD, size_t sizeofElemType)
     m_numMBsToShowResult = configSGD(L"numMBsToShowResult", (size_t)10);
     m_firstMBsToShowResult = configSGD(L"firstMBsToShowResult", (size_t)0);
     m_numMBsToCUDAProfile = configSGD(L"numMBsToCUDAProfile", (size_t)0);
+    m_profileNodes = configSGD(L"profileNodes", false);
+    m_profileTraceFile = (const wstring&) configSGD(L"profileTraceFile", L"");
 
     m_gradientClippingWithTruncation = configSGD(L"gradientClippingWithTruncation", true);
     m_clippingThresholdPerSample = configSGD(L"clippingThresholdPerSample", numeric_limits<double>::infinity());
@@ -2558,9 +2685,15 @@ SGDParams::SGDParams(const ConfigRecordType& configSGD, size_t sizeofElemType)
     m_numGradientBits = 32;
     m_zeroThresholdFor1Bit = true;
     m_bufferedAsyncGradientAggregation = false;
+    m_gradientBucketSizeInBytes = 0;
+    m_useRingAllReduce = false;
+    m_overlapGradientAggregation = false;
+    m_useHierarchicalAllReduce = false;
+    m_ranksPerHost = 0;
     m_enableDistributedMBReading = false;
     m_parallelizationStartEpochNum = 0;
     m_modelAggregationBlockSize = 0; 
+    m_useAsyncModelAggregation = false;
 
     if (configSGD.Exists(L"ParallelTrain"))
     {
@@ -2579,6 +2712,8 @@ SGDParams::SGDParams(const ConfigRecordType& configSGD, size_t sizeofElemType)
             m_parallelizationStartEpochNum = configParallelTrain(L"parallelizationStartEpoch", (int)1) - 1; // Epoch numbers internally are 0 based
             m_enableDistributedMBReading = configParallelTrain(L"distributedMBReading", false);
             m_syncStatsTrace = configParallelTrain(L"syncPerfStats", (int)0);
+            m_useHierarchicalAllReduce = configParallelTrain(L"useHierarchicalAllReduce", false);
+            m_ranksPerHost = configParallelTrain(L"ranksPerHost", (size_t)0);
 
             if (configParallelTrain.Exists(L"DataParallelSGD"))
             {
@@ -2587,6 +2722,13 @@ SGDParams::SGDParams(const ConfigRecordType& configSGD, size_t sizeofElemType)
                 m_numGradientBits = configDataParallelSGD(L"gradientBits", defaultGradientBits);
                 m_zeroThresholdFor1Bit = configDataParallelSGD(L"useZeroThresholdFor1BitQuantization", true);
                 m_bufferedAsyncGradientAggregation = configDataParallelSGD(L"useBufferedAsyncGradientAggregation", false);
+                m_gradientBucketSizeInBytes = (size_t) ((double) configDataParallelSGD(L"gradientBucketSizeInMB", 16.0) * 1024 * 1024);
+                m_useRingAllReduce = configDataParallelSGD(L"useRingAllReduce", false);
+                m_overlapGradientAggregation = configDataParallelSGD(L"overlapAggregationWithBackprop", false);
+                if (m_overlapGradientAggregation && m_bufferedAsyncGradientAggregation)
+                {
+                    InvalidArgument("overlapAggregationWithBackprop cannot be combined with useBufferedAsyncGradientAggregation!");
+                }
                 if ( m_numGradientBits < 1 || m_numGradientBits > (8 * sizeofElemType) )
                 {
                     InvalidArgument("gradientBits must be in the range [1, 32] when using precision=float and in range [1, 64] when using precision=double!");
@@ -2632,6 +2774,7 @@ SGDParams::SGDParams(const ConfigRecordType& configSGD, size_t sizeofElemType)
                     fprintf(stderr, "WARNING: option syncPeroid in ModelAveragingSGD is going to be deprecated. Please use blockSizePerWorker instead in the future.\n");
                 }
 #endif
+                m_useAsyncModelAggregation = configMASGD(L"useAsyncAggregation", false);
             }
             if (configParallelTrain.Exists(L"BlockMomentumSGD"))
             {
@@ -17,8 +17,10 @@
 #include "Config.h"
 #include <chrono>
 #include <random>
+#include <unordered_map>
 #include "Profiler.h"
 #include "MASGD.h"
+#include "AsyncCheckpointWriter.h"
 
 using namespace std; // ugh! TODO: get rid of this from .h files!!!
 
@@ -241,6 +243,10 @@ protected:
     size_t m_firstMBsToShowResult = 0;
     int m_numMBsToCUDAProfile;
 
+    // per-node profiling of forward and backward propagation (see ComputationProfiler), reported at the end of every epoch
+    bool m_profileNodes;
+    std::wstring m_profileTraceFile; // Chrome trace of the profiled events, if not empty
+
     bool m_doGradientCheck;
     double m_gradientCheckSigDigit;
 
@@ -265,9 +271,15 @@ protected:
     int m_numGradientBits;
     bool m_bufferedAsyncGradientAggregation;
     bool m_zeroThresholdFor1Bit;
+    size_t m_gradientBucketSizeInBytes; // unquantized gradients are fused into buckets of this size for the allreduce (0: per gradient)
+    bool m_useRingAllReduce;
+    bool m_overlapGradientAggregation; // start aggregating unquantized gradients during backprop (of minibatches not split into sub-minibatches)
+    bool m_useHierarchicalAllReduce;   // reduce within each host first when a host runs several workers
+    size_t m_ranksPerHost;             // group the workers into hosts of this size (0: by shared memory)
 
     // Parallel training related with MA / BM
     size_t m_modelAggregationBlockSize;
+    bool   m_useAsyncModelAggregation; // aggregate block k in the background while training on block k+1
     bool   m_resetSGDMomentum; 
     bool   m_useNesterovBlockMomentum;
     double m_blockLearningRate; 
@@ -312,6 +324,7 @@ public:
           // TODO: The next few do not belong into SGD any more than the network or reader we operate on. Either move network and reader in here, or move these out.
           m_modelPath((const wstring&) configSGD(L"modelPath")),
           m_keepCheckPointFiles(configSGD(L"keepCheckPointFiles", false)),
+          m_asyncCheckpoint(configSGD(L"asyncCheckpoint", true)),
           m_trainCriterionNodeName((const wstring&) configSGD(L"trainCriterionNodeName", L"")),
           m_evalCriterionNodeName ((const wstring&) configSGD(L"evalCriterionNodeName", L"")),
           m_traceNodeNamesReal    (configSGD(L"traceNodeNamesReal",     ConfigRecordType::Array(stringargvector()))),
@@ -336,6 +349,9 @@ public:
     {
         m_mpi = mpi;
 
+        if (m_mpi != nullptr)
+            m_mpi->SetRanksPerHost(m_ranksPerHost);
+
         if (m_mpi == nullptr)
             m_parallelizationMethod = ParallelizationMethod::none;
     }
@@ -482,6 +498,12 @@ public:
                                const bool needAveMultiplier,
                                const bool useNesterovMomentum);
 
+    // backprop of the criterion of a minibatch or one of its sub-minibatches, handing finalized gradients to an overlapped aggregator
+    static void BackpropCriterion(const ComputationNetworkPtr& net, const ComputationNodeBasePtr& criterionNode, size_t numSubminibatches,
+                                  IDistGradAggregator<ElemType>* overlappedAggregator,
+                                  const std::vector<Matrix<ElemType>*>& gradients,
+                                  const std::unordered_map<ComputationNodeBasePtr, size_t>& gradientIndices);
+
 protected:
     // UpdateWeights - update the weights in
     void UpdateWeights(const ComputationNodeBasePtr& node,
@@ -501,6 +523,15 @@ protected:
                             const double prevCriterion,
                             const size_t minibatchSize);
 
+    void SaveCheckPointInfo(File& fstream, const size_t totalSamplesSeen,
+                            const double learnRatePerSample,
+                            const std::list<Matrix<ElemType>>& smoothedGradients,
+                            const double prevCriterion,
+                            const size_t minibatchSize);
+
+    // waits until the checkpoints written in the background are on disk
+    void WaitForCheckpoints();
+
     bool TryLoadCheckPointInfo(const size_t epochNumber,
                                /*out*/ size_t& totalSamplesSeen,
                                /*out*/ double& learnRatePerSample,
@@ -540,6 +571,9 @@ public:
 protected:
     std::wstring m_modelPath;
     bool m_keepCheckPointFiles;
+    bool m_asyncCheckpoint; // serialize checkpoints into host memory and write them on a background thread
+    std::unique_ptr<AsyncCheckpointWriter> m_checkpointWriter;
+    ComputationProfilerPtr m_profiler; // attached to the network while training if m_profileNodes
 
     std::wstring m_trainCriterionNodeName;
     std::wstring m_evalCriterionNodeName;
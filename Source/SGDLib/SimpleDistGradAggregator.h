@@ -6,25 +6,52 @@
 #include "GPUDataTransferer.h"
 #include "TimerUtility.h"
 #include "MatrixQuantizerImpl.h"
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <unordered_map>
+#include <chrono>
 
 namespace Microsoft { namespace MSR { namespace CNTK {
 
+// Aggregates the gradients of all workers without quantization.
+// The header is summed with a single allreduce, that is in flight while the gradients are aggregated.
+// The gradients are fused into buckets of about 'bucketSizeInBytes' (a gradient at least as large gets its own bucket),
+// so that many small gradients do not each pay the latency of an allreduce. With bucketSizeInBytes = 0 every
+// gradient is aggregated separately. The buckets are reduced either with MPI_Iallreduce or with the
+// bandwidth-optimal ring algorithm of MPIWrapper::RingAllReduce(). With useHierarchicalAllReduce and several workers
+// per host, the buckets are first reduced within each host and only the host leaders exchange them across the network
+// (MPIWrapper::HierarchicalAllReduce()).
+// With overlapWithBackprop the buckets are reduced on a background thread as soon as all their gradients were
+// reported by GradientReady() during backprop, so AggregateGradients() only waits for the outstanding ones.
+// The buckets are then reduced in order, so the gradients should be passed in the order in which backprop finalizes them.
 template <class ElemType>
 class SimpleDistGradAggregator : public IDistGradAggregator<ElemType>
 {
     UsingIDistGradAggregatorMembers;
 
 public:
-    SimpleDistGradAggregator(const MPIWrapperPtr& mpi, bool useAsyncAggregation, int syncStatsTrace)
-        : IDistGradAggregator<ElemType>(mpi), m_useAsyncAggregation(useAsyncAggregation), m_currentEpochNumber(-1), m_bufferedGradHeader(nullptr), m_syncStatsTrace(syncStatsTrace), m_iterationCount(0)
+    SimpleDistGradAggregator(const MPIWrapperPtr& mpi, bool useAsyncAggregation, int syncStatsTrace, size_t bucketSizeInBytes = 0, bool useRingAllReduce = false, bool overlapWithBackprop = false,
+                             bool useHierarchicalAllReduce = false)
+        : IDistGradAggregator<ElemType>(mpi), m_useAsyncAggregation(useAsyncAggregation), m_currentEpochNumber(-1), m_bufferedGradHeader(nullptr), m_syncStatsTrace(syncStatsTrace), m_iterationCount(0),
+          m_bucketSizeInBytes(bucketSizeInBytes), m_useRingAllReduce(useRingAllReduce), m_useHierarchicalAllReduce(useHierarchicalAllReduce && mpi->HasHostHierarchy()),
+          m_overlapWithBackprop(overlapWithBackprop), m_overlappedGradients(nullptr), m_numBucketsSubmitted(0), m_numBucketsReduced(0), m_stopReduction(false),
+          m_communicationTime(0), m_exposedCommunicationTime(0)
     {
+        if (m_overlapWithBackprop && m_useAsyncAggregation)
+            InvalidArgument("SimpleDistGradAggregator: overlapping the aggregation with backprop cannot be combined with buffered async aggregation.");
     }
 
     ~SimpleDistGradAggregator()
     {
-        for (size_t i = 0; i < m_recvHeaders.size(); ++i)
+        if (m_reductionThread.joinable())
         {
-            DistGradHeader::Destroy(m_recvHeaders[i]);
+            {
+                std::unique_lock<std::mutex> lock(m_reductionMutex);
+                m_stopReduction = true;
+            }
+            m_bucketsChanged.notify_all();
+            m_reductionThread.join();
         }
 
         if (m_bufferedGradHeader != nullptr)
@@ -40,7 +67,12 @@ public:
         bool showSyncPerfStats = (m_syncStatsTrace > 0) && ((m_iterationCount % m_syncStatsTrace) == 0);
         m_iterationCount++;
 
-        if (m_useAsyncAggregation)
+        if (m_overlapWithBackprop)
+        {
+            AggregateOverlappedGradients(gradients, headerCPU, showSyncPerfStats);
+            return (headerCPU->numSamples != 0);
+        }
+        else if (m_useAsyncAggregation)
         {
             // If we are performing async gradient aggregation, let's wait for the pending gradient aggregation to finish
             // then swap the contents of the buffered gradients and the new gradient matrices and fire an async aggreagation
@@ -122,6 +154,19 @@ public:
         }
     }
 
+    // Starts the aggregation of the buckets that became complete with gradients[index].
+    // Ignored before the first AggregateGradients() call, which sets up the buckets.
+    void GradientReady(const std::vector<Matrix<ElemType>*>& gradients, size_t index) override
+    {
+        if (!m_overlapWithBackprop || m_buckets.empty() || m_gradientReady[index])
+            return;
+
+        m_overlappedGradients = &gradients;
+        m_gradientReady[index] = true;
+        m_numGradientsPending[m_bucketOfGradient[index]]--;
+        SubmitCompleteBuckets(gradients);
+    }
+
 private:
     std::shared_ptr<ElemType> AllocateIntermediateBuffer(int deviceID, size_t numElements)
     {
@@ -135,6 +180,263 @@ private:
                                          });
     }
 
+    // Assigns the gradients (in order) to buckets
+    void CreateBuckets(const std::vector<Matrix<ElemType>*>& gradients)
+    {
+        const size_t bucketSize = m_bucketSizeInBytes / sizeof(ElemType);
+        for (size_t i = 0; i < gradients.size(); i++)
+        {
+            const size_t numElements = gradients[i]->GetNumElements();
+            if (m_buckets.empty() || ((m_buckets.back().m_numElements > 0) && (m_buckets.back().m_numElements + numElements > bucketSize)))
+            {
+                m_buckets.push_back(GradientBucket());
+            }
+
+            GradientBucket& bucket = m_buckets.back();
+            bucket.m_gradientIndices.push_back(i);
+            bucket.m_offsets.push_back(bucket.m_numElements);
+            bucket.m_numElements += numElements;
+        }
+    }
+
+    // Starts the transfer of the gradients of the bucket into its pinned buffer (GPU only)
+    void CopyBucketToCPU(size_t bucketIndex, const std::vector<Matrix<ElemType>*>& gradients)
+    {
+        const GradientBucket& bucket = m_buckets[bucketIndex];
+        for (size_t k = 0; k < bucket.m_gradientIndices.size(); ++k)
+        {
+            Matrix<ElemType>* gradient = gradients[bucket.m_gradientIndices[k]];
+            m_gpuDataTransferers[bucketIndex]->CopyGPUToCPUAsync(gradient->Data(), gradient->GetNumElements(), m_intermediateCPUBuffers[bucketIndex].get() + bucket.m_offsets[k]);
+        }
+    }
+
+    // Waits for the gradients of the bucket to arrive in (or packs them into) the reduction buffer and reduces it.
+    // With MPI_Iallreduce this only starts the reduction, the caller must wait for 'request'.
+    void ReduceBucket(size_t bucketIndex, const std::vector<Matrix<ElemType>*>& gradients, MPI_Request& request)
+    {
+        const GradientBucket& bucket = m_buckets[bucketIndex];
+        ElemType* reductionBuffer = GetReductionBuffer(bucketIndex, gradients);
+        if (!m_gpuDataTransferers.empty())
+        {
+            m_gpuDataTransferers[bucketIndex]->WaitForCopyGPUToCPUAsync();
+        }
+        else if (bucket.m_gradientIndices.size() > 1)
+        {
+            for (size_t k = 0; k < bucket.m_gradientIndices.size(); ++k)
+            {
+                Matrix<ElemType>* gradient = gradients[bucket.m_gradientIndices[k]];
+                memcpy(reductionBuffer + bucket.m_offsets[k], gradient->Data(), gradient->GetNumElements() * sizeof(ElemType));
+            }
+        }
+
+        request = MPI_REQUEST_NULL;
+        if (bucket.m_numElements == 0)
+        {
+            return;
+        }
+
+        if (m_useHierarchicalAllReduce)
+        {
+            m_mpi->HierarchicalAllReduce(reductionBuffer, bucket.m_numElements, m_useRingAllReduce);
+        }
+        else if (m_useRingAllReduce)
+        {
+            m_mpi->RingAllReduce(reductionBuffer, bucket.m_numElements);
+        }
+        else
+        {
+            // On Windows this async MPI_Iallreduce call requires MS MPI v7 or higher to be installed
+            MPI_Iallreduce(MPI_IN_PLACE, reductionBuffer, (int) bucket.m_numElements, MPIWrapper::GetDataType(reductionBuffer), MPI_SUM, m_mpi->Communicator(), &request) || MpiFail("MPI_Iallreduce");
+        }
+    }
+
+    // Copies the reduced bucket back to its gradients (asynchronously on the GPU)
+    void CopyBucketFromCPU(size_t bucketIndex, const std::vector<Matrix<ElemType>*>& gradients)
+    {
+        const GradientBucket& bucket = m_buckets[bucketIndex];
+        bool isGPU = !m_gpuDataTransferers.empty();
+        if (!isGPU && (bucket.m_gradientIndices.size() == 1))
+        {
+            return;
+        }
+
+        ElemType* reductionBuffer = GetReductionBuffer(bucketIndex, gradients);
+        for (size_t k = 0; k < bucket.m_gradientIndices.size(); ++k)
+        {
+            Matrix<ElemType>* gradient = gradients[bucket.m_gradientIndices[k]];
+            if (isGPU)
+            {
+                m_gpuDataTransferers[bucketIndex]->CopyCPUToGPUAsync(reductionBuffer + bucket.m_offsets[k], gradient->GetNumElements(), gradient->Data());
+            }
+            else
+            {
+                memcpy(gradient->Data(), reductionBuffer + bucket.m_offsets[k], gradient->GetNumElements() * sizeof(ElemType));
+            }
+        }
+    }
+
+    // Hands the buckets, whose gradients are all final, to the reduction thread (in bucket order)
+    void SubmitCompleteBuckets(const std::vector<Matrix<ElemType>*>& gradients)
+    {
+        size_t numBucketsToSubmit = m_numBucketsSubmitted;
+        while ((numBucketsToSubmit < m_buckets.size()) && (m_numGradientsPending[numBucketsToSubmit] == 0))
+        {
+            numBucketsToSubmit++;
+        }
+
+        if (numBucketsToSubmit == m_numBucketsSubmitted)
+        {
+            return;
+        }
+
+        if (m_numBucketsSubmitted == 0)
+        {
+            m_communicationStart = std::chrono::steady_clock::now();
+        }
+
+        if (!m_gpuDataTransferers.empty())
+        {
+            // The transfers must not start before the gradients are computed on the main compute stream
+            std::unique_ptr<MatrixComputeStreamEvent> mainStreamSyncEvent(MatrixComputeStreamEvent::Create(gradients[0]->GetDeviceId()));
+            mainStreamSyncEvent->SynchronizeDataTransferFetchStreamWithEvent<ElemType>();
+            for (size_t b = m_numBucketsSubmitted; b < numBucketsToSubmit; ++b)
+            {
+                CopyBucketToCPU(b, gradients);
+            }
+        }
+
+        {
+            std::unique_lock<std::mutex> lock(m_reductionMutex);
+            m_numBucketsSubmitted = numBucketsToSubmit;
+        }
+        m_bucketsChanged.notify_all();
+    }
+
+    // Reduction thread: reduces the submitted buckets in order
+    void ReduceSubmittedBuckets(int deviceId)
+    {
+        Matrix<ElemType>::SetDevice(deviceId);
+        std::unique_lock<std::mutex> lock(m_reductionMutex);
+        for (;;)
+        {
+            m_bucketsChanged.wait(lock, [this] { return m_stopReduction || (m_numBucketsReduced < m_numBucketsSubmitted); });
+            if (m_stopReduction)
+                return;
+
+            size_t bucketIndex = m_numBucketsReduced;
+            lock.unlock();
+            try
+            {
+                ReduceBucket(bucketIndex, *m_overlappedGradients, m_allReduceRequests[bucketIndex]);
+            }
+            catch (...)
+            {
+                lock.lock();
+                if (!m_reductionError)
+                    m_reductionError = std::current_exception();
+                lock.unlock();
+            }
+            lock.lock();
+
+            m_numBucketsReduced++;
+            m_bucketsChanged.notify_all();
+        }
+    }
+
+    void AggregateOverlappedGradients(const std::vector<Matrix<ElemType>*>& gradients, DistGradHeader* headerCPU, bool showSyncPerfStats)
+    {
+        auto aggregationStart = std::chrono::steady_clock::now();
+        size_t numGradMatrices = gradients.size();
+        if (headerCPU->numSamples == 0)
+        {
+            headerCPU->criterion = 0.0;
+            for (int i = 0; i < headerCPU->numEvalNode; ++i)
+                headerCPU->evalErrors[i] = { 0.0, 0 };
+
+            // If the current node did not process any samples, the gradients should be zero'd
+            for (size_t i = 0; i < numGradMatrices; ++i)
+            {
+                if (!m_gradientReady[i])
+                    gradients[i]->SetValue(0);
+            }
+        }
+
+        // Submit the gradients that were not reported during backprop
+        m_overlappedGradients = &gradients;
+        for (size_t i = 0; i < numGradMatrices; ++i)
+        {
+            if (!m_gradientReady[i])
+            {
+                m_gradientReady[i] = true;
+                m_numGradientsPending[m_bucketOfGradient[i]]--;
+            }
+        }
+        SubmitCompleteBuckets(gradients);
+
+        {
+            std::unique_lock<std::mutex> lock(m_reductionMutex);
+            m_bucketsChanged.wait(lock, [this] { return m_numBucketsReduced == m_buckets.size(); });
+            if (m_reductionError)
+            {
+                auto error = m_reductionError;
+                m_reductionError = nullptr;
+                std::rethrow_exception(error);
+            }
+        }
+
+        for (size_t b = 0; b < m_buckets.size(); ++b)
+        {
+            MPI_Wait(&m_allReduceRequests[b], MPI_STATUSES_IGNORE) || MpiFail("MPI_Wait");
+            CopyBucketFromCPU(b, gradients);
+        }
+
+        // The header is reduced after the buckets, so that all nodes issue the collectives in the same order
+        m_headerValues.resize(headerCPU->NumValues());
+        headerCPU->CopyTo(m_headerValues.data());
+        m_mpi->AllReduce(m_headerValues);
+        headerCPU->CopyFrom(m_headerValues.data());
+
+        for (size_t b = 0; b < m_gpuDataTransferers.size(); ++b)
+        {
+            m_gpuDataTransferers[b]->WaitForCopyCPUToGPUAsync();
+        }
+
+        // Time from the first submitted bucket to the end of the aggregation vs. time the caller waited here
+        auto aggregationEnd = std::chrono::steady_clock::now();
+        m_communicationTime += std::chrono::duration<double>(aggregationEnd - m_communicationStart).count();
+        m_exposedCommunicationTime += std::chrono::duration<double>(aggregationEnd - aggregationStart).count();
+        if (showSyncPerfStats)
+        {
+            double hidden = (m_communicationTime > 0) ? std::max(0.0, 1 - m_exposedCommunicationTime / m_communicationTime) : 0;
+            fprintf(stderr, "Overlapped gradient aggregation: %.6g seconds communication, %.6g seconds exposed, %.1f%% hidden behind backprop\n",
+                    m_communicationTime, m_exposedCommunicationTime, 100 * hidden);
+            m_communicationTime = 0;
+            m_exposedCommunicationTime = 0;
+        }
+
+        // Prepare for the next minibatch
+        std::fill(m_gradientReady.begin(), m_gradientReady.end(), false);
+        for (size_t b = 0; b < m_buckets.size(); ++b)
+        {
+            m_numGradientsPending[b] = m_buckets[b].m_gradientIndices.size();
+        }
+
+        std::unique_lock<std::mutex> lock(m_reductionMutex);
+        m_numBucketsSubmitted = 0;
+        m_numBucketsReduced = 0;
+    }
+
+    // Buffer that is reduced for the bucket: on the CPU a bucket with a single gradient is reduced in place
+    ElemType* GetReductionBuffer(size_t bucketIndex, const std::vector<Matrix<ElemType>*>& gradients)
+    {
+        if (m_intermediateCPUBuffers[bucketIndex])
+        {
+            return m_intermediateCPUBuffers[bucketIndex].get();
+        }
+
+        return gradients[m_buckets[bucketIndex].m_gradientIndices.front()]->Data();
+    }
+
     bool ResetCurrentEpoch(const std::vector<Matrix<ElemType>*>& gradients, int numEvalNode, int epochNumber)
     {
         bool isNewEpoch = (m_currentEpochNumber != epochNumber);
@@ -154,30 +456,58 @@ private:
                 if (gradients[i]->GetMatrixType() != DENSE)
                     RuntimeError("Gradient aggregation for sparse gradient matrices is currently unsupported!");
 
-                if (deviceId != CPUDEVICE)
-                {
-                    m_gpuDataTransferers.push_back(std::unique_ptr<GPUDataTransferer<ElemType>>(new GPUDataTransferer<ElemType>(deviceId, m_useAsyncAggregation)));
-                    m_intermediateCPUBuffers.push_back(AllocateIntermediateBuffer(deviceId, gradients[i]->GetNumElements()));
-                }
-
                 if (m_useAsyncAggregation)
                 {
                     m_bufferedGradients[gradients[i]].reset(new Matrix<ElemType>(gradients[i]->GetNumRows(), gradients[i]->GetNumCols(), deviceId));
                 }
             }
 
-            if (m_useAsyncAggregation)
+            // A GPU bucket is copied into a pinned CPU buffer, a CPU bucket of several gradients is packed into a buffer
+            CreateBuckets(gradients);
+            for (const auto& bucket : m_buckets)
             {
-                m_bufferedGradHeader = DistGradHeader::Create(numEvalNode);
-                m_bufferedGradHeader->Clear();
+                if (deviceId != CPUDEVICE)
+                {
+                    m_gpuDataTransferers.push_back(std::unique_ptr<GPUDataTransferer<ElemType>>(new GPUDataTransferer<ElemType>(deviceId, m_useAsyncAggregation || m_overlapWithBackprop)));
+                    m_intermediateCPUBuffers.push_back(AllocateIntermediateBuffer(deviceId, bucket.m_numElements));
+                }
+                else if (bucket.m_gradientIndices.size() > 1)
+                {
+                    m_intermediateCPUBuffers.push_back(std::shared_ptr<ElemType>(new ElemType[bucket.m_numElements], [](ElemType* p) { delete[] p; }));
+                }
+                else
+                {
+                    m_intermediateCPUBuffers.push_back(nullptr);
+                }
             }
 
-            if (m_mpi->IsMainNode())
+            if (m_overlapWithBackprop)
             {
-                for (size_t i = 0; i < NumProc() - 1; ++i)
+                m_gradientReady.assign(gradients.size(), false);
+                m_numGradientsPending.resize(m_buckets.size());
+                m_bucketOfGradient.resize(gradients.size());
+                m_allReduceRequests.assign(m_buckets.size(), MPI_REQUEST_NULL);
+                for (size_t b = 0; b < m_buckets.size(); ++b)
                 {
-                    m_recvHeaders.push_back(DistGradHeader::Create(numEvalNode));
+                    m_numGradientsPending[b] = m_buckets[b].m_gradientIndices.size();
+                    for (size_t i = 0; i < m_buckets[b].m_gradientIndices.size(); ++i)
+                        m_bucketOfGradient[m_buckets[b].m_gradientIndices[i]] = b;
                 }
+
+                m_reductionThread = std::thread([this, deviceId] { ReduceSubmittedBuckets(deviceId); });
+            }
+
+            if (m_syncStatsTrace > 0)
+            {
+                fprintf(stderr, "SimpleDistGradAggregator: aggregating %d gradient matrices in %d buckets with %s%s%s.\n",
+                        (int) gradients.size(), (int) m_buckets.size(), m_useHierarchicalAllReduce ? "hierarchical " : "", m_useRingAllReduce ? "ring allreduce" : (m_useHierarchicalAllReduce ? "MPI_Allreduce" : "MPI_Iallreduce"),
+                        m_overlapWithBackprop ? ", overlapped with backprop" : "");
+            }
+
+            if (m_useAsyncAggregation)
+            {
+                m_bufferedGradHeader = DistGradHeader::Create(numEvalNode);
+                m_bufferedGradHeader->Clear();
             }
         }
         else
@@ -238,124 +568,49 @@ private:
             }
         }
 
-        // Initiate transfer of the gradient matrices to the CPU if needed
-        if (deviceId >= 0)
-        {
-            for (size_t i = 0; i < numGradMatrices; ++i)
-            {
-                m_gpuDataTransferers[i]->CopyGPUToCPUAsync(gradients[i]->Data(), gradients[i]->GetNumElements(), m_intermediateCPUBuffers[i].get());
-            }
-        }
+        // Sum the headers of all nodes with a single allreduce, that completes while the gradients are aggregated
+        m_headerValues.resize(headerCPU->NumValues());
+        headerCPU->CopyTo(m_headerValues.data());
+        MPI_Request headerRequest;
+        MPI_Iallreduce(MPI_IN_PLACE, m_headerValues.data(), (int) m_headerValues.size(), MPI_DOUBLE, MPI_SUM, m_mpi->Communicator(), &headerRequest) || MpiFail("MPI_Iallreduce");
 
-        // Initiate receive of the header on the main node
-        std::vector<MPI_Request> recvHeaderRequests(NumProc() - 1);
-        if (m_mpi->IsMainNode())
+        // Initiate transfer of the gradient matrices to the CPU if needed, each into the buffer of its bucket
+        size_t numBuckets = m_buckets.size();
+        if (deviceId >= 0)
         {
-            for (size_t j = 0; j < NumProc() - 1; ++j)
+            for (size_t b = 0; b < numBuckets; ++b)
             {
-                int source = (j >= MyRank()) ? (j + 1) : j;
-                // We use a tag of 'numGradMatrices' for the pre-aggregation header
-                MPI_Irecv(m_recvHeaders[j], m_recvHeaders[j]->Size(), MPI_CHAR, source, numGradMatrices, m_mpi->Communicator(), &(recvHeaderRequests[j])) || MpiFail("MPI_Irecv");
+                CopyBucketToCPU(b, gradients);
             }
         }
 
-        // Send the headers from all nodes but the main node
-        MPI_Request sendHeaderRequest;
-        if (!m_mpi->IsMainNode())
-        {
-            MPI_Isend(headerCPU, headerCPU->Size(), MPI_CHAR, m_mpi->MainNodeRank(), numGradMatrices, m_mpi->Communicator(), &sendHeaderRequest) || MpiFail("MPI_Isend");
-        }
-
-        // Perform MPI async allreduce on the gradient data
-        std::vector<MPI_Request> allReduceRequests(numGradMatrices);
-        for (size_t i = 0; i < numGradMatrices; ++i)
+        // Perform the allreduce of the buckets, in the order in which their data becomes available
+        std::vector<MPI_Request> allReduceRequests(numBuckets, MPI_REQUEST_NULL);
+        for (size_t b = 0; b < numBuckets; ++b)
         {
-            ElemType* reductionBuffer = gradients[i]->Data();
-            if (deviceId >= 0)
-            {
-                m_gpuDataTransferers[i]->WaitForCopyGPUToCPUAsync();
-                reductionBuffer = m_intermediateCPUBuffers[i].get();
-            }
-
-            // On Windows this async MPI_Iallreduce call requires MS MPI v7 or higher to be installed
-            MPI_Iallreduce(MPI_IN_PLACE, reductionBuffer, gradients[i]->GetNumElements(), MPIWrapper::GetDataType(reductionBuffer), MPI_SUM, m_mpi->Communicator(), &allReduceRequests[i]) || MpiFail("MPI_Iallreduce");
+            ReduceBucket(b, gradients, allReduceRequests[b]);
         }
 
-        // On the main node wait for the headers to arrive and aggregate
-        if (m_mpi->IsMainNode())
+        // Wait for the allreduce operations to finish and copy the results back to the gradients
+        for (size_t b = 0; b < numBuckets; ++b)
         {
-            size_t numNodesHeadersReceivedFrom = 0;
-            while (numNodesHeadersReceivedFrom < (NumProc() - 1))
-            {
-                int idx = MPI_UNDEFINED;
-                MPI_Waitany(recvHeaderRequests.size(), recvHeaderRequests.data(), &idx, MPI_STATUS_IGNORE) || MpiFail("MPI_Waitany");
-                if (idx == MPI_UNDEFINED)
-                {
-                    break;
-                }
-
-                numNodesHeadersReceivedFrom++;
-
-                headerCPU->Aggregate(m_recvHeaders[idx], true);
-            }
-
-            assert(numNodesHeadersReceivedFrom == (NumProc() - 1));
+            MPI_Wait(&allReduceRequests[b], MPI_STATUSES_IGNORE) || MpiFail("MPI_Wait");
+            CopyBucketFromCPU(b, gradients);
         }
 
-        MPI_Request recvAggHeaderRequest;
-        // Initiate receive of the aggregate header
-        if (!m_mpi->IsMainNode())
-        {
-            MPI_Irecv(headerCPU, headerCPU->Size(), MPI_CHAR, m_mpi->MainNodeRank(), numGradMatrices + 1 + numGradMatrices, m_mpi->Communicator(), &recvAggHeaderRequest) || MpiFail("MPI_Irecv");
-        }
-
-        // Intiate send of the aggregate header from main node
-        std::vector<MPI_Request> sendAggHeaderRequests(NumProc() - 1);
-        if (m_mpi->IsMainNode())
-        {
-            for (size_t j = 0; j < NumProc() - 1; ++j)
-            {
-                int dest = (j >= MyRank()) ? (j + 1) : j;
-                // TODO: Should we use MPI_Bcast instead for better performance
-                MPI_Isend(headerCPU, headerCPU->Size(), MPI_CHAR, dest, numGradMatrices + 1 + numGradMatrices, m_mpi->Communicator(), &(sendAggHeaderRequests[j])) || MpiFail("MPI_Isend");
-            }
-        }
-
-        // Wait for the allreduce operations to finish and initiate transfer back to the GPU if needed
-        for (size_t i = 0; i < numGradMatrices; ++i)
-        {
-            MPI_Wait(&allReduceRequests[i], MPI_STATUSES_IGNORE) || MpiFail("MPI_Wait");
-            if (deviceId >= 0)
-            {
-                m_gpuDataTransferers[i]->CopyCPUToGPUAsync(m_intermediateCPUBuffers[i].get(), gradients[i]->GetNumElements(), gradients[i]->Data());
-            }
-        }
-
-        // Wait to receive aggregate header
-        if (!m_mpi->IsMainNode())
-        {
-            MPI_Wait(&recvAggHeaderRequest, MPI_STATUSES_IGNORE) || MpiFail("MPI_Wait");
-        }
+        // Wait for the aggregate header
+        MPI_Wait(&headerRequest, MPI_STATUSES_IGNORE) || MpiFail("MPI_Wait");
+        headerCPU->CopyFrom(m_headerValues.data());
 
         // Wait for all the transfers to finish
         if (deviceId >= 0)
         {
-            for (size_t i = 0; i < numGradMatrices; ++i)
+            for (size_t b = 0; b < numBuckets; ++b)
             {
-                m_gpuDataTransferers[i]->WaitForCopyCPUToGPUAsync();
+                m_gpuDataTransferers[b]->WaitForCopyCPUToGPUAsync();
             }
         }
 
-        // Wait for completion of the async send requests
-        if (!m_mpi->IsMainNode())
-        {
-            MPI_Wait(&sendHeaderRequest, MPI_STATUSES_IGNORE) || MpiFail("MPI_Wait");
-        }
-        else
-        {
-            MPI_Waitall(sendAggHeaderRequests.size(), sendAggHeaderRequests.data(), MPI_STATUSES_IGNORE) || MpiFail("MPI_Waitall");
-        }
-
         if (showSyncPerfStats)
         {
             aggregationTimer.Stop();
@@ -365,12 +620,50 @@ private:
     }
 
 private:
+    // A group of gradients that are aggregated with a single allreduce
+    struct GradientBucket
+    {
+        GradientBucket() : m_numElements(0) {}
+
+        std::vector<size_t> m_gradientIndices;
+        std::vector<size_t> m_offsets; // offset of each gradient in the bucket
+        size_t m_numElements;
+    };
+
     std::unique_ptr<CUDAPageLockedMemAllocator> m_allocator;
-    std::vector<std::shared_ptr<ElemType>> m_intermediateCPUBuffers;
 
+    // Per bucket: the transfer of the gradients to/from the GPU and the buffer that is reduced
+    std::vector<GradientBucket> m_buckets;
+    std::vector<std::shared_ptr<ElemType>> m_intermediateCPUBuffers;
     std::vector<std::unique_ptr<GPUDataTransferer<ElemType>>> m_gpuDataTransferers;
 
-    std::vector<DistGradHeader*> m_recvHeaders;
+    size_t m_bucketSizeInBytes;
+    bool m_useRingAllReduce;
+    bool m_useHierarchicalAllReduce;
+
+    // The header as flat values for the allreduce
+    std::vector<double> m_headerValues;
+
+    // Aggregation overlapped with backprop: per minibatch, the buckets [0, m_numBucketsSubmitted) have all their gradients
+    // ready and are handed to m_reductionThread, which has started the reduction of the buckets [0, m_numBucketsReduced)
+    bool m_overlapWithBackprop;
+    const std::vector<Matrix<ElemType>*>* m_overlappedGradients;
+    std::vector<size_t> m_bucketOfGradient;
+    std::vector<bool> m_gradientReady;
+    std::vector<size_t> m_numGradientsPending; // per bucket
+    std::vector<MPI_Request> m_allReduceRequests;
+    size_t m_numBucketsSubmitted;
+    size_t m_numBucketsReduced;
+    std::thread m_reductionThread;
+    std::mutex m_reductionMutex;
+    std::condition_variable m_bucketsChanged;
+    std::exception_ptr m_reductionError;
+    bool m_stopReduction;
+
+    // Communication time and the part of it that was not hidden behind backprop, since the last perf stats
+    std::chrono::steady_clock::time_point m_communicationStart;
+    double m_communicationTime;
+    double m_exposedCommunicationTime;
 
     // Perform aysnchronous gradient aggregation using double buffering of the gradient matrices
     bool m_useAsyncAggregation;
@@ -6,6 +6,7 @@
 
 #include "Basics.h"
 #include "DataReader.h"
+#include "DataWriter.h"
 #include "ComputationNetwork.h"
 #include "DataReaderHelpers.h"
 #include "Helpers.h"
@@ -18,6 +19,8 @@
 #include <cstdio>
 #include "ProgressTracing.h"
 #include "ComputationNetworkBuilder.h"
+#include "AsyncFileWriter.h"
+#include "CPUHalfMatrix.h"
 
 using namespace std;
 
@@ -35,6 +38,11 @@ public:
     {
     }
 
+    ~SimpleOutputWriter()
+    {
+        delete[] m_hostBuffer;
+    }
+
     void WriteOutput(IDataReader& dataReader, size_t mbSize, IDataWriter& dataWriter, const std::vector<std::wstring>& outputNodeNames, size_t numOutputSamples = requestDataSize, bool doWriterUnitTest = false)
     {
         ScopedNetworkOperationMode modeGuard(m_net, NetworkOperationMode::inferring);
@@ -119,19 +127,139 @@ public:
         dataWriter.SaveData(0, outputMatrices, 1, 1, 0);
     }
 
-    void WriteMinibatch(FILE* f, ComputationNodePtr node, 
+    // Formats the minibatch (text or binary) and hands it to the writer, which writes it in the background.
+    void WriteMinibatch(AsyncFileWriter& writer, FILE* f, ComputationNodePtr node, 
         const WriteFormattingOptions & formattingOptions, char formatChar, std::string valueFormatString, std::vector<std::string>& labelMapping,
         size_t numMBsRun, bool gradient)
     {
+        if (formattingOptions.isBinary)
+        {
+            auto block = writer.GetBuffer();
+            FormatBinaryMinibatch(node, formattingOptions, gradient, block);
+            writer.Write(f, std::move(block));
+            return;
+        }
+
         const auto sequenceSeparator = formattingOptions.Processed(node->NodeName(), formattingOptions.sequenceSeparator, numMBsRun);
         const auto sequencePrologue =  formattingOptions.Processed(node->NodeName(), formattingOptions.sequencePrologue,  numMBsRun);
         const auto sequenceEpilogue =  formattingOptions.Processed(node->NodeName(), formattingOptions.sequenceEpilogue,  numMBsRun);
         const auto elementSeparator =  formattingOptions.Processed(node->NodeName(), formattingOptions.elementSeparator,  numMBsRun);
         const auto sampleSeparator =   formattingOptions.Processed(node->NodeName(), formattingOptions.sampleSeparator,   numMBsRun);
 
-        node->WriteMinibatchWithFormatting(f, FrameRange(), SIZE_MAX, SIZE_MAX, formattingOptions.transpose, formattingOptions.isCategoryLabel, formattingOptions.isSparse, labelMapping,
+        writer.Write(f, node->FormatMinibatch(FrameRange(), SIZE_MAX, SIZE_MAX, formattingOptions.transpose, formattingOptions.isCategoryLabel, formattingOptions.isSparse, labelMapping,
             sequenceSeparator, sequencePrologue, sequenceEpilogue, elementSeparator, sampleSeparator,
-            valueFormatString, gradient);
+            valueFormatString, gradient));
+    }
+
+    // Binary output format, all numbers little-endian:
+    //  header (once per node): char[8] "CNTKOUT\0", uint32 version (1), uint32 element size in bytes (2 = half, 4 = float, 8 = double),
+    //                          uint32 flags (1 = sequence keys), uint32 sample dimension, uint32 node name length, node name (UTF-8)
+    //  one record per sequence: [uint64 sequence id, if sequence keys are written], uint32 number of samples,
+    //                          followed by the samples, each sample a contiguous vector of 'sample dimension' values
+    // Records are packed without padding, so values in the file are not necessarily aligned to their size.
+    // A node without MBLayout is written as one record per minibatch whose samples are the columns of its value,
+    // i.e. its sample dimension is the leading dimension of its tensor.
+    static size_t GetBinarySampleDimension(const ComputationNodeBasePtr& node)
+    {
+        const auto& shape = node->GetSampleLayout();
+        if (node->HasMBLayout())
+            return shape.GetNumElements();
+        return shape.GetRank() > 0 ? shape[0] : 0;
+    }
+
+    void WriteBinaryHeader(AsyncFileWriter& writer, FILE* f, ComputationNodeBasePtr node, const WriteFormattingOptions& formattingOptions)
+    {
+        auto block = writer.GetBuffer();
+        block.append("CNTKOUT", 8); // including the terminating 0
+        AppendBinary(block, (uint32_t)1);
+        AppendBinary(block, (uint32_t)formattingOptions.binaryElementSize);
+        AppendBinary(block, (uint32_t)(formattingOptions.writeSequenceKeys ? 1 : 0));
+        AppendBinary(block, (uint32_t)GetBinarySampleDimension(node));
+        const auto name = msra::strfun::utf8(node->NodeName());
+        AppendBinary(block, (uint32_t)name.size());
+        block.append(name);
+        writer.Write(f, std::move(block));
+    }
+
+    void FormatBinaryMinibatch(ComputationNodePtr node, const WriteFormattingOptions& formattingOptions, bool gradient, std::string& block)
+    {
+        const Matrix<ElemType>& values = gradient ? node->Gradient() : node->Value();
+        const size_t rows = values.GetNumRows();
+        if (rows != GetBinarySampleDimension(node))
+            LogicError("%ls: Binary output expects %d values per sample, but the node has %d rows.", node->NodeDescription().c_str(), (int)GetBinarySampleDimension(node), (int)rows);
+        values.CopyToArray(m_hostBuffer, m_hostBufferSize);
+
+        // collect the columns of each sequence: (sequence id, first column, column stride, number of samples)
+        struct SequenceColumns { size_t seqId; size_t firstColumn; size_t stride; size_t numSamples; };
+        std::vector<SequenceColumns> sequenceColumns;
+        const auto& layout = node->GetMBLayout();
+        if (!layout) // no MBLayout: a single sample that consists of all columns
+        {
+            sequenceColumns.push_back(SequenceColumns{ 0, 0, 1, values.GetNumCols() });
+        }
+        else
+        {
+            const size_t width = layout->GetNumTimeSteps();
+            const size_t numParallelSequences = layout->GetNumParallelSequences();
+            for (const auto& seqInfo : layout->GetAllSequences())
+            {
+                if (seqInfo.seqId == GAP_SEQUENCE_ID)
+                    continue;
+                const size_t tBegin = seqInfo.tBegin >= 0 ? (size_t)seqInfo.tBegin : 0;
+                const size_t tEnd = seqInfo.tEnd <= width ? seqInfo.tEnd : width;
+                if (tBegin >= tEnd)
+                    continue;
+                sequenceColumns.push_back(SequenceColumns{ seqInfo.seqId, tBegin * numParallelSequences + seqInfo.s, numParallelSequences, tEnd - tBegin });
+            }
+        }
+
+        // compute the record offsets, so that the records can be converted in parallel
+        const size_t elementSize = formattingOptions.binaryElementSize;
+        const size_t recordHeaderSize = (formattingOptions.writeSequenceKeys ? sizeof(uint64_t) : 0) + sizeof(uint32_t);
+        std::vector<size_t> offsets(sequenceColumns.size() + 1, 0);
+        for (size_t i = 0; i < sequenceColumns.size(); i++)
+            offsets[i + 1] = offsets[i] + recordHeaderSize + sequenceColumns[i].numSamples * rows * elementSize;
+        block.resize(offsets.back());
+
+#pragma omp parallel for if (sequenceColumns.size() > 1)
+        for (long long i = 0; i < (long long)sequenceColumns.size(); i++)
+        {
+            const auto& sequence = sequenceColumns[i];
+            char* record = &block[offsets[i]];
+            if (formattingOptions.writeSequenceKeys)
+            {
+                uint64_t key = sequence.seqId;
+                memcpy(record, &key, sizeof(key));
+                record += sizeof(key);
+            }
+            uint32_t numSamples = (uint32_t)sequence.numSamples;
+            memcpy(record, &numSamples, sizeof(numSamples));
+            record += sizeof(numSamples);
+
+            for (size_t t = 0; t < sequence.numSamples; t++)
+            {
+                const ElemType* sample = m_hostBuffer + (sequence.firstColumn + t * sequence.stride) * rows;
+                if (elementSize == sizeof(float))
+                    StoreConverted(record, sample, rows, [](ElemType value) { return (float)value; });
+                else if (elementSize == sizeof(double))
+                    StoreConverted(record, sample, rows, [](ElemType value) { return (double)value; });
+                else
+                    StoreConverted(record, sample, rows, [](ElemType value) { return CPUHalfMatrix::FloatToHalf((float)value); });
+                record += rows * elementSize;
+            }
+        }
+    }
+
+    // Stores 'count' converted values at 'target'. The records are not aligned (e.g. after a 12-byte record header),
+    // so the values are copied byte-wise instead of being assigned through a typed pointer.
+    template <class Converter>
+    static void StoreConverted(char* target, const ElemType* values, size_t count, const Converter& convert)
+    {
+        for (size_t r = 0; r < count; r++)
+        {
+            const auto value = convert(values[r]);
+            memcpy(target + r * sizeof(value), &value, sizeof(value));
+        }
     }
 
     void InsertNode(std::vector<ComputationNodeBasePtr>& allNodes, ComputationNodeBasePtr parent, ComputationNodeBasePtr newNode)
@@ -203,6 +331,9 @@ public:
         if ((formattingOptions.isCategoryLabel || formattingOptions.isSparse) && !formattingOptions.labelMappingFile.empty())
             File::LoadLabelFile(formattingOptions.labelMappingFile, labelMapping);
 
+        if (formattingOptions.isBinary && outputPath == L"-")
+            InvalidArgument("write: binary output cannot be written to stdout, please specify an outputPath.");
+
         // open output files
         File::MakeIntermediateDirs(outputPath);
         std::map<ComputationNodeBasePtr, shared_ptr<File>> outputStreams; // TODO: why does unique_ptr not work here? Complains about non-existent default_delete()
@@ -211,7 +342,7 @@ public:
             std::wstring nodeOutputPath = outputPath;
             if (nodeOutputPath != L"-")
                 nodeOutputPath += L"." + onode->NodeName();
-            auto f = make_shared<File>(nodeOutputPath, fileOptionsWrite | fileOptionsText);
+            auto f = make_shared<File>(nodeOutputPath, fileOptionsWrite | (formattingOptions.isBinary ? fileOptionsBinary : fileOptionsText));
             outputStreams[onode] = f;
         }
 
@@ -222,10 +353,16 @@ public:
 
         size_t totalEpochSamples = 0;
 
-        for (auto & onode : outputNodes)
+        // writes the formatted minibatches while the next one is evaluated
+        AsyncFileWriter writer(formattingOptions.asyncWrite);
+
+        for (auto & onode : allOutputNodes)
         {
             FILE* f = *outputStreams[onode];
-            fprintfOrDie(f, "%s", formattingOptions.prologue.c_str());
+            if (formattingOptions.isBinary)
+                WriteBinaryHeader(writer, f, onode, formattingOptions);
+            else if (find(outputNodes.begin(), outputNodes.end(), onode) != outputNodes.end())
+                writer.Write(f, formattingOptions.prologue);
         }
 
         size_t actualMBSize;
@@ -245,7 +382,7 @@ public:
                 m_net->ForwardProp(onode);
 
                 FILE* file = *outputStreams[onode];
-                WriteMinibatch(file, dynamic_pointer_cast<ComputationNode<ElemType>>(onode), formattingOptions, formatChar, valueFormatString, labelMapping, numMBsRun, /* gradient */ false);
+                WriteMinibatch(writer, file, dynamic_pointer_cast<ComputationNode<ElemType>>(onode), formattingOptions, formatChar, valueFormatString, labelMapping, numMBsRun, /* gradient */ false);
 
                 if (nodeUnitTest)
                     m_net->Backprop(onode);
@@ -262,7 +399,7 @@ public:
                     }
                     else
                     {
-                        WriteMinibatch(file, node, formattingOptions, formatChar, valueFormatString, labelMapping, numMBsRun, /* gradient */ true);
+                        WriteMinibatch(writer, file, node, formattingOptions, formatChar, valueFormatString, labelMapping, numMBsRun, /* gradient */ true);
                     }
                 }
             }
@@ -270,7 +407,7 @@ public:
 
             fprintf(stderr, "Minibatch[%lu]: ActualMBSize = %lu\n", numMBsRun, actualMBSize);
             if (outputPath == L"-") // if we mush all nodes together on stdout, add some visual separator
-                fprintf(stdout, "\n");
+                writer.Write(stdout, std::string("\n"));
 
             numItersSinceLastPrintOfProgress = ProgressTracing::TraceFakeProgress(numIterationsBeforePrintingProgress, numItersSinceLastPrintOfProgress);
 
@@ -279,11 +416,15 @@ public:
             dataReader.DataEnd();
         } // end loop over minibatches
 
-        for (auto & stream : outputStreams)
+        if (!formattingOptions.isBinary)
         {
-            FILE* f = *stream.second;
-            fprintfOrDie(f, "%s", formattingOptions.epilogue.c_str());
+            for (auto & stream : outputStreams)
+            {
+                FILE* f = *stream.second;
+                writer.Write(f, formattingOptions.epilogue);
+            }
         }
+        writer.Flush();
 
         fprintf(stderr, "Written to %ls*\nTotal Samples Evaluated = %lu\n", outputPath.c_str(), totalEpochSamples);
 
@@ -293,8 +434,18 @@ public:
     }
 
 private:
+    template <class T>
+    static void AppendBinary(std::string& block, T value)
+    {
+        block.append(reinterpret_cast<const char*>(&value), sizeof(value));
+    }
+
     ComputationNetworkPtr m_net;
     int m_verbosity;
+
+    // host copy of the output matrix for binary formatting, reused across minibatches
+    ElemType* m_hostBuffer = nullptr;
+    size_t m_hostBufferSize = 0;
     void operator=(const SimpleOutputWriter&); // (not assignable)
 };
 
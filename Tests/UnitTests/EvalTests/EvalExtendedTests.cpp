@@ -294,5 +294,211 @@ BOOST_AUTO_TEST_CASE(EvalSparseTimesTest)
     eval->Destroy();
 }
 
+BOOST_AUTO_TEST_CASE(EvalRecurrentSessionTest)
+{
+    // Running sum over the sequence
+    std::string modelDefinition =
+        "deviceId = -1 \n"
+        "precision = \"float\" \n"
+        "traceLevel = 1 \n"
+        "run=NDLNetworkBuilder \n"
+        "NDLNetworkBuilder=[ \n"
+        "i1 = Input(1) \n"
+        "d1 = PastValue(1, o1, timeStep=1, defaultHiddenActivation=0) \n"
+        "o1 = Plus(i1, d1, tag=\"output\") \n"
+        "FeatureNodes = (i1) \n"
+        "] \n";
+
+    VariableSchema inputLayouts;
+    VariableSchema outputLayouts;
+    IEvaluateModelExtended<float> *eval;
+    eval = SetupNetworkAndGetLayouts(modelDefinition, inputLayouts, outputLayouts);
+
+    Values<float> outputBuffer = outputLayouts.CreateBuffers<float>({ 2 });
+    Values<float> inputBuffer(1);
+
+    // Two sessions, each continuing its own sequence
+    size_t session1 = eval->CreateSession();
+    size_t session2 = eval->CreateSession();
+
+    inputBuffer[0].m_buffer = { 1, 2 };
+    eval->ForwardPass(session1, inputBuffer, outputBuffer);
+    std::vector<float> expected{ 1, 3 };
+    auto buf = outputBuffer[0].m_buffer;
+    BOOST_CHECK_EQUAL_COLLECTIONS(buf.begin(), buf.end(), expected.begin(), expected.end());
+
+    inputBuffer[0].m_buffer = { 10 };
+    eval->ForwardPass(session2, inputBuffer, outputBuffer);
+    expected = { 10 };
+    buf = outputBuffer[0].m_buffer;
+    BOOST_CHECK_EQUAL_COLLECTIONS(buf.begin(), buf.end(), expected.begin(), expected.end());
+
+    // A call without session is a sequence of its own
+    inputBuffer[0].m_buffer = { 5 };
+    eval->ForwardPass(inputBuffer, outputBuffer);
+    expected = { 5 };
+    buf = outputBuffer[0].m_buffer;
+    BOOST_CHECK_EQUAL_COLLECTIONS(buf.begin(), buf.end(), expected.begin(), expected.end());
+
+    inputBuffer[0].m_buffer = { 3, 4 };
+    eval->ForwardPass(session1, inputBuffer, outputBuffer);
+    expected = { 6, 10 };
+    buf = outputBuffer[0].m_buffer;
+    BOOST_CHECK_EQUAL_COLLECTIONS(buf.begin(), buf.end(), expected.begin(), expected.end());
+
+    // After a reset the session starts a new sequence
+    eval->ResetSession(session1);
+    inputBuffer[0].m_buffer = { 1 };
+    eval->ForwardPass(session1, inputBuffer, outputBuffer);
+    expected = { 1 };
+    buf = outputBuffer[0].m_buffer;
+    BOOST_CHECK_EQUAL_COLLECTIONS(buf.begin(), buf.end(), expected.begin(), expected.end());
+
+    eval->ForwardPass(session2, inputBuffer, outputBuffer);
+    expected = { 11 };
+    buf = outputBuffer[0].m_buffer;
+    BOOST_CHECK_EQUAL_COLLECTIONS(buf.begin(), buf.end(), expected.begin(), expected.end());
+
+    // Both sessions in one forward pass, with sequences of different length
+    std::vector<Values<float>> inputBuffers(2, Values<float>(1));
+    inputBuffers[0][0].m_buffer = { 2, 3 };
+    inputBuffers[1][0].m_buffer = { 4 };
+    std::vector<Values<float>> outputBuffers = { outputLayouts.CreateBuffers<float>({ 2 }), outputLayouts.CreateBuffers<float>({ 2 }) };
+    eval->ForwardPass(std::vector<size_t>{ session1, session2 }, inputBuffers, outputBuffers);
+    expected = { 3, 6 };
+    buf = outputBuffers[0][0].m_buffer;
+    BOOST_CHECK_EQUAL_COLLECTIONS(buf.begin(), buf.end(), expected.begin(), expected.end());
+    expected = { 15 };
+    buf = outputBuffers[1][0].m_buffer;
+    BOOST_CHECK_EQUAL_COLLECTIONS(buf.begin(), buf.end(), expected.begin(), expected.end());
+
+    BOOST_REQUIRE_THROW(eval->ForwardPass(std::vector<size_t>{ session1, session1 }, inputBuffers, outputBuffers), std::exception); // Same session twice
+
+    eval->DestroySession(session1);
+    BOOST_REQUIRE_THROW(eval->ForwardPass(session1, inputBuffer, outputBuffer), std::exception); // Invalid session
+
+    eval->Destroy();
+}
+
+// The frames [begin, end) of 'sequence', which holds samples of 'dimension' values, as dense or sparse input
+static ValueBuffer<float, Vector> GetFrames(const std::vector<float>& sequence, size_t dimension, size_t begin, size_t end, bool sparse)
+{
+    ValueBuffer<float, Vector> frames;
+    if (!sparse)
+    {
+        frames.m_buffer.assign(sequence.begin() + begin * dimension, sequence.begin() + end * dimension);
+        return frames;
+    }
+
+    frames.m_colIndices.push_back(0);
+    for (size_t t = begin; t < end; t++)
+    {
+        for (size_t row = 0; row < dimension; row++)
+        {
+            float value = sequence[t * dimension + row];
+            if (value != 0)
+            {
+                frames.m_buffer.push_back(value);
+                frames.m_indices.push_back((int)row);
+            }
+        }
+        frames.m_colIndices.push_back((int)frames.m_indices.size());
+    }
+    return frames;
+}
+
+BOOST_AUTO_TEST_CASE(EvalBatchedSessionsTest)
+{
+    const size_t inputDim = 3;
+    const size_t hiddenDim = 4;
+    for (bool sparse : { false, true })
+    {
+        // A simple recurrent network
+        std::string modelDefinition =
+            "deviceId = -1 \n"
+            "precision = \"float\" \n"
+            "traceLevel = 1 \n"
+            "run=NDLNetworkBuilder \n"
+            "NDLNetworkBuilder=[ \n"
+            + std::string(sparse ? "i1 = SparseInput(3) \n" : "i1 = Input(3) \n") +
+            "W = Parameter(4, 3, init=uniform, initValueScale=1, randomSeed=1) \n"
+            "U = Parameter(4, 4, init=uniform, initValueScale=1, randomSeed=2) \n"
+            "d1 = PastValue(4, o1, timeStep=1, defaultHiddenActivation=0.1) \n"
+            "o1 = Tanh(Plus(Times(W, i1), Times(U, d1)), tag=\"output\") \n"
+            "FeatureNodes = (i1) \n"
+            "] \n";
+
+        VariableSchema inputLayouts;
+        VariableSchema outputLayouts;
+        IEvaluateModelExtended<float> *eval;
+        eval = SetupNetworkAndGetLayouts(modelDefinition, inputLayouts, outputLayouts);
+
+        // One sequence per session, of different lengths, with some zeros for the sparse input
+        const std::vector<size_t> lengths = { 5, 1, 3, 8 };
+        const size_t numSessions = lengths.size();
+        std::vector<std::vector<float>> sequences(numSessions);
+        for (size_t s = 0; s < numSessions; s++)
+            for (size_t i = 0; i < lengths[s] * inputDim; i++)
+                sequences[s].push_back(((s * 7 + i * 3) % 5) * 0.5f - 1.0f);
+
+        // The expected outputs are those of each sequence evaluated alone, in a session of its own
+        std::vector<std::vector<float>> expected(numSessions);
+        for (size_t s = 0; s < numSessions; s++)
+        {
+            size_t session = eval->CreateSession();
+            Values<float> inputBuffer(1);
+            inputBuffer[0] = GetFrames(sequences[s], inputDim, 0, lengths[s], sparse);
+            Values<float> outputBuffer = outputLayouts.CreateBuffers<float>({ lengths[s] });
+            eval->ForwardPass(session, inputBuffer, outputBuffer);
+            BOOST_REQUIRE_EQUAL(hiddenDim * lengths[s], outputBuffer[0].m_buffer.size());
+            expected[s] = outputBuffer[0].m_buffer;
+            eval->DestroySession(session);
+        }
+
+        // All sessions together, in two forward passes: the first half of every sequence, then the rest
+        // of the sequences that are longer than one frame
+        std::vector<size_t> sessions;
+        for (size_t s = 0; s < numSessions; s++)
+            sessions.push_back(eval->CreateSession());
+        std::vector<std::vector<float>> actual(numSessions);
+        for (bool firstHalf : { true, false })
+        {
+            std::vector<size_t> batchSessions, batchSequences;
+            std::vector<Values<float>> inputBuffers, outputBuffers;
+            for (size_t s = 0; s < numSessions; s++)
+            {
+                size_t begin = firstHalf ? 0 : (lengths[s] + 1) / 2;
+                size_t end = firstHalf ? (lengths[s] + 1) / 2 : lengths[s];
+                if (begin == end)
+                    continue;
+                batchSessions.push_back(sessions[s]);
+                batchSequences.push_back(s);
+                inputBuffers.push_back(Values<float>(1));
+                inputBuffers.back()[0] = GetFrames(sequences[s], inputDim, begin, end, sparse);
+                outputBuffers.push_back(outputLayouts.CreateBuffers<float>({ end - begin }));
+            }
+            BOOST_REQUIRE_GT(batchSessions.size(), 1);
+
+            eval->ForwardPass(batchSessions, inputBuffers, outputBuffers);
+            for (size_t k = 0; k < batchSessions.size(); k++)
+            {
+                auto buf = outputBuffers[k][0].m_buffer;
+                actual[batchSequences[k]].insert(actual[batchSequences[k]].end(), buf.begin(), buf.end());
+            }
+        }
+
+        for (size_t s = 0; s < numSessions; s++)
+        {
+            BOOST_REQUIRE_EQUAL(expected[s].size(), actual[s].size());
+            for (size_t i = 0; i < expected[s].size(); i++)
+                BOOST_CHECK_SMALL(expected[s][i] - actual[s][i], 1e-5f);
+        }
+
+        for (auto session : sessions)
+            eval->DestroySession(session);
+        eval->Destroy();
+    }
+}
+
 BOOST_AUTO_TEST_SUITE_END()
 }}}}
\ No newline at end of file
@@ -12,6 +12,7 @@
 #include <vector>
 #include "Matrix.h"
 #include "CPUMatrix.h"
+#include "CPUSparseMatrix.h"
 #include "Sequences.h"
 using namespace Microsoft::MSR::CNTK;
 using namespace std;
@@ -435,8 +436,57 @@ void MandSTest(int count, int devId)
     delete[] data3;
 }
 
+// dense x sparse products as used for embeddings of one-hot inputs, for a sweep of sparsity levels
+template <class ElemType>
+void DenseTimesSparseSweepTest(size_t dim, size_t vocabSize, size_t mbSize, int count)
+{
+    cout << "Testing CPUSparseMatrix" << endl;
+    cout << "E(" << dim << "x" << vocabSize << ") and X(" << vocabSize << "x" << mbSize << ")" << endl;
+    CPUMatrix<ElemType> E(dim, vocabSize);
+    randomInitializeCPUMatrix<ElemType>(E);
+    CPUMatrix<ElemType> Y(dim, mbSize);
+    randomInitializeCPUMatrix<ElemType>(Y);
+    CPUMatrix<ElemType> ET(vocabSize, dim);
+    randomInitializeCPUMatrix<ElemType>(ET);
+    CPUMatrix<ElemType> C(dim, mbSize);
+    CPUMatrix<ElemType> G(dim, vocabSize);
+    CPUSparseMatrix<ElemType> GBlock(matrixFormatSparseBlockCol);
+
+    for (size_t nzPerColumn = 1; nzPerColumn <= 1024; nzPerColumn *= 4)
+    {
+        // nzPerColumn words per column, spread over the vocabulary
+        CPUSparseMatrix<ElemType> X(matrixFormatSparseCSC, vocabSize, mbSize, nzPerColumn * mbSize);
+        const size_t stride = vocabSize / nzPerColumn;
+        for (size_t j = 0; j < mbSize; j++)
+            for (size_t i = 0; i < nzPerColumn; i++)
+                X.SetValue(i * stride + rand() % stride, j, 1);
+
+        auto t_start = clock();
+        for (int i = 0; i < count; ++i)
+            CPUSparseMatrix<ElemType>::MultiplyAndWeightedAdd(1, E, false, X, false, 0, C); // forward
+        auto t_fwd = clock();
+        for (int i = 0; i < count; ++i)
+            CPUSparseMatrix<ElemType>::MultiplyAndWeightedAdd(1, ET, true, X, false, 0, C); // forward, transposed embedding
+        auto t_fwdT = clock();
+        for (int i = 0; i < count; ++i)
+            CPUSparseMatrix<ElemType>::MultiplyAndWeightedAdd(1, Y, false, X, true, 0, G); // dense gradient
+        auto t_grad = clock();
+        for (int i = 0; i < count; ++i)
+            CPUSparseMatrix<ElemType>::MultiplyAndAdd(1, Y, false, X, true, GBlock); // block-sparse gradient
+        auto t_gradBlock = clock();
+
+        cout << "density " << (double) nzPerColumn / vocabSize << ":"
+             << " E*X " << 1.0 * (t_fwd - t_start) / (CLOCKS_PER_SEC * count)
+             << " E'*X " << 1.0 * (t_fwdT - t_fwd) / (CLOCKS_PER_SEC * count)
+             << " Y*X' " << 1.0 * (t_grad - t_fwdT) / (CLOCKS_PER_SEC * count)
+             << " Y*X' (block) " << 1.0 * (t_gradBlock - t_grad) / (CLOCKS_PER_SEC * count) << " seconds" << endl;
+    }
+}
+
 int wmain()
 {
+    DenseTimesSparseSweepTest<float>(256, 100000, 256, 10);
+
     ColumnSliceMultAndAddTest<float>(2048, 2048, 256, 0);
 
     TestRnnForwardPropSRP<float>();
@@ -220,6 +220,34 @@ BOOST_FIXTURE_TEST_CASE(CPUMatrixMultiplyAndDiv, RandomSeedFixture)
     BOOST_CHECK(m3.IsEqualTo(m2));
 }
 
+BOOST_FIXTURE_TEST_CASE(CPUMatrixMultiplyHalfPrecision, RandomSeedFixture)
+{
+    // large enough for several conversion panels
+    const size_t rows = 600, cols = 700, n = 5;
+    SMatrix a = SMatrix::RandomUniform(rows, cols, -1, 1, IncrementCounter());
+    CPUHalfMatrix halfA(a.Data(), rows, cols);
+
+    // the reference uses the same (rounded) values in float
+    SMatrix roundedA(rows, cols);
+    halfA.CopyColumnsTo(0, cols, roundedA.Data());
+    BOOST_CHECK(roundedA.IsEqualTo(a, 1e-3f));
+
+    SMatrix b = SMatrix::RandomUniform(cols, n, -1, 1, IncrementCounter());
+    SMatrix c = SMatrix::RandomUniform(rows, n, -1, 1, IncrementCounter());
+    SMatrix expected(c); // deep copy
+    SMatrix::MultiplyAndWeightedAdd(2, roundedA, false, b, false, 0.5, expected);
+    SMatrix::MultiplyAndWeightedAdd(2, halfA, false, b, false, 0.5, c);
+    BOOST_CHECK(c.IsEqualTo(expected, 1e-3f));
+
+    // transposed operands
+    SMatrix bt = SMatrix::RandomUniform(n, rows, -1, 1, IncrementCounter());
+    SMatrix ct(cols, n);
+    SMatrix expectedT(cols, n);
+    SMatrix::MultiplyAndWeightedAdd(1, roundedA, true, bt, true, 0, expectedT);
+    SMatrix::MultiplyAndWeightedAdd(1, halfA, true, bt, true, 0, ct);
+    BOOST_CHECK(ct.IsEqualTo(expectedT, 1e-3f));
+}
+
 BOOST_FIXTURE_TEST_CASE(CPUMatrixElementOperations, RandomSeedFixture)
 {
     // TODO: consider splitting this large test
@@ -59,6 +59,107 @@ BOOST_FIXTURE_TEST_CASE(CPUSparseMatrixCopyColumnSliceToDense, RandomSeedFixture
     BOOST_CHECK(dm1.IsEqualTo(dm2, c_epsilonFloatE4));
 }
 
+BOOST_FIXTURE_TEST_CASE(CPUSparseMatrixDenseTimesSparse, RandomSeedFixture)
+{
+    const size_t m = 70;
+    const size_t k = 40;
+    const size_t n = 30;
+
+    for (int transposeA = 0; transposeA < 2; transposeA++)
+    {
+        for (int transposeB = 0; transposeB < 2; transposeB++)
+        {
+            DenseMatrix a = transposeA ? DenseMatrix(k, m) : DenseMatrix(m, k);
+            a.SetUniformRandomValue(-1, 1, IncrementCounter());
+
+            // about 10% nonzeros
+            DenseMatrix b = transposeB ? DenseMatrix(n, k) : DenseMatrix(k, n);
+            b.SetUniformRandomValue(-1, 1, IncrementCounter());
+            SparseMatrix sb(MatrixFormat::matrixFormatSparseCSC, b.GetNumRows(), b.GetNumCols(), 0);
+            foreach_coord (row, col, b)
+            {
+                if (fabs(b(row, col)) < 0.9)
+                    b(row, col) = 0;
+                else
+                    sb.SetValue(row, col, b(row, col));
+            }
+
+            DenseMatrix c0(m, n);
+            c0.SetUniformRandomValue(-1, 1, IncrementCounter());
+            DenseMatrix c1(m, n);
+            c1.SetValue(c0);
+            DenseMatrix::MultiplyAndWeightedAdd(0.3, a, !!transposeA, b, !!transposeB, 1.2, c0);
+            SparseMatrix::MultiplyAndWeightedAdd(0.3, a, !!transposeA, sb, !!transposeB, 1.2, c1);
+            BOOST_CHECK(c0.IsEqualTo(c1, c_epsilonFloatE4));
+
+            // as block-sparse result, e.g. the gradient of an embedding
+            DenseMatrix d0(m, n);
+            DenseMatrix::MultiplyAndWeightedAdd(0.3, a, !!transposeA, b, !!transposeB, 0, d0);
+            SparseMatrix sd(MatrixFormat::matrixFormatSparseBlockCol);
+            SparseMatrix::MultiplyAndAdd(0.3, a, !!transposeA, sb, !!transposeB, sd);
+            DenseMatrix d1(m, n);
+            d1.SetValue(0);
+            SparseMatrix::ScaleAndAdd(1, sd, d1);
+            BOOST_CHECK(d0.IsEqualTo(d1, c_epsilonFloatE4));
+        }
+    }
+}
+
+BOOST_FIXTURE_TEST_CASE(CPUSparseMatrixCrossEntropyWithSoftmax, RandomSeedFixture)
+{
+    const size_t m = 500;
+    const size_t n = 40;
+    const double alpha = 0.7;
+
+    DenseMatrix prediction(m, n);
+    prediction.SetUniformRandomValue(-20, 20, IncrementCounter());
+
+    // one-hot labels, dense and sparse
+    DenseMatrix labels(m, n);
+    labels.SetValue(0);
+    SparseMatrix sparseLabels(MatrixFormat::matrixFormatSparseCSC, m, n, 0);
+    foreach_column (col, labels)
+    {
+        size_t row = (col * 37) % m;
+        labels(row, col) = 1;
+        sparseLabels.SetValue(row, col, 1);
+    }
+
+    // reference: -sum(labels .* logSoftmax(prediction)) per column, alpha * (softmax(prediction) - labels)
+    DenseMatrix logSoftmax;
+    logSoftmax.AssignLogSoftmaxOf(prediction, true);
+    DenseMatrix expectedLoss(1, n);
+    DenseMatrix expectedGradient(m, n);
+    expectedGradient.SetUniformRandomValue(-1, 1, IncrementCounter());
+    DenseMatrix denseGradient(m, n);
+    denseGradient.SetValue(expectedGradient);
+    DenseMatrix sparseGradient(m, n);
+    sparseGradient.SetValue(expectedGradient);
+    foreach_column (col, labels)
+    {
+        double loss = 0;
+        foreach_row (row, labels)
+        {
+            loss -= labels(row, col) * logSoftmax(row, col);
+            expectedGradient(row, col) += alpha * (exp(logSoftmax(row, col)) - labels(row, col));
+        }
+        expectedLoss(0, col) = loss;
+    }
+
+    DenseMatrix logSumExp;
+    DenseMatrix denseLoss;
+    denseLoss.AssignCrossEntropyWithSoftmaxOf(labels, prediction, logSumExp);
+    BOOST_CHECK(denseLoss.IsEqualTo(expectedLoss, c_epsilonFloatE4));
+    DenseMatrix::AddCrossEntropyWithSoftmaxGradient(alpha, labels, prediction, logSumExp, denseGradient);
+    BOOST_CHECK(denseGradient.IsEqualTo(expectedGradient, c_epsilonFloatE4));
+
+    DenseMatrix sparseLoss;
+    SparseMatrix::AssignCrossEntropyWithSoftmaxOf(sparseLabels, prediction, logSumExp, sparseLoss);
+    BOOST_CHECK(sparseLoss.IsEqualTo(expectedLoss, c_epsilonFloatE4));
+    SparseMatrix::AddCrossEntropyWithSoftmaxGradient(alpha, sparseLabels, prediction, logSumExp, sparseGradient);
+    BOOST_CHECK(sparseGradient.IsEqualTo(expectedGradient, c_epsilonFloatE4));
+}
+
 BOOST_AUTO_TEST_SUITE_END()
 }
 } } }
@@ -462,6 +462,17 @@ BOOST_FIXTURE_TEST_CASE(CPUMatrix1BitQuantizeDouble, RandomSeedFixture)
     TestQuantization<double>(CPUDEVICE, 100, 50, -0.5f, +0.5f, 2915, 5);
 }
 
+// Matrices large enough that the columns are (un)quantized in parallel.
+BOOST_FIXTURE_TEST_CASE(CPUMatrixQuantizeLarge, RandomSeedFixture)
+{
+    RedirectStdErrAndStdOut(createDebugOut);
+
+    TestQuantization<float>(CPUDEVICE, 256, 135, -1.0f, +1.0f, 2015, 3);
+    TestQuantization<float>(CPUDEVICE, 737, 373, -0.5f, +0.5f, 2915, 3);
+    TestQuantization<double>(CPUDEVICE, 256, 135, -1.0f, +1.0f, 2015, 3);
+    TestQuantization<double>(CPUDEVICE, 737, 373, -0.5f, +0.5f, 2915, 3);
+}
+
 /*
         Original test cases were using these parameter:
 
@@ -0,0 +1,155 @@
+//
+// Copyright (c) Microsoft. All rights reserved.
+// Licensed under the MIT license. See LICENSE.md file in the project root for full license information.
+//
+#include "stdafx.h"
+#include "InputAndParamNodes.h"
+#include "LinearAlgebraNodes.h"
+#include "ComputationNetworkBuilder.h"
+#include "AsyncCheckpointWriter.h"
+#include <boost/filesystem.hpp>
+
+using namespace Microsoft::MSR::CNTK;
+
+namespace Microsoft { namespace MSR { namespace CNTK { namespace Test {
+
+struct CheckpointWriterFixture
+{
+    CheckpointWriterFixture()
+        : m_directory(boost::filesystem::temp_directory_path() / boost::filesystem::unique_path())
+    {
+        boost::filesystem::create_directories(m_directory);
+    }
+
+    ~CheckpointWriterFixture()
+    {
+        boost::filesystem::remove_all(m_directory);
+    }
+
+    std::wstring Path(const std::wstring& fileName) const
+    {
+        return (m_directory / fileName).wstring();
+    }
+
+    static std::string ReadFile(const std::wstring& path)
+    {
+        std::ifstream file(boost::filesystem::path(path).string(), std::ios::binary);
+        return std::string(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
+    }
+
+    boost::filesystem::path m_directory;
+};
+
+BOOST_FIXTURE_TEST_SUITE(CheckpointWriterSuite, CheckpointWriterFixture)
+
+BOOST_AUTO_TEST_CASE(CheckpointFilesAndCleanup)
+{
+    for (bool async : { false, true })
+    {
+        const size_t numCheckpoints = 5;
+        {
+            AsyncCheckpointWriter writer(async);
+            for (size_t epoch = 0; epoch < numCheckpoints; epoch++)
+            {
+                // the model grows, so the buffers sized after the previous checkpoint are too small
+                writer.BeginCheckpoint();
+                File& model = writer.AddFile(Path(L"model." + std::to_wstring(epoch)), 10);
+                for (size_t k = 0; k < 100000 * (epoch + 1); k++)
+                    model << (double) (k + epoch);
+                File& state = writer.AddFile(Path(L"state." + std::to_wstring(epoch)), 0);
+                state << epoch;
+                if (epoch > 0)
+                    writer.AddFileToDelete(Path(L"state." + std::to_wstring(epoch - 1)));
+                writer.EndCheckpoint();
+            }
+            writer.WaitForPendingCheckpoints();
+        }
+
+        for (size_t epoch = 0; epoch < numCheckpoints; epoch++)
+        {
+            File model(Path(L"model." + std::to_wstring(epoch)), fileOptionsBinary | fileOptionsRead);
+            for (size_t k = 0; k < 100000 * (epoch + 1); k++)
+            {
+                double value;
+                model >> value;
+                BOOST_REQUIRE_EQUAL((double) (k + epoch), value);
+            }
+            BOOST_CHECK_EQUAL(model.Size(), model.GetPosition());
+
+            // only the state of the last checkpoint is kept, and no temporary file remains
+            BOOST_CHECK_EQUAL(epoch + 1 == numCheckpoints, File::Exists(Path(L"state." + std::to_wstring(epoch))));
+            BOOST_CHECK(!File::Exists(Path(L"model." + std::to_wstring(epoch) + L".tmp")));
+            BOOST_CHECK(!File::Exists(Path(L"state." + std::to_wstring(epoch) + L".tmp")));
+        }
+
+        File state(Path(L"state." + std::to_wstring(numCheckpoints - 1)), fileOptionsBinary | fileOptionsRead);
+        size_t lastEpoch;
+        state >> lastEpoch;
+        BOOST_CHECK_EQUAL(numCheckpoints - 1, lastEpoch);
+        boost::filesystem::remove_all(m_directory);
+        boost::filesystem::create_directories(m_directory);
+    }
+}
+
+BOOST_AUTO_TEST_CASE(CheckpointWithModel)
+{
+    auto net = make_shared<ComputationNetwork>(CPUDEVICE);
+    ComputationNetworkBuilder<float> builder(*net);
+    auto features = builder.CreateInputNode(L"features", 3);
+    auto weights = builder.CreateLearnableParameter(L"W", 4, 3);
+    auto output = builder.Times(weights, features, 1, L"output");
+    net->AddToNodeGroup(L"output", output);
+    net->CompileNetwork();
+    weights->Value().SetUniformRandomValue(-1, 1, 1);
+
+    // the model written through the writer is the same as the one saved by the network
+    net->Save(Path(L"reference"));
+    for (bool async : { false, true })
+    {
+        AsyncCheckpointWriter writer(async);
+        writer.BeginCheckpoint();
+        net->Save(writer.AddFile(Path(L"model"), 0));
+        writer.EndCheckpoint();
+        writer.WaitForPendingCheckpoints();
+        BOOST_CHECK(ReadFile(Path(L"reference")) == ReadFile(Path(L"model")));
+    }
+}
+
+BOOST_AUTO_TEST_CASE(CheckpointWriteErrors)
+{
+    for (bool async : { false, true })
+    {
+        // the file cannot be renamed over the directory of the same name
+        boost::filesystem::create_directories(m_directory / L"blocked");
+        AsyncCheckpointWriter writer(async);
+        writer.BeginCheckpoint();
+        writer.AddFile(Path(L"blocked"), 0) << (size_t) 1;
+        if (async)
+        {
+            writer.EndCheckpoint();
+            BOOST_CHECK_THROW(writer.WaitForPendingCheckpoints(), std::exception);
+        }
+        else
+        {
+            BOOST_CHECK_THROW(writer.EndCheckpoint(), std::exception);
+        }
+
+        // the error is reported once, later checkpoints are written
+        writer.BeginCheckpoint();
+        writer.AddFile(Path(L"model"), 0) << (size_t) 2;
+        writer.EndCheckpoint();
+        writer.WaitForPendingCheckpoints();
+        File model(Path(L"model"), fileOptionsBinary | fileOptionsRead);
+        size_t value;
+        model >> value;
+        BOOST_CHECK_EQUAL(2, value);
+    }
+
+    AsyncCheckpointWriter writer(true);
+    BOOST_CHECK_THROW(writer.AddFile(Path(L"model"), 0), std::exception);
+    BOOST_CHECK_THROW(writer.EndCheckpoint(), std::exception);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
+
+}}}}
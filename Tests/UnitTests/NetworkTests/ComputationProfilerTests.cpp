@@ -0,0 +1,134 @@
+//
+// Copyright (c) Microsoft. All rights reserved.
+// Licensed under the MIT license. See LICENSE.md file in the project root for full license information.
+//
+#include "stdafx.h"
+#include "InputAndParamNodes.h"
+#include "ComputationNetworkBuilder.h"
+#include "ComputationProfiler.h"
+#include <boost/property_tree/ptree.hpp>
+#include <boost/property_tree/json_parser.hpp>
+#include <cstdio>
+#include <map>
+
+using namespace Microsoft::MSR::CNTK;
+
+namespace Microsoft { namespace MSR { namespace CNTK { namespace Test {
+
+// crit = SquareError(label, Tanh(W x + b))
+static ComputationNetworkPtr CreateProfiledNetwork()
+{
+    auto net = make_shared<ComputationNetwork>(CPUDEVICE);
+    ComputationNetworkBuilder<float> builder(*net);
+    auto x = builder.CreateInputNode(L"x", 3);
+    auto label = builder.CreateInputNode(L"label", 2);
+    auto W = builder.CreateLearnableParameter(L"W", 2, 3);
+    auto b = builder.CreateLearnableParameter(L"b", 2, 1);
+    auto output = builder.Tanh(builder.Plus(builder.Times(W, x, 1, L"times"), b, L"plus"), L"tanh");
+    auto criterion = builder.SquareError(label, output, L"crit");
+    net->AddToNodeGroup(L"feature", x);
+    net->AddToNodeGroup(L"feature", label);
+    net->AddToNodeGroup(L"criterion", criterion);
+    net->CompileNetwork();
+    net->InitLearnableParameters<float>(W, true, 1, 1.0f);
+    net->InitLearnableParameters<float>(b, true, 2, 1.0f);
+    net->AllocateAllMatrices({}, {}, criterion);
+    return net;
+}
+
+static void RunMinibatches(const ComputationNetworkPtr& net, size_t numMinibatches)
+{
+    const size_t T = 5;
+    auto criterion = net->GetNodeFromName(L"crit");
+    ScopedNetworkOperationMode modeGuard(net, NetworkOperationMode::training);
+    net->StartEvaluateMinibatchLoop(criterion);
+    for (size_t minibatch = 0; minibatch < numMinibatches; minibatch++)
+    {
+        auto layout = net->GetMBLayoutPtrOfNetwork();
+        layout->Init(1, T);
+        layout->AddSequence(0, 0, 0, T);
+        unsigned long seed = (unsigned long) (minibatch + 1);
+        for (const auto& feature : net->FeatureNodes())
+        {
+            auto& value = feature->As<ComputationNode<float>>()->Value();
+            value.Resize(feature->GetSampleLayout().GetNumElements(), T);
+            value.SetUniformRandomValue(-1, 1, seed++);
+        }
+        ComputationNetwork::BumpEvalTimeStamp(net->FeatureNodes());
+        net->ForwardProp(criterion);
+        net->Backprop(criterion);
+    }
+}
+
+BOOST_AUTO_TEST_SUITE(ComputationProfilerSuite)
+
+BOOST_AUTO_TEST_CASE(ProfileCountsNodesAndWritesJsonTrace)
+{
+    const std::string traceFile = "profiler_trace.tmp.json";
+    const size_t numMinibatches = 3;
+    const std::vector<std::wstring> computedNodes = { L"times", L"plus", L"tanh", L"crit" };
+
+    auto net = CreateProfiledNetwork();
+    auto profiler = make_shared<ComputationProfiler>(msra::strfun::utf16(traceFile));
+    net->Environment().SetProfiler(profiler);
+    {
+        ComputationProfiler::PhaseScope phase(profiler.get(), L"minibatches");
+        RunMinibatches(net, numMinibatches);
+    }
+
+    // each computing node is recorded once per minibatch and pass, inputs and parameters are not recorded
+    for (const auto& nodeName : computedNodes)
+    {
+        BOOST_CHECK_EQUAL(numMinibatches, profiler->GetNumCalls(nodeName, false));
+        BOOST_CHECK_EQUAL(numMinibatches, profiler->GetNumCalls(nodeName, true));
+    }
+    for (const auto& nodeName : { L"x", L"label", L"W", L"b" })
+    {
+        BOOST_CHECK_EQUAL(0, profiler->GetNumCalls(nodeName, false));
+        BOOST_CHECK_EQUAL(0, profiler->GetNumCalls(nodeName, true));
+    }
+
+    profiler->Reset();
+    BOOST_CHECK_EQUAL(0, profiler->GetNumCalls(L"crit", false));
+    RunMinibatches(net, 1);
+    BOOST_CHECK_EQUAL(1, profiler->GetNumCalls(L"crit", false));
+
+    // detaching the profiler closes the trace
+    net->Environment().SetProfiler(nullptr);
+    profiler.reset();
+
+    // the trace is a JSON array of complete events, one per recorded call plus the phase
+    boost::property_tree::ptree trace;
+    BOOST_REQUIRE_NO_THROW(boost::property_tree::read_json(traceFile, trace));
+    std::map<std::string, size_t> numEvents;
+    for (const auto& event : trace)
+    {
+        BOOST_CHECK(event.first.empty());
+        const auto& properties = event.second;
+        BOOST_CHECK_EQUAL("X", properties.get<std::string>("ph"));
+        BOOST_CHECK_GE(properties.get<double>("dur"), 0);
+        const auto category = properties.get<std::string>("cat");
+        if (category != "phase")
+        {
+            BOOST_CHECK(category == "forward" || category == "backprop");
+            BOOST_CHECK(!properties.get<std::string>("args.op").empty());
+            BOOST_CHECK_GE(properties.get<double>("args.flops"), 0);
+            BOOST_CHECK_NO_THROW(properties.get<uint64_t>("args.bytesAllocated"));
+        }
+        numEvents[category + "/" + properties.get<std::string>("name")]++;
+    }
+
+    BOOST_CHECK_EQUAL(1, numEvents["phase/minibatches"]);
+    for (const auto& nodeName : computedNodes)
+    {
+        BOOST_CHECK_EQUAL(numMinibatches + 1, numEvents["forward/" + msra::strfun::utf8(nodeName)]);
+        BOOST_CHECK_EQUAL(numMinibatches + 1, numEvents["backprop/" + msra::strfun::utf8(nodeName)]);
+    }
+    BOOST_CHECK_EQUAL(1 + 2 * (numMinibatches + 1) * computedNodes.size(), trace.size());
+
+    remove(traceFile.c_str());
+}
+
+BOOST_AUTO_TEST_SUITE_END()
+
+}}}}
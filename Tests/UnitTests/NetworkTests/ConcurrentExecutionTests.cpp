@@ -0,0 +1,321 @@
+//
+// Copyright (c) Microsoft. All rights reserved.
+// Licensed under the MIT license. See LICENSE.md file in the project root for full license information.
+//
+#include "stdafx.h"
+#include "InputAndParamNodes.h"
+#include "NonlinearityNodes.h"
+#include "ComputationNetworkBuilder.h"
+#include "ComputationScheduler.h"
+#include <atomic>
+#include <map>
+
+using namespace Microsoft::MSR::CNTK;
+
+namespace Microsoft { namespace MSR { namespace CNTK { namespace Test {
+
+// Tanh that fails in ForwardProp() or BackpropTo() on request, to test the error handling of the concurrent execution
+class FailingTanhNode : public TanhNode<float>
+{
+public:
+    enum class Failure { none, forward, backward };
+    static Failure s_failure;
+
+    FailingTanhNode(DEVICEID_TYPE deviceId, const wstring& name)
+        : TanhNode<float>(deviceId, name)
+    {
+    }
+
+    virtual void ForwardProp(const FrameRange& fr) override
+    {
+        if (s_failure == Failure::forward)
+            RuntimeError("FailingTanhNode: ForwardProp failed.");
+        TanhNode<float>::ForwardProp(fr);
+    }
+
+    virtual void BackpropTo(const size_t inputIndex, const FrameRange& fr) override
+    {
+        if (s_failure == Failure::backward)
+            RuntimeError("FailingTanhNode: BackpropTo failed.");
+        TanhNode<float>::BackpropTo(inputIndex, fr);
+    }
+};
+
+/*static*/ FailingTanhNode::Failure FailingTanhNode::s_failure = FailingTanhNode::Failure::none;
+
+struct ConcurrentExecutionFixture
+{
+    ~ConcurrentExecutionFixture()
+    {
+        // the settings are global, the other tests run sequentially
+        ComputationNetwork::SetConcurrentNodeExecution(0);
+        g_shareNodeValueMatrices = false;
+        FailingTanhNode::s_failure = FailingTanhNode::Failure::none;
+    }
+};
+
+// towers of
+//   t = Sigmoid(W2 Tanh(W1 in + b1 + W0 x)),
+// with W0 shared by all towers (its gradient is accumulated from all of them), and
+//   crit = SquareError(label, CosDistance(t0, t1) + CosDistance(t0, t2) + ...)
+// The second tower clips its hidden layer with a Clip node, which is not thread-safe, and the third tower
+// uses a FailingTanhNode.
+static ComputationNetworkPtr CreateNetwork(size_t numTowers)
+{
+    const size_t dim = 16;
+    auto net = make_shared<ComputationNetwork>(CPUDEVICE);
+    ComputationNetworkBuilder<float> builder(*net);
+    auto x = builder.CreateInputNode(L"x", dim);
+    auto label = builder.CreateInputNode(L"label", 1);
+    auto W0 = builder.CreateLearnableParameter(L"W0", dim, dim);
+    std::vector<shared_ptr<ComputationNode<float>>> parameters = { W0 };
+    std::vector<shared_ptr<ComputationNode<float>>> towers;
+    for (size_t t = 0; t < numTowers; t++)
+    {
+        const std::wstring prefix = L"t" + std::to_wstring(t) + L".";
+        auto in = builder.CreateInputNode(prefix + L"in", dim);
+        net->AddToNodeGroup(L"feature", in);
+        auto W1 = builder.CreateLearnableParameter(prefix + L"W1", dim, dim);
+        auto b1 = builder.CreateLearnableParameter(prefix + L"b1", dim, 1);
+        auto W2 = builder.CreateLearnableParameter(prefix + L"W2", dim, dim);
+        parameters.insert(parameters.end(), { W1, b1, W2 });
+
+        auto sum = builder.Plus(builder.Plus(builder.Times(W1, in), b1), builder.Times(W0, x));
+        shared_ptr<ComputationNode<float>> hidden;
+        if (t == 2)
+        {
+            hidden = make_shared<FailingTanhNode>(CPUDEVICE, prefix + L"tanh");
+            hidden->AttachInputs({ sum });
+            net->AddNodeToNet(hidden);
+        }
+        else
+            hidden = builder.Tanh(sum);
+        if (t == 1)
+        {
+            auto lower = builder.CreateLearnableParameter(prefix + L"lower", 1, 1);
+            auto upper = builder.CreateLearnableParameter(prefix + L"upper", 1, 1);
+            lower->Value().SetValue(-0.5f);
+            upper->Value().SetValue(0.5f);
+            lower->SetLearningRateMultiplier(0);
+            upper->SetLearningRateMultiplier(0);
+            hidden = builder.Clip(lower, upper, hidden);
+        }
+        towers.push_back(builder.Sigmoid(builder.Times(W2, hidden)));
+    }
+    shared_ptr<ComputationNode<float>> similarity = builder.CosDistance(towers[0], towers[1]);
+    for (size_t t = 2; t < numTowers; t++)
+        similarity = builder.Plus(similarity, builder.CosDistance(towers[0], towers[t]));
+    auto criterion = builder.SquareError(label, similarity, L"crit");
+    net->AddToNodeGroup(L"feature", x);
+    net->AddToNodeGroup(L"feature", label);
+    net->AddToNodeGroup(L"criterion", criterion);
+    net->CompileNetwork();
+
+    int seed = 1;
+    for (const auto& parameter : parameters)
+        net->InitLearnableParameters<float>(parameter, true, seed++, 1.0f);
+    return net;
+}
+
+static std::vector<float> ToVector(const Matrix<float>& matrix)
+{
+    std::unique_ptr<float[]> values(matrix.CopyToArray());
+    return std::vector<float>(values.get(), values.get() + matrix.GetNumElements());
+}
+
+static void AllocateMatrices(const ComputationNetworkPtr& net)
+{
+    net->AllocateAllMatrices({}, {}, net->GetNodeFromName(L"crit"));
+}
+
+// the criterion and the gradients of the parameters after each of 'numMinibatches' forward and backward passes
+static std::vector<std::vector<float>> Train(const ComputationNetworkPtr& net, size_t numMinibatches)
+{
+    const size_t T = 6;
+    auto criterion = net->GetNodeFromName(L"crit");
+    AllocateMatrices(net);
+    ScopedNetworkOperationMode modeGuard(net, NetworkOperationMode::training);
+    net->StartEvaluateMinibatchLoop(criterion);
+    std::vector<std::vector<float>> results;
+    for (size_t minibatch = 0; minibatch < numMinibatches; minibatch++)
+    {
+        // two sequences, the second one ends before the first one
+        auto layout = net->GetMBLayoutPtrOfNetwork();
+        layout->Init(2, T);
+        layout->AddSequence(0, 0, 0, T);
+        layout->AddSequence(1, 1, 0, T - 2);
+        layout->AddGap(1, T - 2, T);
+        unsigned long seed = 10 + minibatch;
+        for (const auto& feature : net->FeatureNodes())
+        {
+            auto& value = feature->As<ComputationNode<float>>()->Value();
+            value.Resize(feature->GetSampleLayout().GetNumElements(), 2 * T);
+            value.SetUniformRandomValue(-1, 1, seed++);
+        }
+        ComputationNetwork::BumpEvalTimeStamp(net->FeatureNodes());
+        net->ForwardProp(criterion);
+        net->Backprop(criterion);
+
+        results.push_back(ToVector(criterion->As<ComputationNode<float>>()->Value()));
+        for (const auto& parameter : net->LearnableParameterNodes(criterion))
+            results.push_back(ToVector(parameter->As<ComputationNode<float>>()->Gradient()));
+    }
+    return results;
+}
+
+// which nodes share their value matrix: for each node in evaluation order, the index of the first node with the same matrix
+static std::vector<size_t> ValueSharing(const ComputationNetworkPtr& net)
+{
+    std::vector<size_t> sharing;
+    std::map<const MatrixBase*, size_t> firstNode;
+    for (const auto& node : net->GetEvalOrder(net->GetNodeFromName(L"crit")))
+    {
+        const MatrixBase* value = node->ValuePtr().get();
+        sharing.push_back(firstNode.insert(std::make_pair(value, sharing.size())).first->second);
+    }
+    return sharing;
+}
+
+static shared_ptr<FlowControlNode> OuterLoopNode(const ComputationNetworkPtr& net)
+{
+    return dynamic_pointer_cast<FlowControlNode>(net->GetNestedNetwork(net->GetNodeFromName(L"crit")));
+}
+
+BOOST_FIXTURE_TEST_SUITE(ConcurrentExecutionSuite, ConcurrentExecutionFixture)
+
+BOOST_AUTO_TEST_CASE(ConcurrentMatchesSequential)
+{
+    const size_t numMinibatches = 10;
+    for (bool shareNodeValueMatrices : { false, true })
+    {
+        g_shareNodeValueMatrices = shareNodeValueMatrices;
+        ComputationNetwork::SetConcurrentNodeExecution(0);
+        auto expected = Train(CreateNetwork(4), numMinibatches);
+
+        for (size_t numThreads : { 2, 4 })
+        {
+            ComputationNetwork::SetConcurrentNodeExecution(numThreads);
+            auto net = CreateNetwork(4);
+            AllocateMatrices(net);
+            ComputationScheduler scheduler(OuterLoopNode(net)->m_nestedNodes);
+            BOOST_CHECK(scheduler.IsConcurrentForwardProp());
+            BOOST_CHECK(scheduler.IsConcurrentBackprop());
+
+            // the order of all operations on each matrix is the same, so the results are identical
+            auto actual = Train(net, numMinibatches);
+            BOOST_REQUIRE_EQUAL(expected.size(), actual.size());
+            for (size_t i = 0; i < expected.size(); i++)
+                BOOST_CHECK(expected[i] == actual[i]);
+        }
+    }
+}
+
+BOOST_AUTO_TEST_CASE(SingleThreadIsSequential)
+{
+    g_shareNodeValueMatrices = true;
+    ComputationNetwork::SetConcurrentNodeExecution(0);
+    auto sequentialNet = CreateNetwork(4);
+    AllocateMatrices(sequentialNet);
+    auto expected = Train(sequentialNet, 3);
+
+    // one thread allocates the matrices and executes the nodes as before
+    ComputationNetwork::SetConcurrentNodeExecution(1);
+    auto net = CreateNetwork(4);
+    AllocateMatrices(net);
+    BOOST_CHECK(ValueSharing(sequentialNet) == ValueSharing(net));
+    BOOST_CHECK(expected == Train(net, 3));
+}
+
+BOOST_AUTO_TEST_CASE(SchedulerExecutesInDependencyOrder)
+{
+    auto net = CreateNetwork(4);
+    AllocateMatrices(net);
+    const auto& units = OuterLoopNode(net)->m_nestedNodes;
+    ComputationScheduler scheduler(units);
+    auto threadPool = WorkStealingThreadPool::GetInstance(4);
+
+    for (bool forward : { true, false })
+    {
+        // each unit is executed once, after the units that compute its inputs (forward) or consume it (backward)
+        std::unique_ptr<std::atomic<size_t>[]> startTimes(new std::atomic<size_t>[units.size()]);
+        std::unique_ptr<std::atomic<size_t>[]> endTimes(new std::atomic<size_t>[units.size()]);
+        std::atomic<size_t> clock(1);
+        for (size_t i = 0; i < units.size(); i++)
+            startTimes[i] = endTimes[i] = 0;
+        auto execute = [&](size_t i)
+        {
+            BOOST_REQUIRE_EQUAL(0, startTimes[i].exchange(clock++));
+            endTimes[i] = clock++;
+        };
+        if (forward)
+            scheduler.ForwardProp(*threadPool, execute);
+        else
+            scheduler.Backprop(*threadPool, execute);
+
+        for (size_t i = 0; i < units.size(); i++)
+        {
+            BOOST_REQUIRE_NE(0, endTimes[i]);
+            for (size_t j = 0; j < units.size(); j++)
+            {
+                const auto& inputs = units[i]->GetInputs();
+                if (find(inputs.begin(), inputs.end(), units[j]) == inputs.end())
+                    continue;
+                if (forward)
+                    BOOST_CHECK_LT(endTimes[j], startTimes[i]);
+                else
+                    BOOST_CHECK_LT(endTimes[i], startTimes[j]);
+            }
+        }
+    }
+}
+
+BOOST_AUTO_TEST_CASE(SchedulerReportsExceptions)
+{
+    auto net = CreateNetwork(4);
+    AllocateMatrices(net);
+    const auto& units = OuterLoopNode(net)->m_nestedNodes;
+    ComputationScheduler scheduler(units);
+    auto threadPool = WorkStealingThreadPool::GetInstance(4);
+
+    // the exception thrown on a worker thread is rethrown to the caller, and the units after it are not executed
+    const size_t failingUnit = units.size() / 2;
+    std::atomic<size_t> numExecuted(0);
+    auto execute = [&](size_t i)
+    {
+        if (i == failingUnit)
+            InvalidArgument("unit %d failed", (int) i);
+        numExecuted++;
+    };
+    BOOST_CHECK_EXCEPTION(scheduler.ForwardProp(*threadPool, execute), std::invalid_argument,
+                          [&](const std::invalid_argument& e) { return std::string(e.what()) == "unit " + std::to_string(failingUnit) + " failed"; });
+    BOOST_CHECK_LT(numExecuted, units.size() - 1);
+
+    // the scheduler and the pool can still be used
+    numExecuted = 0;
+    scheduler.ForwardProp(*threadPool, [&](size_t) { numExecuted++; });
+    BOOST_CHECK_EQUAL(units.size(), numExecuted);
+}
+
+BOOST_AUTO_TEST_CASE(NodeExceptionsReachCaller)
+{
+    ComputationNetwork::SetConcurrentNodeExecution(4);
+    auto net = CreateNetwork(4);
+    AllocateMatrices(net);
+    BOOST_REQUIRE(ComputationScheduler(OuterLoopNode(net)->m_nestedNodes).IsConcurrentForwardProp());
+
+    FailingTanhNode::s_failure = FailingTanhNode::Failure::forward;
+    BOOST_CHECK_THROW(Train(net, 1), std::runtime_error);
+    FailingTanhNode::s_failure = FailingTanhNode::Failure::backward;
+    BOOST_CHECK_THROW(Train(net, 1), std::runtime_error);
+
+    // the network can still be evaluated
+    FailingTanhNode::s_failure = FailingTanhNode::Failure::none;
+    ComputationNetwork::SetConcurrentNodeExecution(0);
+    auto expected = Train(CreateNetwork(4), 2);
+    ComputationNetwork::SetConcurrentNodeExecution(4);
+    BOOST_CHECK(expected == Train(net, 2));
+}
+
+BOOST_AUTO_TEST_SUITE_END()
+
+}}}}
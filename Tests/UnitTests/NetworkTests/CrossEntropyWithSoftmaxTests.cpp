@@ -0,0 +1,190 @@
+//
+// Copyright (c) Microsoft. All rights reserved.
+// Licensed under the MIT license. See LICENSE.md file in the project root for full license information.
+//
+#include "stdafx.h"
+#include "InputAndParamNodes.h"
+#include "TrainingNodes.h"
+#include "ComputationNetworkBuilder.h"
+
+using namespace Microsoft::MSR::CNTK;
+
+namespace Microsoft { namespace MSR { namespace CNTK { namespace Test {
+
+// CrossEntropyWithSoftmax that can be forced onto the unfused path, which is otherwise only taken on the GPU
+class TestCrossEntropyWithSoftmaxNode : public CrossEntropyWithSoftmaxNode<float>
+{
+    typedef CrossEntropyWithSoftmaxNode<float> Base;
+
+public:
+    TestCrossEntropyWithSoftmaxNode(DEVICEID_TYPE deviceId, const wstring& name, bool allowFusedKernel)
+        : Base(deviceId, name), m_allowFusedKernel(allowFusedKernel)
+    {
+    }
+
+    bool UsesFusedKernel() const { return UseFusedKernel(); }
+    size_t GetNumSoftmaxElements() const { return m_softmaxOfRight->GetNumElements(); }
+
+protected:
+    virtual bool UseFusedKernel() const override { return m_allowFusedKernel && Base::UseFusedKernel(); }
+
+private:
+    bool m_allowFusedKernel;
+};
+
+static const size_t s_numClasses = 7;
+static const size_t s_numParallelSequences = 3;
+static const size_t s_numTimeSteps = 6;
+
+// ce = CrossEntropyWithSoftmax(labels, z)
+static ComputationNetworkPtr CreateNetwork(bool allowFusedKernel, bool sparseLabels)
+{
+    auto net = make_shared<ComputationNetwork>(CPUDEVICE);
+    ComputationNetworkBuilder<float> builder(*net);
+    auto labels = sparseLabels ? builder.CreateSparseInputNode(L"labels", s_numClasses) : builder.CreateInputNode(L"labels", s_numClasses);
+    auto z = builder.CreateInputNode(L"z", s_numClasses);
+    // the inputs stand in for computed labels and prediction, so that both gradients are computed
+    labels->SetLearningRateMultiplier(1);
+    z->SetLearningRateMultiplier(1);
+    auto ce = net->AddNodeToNetWithElemType(New<TestCrossEntropyWithSoftmaxNode>(CPUDEVICE, L"ce", allowFusedKernel));
+    ce->AttachInputs({ labels, z });
+    net->AddToNodeGroup(L"feature", z);
+    net->AddToNodeGroup(L"label", labels);
+    net->AddToNodeGroup(L"criterion", ce);
+    net->CompileNetwork();
+    return net;
+}
+
+struct Result
+{
+    bool m_usedFusedKernel;
+    size_t m_numSoftmaxElements; // after the forward pass
+    float m_criterion;
+    std::vector<float> m_labelGradient;
+    std::vector<float> m_predictionGradient;
+};
+
+static std::vector<float> ToVector(const Matrix<float>& matrix)
+{
+    std::unique_ptr<float[]> values(matrix.CopyToArray());
+    return std::vector<float>(values.get(), values.get() + matrix.GetNumElements());
+}
+
+// The sequences end at different time steps and one starts late. The gaps hold labels and predictions as well,
+// such that they would contribute to the criterion and to the gradients if they were not masked.
+static MBLayoutPtr InitLayout(const ComputationNetworkPtr& net)
+{
+    auto layout = net->GetMBLayoutPtrOfNetwork();
+    layout->Init(s_numParallelSequences, s_numTimeSteps);
+    layout->AddSequence(0, 0, 0, s_numTimeSteps);
+    layout->AddSequence(1, 1, 0, s_numTimeSteps - 2);
+    layout->AddGap(1, s_numTimeSteps - 2, s_numTimeSteps);
+    layout->AddGap(2, 0, 2);
+    layout->AddSequence(2, 2, 2, s_numTimeSteps - 1);
+    layout->AddGap(2, s_numTimeSteps - 1, s_numTimeSteps);
+    return layout;
+}
+
+// one forward and backward pass, with soft or one-hot labels
+static Result ForwardBackward(const ComputationNetworkPtr& net, bool oneHotLabels)
+{
+    const size_t numColumns = s_numParallelSequences * s_numTimeSteps;
+    InitLayout(net);
+    Matrix<float> labelValues(s_numClasses, numColumns, CPUDEVICE);
+    if (oneHotLabels)
+    {
+        labelValues.SetValue(0);
+        for (size_t j = 0; j < numColumns; j++)
+            labelValues.SetValue((j * 5) % s_numClasses, j, 1);
+    }
+    else
+        labelValues.SetUniformRandomValue(0, 1, 1);
+    auto labels = dynamic_pointer_cast<ComputationNode<float>>(net->GetNodeFromName(L"labels"));
+    auto z = dynamic_pointer_cast<ComputationNode<float>>(net->GetNodeFromName(L"z"));
+    labels->Value().AssignValuesOf(labelValues);
+    z->Value().Resize(s_numClasses, numColumns);
+    z->Value().SetUniformRandomValue(-3, 3, 2);
+
+    auto criterion = net->GetNodeFromName(L"ce");
+    ScopedNetworkOperationMode modeGuard(net, NetworkOperationMode::training);
+    net->AllocateAllMatrices({}, {}, criterion);
+    net->StartEvaluateMinibatchLoop(criterion);
+    ComputationNetwork::BumpEvalTimeStamp(net->FeatureNodes());
+    ComputationNetwork::BumpEvalTimeStamp(net->LabelNodes());
+    net->ForwardProp(criterion);
+
+    auto node = dynamic_pointer_cast<TestCrossEntropyWithSoftmaxNode>(criterion);
+    Result result;
+    result.m_usedFusedKernel = node->UsesFusedKernel();
+    result.m_numSoftmaxElements = node->GetNumSoftmaxElements();
+    result.m_criterion = node->Value().Get00Element();
+    net->Backprop(criterion);
+    result.m_labelGradient = ToVector(labels->Gradient());
+    result.m_predictionGradient = ToVector(z->Gradient());
+    return result;
+}
+
+// Sparse labels are one-hot. On the CPU, the unfused path supports dense labels only, it gets the same values densely.
+static void CheckFusedMatchesUnfused(bool sparseLabels)
+{
+    auto fusedNet = CreateNetwork(true, sparseLabels);
+    auto fused = ForwardBackward(fusedNet, sparseLabels);
+    auto unfused = ForwardBackward(CreateNetwork(false, false), sparseLabels);
+    auto fusedLabels = dynamic_pointer_cast<ComputationNode<float>>(fusedNet->GetNodeFromName(L"labels"));
+    BOOST_REQUIRE(fusedLabels->Value().GetMatrixType() == (sparseLabels ? MatrixType::SPARSE : MatrixType::DENSE));
+
+    // the fused kernel does not materialize the softmax
+    BOOST_CHECK(fused.m_usedFusedKernel);
+    BOOST_CHECK(!unfused.m_usedFusedKernel);
+    BOOST_CHECK_EQUAL(0, fused.m_numSoftmaxElements);
+    BOOST_CHECK_EQUAL(s_numClasses * s_numParallelSequences * s_numTimeSteps, unfused.m_numSoftmaxElements);
+
+    BOOST_CHECK_GT(unfused.m_criterion, 0);
+    BOOST_CHECK_CLOSE(unfused.m_criterion, fused.m_criterion, 1e-4);
+
+    // the gradients are compared in the valid columns, the unfused path zeroes the labels in the gaps
+    auto layout = fusedNet->GetMBLayoutPtrOfNetwork();
+    BOOST_REQUIRE_EQUAL(s_numClasses * layout->GetNumCols(), fused.m_labelGradient.size());
+    BOOST_REQUIRE_EQUAL(fused.m_labelGradient.size(), unfused.m_labelGradient.size());
+    BOOST_REQUIRE_EQUAL(fused.m_labelGradient.size(), fused.m_predictionGradient.size());
+    BOOST_REQUIRE_EQUAL(fused.m_predictionGradient.size(), unfused.m_predictionGradient.size());
+    size_t numGaps = 0;
+    for (size_t t = 0; t < s_numTimeSteps; t++)
+    {
+        for (size_t s = 0; s < s_numParallelSequences; s++)
+        {
+            const size_t j = t * s_numParallelSequences + s;
+            const bool isGap = layout->IsGap(FrameRange(layout, t).Sequence(s));
+            numGaps += isGap;
+            for (size_t i = j * s_numClasses; i < (j + 1) * s_numClasses; i++)
+            {
+                if (isGap)
+                {
+                    BOOST_CHECK_EQUAL(0, fused.m_labelGradient[i]);
+                    BOOST_CHECK_EQUAL(0, unfused.m_labelGradient[i]);
+                    continue;
+                }
+                BOOST_CHECK_GT(fused.m_labelGradient[i], 0); // -log softmax
+                BOOST_CHECK_SMALL(unfused.m_labelGradient[i] - fused.m_labelGradient[i], 1e-5f);
+                BOOST_CHECK_SMALL(unfused.m_predictionGradient[i] - fused.m_predictionGradient[i], 1e-6f);
+            }
+        }
+    }
+    BOOST_CHECK_EQUAL(5, numGaps);
+}
+
+BOOST_AUTO_TEST_SUITE(CrossEntropyWithSoftmaxSuite)
+
+BOOST_AUTO_TEST_CASE(FusedMatchesUnfusedWithDenseLabels)
+{
+    CheckFusedMatchesUnfused(false);
+}
+
+BOOST_AUTO_TEST_CASE(FusedMatchesUnfusedWithSparseLabels)
+{
+    CheckFusedMatchesUnfused(true);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
+
+}}}}
@@ -0,0 +1,585 @@
+//
+// Copyright (c) Microsoft. All rights reserved.
+// Licensed under the MIT license. See LICENSE.md file in the project root for full license information.
+//
+// Tests of the distributed aggregation. With a single process they cover only the degenerate cases,
+// run them under MPI to compare with MPI_Allreduce over several ranks, e.g.
+//     mpiexec -n 4 NetworkTests.exe --run_test=DistributedSuite
+//
+#include "stdafx.h"
+#include "MPIWrapper.h"
+#include "Matrix.h"
+#include "SimpleDistGradAggregator.h"
+#include "QuantizedDistGradAggregator.h"
+#include "SGD.h" // includes MASGD.h
+#include "InputAndParamNodes.h"
+#include "ComputationNetworkBuilder.h"
+#include <random>
+
+using namespace Microsoft::MSR::CNTK;
+
+namespace Microsoft { namespace MSR { namespace CNTK { namespace Test {
+
+// MPI can be initialized only once per process, the instance is shared by all tests.
+static MPIWrapperPtr GetMPI()
+{
+    static MPIWrapperPtr mpi = MPIWrapper::GetInstance(true);
+    return mpi;
+}
+
+// Data that differs between the ranks. Small integers are summed exactly in any order.
+template <class ElemType>
+static std::vector<ElemType> CreateRankData(size_t size, size_t rank, bool integers)
+{
+    std::mt19937 rng((unsigned int) (rank * 1000 + size));
+    std::uniform_int_distribution<int> integerDistribution(-100, 100);
+    std::uniform_real_distribution<ElemType> realDistribution(-1, 1);
+    std::vector<ElemType> data(size);
+    for (auto& value : data)
+        value = integers ? (ElemType) integerDistribution(rng) : realDistribution(rng);
+    return data;
+}
+
+// Checks that all ranks hold bit-identical data.
+template <class ElemType>
+static void CheckSameOnAllRanks(const std::vector<ElemType>& data)
+{
+    std::vector<ElemType> minimum(data.size()), maximum(data.size());
+    ElemType* pData = const_cast<ElemType*>(data.data());
+    MPI_Allreduce(pData, minimum.data(), (int) data.size(), MPIWrapper::GetDataType(pData), MPI_MIN, MPI_COMM_WORLD) || MpiFail("MPI_Allreduce");
+    MPI_Allreduce(pData, maximum.data(), (int) data.size(), MPIWrapper::GetDataType(pData), MPI_MAX, MPI_COMM_WORLD) || MpiFail("MPI_Allreduce");
+    BOOST_CHECK(minimum == data);
+    BOOST_CHECK(maximum == data);
+}
+
+template <class ElemType>
+static void CheckClose(const std::vector<ElemType>& expected, const std::vector<ElemType>& actual, bool exact)
+{
+    BOOST_REQUIRE_EQUAL(expected.size(), actual.size());
+    for (size_t i = 0; i < expected.size(); i++)
+    {
+        if (exact)
+            BOOST_REQUIRE_EQUAL(expected[i], actual[i]);
+        else
+            BOOST_REQUIRE_SMALL(expected[i] - actual[i], (ElemType) 1e-4);
+    }
+}
+
+// Sizes smaller than, equal to and not divisible by the number of ranks.
+static const size_t s_bufferSizes[] = { 0, 1, 2, 3, 5, 7, 100, 1001, 1 << 18 };
+
+BOOST_AUTO_TEST_SUITE(DistributedSuite)
+
+template <class ElemType>
+static void TestRingAllReduce(bool integers)
+{
+    auto mpi = GetMPI();
+    for (size_t size : s_bufferSizes)
+    {
+        auto ring = CreateRankData<ElemType>(size, mpi->CurrentNodeRank(), integers);
+        auto reference = ring;
+        mpi->RingAllReduce(ring.data(), ring.size());
+        mpi->AllReduce(reference.data(), reference.size());
+
+        CheckClose(reference, ring, integers);
+        CheckSameOnAllRanks(ring);
+    }
+}
+
+BOOST_AUTO_TEST_CASE(RingAllReduceMatchesAllReduce)
+{
+    TestRingAllReduce<float>(true);
+    TestRingAllReduce<double>(true);
+    TestRingAllReduce<float>(false);
+    TestRingAllReduce<double>(false);
+}
+
+// Gradients of different sizes, including an empty one and ones that do not fit a bucket.
+static const size_t s_gradientSizes[] = { 7, 30, 100, 1, 3, 0, 50 };
+
+template <class ElemType>
+class TestGradients
+{
+public:
+    TestGradients()
+    {
+        for (size_t size : s_gradientSizes)
+        {
+            m_matrices.emplace_back(new Matrix<ElemType>(size, 1, CPUDEVICE));
+            m_gradients.push_back(m_matrices.back().get());
+        }
+    }
+
+    const std::vector<Matrix<ElemType>*>& Gradients() const { return m_gradients; }
+
+    void Fill(size_t rank, size_t minibatch, bool integers)
+    {
+        for (size_t i = 0; i < m_gradients.size(); i++)
+        {
+            auto data = CreateRankData<ElemType>(m_gradients[i]->GetNumElements(), rank * 100 + minibatch * 10 + i, integers);
+            if (!data.empty())
+                m_gradients[i]->SetValue(m_gradients[i]->GetNumRows(), 1, CPUDEVICE, data.data());
+        }
+    }
+
+    std::vector<ElemType> Values(size_t index) const
+    {
+        const auto& gradient = *m_gradients[index];
+        return std::vector<ElemType>(gradient.Data(), gradient.Data() + gradient.GetNumElements());
+    }
+
+private:
+    std::vector<std::unique_ptr<Matrix<ElemType>>> m_matrices;
+    std::vector<Matrix<ElemType>*> m_gradients;
+};
+
+// Aggregates a few minibatches, rank 1 processes no samples in one of them, and compares the result with MPI_Allreduce
+// of the same gradients. With reportGradients the gradients are passed to GradientReady() in backprop order first.
+template <class ElemType>
+static void CheckAggregation(IDistGradAggregator<ElemType>& aggregator, bool reportGradients, bool integers)
+{
+    auto mpi = GetMPI();
+    const size_t rank = mpi->CurrentNodeRank();
+    TestGradients<ElemType> gradients;
+    std::unique_ptr<DistGradHeader, void (*)(DistGradHeader*)> header(DistGradHeader::Create(2), &DistGradHeader::Destroy);
+    for (size_t minibatch = 0; minibatch < 5; minibatch++)
+    {
+        const bool isEmpty = (rank == 1) && (minibatch == 3);
+        header->numSamples = isEmpty ? 0 : 10 + rank;
+        header->numSamplesWithLabel = header->numSamples;
+        header->criterion = isEmpty ? 0 : 1.5 * (rank + 1);
+        header->evalErrors[0] = { 1.0, isEmpty ? 0 : 2 };
+        header->evalErrors[1] = { 3.0, isEmpty ? 0 : 4 };
+        gradients.Fill(rank, minibatch, integers);
+
+        // the reference: a rank without samples contributes zeros
+        std::vector<std::vector<ElemType>> expected;
+        for (size_t i = 0; i < gradients.Gradients().size(); i++)
+        {
+            expected.push_back(isEmpty ? std::vector<ElemType>(gradients.Gradients()[i]->GetNumElements(), 0) : gradients.Values(i));
+            mpi->AllReduce(expected.back().data(), expected.back().size());
+        }
+        size_t expectedSamples = header->numSamples, expectedErrors = header->evalErrors[1].second;
+        mpi->AllReduce(&expectedSamples, 1);
+        mpi->AllReduce(&expectedErrors, 1);
+
+        if (reportGradients && !isEmpty)
+        {
+            for (size_t i = gradients.Gradients().size(); i-- > 0;)
+                aggregator.GradientReady(gradients.Gradients(), i);
+        }
+
+        BOOST_CHECK(aggregator.AggregateGradients(gradients.Gradients(), header.get(), 0));
+        BOOST_CHECK_EQUAL(expectedSamples, header->numSamples);
+        BOOST_CHECK_EQUAL(expectedSamples, header->numSamplesWithLabel);
+        BOOST_CHECK_EQUAL(expectedErrors, header->evalErrors[1].second);
+        for (size_t i = 0; i < gradients.Gradients().size(); i++)
+        {
+            auto actual = gradients.Values(i);
+            CheckClose(expected[i], actual, integers);
+            CheckSameOnAllRanks(actual);
+        }
+    }
+}
+
+BOOST_AUTO_TEST_CASE(SimpleAggregationMatchesAllReduce)
+{
+    auto mpi = GetMPI();
+    for (size_t bucketSize : { (size_t) 0, 40 * sizeof(float) })
+    {
+        for (bool ring : { false, true })
+        {
+            for (bool overlap : { false, true })
+            {
+                SimpleDistGradAggregator<float> aggregator(mpi, false, 0, bucketSize, ring, overlap);
+                CheckAggregation(aggregator, overlap, true);
+            }
+        }
+    }
+
+    SimpleDistGradAggregator<double> aggregator(mpi, false, 0, 40 * sizeof(double), false, true);
+    CheckAggregation(aggregator, true, false);
+}
+
+BOOST_AUTO_TEST_CASE(OverlappedAggregationWithoutGradientReady)
+{
+    // gradients that are not reported during backprop are aggregated by AggregateGradients()
+    SimpleDistGradAggregator<float> aggregator(GetMPI(), false, 0, 40 * sizeof(float), false, true);
+    CheckAggregation(aggregator, false, true);
+}
+
+// With error feedback the quantization error of a minibatch is carried into the next one, so for constant gradients
+// the average of the aggregated gradients over many minibatches approaches the exact sum.
+// The tolerance is per node, as the range of the summed values grows with the number of nodes.
+template <class ElemType>
+static void TestQuantizedAggregation(size_t numBits, ElemType tolerancePerNode)
+{
+    auto mpi = GetMPI();
+    const size_t rank = mpi->CurrentNodeRank();
+    QuantizedDistGradAggregator<ElemType> aggregator(mpi, numBits, true, false, 0);
+
+    // the columns are split into stripes, also fewer columns than nodes
+    const size_t dimensions[][2] = { { 50, 7 }, { 13, 1 }, { 200, 30 }, { 0, 0 }, { 5, 2 } };
+    std::vector<std::unique_ptr<Matrix<ElemType>>> matrices;
+    std::vector<Matrix<ElemType>*> gradients;
+    std::vector<std::vector<ElemType>> input, expected, average;
+    for (const auto& dimension : dimensions)
+    {
+        matrices.emplace_back(new Matrix<ElemType>(dimension[0], dimension[1], CPUDEVICE));
+        gradients.push_back(matrices.back().get());
+        input.push_back(CreateRankData<ElemType>(dimension[0] * dimension[1], rank * 10 + input.size(), false));
+        expected.push_back(input.back());
+        mpi->AllReduce(expected.back().data(), expected.back().size());
+        average.push_back(std::vector<ElemType>(expected.back().size(), 0));
+    }
+
+    std::unique_ptr<DistGradHeader, void (*)(DistGradHeader*)> header(DistGradHeader::Create(1), &DistGradHeader::Destroy);
+    const size_t numMinibatches = 200;
+    for (size_t minibatch = 0; minibatch < numMinibatches; minibatch++)
+    {
+        header->numSamples = 10 + rank;
+        header->numSamplesWithLabel = header->numSamples;
+        header->criterion = 1.5;
+        header->evalErrors[0] = { 1.0, 2 };
+        for (size_t i = 0; i < gradients.size(); i++)
+        {
+            if (!input[i].empty())
+                gradients[i]->SetValue(gradients[i]->GetNumRows(), gradients[i]->GetNumCols(), CPUDEVICE, input[i].data());
+        }
+
+        BOOST_CHECK(aggregator.AggregateGradients(gradients, header.get(), 0));
+        BOOST_CHECK_EQUAL(mpi->NumNodesInUse() * (19 + mpi->NumNodesInUse()) / 2, header->numSamples);
+        BOOST_CHECK_EQUAL(2 * mpi->NumNodesInUse(), header->evalErrors[0].second);
+        for (size_t i = 0; i < gradients.size(); i++)
+        {
+            std::vector<ElemType> actual(gradients[i]->Data(), gradients[i]->Data() + gradients[i]->GetNumElements());
+            CheckSameOnAllRanks(actual);
+            for (size_t k = 0; k < actual.size(); k++)
+                average[i][k] += actual[k] / numMinibatches;
+        }
+    }
+
+    const ElemType tolerance = tolerancePerNode * mpi->NumNodesInUse();
+    for (size_t i = 0; i < gradients.size(); i++)
+    {
+        for (size_t k = 0; k < average[i].size(); k++)
+            BOOST_REQUIRE_SMALL(average[i][k] - expected[i][k], tolerance);
+    }
+}
+
+BOOST_AUTO_TEST_CASE(QuantizedAggregationConvergesToAllReduce)
+{
+    TestQuantizedAggregation<float>(1, 0.2f);
+    TestQuantizedAggregation<float>(2, 0.02f);
+    TestQuantizedAggregation<float>(8, 2e-4f);
+    TestQuantizedAggregation<double>(1, 0.2);
+    TestQuantizedAggregation<double>(16, 1e-6);
+}
+
+BOOST_AUTO_TEST_CASE(QuantizedAggregationInvalidArguments)
+{
+    auto mpi = GetMPI();
+    BOOST_CHECK_THROW(QuantizedDistGradAggregator<float>(mpi, 32, true, false, 0), std::exception);
+    BOOST_CHECK_THROW(QuantizedDistGradAggregator<float>(mpi, 3, true, false, 0), std::exception);
+    BOOST_CHECK_THROW(QuantizedDistGradAggregator<float>(mpi, 1, true, true, 0), std::exception);
+}
+
+// Runs an epoch of model averaging with two sync points on parameters initialized to 'initial'; 'delta' is added
+// after the first sync point to simulate training. Returns the final parameters.
+static std::vector<float> RunModelAveraging(bool useAsyncAggregation, bool useHierarchicalAggregation, const std::vector<float>& initial, const std::vector<float>& delta,
+                                            size_t samplesPerBlock)
+{
+    auto mpi = GetMPI();
+    auto parameter = make_shared<LearnableParameter<float>>(CPUDEVICE, L"W", TensorShape(3, 4));
+    parameter->Value().SetValue(3, 4, CPUDEVICE, const_cast<float*>(initial.data()));
+    std::list<ComputationNodeBasePtr> learnableNodes = { parameter };
+    std::list<Matrix<float>> smoothedGradients;
+    auto values = [&]()
+    {
+        return std::vector<float>(parameter->Value().Data(), parameter->Value().Data() + parameter->Value().GetNumElements());
+    };
+
+    BasicModelAveragingSGD<float> modelAveraging(mpi, 0, CPUDEVICE);
+    modelAveraging.SetAsyncAggregation(useAsyncAggregation);
+    modelAveraging.SetHierarchicalAggregation(useHierarchicalAggregation);
+    modelAveraging.OnEpochStart(learnableNodes);
+    BOOST_CHECK(modelAveraging.OnArrivingAtSyncPoint(learnableNodes, smoothedGradients, samplesPerBlock));
+
+    // the asynchronous aggregation is applied at the next sync point, the parameters are not touched before
+    if (useAsyncAggregation)
+        CheckClose(initial, values(), true);
+
+    Matrix<float> update(3, 4, const_cast<float*>(delta.data()), CPUDEVICE);
+    parameter->Value() += update;
+    BOOST_CHECK(modelAveraging.OnArrivingAtSyncPoint(learnableNodes, smoothedGradients, samplesPerBlock));
+    modelAveraging.OnEpochEnd(learnableNodes, smoothedGradients, samplesPerBlock);
+    return values();
+}
+
+BOOST_AUTO_TEST_CASE(AsyncModelAveragingMatchesSynchronous)
+{
+    auto mpi = GetMPI();
+    const size_t rank = mpi->CurrentNodeRank();
+    auto initial = CreateRankData<float>(12, rank, true);
+    auto delta = CreateRankData<float>(12, rank + 100, true);
+
+    // the models are weighted by the number of samples of each worker
+    const size_t samplesPerBlock = 10 + rank;
+    size_t totalSamples = samplesPerBlock;
+    mpi->AllReduce(&totalSamples, 1);
+    std::vector<double> expected(initial.size());
+    for (size_t k = 0; k < expected.size(); k++)
+        expected[k] = (double) samplesPerBlock / totalSamples * (initial[k] + delta[k]);
+    mpi->AllReduce(expected.data(), expected.size());
+
+    for (bool useAsyncAggregation : { false, true })
+    {
+        auto actual = RunModelAveraging(useAsyncAggregation, false, initial, delta, samplesPerBlock);
+        for (size_t k = 0; k < actual.size(); k++)
+            BOOST_REQUIRE_SMALL(expected[k] - actual[k], 1e-3);
+        CheckSameOnAllRanks(actual);
+    }
+}
+
+// Groups the ranks into hosts of 'ranksPerHost' ranks for the lifetime of the object.
+class SimulatedHosts
+{
+public:
+    SimulatedHosts(size_t ranksPerHost)
+    {
+        GetMPI()->SetRanksPerHost(ranksPerHost);
+    }
+
+    ~SimulatedHosts()
+    {
+        GetMPI()->SetRanksPerHost(0);
+    }
+};
+
+// Host sizes that divide the ranks evenly or not, with one rank per host there is no hierarchy.
+static const size_t s_ranksPerHost[] = { 1, 2, 3 };
+
+template <class ElemType>
+static void TestHierarchicalAllReduce(bool integers)
+{
+    auto mpi = GetMPI();
+    for (size_t ranksPerHost : s_ranksPerHost)
+    {
+        SimulatedHosts hosts(ranksPerHost);
+        BOOST_CHECK_EQUAL(ranksPerHost > 1 && mpi->NumNodesInUse() > 1, mpi->HasHostHierarchy());
+        for (bool useRingAcrossHosts : { false, true })
+        {
+            for (size_t size : s_bufferSizes)
+            {
+                auto hierarchical = CreateRankData<ElemType>(size, mpi->CurrentNodeRank(), integers);
+                auto reference = hierarchical;
+                mpi->HierarchicalAllReduce(hierarchical.data(), hierarchical.size(), useRingAcrossHosts);
+                mpi->AllReduce(reference.data(), reference.size());
+
+                CheckClose(reference, hierarchical, integers);
+                CheckSameOnAllRanks(hierarchical);
+            }
+        }
+    }
+}
+
+BOOST_AUTO_TEST_CASE(HierarchicalAllReduceMatchesAllReduce)
+{
+    TestHierarchicalAllReduce<float>(true);
+    TestHierarchicalAllReduce<double>(true);
+    TestHierarchicalAllReduce<float>(false);
+    TestHierarchicalAllReduce<double>(false);
+}
+
+BOOST_AUTO_TEST_CASE(HierarchicalBcastMatchesBcast)
+{
+    auto mpi = GetMPI();
+    for (size_t ranksPerHost : s_ranksPerHost)
+    {
+        SimulatedHosts hosts(ranksPerHost);
+        for (size_t sourceRank = 0; sourceRank < mpi->NumNodesInUse(); sourceRank++)
+        {
+            auto data = CreateRankData<double>(1001, mpi->CurrentNodeRank(), false);
+            auto expected = CreateRankData<double>(1001, sourceRank, false);
+            mpi->HierarchicalBcast(data.data(), data.size(), sourceRank);
+            CheckClose(expected, data, true);
+        }
+    }
+}
+
+BOOST_AUTO_TEST_CASE(HierarchicalAggregationMatchesAllReduce)
+{
+    auto mpi = GetMPI();
+    for (size_t ranksPerHost : s_ranksPerHost)
+    {
+        SimulatedHosts hosts(ranksPerHost);
+        for (bool overlap : { false, true })
+        {
+            SimpleDistGradAggregator<float> aggregator(mpi, false, 0, 40 * sizeof(float), false, overlap, true);
+            CheckAggregation(aggregator, overlap, true);
+        }
+
+        const size_t rank = mpi->CurrentNodeRank();
+        auto initial = CreateRankData<float>(12, rank, true);
+        auto delta = CreateRankData<float>(12, rank + 100, true);
+        auto flat = RunModelAveraging(false, false, initial, delta, 10);
+        auto hierarchical = RunModelAveraging(false, mpi->HasHostHierarchy(), initial, delta, 10);
+        CheckClose(flat, hierarchical, false);
+        CheckSameOnAllRanks(hierarchical);
+    }
+}
+
+// Aggregator that records the gradients reported by GradientReady() and the ones passed to AggregateGradients().
+class RecordingAggregator : public IDistGradAggregator<float>
+{
+public:
+    RecordingAggregator()
+        : IDistGradAggregator<float>(GetMPI())
+    {
+    }
+
+    bool AggregateGradients(const std::vector<Matrix<float>*>& gradients, DistGradHeader* /*headerCPU*/, int /*epochNumber*/) override
+    {
+        m_aggregated.clear();
+        for (const auto& gradient : gradients)
+            m_aggregated.push_back(Values(*gradient));
+        return true;
+    }
+
+    void GradientReady(const std::vector<Matrix<float>*>& gradients, size_t index) override
+    {
+        m_ready[index] = Values(*gradients[index]);
+    }
+
+    static std::vector<float> Values(const Matrix<float>& matrix)
+    {
+        std::unique_ptr<float[]> values(matrix.CopyToArray());
+        return std::vector<float>(values.get(), values.get() + matrix.GetNumElements());
+    }
+
+    std::map<size_t, std::vector<float>> m_ready;
+    std::vector<std::vector<float>> m_aggregated;
+};
+
+// crit = SquareError(label, W x + b)
+static ComputationNetworkPtr CreateRegressionNetwork()
+{
+    auto net = make_shared<ComputationNetwork>(CPUDEVICE);
+    ComputationNetworkBuilder<float> builder(*net);
+    auto x = builder.CreateInputNode(L"x", 3);
+    auto label = builder.CreateInputNode(L"label", 2);
+    auto W = builder.CreateLearnableParameter(L"W", 2, 3);
+    auto b = builder.CreateLearnableParameter(L"b", 2, 1);
+    auto criterion = builder.SquareError(label, builder.Plus(builder.Times(W, x), b), L"crit");
+    net->AddToNodeGroup(L"feature", x);
+    net->AddToNodeGroup(L"feature", label);
+    net->AddToNodeGroup(L"criterion", criterion);
+    net->CompileNetwork();
+    net->InitLearnableParameters<float>(W, true, 1, 1.0f);
+    net->InitLearnableParameters<float>(b, true, 2, 1.0f);
+    net->AllocateAllMatrices({}, {}, criterion);
+    return net;
+}
+
+// Runs a minibatch split into 'numSubminibatches' like SGD with the sub-minibatch dispatcher: the gradients are summed up
+// after the backprop of each sub-minibatch and the sum is set before the aggregation. Returns the sum.
+static std::vector<std::vector<float>> RunSubminibatches(const ComputationNetworkPtr& net, size_t numSubminibatches, IDistGradAggregator<float>& aggregator,
+                                                         const std::vector<Matrix<float>*>& gradients, const std::unordered_map<ComputationNodeBasePtr, size_t>& gradientIndices)
+{
+    const size_t T = 4;
+    auto criterion = net->GetNodeFromName(L"crit");
+    ScopedNetworkOperationMode modeGuard(net, NetworkOperationMode::training);
+    net->StartEvaluateMinibatchLoop(criterion);
+    std::vector<Matrix<float>> sums;
+    for (const auto& gradient : gradients)
+        sums.emplace_back(Matrix<float>::Zeros(gradient->GetNumRows(), gradient->GetNumCols(), CPUDEVICE));
+    for (size_t ismb = 0; ismb < numSubminibatches; ismb++)
+    {
+        auto layout = net->GetMBLayoutPtrOfNetwork();
+        layout->Init(1, T);
+        layout->AddSequence(0, 0, 0, T);
+        unsigned long seed = (unsigned long) (10 * GetMPI()->CurrentNodeRank() + ismb + 1);
+        for (const auto& feature : net->FeatureNodes())
+        {
+            auto& value = feature->As<ComputationNode<float>>()->Value();
+            value.Resize(feature->GetSampleLayout().GetNumElements(), T);
+            value.SetUniformRandomValue(-1, 1, seed++);
+        }
+        ComputationNetwork::BumpEvalTimeStamp(net->FeatureNodes());
+        net->ForwardProp(criterion);
+        SGD<float>::BackpropCriterion(net, criterion, numSubminibatches, &aggregator, gradients, gradientIndices);
+        if (numSubminibatches > 1)
+        {
+            for (size_t i = 0; i < gradients.size(); i++)
+            {
+                sums[i] += *gradients[i];
+                gradients[i]->SetValue(0);
+            }
+        }
+    }
+
+    std::vector<std::vector<float>> result;
+    for (size_t i = 0; i < gradients.size(); i++)
+    {
+        if (numSubminibatches > 1)
+            gradients[i]->SetValue(sums[i]);
+        result.push_back(RecordingAggregator::Values(*gradients[i]));
+    }
+    return result;
+}
+
+BOOST_AUTO_TEST_CASE(OverlappedAggregationWithSubminibatches)
+{
+    auto net = CreateRegressionNetwork();
+    std::vector<Matrix<float>*> gradients;
+    std::unordered_map<ComputationNodeBasePtr, size_t> gradientIndices;
+    for (const auto& parameter : net->LearnableParameterNodes(net->GetNodeFromName(L"crit")))
+    {
+        gradientIndices[parameter] = gradients.size();
+        gradients.push_back(&parameter->As<ComputationNode<float>>()->Gradient());
+    }
+    BOOST_REQUIRE_EQUAL(2, gradients.size());
+    std::unique_ptr<DistGradHeader, void (*)(DistGradHeader*)> header(DistGradHeader::Create(0), &DistGradHeader::Destroy);
+
+    // a minibatch that is not split reports each final gradient during backprop
+    RecordingAggregator recording;
+    auto expected = RunSubminibatches(net, 1, recording, gradients, gradientIndices);
+    recording.AggregateGradients(gradients, header.get(), 0);
+    BOOST_REQUIRE_EQUAL(gradients.size(), recording.m_ready.size());
+    for (size_t i = 0; i < gradients.size(); i++)
+    {
+        BOOST_CHECK(recording.m_ready[i] == expected[i]);
+        BOOST_CHECK(recording.m_aggregated[i] == expected[i]);
+    }
+
+    // with sub-minibatches the gradients are final only after the last one was summed up, so none is reported early
+    for (size_t numSubminibatches : { 2, 3 })
+    {
+        RecordingAggregator subminibatchRecording;
+        expected = RunSubminibatches(net, numSubminibatches, subminibatchRecording, gradients, gradientIndices);
+        subminibatchRecording.AggregateGradients(gradients, header.get(), 0);
+        BOOST_CHECK(subminibatchRecording.m_ready.empty());
+        BOOST_REQUIRE_EQUAL(gradients.size(), subminibatchRecording.m_aggregated.size());
+        for (size_t i = 0; i < gradients.size(); i++)
+            BOOST_CHECK(subminibatchRecording.m_aggregated[i] == expected[i]);
+    }
+
+    // the overlapped aggregator sums up the gradients of all sub-minibatches over the ranks
+    auto mpi = GetMPI();
+    SimpleDistGradAggregator<float> aggregator(mpi, false, 0, 4 * sizeof(float), false, true);
+    for (size_t numSubminibatches : { 1, 3 })
+    {
+        expected = RunSubminibatches(net, numSubminibatches, aggregator, gradients, gradientIndices);
+        for (auto& values : expected)
+            mpi->AllReduce(values.data(), values.size());
+        header->numSamples = header->numSamplesWithLabel = 4 * numSubminibatches;
+        header->criterion = 0;
+        BOOST_CHECK(aggregator.AggregateGradients(gradients, header.get(), 0));
+        for (size_t i = 0; i < gradients.size(); i++)
+            CheckClose(expected[i], RecordingAggregator::Values(*gradients[i]), false);
+    }
+}
+
+BOOST_AUTO_TEST_SUITE_END()
+
+}}}}
@@ -0,0 +1,224 @@
+//
+// Copyright (c) Microsoft. All rights reserved.
+// Licensed under the MIT license. See LICENSE.md file in the project root for full license information.
+//
+#include "stdafx.h"
+#include "InputAndParamNodes.h"
+#include "SpecialPurposeNodes.h"
+#include "ComputationNetworkBuilder.h"
+#include <boost/filesystem.hpp>
+
+using namespace Microsoft::MSR::CNTK;
+
+namespace Microsoft { namespace MSR { namespace CNTK { namespace Test {
+
+struct ElementwiseFusionFixture
+{
+    ElementwiseFusionFixture()
+        : m_path((boost::filesystem::temp_directory_path() / boost::filesystem::unique_path()).wstring())
+    {
+    }
+
+    ~ElementwiseFusionFixture()
+    {
+        // the setting is global, the other tests run unfused
+        ComputationNetwork::SetElementwiseFusion(false);
+        boost::filesystem::remove(m_path);
+    }
+
+    static std::string ReadFile(const std::wstring& path)
+    {
+        std::ifstream file(boost::filesystem::path(path).string(), std::ios::binary);
+        return std::string(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
+    }
+
+    std::wstring m_path;
+};
+
+// the nodes of the network below that are absorbed into the fused nodes s and q
+static const std::vector<std::wstring> s_absorbedNodeNames = { L"p", L"m", L"t", L"e", L"ss", L"es", L"r" };
+
+// q = ReLU(Sigmoid(W x + b) .* Tanh(W x - c) + Sigmoid(W x + b) .* Sigmoid(W x + b)) .* k
+// The element-wise nodes form two trees with the roots s and q, since s has more than one consumer.
+static ComputationNetworkPtr CreateNetwork(bool fuse)
+{
+    ComputationNetwork::SetElementwiseFusion(fuse);
+    auto net = make_shared<ComputationNetwork>(CPUDEVICE);
+    ComputationNetworkBuilder<float> builder(*net);
+    auto x = builder.CreateInputNode(L"x", 8);
+    auto y = builder.CreateInputNode(L"y", 6);
+    auto W = builder.CreateLearnableParameter(L"W", 6, 8);
+    auto b = builder.CreateLearnableParameter(L"b", 6, 1);
+    auto c = builder.CreateLearnableParameter(L"c", 6, 1);
+    auto k = builder.CreateLearnableParameter(L"k", 1, 1);
+    auto z = builder.Times(W, x, 1, L"z");
+    auto s = builder.Sigmoid(builder.Plus(z, b, L"p"), L"s");
+    auto t = builder.Tanh(builder.Minus(z, c, L"m"), L"t");
+    auto e = builder.ElementTimes(s, t, L"e");
+    auto r = builder.RectifiedLinear(builder.Plus(e, builder.ElementTimes(s, s, L"ss"), L"es"), L"r");
+    auto q = builder.ElementTimes(r, k, L"q");
+    auto ce = builder.SquareError(y, q, L"ce");
+    net->AddToNodeGroup(L"feature", x);
+    net->AddToNodeGroup(L"label", y);
+    net->AddToNodeGroup(L"criterion", ce);
+    net->CompileNetwork();
+
+    int seed = 1;
+    for (auto parameter : { W, b, c, k })
+        net->InitLearnableParameters<float>(parameter, true, seed++, 1.0f);
+    return net;
+}
+
+static size_t NumFusedNodes(const ComputationNetworkPtr& net)
+{
+    return net->GetNodesWithType(OperationNameOf(FusedElementwiseNode)).size();
+}
+
+struct Result
+{
+    std::vector<float> m_output; // q
+    std::vector<float> m_criterion;
+    std::vector<std::vector<float>> m_gradients; // of the parameters
+};
+
+static std::vector<float> ToVector(const Matrix<float>& matrix)
+{
+    std::unique_ptr<float[]> values(matrix.CopyToArray());
+    return std::vector<float>(values.get(), values.get() + matrix.GetNumElements());
+}
+
+// one forward and backward pass over two sequences of different lengths
+static Result ForwardBackward(const ComputationNetworkPtr& net)
+{
+    const size_t T = 10;
+    auto layout = net->GetMBLayoutPtrOfNetwork();
+    layout->Init(2, T);
+    layout->AddSequence(0, 0, 0, T);
+    layout->AddSequence(1, 1, 0, T - 3);
+    layout->AddGap(1, T - 3, T);
+    auto x = dynamic_pointer_cast<ComputationNode<float>>(net->GetNodeFromName(L"x"));
+    auto y = dynamic_pointer_cast<ComputationNode<float>>(net->GetNodeFromName(L"y"));
+    x->Value().Resize(8, 2 * T);
+    x->Value().SetUniformRandomValue(-1, 1, 3);
+    y->Value().Resize(6, 2 * T);
+    y->Value().SetUniformRandomValue(-1, 1, 4);
+
+    auto criterion = net->GetNodeFromName(L"ce");
+    ScopedNetworkOperationMode modeGuard(net, NetworkOperationMode::training);
+    net->AllocateAllMatrices({}, {}, criterion);
+    net->StartEvaluateMinibatchLoop(criterion);
+    ComputationNetwork::BumpEvalTimeStamp(net->FeatureNodes());
+    ComputationNetwork::BumpEvalTimeStamp(net->LabelNodes());
+    net->ForwardProp(criterion);
+
+    // the matrix of q is reused during the backward pass
+    Result result;
+    result.m_output = ToVector(dynamic_pointer_cast<ComputationNode<float>>(net->GetNodeFromName(L"q"))->Value());
+    result.m_criterion = ToVector(dynamic_pointer_cast<ComputationNode<float>>(criterion)->Value());
+    net->Backprop(criterion);
+    for (const auto& name : { L"W", L"b", L"c", L"k" })
+        result.m_gradients.push_back(ToVector(dynamic_pointer_cast<ComputationNode<float>>(net->GetNodeFromName(name))->Gradient()));
+    return result;
+}
+
+static void CheckClose(const std::vector<float>& expected, const std::vector<float>& actual)
+{
+    BOOST_REQUIRE_EQUAL(expected.size(), actual.size());
+    for (size_t i = 0; i < expected.size(); i++)
+        BOOST_CHECK_SMALL(expected[i] - actual[i], 1e-5f * std::max(1.0f, fabs(expected[i])));
+}
+
+BOOST_FIXTURE_TEST_SUITE(ElementwiseFusionSuite, ElementwiseFusionFixture)
+
+BOOST_AUTO_TEST_CASE(FusionIsOffByDefault)
+{
+    auto net = make_shared<ComputationNetwork>(CPUDEVICE);
+    ComputationNetworkBuilder<float> builder(*net);
+    auto x = builder.CreateInputNode(L"x", 3);
+    auto output = builder.Tanh(builder.Sigmoid(x, L"s"), L"output");
+    net->AddToNodeGroup(L"output", output);
+    net->CompileNetwork();
+    BOOST_CHECK_EQUAL(0, NumFusedNodes(net));
+    BOOST_CHECK(net->NodeNameExists(L"s"));
+}
+
+BOOST_AUTO_TEST_CASE(FusedMatchesUnfused)
+{
+    auto unfusedNet = CreateNetwork(false);
+    auto fusedNet = CreateNetwork(true);
+    BOOST_CHECK_EQUAL(0, NumFusedNodes(unfusedNet));
+    BOOST_CHECK_EQUAL(2, NumFusedNodes(fusedNet));
+    BOOST_CHECK_EQUAL(unfusedNet->GetTotalNumberOfNodes() - s_absorbedNodeNames.size(), fusedNet->GetTotalNumberOfNodes());
+    for (const auto& name : s_absorbedNodeNames)
+        BOOST_CHECK(!fusedNet->NodeNameExists(name));
+
+    auto expected = ForwardBackward(unfusedNet);
+    auto actual = ForwardBackward(fusedNet);
+    CheckClose(expected.m_output, actual.m_output);
+    CheckClose(expected.m_criterion, actual.m_criterion);
+    for (size_t i = 0; i < expected.m_gradients.size(); i++)
+        CheckClose(expected.m_gradients[i], actual.m_gradients[i]);
+}
+
+BOOST_AUTO_TEST_CASE(FusedNetworkIsSavedUnfused)
+{
+    // the model file is the same with and without fusion
+    CreateNetwork(false)->Save(m_path);
+    const auto unfusedModel = ReadFile(m_path);
+    auto fusedNet = CreateNetwork(true);
+    fusedNet->Save(m_path);
+    BOOST_CHECK(unfusedModel == ReadFile(m_path));
+
+    // it loads with all the original nodes
+    ComputationNetwork::SetElementwiseFusion(false);
+    auto loadedNet = ComputationNetwork::CreateFromFile<float>(CPUDEVICE, m_path);
+    BOOST_CHECK_EQUAL(0, NumFusedNodes(loadedNet));
+    for (const auto& name : s_absorbedNodeNames)
+        BOOST_CHECK(loadedNet->NodeNameExists(name));
+    BOOST_CHECK(loadedNet->GetNodeFromName(L"e")->Input(0) == loadedNet->GetNodeFromName(L"s"));
+
+    // and is fused again when loaded with fusion
+    ComputationNetwork::SetElementwiseFusion(true);
+    auto reloadedFusedNet = ComputationNetwork::CreateFromFile<float>(CPUDEVICE, m_path);
+    BOOST_CHECK_EQUAL(2, NumFusedNodes(reloadedFusedNet));
+
+    auto expected = ForwardBackward(fusedNet);
+    for (const auto& net : { loadedNet, reloadedFusedNet })
+    {
+        auto actual = ForwardBackward(net);
+        CheckClose(expected.m_output, actual.m_output);
+        CheckClose(expected.m_criterion, actual.m_criterion);
+    }
+}
+
+BOOST_AUTO_TEST_CASE(FusedNetworkRereadsParameters)
+{
+    // as done by SGD when it goes back to an earlier model
+    auto fusedNet = CreateNetwork(true);
+    auto expected = ForwardBackward(fusedNet);
+    fusedNet->Save(m_path);
+
+    auto W = dynamic_pointer_cast<ComputationNode<float>>(fusedNet->GetNodeFromName(L"W"));
+    W->Value().SetValue(0);
+    fusedNet->RereadPersistableParameters<float>(m_path);
+    BOOST_CHECK_EQUAL(2, NumFusedNodes(fusedNet));
+    CheckClose(expected.m_output, ForwardBackward(fusedNet).m_output);
+}
+
+BOOST_AUTO_TEST_CASE(DisallowedElementwiseFusion)
+{
+    ComputationNetwork::SetElementwiseFusion(true);
+    auto net = make_shared<ComputationNetwork>(CPUDEVICE);
+    net->DisallowElementwiseFusion();
+    ComputationNetworkBuilder<float> builder(*net);
+    auto x = builder.CreateInputNode(L"x", 3);
+    auto output = builder.Tanh(builder.Sigmoid(x, L"s"), L"output");
+    net->AddToNodeGroup(L"output", output);
+    net->CompileNetwork();
+    BOOST_CHECK_EQUAL(0, NumFusedNodes(net));
+    BOOST_CHECK(net->GetNodeFromName(L"output") == output);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
+
+}}}}
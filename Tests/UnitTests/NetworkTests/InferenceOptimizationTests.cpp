@@ -0,0 +1,246 @@
+//
+// Copyright (c) Microsoft. All rights reserved.
+// Licensed under the MIT license. See LICENSE.md file in the project root for full license information.
+//
+#include "stdafx.h"
+#include "InputAndParamNodes.h"
+#include "LinearAlgebraNodes.h"
+#include "ConvolutionalNodes.h"
+#include "TrainingNodes.h"
+#include "ComputationNetworkBuilder.h"
+#include <boost/filesystem.hpp>
+
+using namespace Microsoft::MSR::CNTK;
+
+namespace Microsoft { namespace MSR { namespace CNTK { namespace Test {
+
+struct InferenceOptimizationFixture
+{
+    InferenceOptimizationFixture()
+        : m_path((boost::filesystem::temp_directory_path() / boost::filesystem::unique_path()).wstring())
+    {
+    }
+
+    ~InferenceOptimizationFixture()
+    {
+        boost::filesystem::remove(m_path);
+    }
+
+    std::wstring m_path;
+};
+
+// Creates the networks of the tests with parameters initialized from fixed seeds.
+class NetworkCreator
+{
+public:
+    NetworkCreator()
+        : m_net(make_shared<ComputationNetwork>(CPUDEVICE)), m_builder(*m_net)
+    {
+    }
+
+    ComputationNetworkBuilder<float>& Builder() { return m_builder; }
+
+    shared_ptr<ComputationNode<float>> Parameter(const std::wstring& name, const TensorShape& shape)
+    {
+        auto parameter = m_builder.CreateLearnableParameter(name, shape);
+        m_parameters.push_back(parameter);
+        return parameter;
+    }
+
+    shared_ptr<ComputationNode<float>> Parameter(const std::wstring& name, size_t rows, size_t cols)
+    {
+        return Parameter(name, TensorShape(rows, cols));
+    }
+
+    // BatchNormalization with random statistics, as after training
+    shared_ptr<ComputationNode<float>> BatchNormalization(const std::wstring& name, shared_ptr<ComputationNode<float>> input, size_t dim, bool spatial)
+    {
+        auto scale = Parameter(name + L".scale", dim, 1);
+        auto bias = Parameter(name + L".bias", dim, 1);
+        auto mean = Parameter(name + L".mean", dim, 1);
+        auto invStdDev = Parameter(name + L".invStdDev", dim, 1);
+        m_invStdDevs.push_back(invStdDev);
+        return m_builder.BatchNormalization(input, scale, bias, mean, invStdDev, spatial, 0, 0, 1e-5, true, ImageLayoutKind::CHW, name);
+    }
+
+    ComputationNetworkPtr Compile(const std::vector<ComputationNodeBasePtr>& features, const std::vector<ComputationNodeBasePtr>& outputs)
+    {
+        for (const auto& node : features)
+            m_net->AddToNodeGroup(L"feature", node);
+        for (const auto& node : outputs)
+            m_net->AddToNodeGroup(L"output", node);
+        m_net->CompileNetwork();
+
+        int seed = 1;
+        for (const auto& parameter : m_parameters)
+            m_net->InitLearnableParameters<float>(parameter, true, seed++, 1.0f);
+        // the inverse standard deviations are positive
+        for (const auto& invStdDev : m_invStdDevs)
+        {
+            invStdDev->Value().InplaceAbs();
+            invStdDev->Value() += 0.5f;
+        }
+        return m_net;
+    }
+
+private:
+    ComputationNetworkPtr m_net;
+    ComputationNetworkBuilder<float> m_builder;
+    std::vector<ComputationNodeBasePtr> m_parameters;
+    std::vector<shared_ptr<ComputationNode<float>>> m_invStdDevs;
+};
+
+// out = BatchNormalization((Exp(U) .* V) Sigmoid(Dropout(BatchNormalization(W x + b))))
+// The first BatchNormalization is folded into W and b, the second one into the constant Exp(U) .* V and a new bias.
+static ComputationNetworkPtr CreateTimesNetwork()
+{
+    NetworkCreator creator;
+    auto& builder = creator.Builder();
+    auto x = builder.CreateInputNode(L"x", 8);
+    auto W = creator.Parameter(L"W", 6, 8);
+    auto b = creator.Parameter(L"b", 6, 1);
+    auto bn1 = creator.BatchNormalization(L"bn1", builder.Plus(builder.Times(W, x, 1, L"z"), b, L"p"), 6, false);
+    auto hidden = builder.Sigmoid(builder.Dropout(bn1, L"d"), L"h");
+    auto U = creator.Parameter(L"U", 5, 6);
+    auto V = creator.Parameter(L"V", 5, 6);
+    auto W2 = builder.ElementTimes(builder.Exp(U, L"expU"), V, L"W2");
+    auto out = creator.BatchNormalization(L"out", builder.Times(W2, hidden, 1, L"z2"), 5, false);
+    return creator.Compile({ x }, { out });
+}
+
+// out = BatchNormalization(Convolution(K, image) [+ convBias]), spatial, for images of 5 x 5 x 3 and 4 output channels
+static ComputationNetworkPtr CreateConvolutionNetwork(bool withBias)
+{
+    NetworkCreator creator;
+    auto& builder = creator.Builder();
+    auto image = builder.CreateInputNode(L"image", TensorShape(5, 5, 3));
+    auto K = creator.Parameter(L"K", 4, 27);
+    shared_ptr<ComputationNode<float>> conv = builder.Convolution(K, image, 3, 3, 4, 1, 1, ImageLayoutKind::CHW, true, 0, L"conv");
+    if (withBias) // one bias per channel, the last dimension
+        conv = builder.Plus(conv, creator.Parameter(L"convBias", TensorShape(1, 1, 4)), L"convPlusBias");
+    auto out = creator.BatchNormalization(L"out", conv, 4, true);
+    return creator.Compile({ image }, { out });
+}
+
+// the values of the outputs for a minibatch of 'numSamples' random samples
+static std::vector<std::vector<float>> Evaluate(const ComputationNetworkPtr& net, size_t numSamples)
+{
+    auto outputs = net->OutputNodes();
+    net->AllocateAllMatrices({}, outputs, nullptr);
+    auto layout = net->GetMBLayoutPtrOfNetwork();
+    layout->Init(1, numSamples);
+    layout->AddSequence(0, 0, 0, numSamples);
+    unsigned long seed = 1;
+    for (const auto& feature : net->FeatureNodes())
+    {
+        auto& value = feature->As<ComputationNode<float>>()->Value();
+        value.Resize(feature->GetSampleLayout().GetNumElements(), numSamples);
+        value.SetUniformRandomValue(-1, 1, seed++);
+    }
+
+    ScopedNetworkOperationMode modeGuard(net, NetworkOperationMode::inferring);
+    net->StartEvaluateMinibatchLoop(outputs);
+    ComputationNetwork::BumpEvalTimeStamp(net->FeatureNodes());
+    std::vector<std::vector<float>> values;
+    for (const auto& output : outputs)
+    {
+        net->ForwardProp(output);
+        const auto& value = output->As<ComputationNode<float>>()->Value();
+        std::unique_ptr<float[]> data(value.CopyToArray());
+        values.push_back(std::vector<float>(data.get(), data.get() + value.GetNumElements()));
+    }
+    return values;
+}
+
+static void CheckClose(const std::vector<std::vector<float>>& expected, const std::vector<std::vector<float>>& actual)
+{
+    BOOST_REQUIRE_EQUAL(expected.size(), actual.size());
+    for (size_t i = 0; i < expected.size(); i++)
+    {
+        BOOST_REQUIRE_EQUAL(expected[i].size(), actual[i].size());
+        for (size_t j = 0; j < expected[i].size(); j++)
+            BOOST_CHECK_SMALL(expected[i][j] - actual[i][j], 1e-4f * std::max(1.0f, fabs(expected[i][j])));
+    }
+}
+
+static size_t NumNodesWithType(const ComputationNetworkPtr& net, const std::wstring& typeName)
+{
+    return net->GetNodesWithType(typeName).size();
+}
+
+BOOST_FIXTURE_TEST_SUITE(InferenceOptimizationSuite, InferenceOptimizationFixture)
+
+BOOST_AUTO_TEST_CASE(BatchNormalizationFoldedIntoTimes)
+{
+    const size_t numSamples = 7;
+    auto expected = Evaluate(CreateTimesNetwork(), numSamples);
+
+    auto net = CreateTimesNetwork();
+    net->OptimizeForInference<float>();
+    BOOST_CHECK_EQUAL(0, NumNodesWithType(net, OperationNameOf(BatchNormalizationNode)));
+    BOOST_CHECK_EQUAL(0, NumNodesWithType(net, OperationNameOf(DropoutNode)));
+    BOOST_CHECK(!net->NodeNameExists(L"expU"));
+    BOOST_CHECK(net->GetNodeFromName(L"W2")->OperationName() == OperationNameOf(LearnableParameter));
+    // the outputs keep their names
+    BOOST_CHECK(net->GetNodeFromName(L"bn1")->OperationName() == OperationNameOf(PlusNode));
+    BOOST_CHECK(net->GetNodeFromName(L"out")->OperationName() == OperationNameOf(PlusNode));
+    BOOST_CHECK(net->OutputNodes()[0] == net->GetNodeFromName(L"out"));
+
+    CheckClose(expected, Evaluate(net, numSamples));
+}
+
+BOOST_AUTO_TEST_CASE(BatchNormalizationFoldedIntoConvolution)
+{
+    const size_t numSamples = 3;
+    for (bool withBias : { false, true })
+    {
+        auto expected = Evaluate(CreateConvolutionNetwork(withBias), numSamples);
+
+        auto net = CreateConvolutionNetwork(withBias);
+        net->OptimizeForInference<float>();
+        BOOST_CHECK_EQUAL(0, NumNodesWithType(net, OperationNameOf(BatchNormalizationNode)));
+        BOOST_CHECK(net->GetNodeFromName(L"out")->OperationName() == OperationNameOf(PlusNode));
+        BOOST_CHECK(net->GetNodeFromName(L"out")->Input(0) == net->GetNodeFromName(L"conv"));
+
+        CheckClose(expected, Evaluate(net, numSamples));
+    }
+}
+
+BOOST_AUTO_TEST_CASE(BatchNormalizationWithSharedWeightsNotFolded)
+{
+    // W is also used by the second output, so it cannot absorb the scale of the BatchNormalization
+    NetworkCreator creator;
+    auto& builder = creator.Builder();
+    auto x = builder.CreateInputNode(L"x", 8);
+    auto W = creator.Parameter(L"W", 6, 8);
+    auto out = creator.BatchNormalization(L"out", builder.Times(W, x, 1, L"z"), 6, false);
+    auto out2 = builder.Times(W, x, 1, L"out2");
+    auto net = creator.Compile({ x }, { out, out2 });
+    net->OptimizeForInference<float>();
+    BOOST_CHECK_EQUAL(1, NumNodesWithType(net, OperationNameOf(BatchNormalizationNode)));
+    BOOST_CHECK(net->GetNodeFromName(L"out")->Input(0) == net->GetNodeFromName(L"z"));
+}
+
+BOOST_AUTO_TEST_CASE(OptimizedNetworkSavesAndLoads)
+{
+    const size_t numSamples = 5;
+    auto expected = Evaluate(CreateTimesNetwork(), numSamples);
+
+    auto net = CreateTimesNetwork();
+    net->OptimizeForInference<float>();
+    net->Save(m_path);
+    auto loadedNet = ComputationNetwork::CreateFromFile<float>(CPUDEVICE, m_path);
+    BOOST_CHECK_EQUAL(net->GetTotalNumberOfNodes(), loadedNet->GetTotalNumberOfNodes());
+    CheckClose(expected, Evaluate(loadedNet, numSamples));
+}
+
+BOOST_AUTO_TEST_CASE(OptimizeEvaluatedNetwork)
+{
+    auto net = CreateTimesNetwork();
+    Evaluate(net, 2);
+    BOOST_CHECK_THROW(net->OptimizeForInference<float>(), std::exception);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
+
+}}}}
@@ -0,0 +1,225 @@
+//
+// Copyright (c) Microsoft. All rights reserved.
+// Licensed under the MIT license. See LICENSE.md file in the project root for full license information.
+//
+#include "stdafx.h"
+#include "InputAndParamNodes.h"
+#include "ComputationNetworkBuilder.h"
+#include "SimpleOutputWriter.h"
+#include "AsyncFileWriter.h"
+#include "CPUHalfMatrix.h"
+#include <boost/filesystem.hpp>
+
+using namespace Microsoft::MSR::CNTK;
+
+namespace Microsoft { namespace MSR { namespace CNTK { namespace Test {
+
+// Reads back files written by AsyncFileWriter and SimpleOutputWriter.
+class BinaryFileReader
+{
+public:
+    BinaryFileReader(const std::string& path)
+    {
+        std::ifstream file(path, std::ios::binary);
+        m_data.assign(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
+        m_position = 0;
+    }
+
+    template <class T>
+    T Read()
+    {
+        BOOST_REQUIRE_LE(m_position + sizeof(T), m_data.size());
+        T value;
+        memcpy(&value, &m_data[m_position], sizeof(T));
+        m_position += sizeof(T);
+        return value;
+    }
+
+    std::string ReadString(size_t length)
+    {
+        BOOST_REQUIRE_LE(m_position + length, m_data.size());
+        std::string value(&m_data[m_position], length);
+        m_position += length;
+        return value;
+    }
+
+    float ReadValue(size_t elementSize)
+    {
+        if (elementSize == sizeof(float))
+            return Read<float>();
+        else if (elementSize == sizeof(double))
+            return (float)Read<double>();
+        return CPUHalfMatrix::HalfToFloat(Read<uint16_t>());
+    }
+
+    bool AtEnd() const { return m_position == m_data.size(); }
+    const std::string& Data() const { return m_data; }
+
+private:
+    std::string m_data;
+    size_t m_position;
+};
+
+struct OutputWriterFixture
+{
+    OutputWriterFixture()
+        : m_path((boost::filesystem::temp_directory_path() / boost::filesystem::unique_path()).string())
+    {
+    }
+
+    ~OutputWriterFixture()
+    {
+        boost::filesystem::remove(m_path);
+        boost::filesystem::remove(m_path + ".1");
+    }
+
+    std::string m_path;
+};
+
+BOOST_FIXTURE_TEST_SUITE(OutputWriterSuite, OutputWriterFixture)
+
+BOOST_AUTO_TEST_CASE(AsyncFileWriterOrderAndFlush)
+{
+    for (bool async : { false, true })
+    {
+        FILE* f0 = fopen(m_path.c_str(), "wb");
+        FILE* f1 = fopen((m_path + ".1").c_str(), "wb");
+        BOOST_REQUIRE(f0 && f1);
+
+        std::string expected0, expected1;
+        {
+            AsyncFileWriter writer(async);
+            for (size_t i = 0; i < 1000; i++)
+            {
+                // blocks of different sizes, the buffers are recycled
+                auto block = writer.GetBuffer();
+                BOOST_REQUIRE(block.empty());
+                block.assign(i % 7 + 1, (char)('a' + i % 26));
+                block += std::to_string(i);
+                (i % 3 == 0 ? expected1 : expected0) += block;
+                writer.Write(i % 3 == 0 ? f1 : f0, std::move(block));
+            }
+
+            // after Flush() everything submitted has been handed to the files
+            writer.Flush();
+            fflush(f0);
+            fflush(f1);
+            BOOST_CHECK_EQUAL(expected0, BinaryFileReader(m_path).Data());
+            BOOST_CHECK_EQUAL(expected1, BinaryFileReader(m_path + ".1").Data());
+
+            // blocks submitted after the flush are written by the destructor
+            writer.Write(f0, std::string("tail"));
+            expected0 += "tail";
+        }
+
+        fclose(f0);
+        fclose(f1);
+        BOOST_CHECK_EQUAL(expected0, BinaryFileReader(m_path).Data());
+        BOOST_CHECK_EQUAL(expected1, BinaryFileReader(m_path + ".1").Data());
+    }
+}
+
+BOOST_AUTO_TEST_CASE(AsyncFileWriterReportsWriteErrors)
+{
+    fclose(fopen(m_path.c_str(), "wb"));
+    FILE* readOnly = fopen(m_path.c_str(), "rb");
+    BOOST_REQUIRE(readOnly);
+
+    AsyncFileWriter writer(true);
+    writer.Write(readOnly, std::string("cannot be written"));
+    BOOST_CHECK_THROW(writer.Flush(), std::exception);
+
+    // the error is reported once
+    writer.Flush();
+    fclose(readOnly);
+}
+
+// Writes the value of the node in binary format and checks what is read back.
+static void CheckBinaryOutput(const std::string& path, shared_ptr<ComputationNode<float>> node, size_t elementSize, bool writeSequenceKeys,
+                              size_t expectedDimension, const std::vector<std::pair<uint64_t, std::vector<size_t>>>& expectedRecords)
+{
+    WriteFormattingOptions formattingOptions;
+    formattingOptions.isBinary = true;
+    formattingOptions.binaryElementSize = elementSize;
+    formattingOptions.writeSequenceKeys = writeSequenceKeys;
+
+    {
+        FILE* f = fopen(path.c_str(), "wb");
+        BOOST_REQUIRE(f);
+        SimpleOutputWriter<float> outputWriter(nullptr);
+        AsyncFileWriter writer(true);
+        std::vector<std::string> labelMapping;
+        outputWriter.WriteBinaryHeader(writer, f, node, formattingOptions);
+        outputWriter.WriteMinibatch(writer, f, node, formattingOptions, 'f', "%f", labelMapping, 0, false);
+        writer.Flush();
+        fclose(f);
+    }
+
+    BinaryFileReader reader(path);
+    BOOST_CHECK_EQUAL(std::string("CNTKOUT", 8), reader.ReadString(8));
+    BOOST_CHECK_EQUAL(1, reader.Read<uint32_t>());
+    BOOST_CHECK_EQUAL(elementSize, reader.Read<uint32_t>());
+    BOOST_CHECK_EQUAL(writeSequenceKeys ? 1 : 0, reader.Read<uint32_t>());
+    const uint32_t dimension = reader.Read<uint32_t>();
+    BOOST_REQUIRE_EQUAL(expectedDimension, dimension);
+    const uint32_t nameLength = reader.Read<uint32_t>();
+    BOOST_CHECK_EQUAL(msra::strfun::utf8(node->NodeName()), reader.ReadString(nameLength));
+
+    const auto& value = node->Value();
+    for (const auto& record : expectedRecords)
+    {
+        if (writeSequenceKeys)
+            BOOST_CHECK_EQUAL(record.first, reader.Read<uint64_t>());
+        const auto& columns = record.second;
+        BOOST_REQUIRE_EQUAL(columns.size(), reader.Read<uint32_t>());
+        for (auto column : columns)
+        {
+            for (size_t row = 0; row < dimension; row++)
+            {
+                // the values are small integers, exact in half precision
+                BOOST_CHECK_EQUAL(value(row, column), reader.ReadValue(elementSize));
+            }
+        }
+    }
+
+    BOOST_CHECK(reader.AtEnd());
+}
+
+BOOST_AUTO_TEST_CASE(BinaryOutputWithMBLayout)
+{
+    auto net = make_shared<ComputationNetwork>(CPUDEVICE);
+    auto node = ComputationNetworkBuilder<float>(*net).CreateInputNode(L"features", 3);
+    net->CompileNetwork();
+
+    // two parallel sequences: id 7 over 4 time steps, id 9 over 2 time steps followed by a gap
+    auto pMBLayout = node->GetMBLayout();
+    pMBLayout->Init(2, 4);
+    pMBLayout->AddSequence(7, 0, 0, 4);
+    pMBLayout->AddSequence(9, 1, 0, 2);
+    pMBLayout->AddGap(1, 2, 4);
+    node->Value().Resize(3, 8);
+    foreach_coord (row, column, node->Value())
+        node->Value()(row, column) = (float)(10 * column + row);
+
+    // columns are interleaved: time step t of parallel sequence s is column t * 2 + s
+    std::vector<std::pair<uint64_t, std::vector<size_t>>> expectedRecords = { { 7, { 0, 2, 4, 6 } }, { 9, { 1, 3 } } };
+    for (size_t elementSize : { sizeof(float), sizeof(double), sizeof(uint16_t) })
+    {
+        CheckBinaryOutput(m_path, node, elementSize, true, 3, expectedRecords);
+        CheckBinaryOutput(m_path, node, elementSize, false, 3, expectedRecords);
+    }
+}
+
+BOOST_AUTO_TEST_CASE(BinaryOutputWithoutMBLayout)
+{
+    // a [3 x 4] parameter is written as a single record of 4 samples of dimension 3
+    auto node = make_shared<LearnableParameter<float>>(CPUDEVICE, L"W", TensorShape(3, 4));
+    foreach_coord (row, column, node->Value())
+        node->Value()(row, column) = (float)(10 * column + row);
+
+    CheckBinaryOutput(m_path, node, sizeof(float), true, 3, { { 0, { 0, 1, 2, 3 } } });
+}
+
+BOOST_AUTO_TEST_SUITE_END()
+
+}}}}
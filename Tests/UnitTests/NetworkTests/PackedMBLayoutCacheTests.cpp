@@ -0,0 +1,119 @@
+//
+// Copyright (c) Microsoft. All rights reserved.
+// Licensed under the MIT license. See LICENSE.md file in the project root for full license information.
+//
+#include "stdafx.h"
+#include "Sequences.h"
+
+using namespace Microsoft::MSR::CNTK;
+
+namespace Microsoft { namespace MSR { namespace CNTK { namespace Test {
+
+// the layout packed from scratch, as without the cache
+static std::pair<MBLayoutPtr, std::vector<std::pair<size_t, size_t>>> PackSequences(const std::vector<size_t>& sequenceLengths)
+{
+    std::vector<MBLayout::SequenceInfo> sequences;
+    for (size_t i = 0; i < sequenceLengths.size(); i++)
+        sequences.push_back({ i, SIZE_MAX, 0, sequenceLengths[i] });
+
+    auto layout = std::make_shared<MBLayout>();
+    std::vector<std::pair<size_t, size_t>> placement;
+    std::vector<size_t> rowAllocations;
+    layout->InitAsPackedSequences(sequences, placement, rowAllocations);
+    return{ layout, placement };
+}
+
+static void CheckMatchesFreshPacking(const PackedMBLayoutCache::Entry& entry, const std::vector<size_t>& sequenceLengths)
+{
+    auto expected = PackSequences(sequenceLengths);
+    BOOST_CHECK(*entry.m_layout == *expected.first);
+    BOOST_CHECK(entry.m_placement == expected.second);
+    BOOST_CHECK_EQUAL(sequenceLengths.size(), entry.m_layout->GetNumSequences());
+}
+
+BOOST_AUTO_TEST_SUITE(PackedMBLayoutCacheSuite)
+
+BOOST_AUTO_TEST_CASE(CacheHitMatchesFreshPacking)
+{
+    PackedMBLayoutCache cache;
+    const std::vector<std::vector<size_t>> signatures = { { 5, 3, 2 }, { 4, 4 }, { 7, 1, 6, 2 }, { 1 } };
+    std::vector<MBLayoutPtr> layouts;
+    for (const auto& sequenceLengths : signatures)
+    {
+        const auto& entry = cache.Get(sequenceLengths);
+        CheckMatchesFreshPacking(entry, sequenceLengths);
+        layouts.push_back(entry.m_layout);
+    }
+    BOOST_CHECK_EQUAL(0, cache.GetStatistics().m_numHits);
+    BOOST_CHECK_EQUAL(signatures.size(), cache.GetStatistics().m_numMisses);
+
+    // the same lengths hand out the same layout again
+    for (size_t i = signatures.size(); i-- > 0;)
+    {
+        const auto& entry = cache.Get(signatures[i]);
+        BOOST_CHECK(entry.m_layout == layouts[i]);
+        CheckMatchesFreshPacking(entry, signatures[i]);
+    }
+    const auto& statistics = cache.GetStatistics();
+    BOOST_CHECK_EQUAL(signatures.size(), statistics.m_numHits);
+    BOOST_CHECK_EQUAL(signatures.size(), statistics.m_numMisses);
+    BOOST_CHECK_EQUAL(0.5, statistics.HitRate());
+    BOOST_CHECK_GE(statistics.m_secondsSaved, 0);
+}
+
+BOOST_AUTO_TEST_CASE(ChangedSequenceLengthsMiss)
+{
+    PackedMBLayoutCache cache;
+    auto layout = cache.Get({ 5, 3, 2 }).m_layout;
+
+    // any change of the lengths, including their order, is a different packing
+    const std::vector<std::vector<size_t>> changedSignatures = { { 5, 3, 1 }, { 5, 3, 2, 1 }, { 5, 3 }, { 2, 3, 5 } };
+    for (const auto& sequenceLengths : changedSignatures)
+    {
+        size_t numMisses = cache.GetStatistics().m_numMisses;
+        const auto& entry = cache.Get(sequenceLengths);
+        BOOST_CHECK_EQUAL(numMisses + 1, cache.GetStatistics().m_numMisses);
+        BOOST_CHECK(entry.m_layout != layout);
+        CheckMatchesFreshPacking(entry, sequenceLengths);
+    }
+    BOOST_CHECK_EQUAL(0, cache.GetStatistics().m_numHits);
+
+    BOOST_CHECK(cache.Get({ 5, 3, 2 }).m_layout == layout);
+    BOOST_CHECK_EQUAL(1, cache.GetStatistics().m_numHits);
+}
+
+BOOST_AUTO_TEST_CASE(CacheStartsOverWhenFull)
+{
+    PackedMBLayoutCache cache(2);
+    auto layout = cache.Get({ 3 }).m_layout;
+    cache.Get({ 4 });
+    BOOST_CHECK(cache.Get({ 3 }).m_layout == layout);
+
+    // the third signature clears the cache
+    cache.Get({ 5 });
+    const auto& entry = cache.Get({ 3 });
+    BOOST_CHECK(entry.m_layout != layout);
+    CheckMatchesFreshPacking(entry, { 3 });
+    BOOST_CHECK_EQUAL(1, cache.GetStatistics().m_numHits);
+    BOOST_CHECK_EQUAL(4, cache.GetStatistics().m_numMisses);
+}
+
+BOOST_AUTO_TEST_CASE(StatisticsAccumulate)
+{
+    PackedMBLayoutCache::Statistics statistics;
+    BOOST_CHECK_EQUAL(0, statistics.HitRate());
+    statistics.OnHit(0.5);
+    statistics.OnMiss();
+    PackedMBLayoutCache::Statistics other;
+    other.OnHit(0.25);
+    other.OnHit(0.25);
+    statistics += other;
+    BOOST_CHECK_EQUAL(3, statistics.m_numHits);
+    BOOST_CHECK_EQUAL(1, statistics.m_numMisses);
+    BOOST_CHECK_EQUAL(0.75, statistics.HitRate());
+    BOOST_CHECK_EQUAL(1.0, statistics.m_secondsSaved);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
+
+}}}}
@@ -0,0 +1,144 @@
+//
+// Copyright (c) Microsoft. All rights reserved.
+// Licensed under the MIT license. See LICENSE.md file in the project root for full license information.
+//
+#include "stdafx.h"
+#include "Common/ReaderTestHelper.h"
+#include "TextParser.h"
+#include "BinaryDataDeserializer.h"
+
+using namespace Microsoft::MSR::CNTK;
+
+namespace Microsoft { namespace MSR { namespace CNTK { namespace Test {
+
+// The binary files in Data/CNTKBinaryReader are converted from data.ctf with
+//   ctf2bin.py --input data.ctf --output data.bin --stream features F dense 5 --stream labels L sparse 100 --chunkSize 1024
+// and, for data_double.bin, the additional option --precision double.
+struct CNTKBinaryReaderFixture : ReaderFixture
+{
+    CNTKBinaryReaderFixture()
+        : ReaderFixture("/Data/CNTKBinaryReader/")
+    {
+    }
+};
+
+static const size_t s_featureDimension = 5;
+
+template <class ElemType>
+static void CheckValues(const void* expected, const void* actual, size_t count, double tolerance)
+{
+    auto expectedValues = static_cast<const ElemType*>(expected);
+    auto actualValues = static_cast<const ElemType*>(actual);
+    for (size_t i = 0; i < count; i++)
+    {
+        if (tolerance == 0)
+            BOOST_REQUIRE_EQUAL(expectedValues[i], actualValues[i]);
+        else
+            BOOST_REQUIRE_SMALL((double) expectedValues[i] - (double) actualValues[i], tolerance);
+    }
+}
+
+// Reads the text and the converted binary file with the given precision and checks that
+// both deserializers expose the same sequences, samples and values.
+template <class ElemType>
+static void CheckBinaryMatchesText(const string& binaryFile, double tolerance)
+{
+    const string precision = std::is_same<ElemType, float>::value ? "float" : "double";
+    ConfigParameters textConfig;
+    textConfig.Parse("file=data.ctf\nprecision=" + precision + "\n"
+                     "input=[features=[alias=F\ndim=5\nformat=dense]\nlabels=[alias=L\ndim=100\nformat=sparse]]\n");
+    // the streams are exposed in the order of the configuration, 'feats' is an alias of the stream 'features' of the file
+    ConfigParameters binaryConfig;
+    binaryConfig.Parse("file=" + binaryFile + "\nprecision=" + precision + "\ninput=[feats=[alias=features]\nlabels=[]]\n");
+
+    auto corpus = std::make_shared<CorpusDescriptor>();
+    TextParser<ElemType> text(corpus, TextConfigHelper(textConfig));
+    BinaryDataDeserializer binary(corpus, binaryConfig, false);
+
+    auto streams = binary.GetStreamDescriptions();
+    BOOST_REQUIRE_EQUAL(2, streams.size());
+    BOOST_CHECK(streams[0]->m_name == L"feats");
+    BOOST_CHECK(streams[0]->m_storageType == StorageType::dense);
+    BOOST_CHECK(streams[1]->m_name == L"labels");
+    BOOST_CHECK(streams[1]->m_storageType == StorageType::sparse_csc);
+    for (const auto& stream : streams)
+        BOOST_CHECK(stream->m_elementType == (std::is_same<ElemType, float>::value ? ElementType::tfloat : ElementType::tdouble));
+
+    // the file is split into several chunks
+    auto binaryChunks = binary.GetChunkDescriptions();
+    BOOST_CHECK_GT(binaryChunks.size(), 1);
+    size_t numBinarySequences = 0, numBinarySamples = 0;
+    for (const auto& chunk : binaryChunks)
+    {
+        numBinarySequences += chunk->m_numberOfSequences;
+        numBinarySamples += chunk->m_numberOfSamples;
+    }
+
+    size_t numSequences = 0, numSamples = 0, numLabelValues = 0;
+    for (const auto& chunkDescription : text.GetChunkDescriptions())
+    {
+        std::vector<SequenceDescription> sequences;
+        text.GetSequencesForChunk(chunkDescription->m_id, sequences);
+        auto chunk = text.GetChunk(chunkDescription->m_id);
+        for (const auto& sequence : sequences)
+        {
+            SequenceDescription binarySequence;
+            BOOST_REQUIRE(binary.GetSequenceDescriptionByKey(sequence.m_key, binarySequence));
+            BOOST_REQUIRE_EQUAL(sequence.m_numberOfSamples, binarySequence.m_numberOfSamples);
+
+            std::vector<SequenceDataPtr> expected, actual;
+            chunk->GetSequence(sequence.m_id, expected);
+            binary.GetChunk(binarySequence.m_chunkId)->GetSequence(binarySequence.m_id, actual);
+            BOOST_REQUIRE_EQUAL(2, expected.size());
+            BOOST_REQUIRE_EQUAL(2, actual.size());
+
+            // dense features
+            BOOST_REQUIRE_EQUAL(expected[0]->m_numberOfSamples, actual[0]->m_numberOfSamples);
+            CheckValues<ElemType>(expected[0]->m_data, actual[0]->m_data, expected[0]->m_numberOfSamples * s_featureDimension, tolerance);
+
+            // sparse labels, including samples without any value
+            auto expectedLabels = std::static_pointer_cast<SparseSequenceData>(expected[1]);
+            auto actualLabels = std::static_pointer_cast<SparseSequenceData>(actual[1]);
+            BOOST_REQUIRE_EQUAL(expectedLabels->m_numberOfSamples, actualLabels->m_numberOfSamples);
+            BOOST_REQUIRE_EQUAL(expectedLabels->m_totalNnzCount, actualLabels->m_totalNnzCount);
+            BOOST_CHECK(expectedLabels->m_nnzCounts == actualLabels->m_nnzCounts);
+            BOOST_CHECK(std::equal(expectedLabels->m_indices, expectedLabels->m_indices + expectedLabels->m_totalNnzCount, actualLabels->m_indices));
+            CheckValues<ElemType>(expectedLabels->m_data, actualLabels->m_data, expectedLabels->m_totalNnzCount, tolerance);
+
+            numSequences++;
+            numSamples += sequence.m_numberOfSamples;
+            numLabelValues += expectedLabels->m_totalNnzCount;
+        }
+    }
+
+    BOOST_CHECK_EQUAL(numSequences, numBinarySequences);
+    BOOST_CHECK_EQUAL(numSamples, numBinarySamples);
+    BOOST_CHECK_GT(numLabelValues, 0);
+}
+
+BOOST_FIXTURE_TEST_SUITE(ReaderTestSuite, CNTKBinaryReaderFixture)
+
+BOOST_AUTO_TEST_CASE(CNTKBinaryReader_MatchesTextFormat)
+{
+    CheckBinaryMatchesText<float>("data.bin", 0);
+    // the text parser may round the last bit of a double differently
+    CheckBinaryMatchesText<double>("data_double.bin", 1e-15);
+}
+
+BOOST_AUTO_TEST_CASE(CNTKBinaryReader_ConvertsPrecision)
+{
+    // the values are converted when the precision of the file differs from the requested one
+    CheckBinaryMatchesText<double>("data.bin", 1e-6);
+    CheckBinaryMatchesText<float>("data_double.bin", 0);
+}
+
+BOOST_AUTO_TEST_CASE(CNTKBinaryReader_InvalidPrecision)
+{
+    ConfigParameters config;
+    config.Parse("file=data.bin\nprecision=half\ninput=[labels=[]]\n");
+    BOOST_CHECK_THROW(BinaryDataDeserializer(std::make_shared<CorpusDescriptor>(), config, false), std::exception);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
+
+}}}}
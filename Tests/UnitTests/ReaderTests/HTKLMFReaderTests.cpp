@@ -619,6 +619,42 @@ BOOST_AUTO_TEST_CASE(HTKDeserializersSimpleDataLoop12)
         1);
 };
 
+// Same as HTKDeserializersSimpleDataLoop1, but with several minibatches prefetched by the shim.
+BOOST_AUTO_TEST_CASE(HTKDeserializersSimpleDataLoop22)
+{
+    HelperRunReaderTest<float>(
+        testDataPath() + "/Config/HTKDeserializersSimpleDataLoop22_Config.cntk",
+        testDataPath() + "/Control/HTKMLFReaderSimpleDataLoop1_5_11_Control.txt",
+        testDataPath() + "/Control/HTKDeserializersSimpleDataLoop22_Output.txt",
+        "Simple_Test",
+        "reader",
+        500,
+        250,
+        2,
+        1,
+        1,
+        0,
+        1);
+};
+
+// Same as HTKDeserializersSimpleDataLoop1, but the CPU input matrices use the packer buffers directly.
+BOOST_AUTO_TEST_CASE(HTKDeserializersSimpleDataLoop23)
+{
+    HelperRunReaderTest<float>(
+        testDataPath() + "/Config/HTKDeserializersSimpleDataLoop23_Config.cntk",
+        testDataPath() + "/Control/HTKMLFReaderSimpleDataLoop1_5_11_Control.txt",
+        testDataPath() + "/Control/HTKDeserializersSimpleDataLoop23_Output.txt",
+        "Simple_Test",
+        "reader",
+        500,
+        250,
+        2,
+        1,
+        1,
+        0,
+        1);
+};
+
 BOOST_AUTO_TEST_SUITE_END()
 }
 
@@ -9,9 +9,13 @@
 #include "DataDeserializer.h"
 #include "BlockRandomizer.h"
 #include "CorpusDescriptor.h"
+#include "SequenceBucketizer.h"
+#include "Bundler.h"
 
 #include <numeric>
 #include <random>
+#include <map>
+#include <atomic>
 
 using namespace Microsoft::MSR::CNTK;
 using namespace std;
@@ -436,6 +440,648 @@ BOOST_AUTO_TEST_CASE(CorpusDescriptorFromFile)
     remove("test.tmp");
 }
 
+// Sequence enumerator returning sequences of the given lengths in order, the data of a sequence is its index.
+class MockSequenceEnumerator : public SequenceEnumerator
+{
+private:
+    vector<size_t> m_lengths;
+    vector<vector<float>> m_sequenceData;
+    vector<StreamDescriptionPtr> m_streams;
+    TensorShapePtr m_sampleLayout;
+    size_t m_next;
+
+public:
+    MockSequenceEnumerator(const vector<size_t>& lengths)
+        : m_lengths(lengths),
+          m_sampleLayout(make_shared<TensorShape>(1)),
+          m_next(0)
+    {
+        for (size_t i = 0; i < m_lengths.size(); ++i)
+        {
+            m_sequenceData.push_back(vector<float>(m_lengths[i], (float)i));
+        }
+
+        m_streams.push_back(make_shared<StreamDescription>(StreamDescription{
+            L"input",
+            0,
+            StorageType::dense,
+            ElementType::tfloat,
+            m_sampleLayout
+        }));
+    }
+
+    vector<StreamDescriptionPtr> GetStreamDescriptions() const override
+    {
+        return m_streams;
+    }
+
+    void StartEpoch(const EpochConfiguration&) override
+    {
+        m_next = 0;
+    }
+
+    // Returns sequences up to the sample count, at least one.
+    Sequences GetNextSequences(size_t sampleCount) override
+    {
+        Sequences result;
+        result.m_data.resize(1);
+        size_t numberOfSamples = 0;
+        while (m_next < m_lengths.size() &&
+               (result.m_data[0].empty() || numberOfSamples + m_lengths[m_next] <= sampleCount))
+        {
+            auto data = make_shared<DenseSequenceData>();
+            data->m_data = &m_sequenceData[m_next][0];
+            data->m_numberOfSamples = (uint32_t)m_lengths[m_next];
+            data->m_sampleLayout = m_sampleLayout;
+            result.m_data[0].push_back(data);
+            numberOfSamples += m_lengths[m_next];
+            m_next++;
+        }
+
+        if (result.m_data[0].empty())
+        {
+            result.m_data.clear();
+        }
+
+        result.m_endOfEpoch = m_next == m_lengths.size();
+        return result;
+    }
+
+    // Number of sequences returned so far in the current epoch.
+    size_t NumberOfRetrievedSequences() const
+    {
+        return m_next;
+    }
+};
+
+static vector<size_t> CreateSequenceLengths(size_t numberOfSequences, size_t maxLength, int seed)
+{
+    mt19937 rng(seed);
+    uniform_int_distribution<size_t> distr(1, maxLength);
+    vector<size_t> lengths(numberOfSequences);
+    for (auto& length : lengths)
+    {
+        length = distr(rng);
+    }
+    return lengths;
+}
+
+static EpochConfiguration CreateEpochConfiguration(size_t minibatchSize, size_t epochSize)
+{
+    EpochConfiguration epochConfiguration;
+    epochConfiguration.m_numberOfWorkers = 1;
+    epochConfiguration.m_workerRank = 0;
+    epochConfiguration.m_minibatchSizeInSamples = minibatchSize;
+    epochConfiguration.m_totalEpochSizeInSamples = epochSize;
+    epochConfiguration.m_epochIndex = 0;
+    return epochConfiguration;
+}
+
+BOOST_AUTO_TEST_CASE(SequenceBucketizerBucketBoundaries)
+{
+    vector<size_t> lengths { 7, 1, 3, 5, 2, 8, 4, 6 };
+    vector<size_t> expected { 2, 4, 6, 8 };
+    auto boundaries = SequenceBucketizer::GetBucketBoundaries(lengths, 4);
+    BOOST_CHECK_EQUAL_COLLECTIONS(expected.begin(), expected.end(), boundaries.begin(), boundaries.end());
+
+    BOOST_CHECK_EQUAL(0, SequenceBucketizer::GetBucket(boundaries, 1));
+    BOOST_CHECK_EQUAL(0, SequenceBucketizer::GetBucket(boundaries, 2));
+    BOOST_CHECK_EQUAL(1, SequenceBucketizer::GetBucket(boundaries, 3));
+    BOOST_CHECK_EQUAL(3, SequenceBucketizer::GetBucket(boundaries, 8));
+
+    // More buckets than sequences.
+    boundaries = SequenceBucketizer::GetBucketBoundaries(vector<size_t> { 5, 3 }, 4);
+    expected = { 3, 3, 3, 5 };
+    BOOST_CHECK_EQUAL_COLLECTIONS(expected.begin(), expected.end(), boundaries.begin(), boundaries.end());
+}
+
+BOOST_AUTO_TEST_CASE(SequenceBucketizerReturnsEachSequenceOnce)
+{
+    const size_t minibatchSize = 100;
+    auto lengths = CreateSequenceLengths(1000, 50, 7);
+    size_t totalSamples = accumulate(lengths.begin(), lengths.end(), (size_t)0);
+
+    for (size_t numberOfBuckets : { 1, 3, 8 })
+    {
+        auto bucketizer = make_shared<SequenceBucketizer>(numberOfBuckets, 4, make_shared<MockSequenceEnumerator>(lengths));
+
+        // Two epochs, the second one has to start over.
+        for (int epoch = 0; epoch < 2; ++epoch)
+        {
+            bucketizer->StartEpoch(CreateEpochConfiguration(minibatchSize, totalSamples));
+
+            vector<size_t> ids;
+            Sequences sequences;
+            do
+            {
+                sequences = bucketizer->GetNextSequences(minibatchSize);
+                if (sequences.m_data.empty())
+                {
+                    continue;
+                }
+
+                size_t numberOfSamples = 0;
+                for (const auto& sequence : sequences.m_data.front())
+                {
+                    auto data = static_cast<DenseSequenceData&>(*sequence);
+                    size_t id = (size_t)*((float*)data.m_data);
+                    BOOST_REQUIRE_LT(id, lengths.size());
+                    BOOST_REQUIRE_EQUAL(lengths[id], data.m_numberOfSamples);
+                    ids.push_back(id);
+                    numberOfSamples += data.m_numberOfSamples;
+                }
+
+                // The minibatch size is exceeded only by a single sequence.
+                if (sequences.m_data.front().size() > 1)
+                {
+                    BOOST_CHECK_LE(numberOfSamples, minibatchSize);
+                }
+            } while (!sequences.m_endOfEpoch);
+
+            sort(ids.begin(), ids.end());
+            vector<size_t> expected(lengths.size());
+            iota(expected.begin(), expected.end(), 0);
+            BOOST_CHECK_EQUAL_COLLECTIONS(expected.begin(), expected.end(), ids.begin(), ids.end());
+        }
+    }
+}
+
+BOOST_AUTO_TEST_CASE(SequenceBucketizerRespectsBucketBoundaries)
+{
+    const size_t minibatchSize = 64;
+    const size_t numberOfBuckets = 4;
+    auto lengths = CreateSequenceLengths(2000, 40, 13);
+    size_t totalSamples = accumulate(lengths.begin(), lengths.end(), (size_t)0);
+
+    auto provider = make_shared<MockSequenceEnumerator>(lengths);
+    auto bucketizer = make_shared<SequenceBucketizer>(numberOfBuckets, 5, provider);
+    bucketizer->StartEpoch(CreateEpochConfiguration(minibatchSize, totalSamples));
+
+    // Sequences retrieved from the provider but not returned by the bucketizer yet, in the order of retrieval.
+    vector<size_t> window;
+    size_t numberOfRetrieved = 0;
+    size_t numberOfReturned = 0;
+    Sequences sequences;
+    do
+    {
+        sequences = bucketizer->GetNextSequences(minibatchSize);
+        for (; numberOfRetrieved < provider->NumberOfRetrievedSequences(); ++numberOfRetrieved)
+        {
+            window.push_back(numberOfRetrieved);
+        }
+
+        if (sequences.m_data.empty())
+        {
+            continue;
+        }
+
+        // All sequences of the minibatch belong to the bucket of the oldest sequence in the window.
+        vector<size_t> windowLengths;
+        for (auto id : window)
+        {
+            windowLengths.push_back(lengths[id]);
+        }
+
+        auto boundaries = SequenceBucketizer::GetBucketBoundaries(windowLengths, numberOfBuckets);
+        size_t oldest = window.front();
+        size_t bucket = SequenceBucketizer::GetBucket(boundaries, lengths[oldest]);
+        bool containsOldest = false;
+        for (const auto& sequence : sequences.m_data.front())
+        {
+            size_t id = (size_t)*((float*)static_cast<DenseSequenceData&>(*sequence).m_data);
+            BOOST_CHECK_EQUAL(bucket, SequenceBucketizer::GetBucket(boundaries, lengths[id]));
+            containsOldest |= id == oldest;
+
+            auto position = find(window.begin(), window.end(), id);
+            BOOST_REQUIRE(position != window.end());
+            window.erase(position);
+            numberOfReturned++;
+        }
+
+        BOOST_CHECK(containsOldest);
+    } while (!sequences.m_endOfEpoch);
+
+    BOOST_CHECK(window.empty());
+    BOOST_CHECK_EQUAL(lengths.size(), numberOfReturned);
+}
+
+// Deserializer with sequences stored in the given order of keys, the samples of a sequence are (offset + key).
+// Sequence ids are positions in the chunk, as the bundler expects them.
+class MockKeyedDeserializer : public IDataDeserializer
+{
+private:
+    class KeyedChunk : public Chunk
+    {
+        MockKeyedDeserializer& m_parent;
+        size_t m_chunkBegin;
+
+    public:
+        KeyedChunk(MockKeyedDeserializer& parent, size_t chunkBegin)
+            : m_parent(parent), m_chunkBegin(chunkBegin)
+        {
+        }
+
+        void GetSequence(size_t sequenceId, vector<SequenceDataPtr>& result) override
+        {
+            size_t index = m_chunkBegin + sequenceId;
+            auto data = make_shared<DenseSequenceData>();
+            data->m_data = &m_parent.m_sequenceData[index][0];
+            data->m_numberOfSamples = (uint32_t)m_parent.m_sequenceData[index].size();
+            data->m_sampleLayout = m_parent.m_sampleLayout;
+            result.push_back(data);
+        }
+    };
+
+    size_t m_numSequencesPerChunk;
+    vector<size_t> m_keys;
+    map<size_t, size_t> m_keyToIndex;
+    vector<vector<float>> m_sequenceData;
+    TensorShapePtr m_sampleLayout;
+    vector<StreamDescriptionPtr> m_streams;
+    atomic<size_t> m_numberOfLookups;
+
+    SequenceDescription Describe(size_t index) const
+    {
+        return SequenceDescription {
+            index % m_numSequencesPerChunk,
+            (uint32_t)m_sequenceData[index].size(),
+            (ChunkIdType)(index / m_numSequencesPerChunk),
+            { m_keys[index], 0 }
+        };
+    }
+
+public:
+    MockKeyedDeserializer(const wstring& name, const vector<size_t>& keys, size_t numSequencesPerChunk, float offset, size_t maxLength)
+        : m_numSequencesPerChunk(numSequencesPerChunk),
+          m_keys(keys),
+          m_sampleLayout(make_shared<TensorShape>(1)),
+          m_numberOfLookups(0)
+    {
+        for (size_t i = 0; i < m_keys.size(); ++i)
+        {
+            m_keyToIndex[m_keys[i]] = i;
+            m_sequenceData.push_back(vector<float>(1 + m_keys[i] % maxLength, offset + m_keys[i]));
+        }
+
+        m_streams.push_back(make_shared<StreamDescription>(StreamDescription{
+            name,
+            0,
+            StorageType::dense,
+            ElementType::tfloat,
+            m_sampleLayout
+        }));
+    }
+
+    vector<StreamDescriptionPtr> GetStreamDescriptions() const override
+    {
+        return m_streams;
+    }
+
+    ChunkDescriptions GetChunkDescriptions() override
+    {
+        ChunkDescriptions result;
+        for (size_t begin = 0; begin < m_keys.size(); begin += m_numSequencesPerChunk)
+        {
+            size_t end = min(begin + m_numSequencesPerChunk, m_keys.size());
+            size_t numberOfSamples = 0;
+            for (size_t i = begin; i < end; ++i)
+            {
+                numberOfSamples += m_sequenceData[i].size();
+            }
+
+            result.push_back(make_shared<ChunkDescription>(ChunkDescription {
+                (ChunkIdType)result.size(),
+                numberOfSamples,
+                end - begin
+            }));
+        }
+        return result;
+    }
+
+    void GetSequencesForChunk(ChunkIdType chunkId, vector<SequenceDescription>& descriptions) override
+    {
+        size_t begin = chunkId * m_numSequencesPerChunk;
+        for (size_t i = begin; i < min(begin + m_numSequencesPerChunk, m_keys.size()); ++i)
+        {
+            descriptions.push_back(Describe(i));
+        }
+    }
+
+    bool GetSequenceDescriptionByKey(const KeyType& key, SequenceDescription& description) override
+    {
+        m_numberOfLookups++;
+        auto index = m_keyToIndex.find(key.m_sequence);
+        if (index == m_keyToIndex.end())
+        {
+            return false;
+        }
+
+        description = Describe(index->second);
+        return true;
+    }
+
+    ChunkPtr GetChunk(ChunkIdType chunkId) override
+    {
+        return make_shared<KeyedChunk>(*this, chunkId * m_numSequencesPerChunk);
+    }
+
+    vector<wstring> GetInputFiles() const override
+    {
+        return m_inputFiles;
+    }
+
+    size_t NumberOfLookups() const
+    {
+        return m_numberOfLookups;
+    }
+
+    vector<wstring> m_inputFiles;
+};
+
+// Reads all sequences through the bundler and checks that the secondary data belongs to the same key as the primary one.
+// Returns the keys of all sequences.
+static vector<size_t> ReadBundledSequences(Bundler& bundler, size_t maxSecondaryLength)
+{
+    vector<size_t> keys;
+    for (const auto& chunkDescription : bundler.GetChunkDescriptions())
+    {
+        vector<SequenceDescription> sequences;
+        bundler.GetSequencesForChunk(chunkDescription->m_id, sequences);
+        BOOST_CHECK_EQUAL(chunkDescription->m_numberOfSequences, sequences.size());
+
+        auto chunk = bundler.GetChunk(chunkDescription->m_id);
+        for (const auto& sequence : sequences)
+        {
+            vector<SequenceDataPtr> data;
+            chunk->GetSequence(sequence.m_id, data);
+            BOOST_REQUIRE_EQUAL(2, data.size());
+
+            size_t key = (size_t)*(float*)static_cast<DenseSequenceData&>(*data[0]).m_data;
+            float secondary = *(float*)static_cast<DenseSequenceData&>(*data[1]).m_data;
+            BOOST_CHECK_EQUAL(sequence.m_key.m_sequence, key);
+            BOOST_CHECK_EQUAL(1000.0f + key, secondary);
+            BOOST_CHECK_EQUAL(1 + key % maxSecondaryLength, data[1]->m_numberOfSamples);
+            keys.push_back(key);
+        }
+    }
+
+    sort(keys.begin(), keys.end());
+    return keys;
+}
+
+BOOST_AUTO_TEST_CASE(BundlerWithMisalignedKeys)
+{
+    const size_t numberOfSequences = 100;
+    vector<size_t> primaryKeys(numberOfSequences);
+    iota(primaryKeys.begin(), primaryKeys.end(), 0);
+
+    // The secondary deserializer stores the same keys in a different order and chunking.
+    vector<size_t> secondaryKeys = primaryKeys;
+    shuffle(secondaryKeys.begin(), secondaryKeys.end(), mt19937(3));
+
+    for (bool cleanse : { false, true })
+    {
+        auto primary = make_shared<MockKeyedDeserializer>(L"primary", primaryKeys, 10, 0.0f, 3);
+        auto secondary = make_shared<MockKeyedDeserializer>(L"secondary", secondaryKeys, 7, 1000.0f, 4);
+        Bundler bundler(ConfigParameters(), primary, { primary, secondary }, cleanse);
+
+        // Only cleansing looks up the keys at startup, no positions are kept afterwards.
+        BOOST_CHECK_EQUAL(cleanse ? numberOfSequences : 0, secondary->NumberOfLookups());
+
+        // The keys of a chunk are looked up when the chunk is loaded. With cleansing the secondary sequences
+        // are longer, so the sequence descriptions look them up as well.
+        auto keys = ReadBundledSequences(bundler, 4);
+        BOOST_CHECK_EQUAL((cleanse ? 3 : 1) * numberOfSequences, secondary->NumberOfLookups());
+        BOOST_CHECK_EQUAL_COLLECTIONS(primaryKeys.begin(), primaryKeys.end(), keys.begin(), keys.end());
+    }
+}
+
+BOOST_AUTO_TEST_CASE(BundlerWithMissingKeys)
+{
+    const size_t numberOfSequences = 100;
+    vector<size_t> primaryKeys(numberOfSequences);
+    iota(primaryKeys.begin(), primaryKeys.end(), 0);
+
+    // Every tenth sequence is missing in the secondary deserializer.
+    vector<size_t> secondaryKeys, expectedKeys;
+    for (auto key : primaryKeys)
+    {
+        if (key % 10 != 0)
+        {
+            secondaryKeys.push_back(key);
+        }
+    }
+    expectedKeys = secondaryKeys;
+    reverse(secondaryKeys.begin(), secondaryKeys.end());
+
+    auto primary = make_shared<MockKeyedDeserializer>(L"primary", primaryKeys, 10, 0.0f, 3);
+    auto secondary = make_shared<MockKeyedDeserializer>(L"secondary", secondaryKeys, 9, 1000.0f, 4);
+
+    // Cleansing drops the missing sequences.
+    Bundler bundler(ConfigParameters(), primary, { primary, secondary }, true);
+    auto keys = ReadBundledSequences(bundler, 4);
+    BOOST_CHECK_EQUAL_COLLECTIONS(expectedKeys.begin(), expectedKeys.end(), keys.begin(), keys.end());
+
+    // Without cleansing the data is expected to be clean, a missing key is reported when its chunk is loaded.
+    Bundler uncleansed(ConfigParameters(), primary, { primary, secondary }, false);
+    BOOST_CHECK_THROW(ReadBundledSequences(uncleansed, 4), std::exception);
+}
+
+static void WriteTextFile(const string& path, const string& content)
+{
+    ofstream file(path, ios::binary | ios::trunc);
+    file << content;
+}
+
+BOOST_AUTO_TEST_CASE(BundlerCheckDataCache)
+{
+    const string primaryFile = "bundler_primary.tmp";
+    const string secondaryFile = "bundler_secondary.tmp";
+    const string cacheFile = "bundler_cache.tmp";
+    WriteTextFile(primaryFile, "primary");
+    WriteTextFile(secondaryFile, "secondary");
+    remove(cacheFile.c_str());
+
+    ConfigParameters config;
+    config.Insert("checkDataCache", cacheFile);
+
+    vector<size_t> primaryKeys(100), secondaryKeys, expectedKeys;
+    iota(primaryKeys.begin(), primaryKeys.end(), 0);
+    copy_if(primaryKeys.begin(), primaryKeys.end(), back_inserter(secondaryKeys), [](size_t key) { return key % 7 != 3; });
+    expectedKeys = secondaryKeys;
+    shuffle(secondaryKeys.begin(), secondaryKeys.end(), mt19937(5));
+
+    // Runs the bundler over fresh deserializers, returns the number of key lookups needed to set it up.
+    // Reading the sequences looks the keys up per chunk in any case.
+    auto run = [&]()
+    {
+        auto primary = make_shared<MockKeyedDeserializer>(L"primary", primaryKeys, 10, 0.0f, 3);
+        auto secondary = make_shared<MockKeyedDeserializer>(L"secondary", secondaryKeys, 6, 1000.0f, 4);
+        primary->m_inputFiles = { msra::strfun::utf16(primaryFile) };
+        secondary->m_inputFiles = { msra::strfun::utf16(secondaryFile) };
+
+        Bundler bundler(config, primary, { primary, secondary }, true);
+        size_t numberOfLookups = secondary->NumberOfLookups();
+        auto keys = ReadBundledSequences(bundler, 4);
+        BOOST_CHECK_EQUAL_COLLECTIONS(expectedKeys.begin(), expectedKeys.end(), keys.begin(), keys.end());
+        return numberOfLookups;
+    };
+
+    // The first run validates the data and writes the cache.
+    BOOST_CHECK_EQUAL(primaryKeys.size(), run());
+    BOOST_CHECK(ifstream(cacheFile).good());
+
+    // Only the counts and the invalid sequences of the chunks are cached: tag, fingerprint, flag and number of chunks,
+    // then per chunk the original index, samples, sequences, number of invalid sequences and their indices.
+    const size_t numberOfChunks = 10;
+    const size_t numberOfInvalid = primaryKeys.size() - expectedKeys.size();
+    BOOST_CHECK_EQUAL(4 + 8 + 1 + 8 + numberOfChunks * 4 * 8 + numberOfInvalid * 8, (size_t)ifstream(cacheFile, ios::binary | ios::ate).tellg());
+
+    // The second run loads the cleansed chunks from the cache.
+    BOOST_CHECK_EQUAL(0, run());
+
+    // A change of an input file invalidates the cache, the data is validated and cached again.
+    WriteTextFile(secondaryFile, "secondary, changed");
+    BOOST_CHECK_EQUAL(primaryKeys.size(), run());
+    BOOST_CHECK_EQUAL(0, run());
+
+    // A damaged cache is ignored.
+    WriteTextFile(cacheFile, "BNDL");
+    BOOST_CHECK_EQUAL(primaryKeys.size(), run());
+    BOOST_CHECK_EQUAL(0, run());
+
+    // So is a cache whose invalid sequences do not fit the chunk: the last invalid index of the last chunk is out of range.
+    {
+        fstream file(cacheFile, ios::binary | ios::in | ios::out);
+        file.seekp(-8, ios::end);
+        uint64_t outOfRange = 10;
+        file.write((const char*)&outOfRange, sizeof(outOfRange));
+    }
+    BOOST_CHECK_EQUAL(primaryKeys.size(), run());
+    BOOST_CHECK_EQUAL(0, run());
+
+    remove(primaryFile.c_str());
+    remove(secondaryFile.c_str());
+    remove(cacheFile.c_str());
+}
+
+// Keys in the style of utterance ids.
+static vector<string> CreateSequenceKeys(size_t numberOfKeys)
+{
+    vector<string> keys;
+    keys.reserve(numberOfKeys);
+    for (size_t i = 0; i < numberOfKeys; ++i)
+    {
+        keys.push_back("speaker" + to_string(i % 977) + "/utterance_" + to_string(i * 7919));
+    }
+    return keys;
+}
+
+BOOST_AUTO_TEST_CASE(StringToIdMapAddAndLookup)
+{
+    StringToIdMap registry;
+    auto keys = CreateSequenceKeys(10000);
+
+    for (size_t i = 0; i < keys.size(); ++i)
+    {
+        BOOST_REQUIRE_EQUAL(i, registry[keys[i]]);
+    }
+
+    // Ids are stable, adding existing values does not change them.
+    for (size_t i = 0; i < keys.size(); ++i)
+    {
+        BOOST_REQUIRE_EQUAL(i, registry.AddValue(keys[i]));
+        size_t id;
+        BOOST_REQUIRE(registry.TryGet(keys[i], id));
+        BOOST_REQUIRE_EQUAL(i, id);
+        BOOST_REQUIRE_EQUAL(keys[i], registry[i]);
+    }
+
+    BOOST_CHECK_EQUAL(keys.size(), registry.Size());
+    BOOST_CHECK(!registry.Contains("speaker0/utterance_1"));
+    BOOST_CHECK(!registry.Contains(""));
+    BOOST_CHECK_EQUAL(keys.size(), registry[""]);
+    BOOST_CHECK(registry.Contains(""));
+    BOOST_CHECK_EQUAL("", registry[keys.size()]);
+}
+
+BOOST_AUTO_TEST_CASE(StringToIdMapBulkInsert)
+{
+    StringToIdMap registry;
+    registry[string("first")];
+
+    auto keys = CreateSequenceKeys(10000);
+    keys.push_back("first");
+    keys.push_back(keys.front());
+
+    vector<size_t> ids;
+    registry.AddValues(keys, ids);
+    BOOST_REQUIRE_EQUAL(keys.size(), ids.size());
+    for (size_t i = 0; i + 2 < keys.size(); ++i)
+    {
+        BOOST_REQUIRE_EQUAL(i + 1, ids[i]);
+    }
+
+    BOOST_CHECK_EQUAL(0, ids[keys.size() - 2]);
+    BOOST_CHECK_EQUAL(1, ids[keys.size() - 1]);
+    BOOST_CHECK_EQUAL(keys.size() - 1, registry.Size());
+}
+
+// The registry stores the characters of all values in a single arena instead of a string per value.
+BOOST_AUTO_TEST_CASE(StringToIdMapArenaMemory)
+{
+    auto keys = CreateSequenceKeys(100000);
+    size_t numberOfCharacters = 0;
+    for (const auto& key : keys)
+    {
+        numberOfCharacters += key.size();
+    }
+
+    // Bulk insertion reserves everything up front: the characters, an offset per value
+    // and the smallest power of two index that is at most 3/4 full.
+    StringToIdMap registry;
+    vector<size_t> ids;
+    registry.AddValues(keys, ids);
+    size_t indexSize = 64;
+    while (keys.size() * 4 > indexSize * 3)
+    {
+        indexSize *= 2;
+    }
+    const size_t slotSize = 2 * sizeof(uint32_t);
+    BOOST_CHECK_EQUAL(numberOfCharacters + (keys.size() + 1) * sizeof(size_t) + indexSize * slotSize, registry.GetMemoryUsage());
+
+    // Looking up and adding existing values does not allocate.
+    size_t memoryUsage = registry.GetMemoryUsage();
+    for (size_t i = 0; i < keys.size(); ++i)
+    {
+        size_t id;
+        BOOST_REQUIRE(registry.TryGet(keys[i], id));
+        BOOST_REQUIRE_EQUAL(ids[i], id);
+        BOOST_REQUIRE_EQUAL(ids[i], registry.AddValue(keys[i]));
+        BOOST_REQUIRE_EQUAL(keys[i], registry[id]);
+    }
+    BOOST_CHECK_EQUAL(memoryUsage, registry.GetMemoryUsage());
+
+    // Less than a node based map of the same keys: a tree node with the value and the string buffer,
+    // if the string does not fit the small string buffer.
+    size_t mapMemory = 0;
+    for (const auto& key : keys)
+    {
+        mapMemory += 4 * sizeof(void*) + sizeof(pair<const string, size_t>) + (key.size() >= 16 ? key.size() + 1 : 0);
+    }
+    BOOST_CHECK_LT(registry.GetMemoryUsage(), mapMemory);
+
+    // Wide strings keep their characters in the arena as well.
+    WStringToIdMap wideRegistry;
+    wideRegistry.AddValue(L"speaker1/utterance_1");
+    wideRegistry.AddValue(L"");
+    wideRegistry.AddValue(L"speaker1/utterance_1");
+    BOOST_CHECK_EQUAL(2, wideRegistry.Size());
+    BOOST_CHECK(wideRegistry[0] == L"speaker1/utterance_1");
+    BOOST_CHECK(wideRegistry[1] == L"");
+    BOOST_CHECK(wideRegistry[wstring(L"speaker1/utterance_1")] == 0);
+}
+
 BOOST_AUTO_TEST_SUITE_END()
 
 } } } }
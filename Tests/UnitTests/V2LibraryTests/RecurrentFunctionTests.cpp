@@ -471,8 +471,89 @@ void TestSimpleRecurrence(size_t inputDim,
     }
 }
 
+// The valid frames of each sequence of the output of 'func' for the given input sequences
+template <typename ElementType>
+std::vector<std::vector<ElementType>> EvaluateSequences(const FunctionPtr& func, const Variable& inputVar, const std::vector<std::vector<ElementType>>& inputSequences, const DeviceDescriptor& device)
+{
+    size_t inputDim = inputVar.Shape().TotalSize();
+    ValuePtr inputValue = Value::Create(inputVar.Shape(), inputSequences, device, true);
+    std::unordered_map<Variable, ValuePtr> outputs = { { func->Output(), nullptr } };
+    func->Forward({ { inputVar, inputValue } }, outputs, device);
+
+    ValuePtr outputValue = outputs[func->Output()];
+    NDShape outputShape = outputValue->Data()->Shape();
+    std::vector<ElementType> outputData(outputShape.TotalSize());
+    NDArrayViewPtr cpuArrayView = MakeSharedObject<NDArrayView>(outputShape, outputData.data(), outputData.size(), DeviceDescriptor::CPUDevice(), false);
+    cpuArrayView->CopyFrom(*outputValue->Data());
+
+    size_t outputDim = func->Output().Shape().TotalSize();
+    size_t maxSequenceLength = outputShape[outputShape.NumAxes() - 2];
+    std::vector<std::vector<ElementType>> outputSequences;
+    for (size_t i = 0; i < inputSequences.size(); ++i)
+    {
+        auto sequenceBegin = outputData.begin() + (i * maxSequenceLength * outputDim);
+        outputSequences.push_back(std::vector<ElementType>(sequenceBegin, sequenceBegin + ((inputSequences[i].size() / inputDim) * outputDim)));
+    }
+
+    return outputSequences;
+}
+
+template <typename ElementType>
+void TestPackingCache(const DeviceDescriptor& device)
+{
+    const size_t inputDim = 3;
+    const size_t outputDim = 2;
+
+    Parameter timesParam(NDArrayView::RandomUniform<ElementType>({ outputDim, inputDim }, -0.5, 0.5, seed++, device));
+    Variable inputVar({ inputDim }, AsDataType<ElementType>(), L"input");
+    auto placeholder = Placeholder({ outputDim });
+    auto plusOutput = Plus(placeholder, Times(timesParam, inputVar));
+    plusOutput = plusOutput->ReplacePlaceholders({ { placeholder, PastValue(Constant({}, (ElementType)0.0, device), plusOutput, 1) } });
+
+    // Several sequences of different lengths need packing, gather and scatter indices
+    std::vector<size_t> sequenceLengths = { 3, 5, 2, 5 };
+    srand(1);
+    std::vector<std::vector<ElementType>> inputSequences;
+    for (size_t i = 0; i < sequenceLengths.size(); ++i)
+    {
+        std::vector<ElementType> currentSequence(inputDim * sequenceLengths[i]);
+        for (size_t j = 0; j < currentSequence.size(); ++j)
+            currentSequence[j] = ((ElementType)rand()) / RAND_MAX;
+
+        inputSequences.push_back(std::move(currentSequence));
+    }
+
+    auto freshOutputs = EvaluateSequences(plusOutput, inputVar, inputSequences, device);
+    auto statistics = GetPackingCacheStatistics();
+
+    // The same sequence lengths again: the packed layout and the gather and scatter indices are taken from the caches
+    auto cachedOutputs = EvaluateSequences(plusOutput, inputVar, inputSequences, device);
+    auto cachedStatistics = GetPackingCacheStatistics();
+    if ((cachedStatistics.m_numMisses != statistics.m_numMisses) || (cachedStatistics.m_numHits < statistics.m_numHits + 3))
+        throw std::runtime_error("TestPackingCache: Repeated sequence lengths were not found in the packing caches");
+
+    if (cachedOutputs != freshOutputs)
+        throw std::runtime_error("TestPackingCache: Results with cached packing differ from the results with fresh packing");
+
+    // Changed sequence lengths must not hit the entries of the earlier ones
+    inputSequences[1].resize(inputDim * (sequenceLengths[1] - 1));
+    auto changedOutputs = EvaluateSequences(plusOutput, inputVar, inputSequences, device);
+    if (GetPackingCacheStatistics().m_numMisses == cachedStatistics.m_numMisses)
+        throw std::runtime_error("TestPackingCache: Changed sequence lengths were found in the packing caches");
+
+    // The recurrence is per sequence, so the shortened sequence produces the first frames of its earlier output
+    freshOutputs[1].resize(changedOutputs[1].size());
+    for (size_t i = 0; i < sequenceLengths.size(); ++i)
+        FloatingPointVectorCompare(changedOutputs[i], freshOutputs[i], "TestPackingCache: Results for changed sequence lengths do not match expected results");
+}
+
 void RecurrentFunctionTests()
 {
+    TestPackingCache<float>(DeviceDescriptor::CPUDevice());
+#ifndef CPUONLY
+    TestPackingCache<double>(DeviceDescriptor::GPUDevice(0));
+#endif
+
     TestSimpleRecurrence<float>(2, 1, 4, 1, DeviceDescriptor::CPUDevice(), 3, false, false);
 #ifndef CPUONLY
     TestSimpleRecurrence<double>(11, 9, 16, 7, DeviceDescriptor::GPUDevice(0), 5, true, false);